@@ -0,0 +1,20 @@
+# Checks scripts/compare_benchmarks.py on a result file of soatlbenchsuite (RESULTS) :
+# comparing the file with itself must pass, comparing it with a slower copy must report regressions.
+
+execute_process(COMMAND ${SOATL_PYTHON} ${COMPARE_SCRIPT} ${RESULTS} ${RESULTS} RESULT_VARIABLE status OUTPUT_VARIABLE output)
+if(NOT status EQUAL 0)
+  message(FATAL_ERROR "identical results reported as regressions :\n${output}")
+endif()
+
+# prepending a 1 to every median at least doubles it
+file(READ ${RESULTS} content)
+string(REGEX REPLACE "\"median_ns\": ([0-9])" "\"median_ns\": 1\\1" content "${content}")
+get_filename_component(name ${RESULTS} NAME_WE)
+set(SLOWER ${CMAKE_CURRENT_BINARY_DIR}/${name}_slower.json)
+file(WRITE ${SLOWER} "${content}")
+
+execute_process(COMMAND ${SOATL_PYTHON} ${COMPARE_SCRIPT} ${RESULTS} ${SLOWER} RESULT_VARIABLE status OUTPUT_VARIABLE output)
+message("${output}")
+if(status EQUAL 0 OR NOT output MATCHES "REGRESSION")
+  message(FATAL_ERROR "slower results not reported as regressions")
+endif()
@@ -1,44 +1,130 @@
-message("Analysing ${BINARY_FILE} ...")
+# Vectorization report of the kernels of a binary.
+# Instructions are attributed to kernels through function names : a function whose (demangled) name contains MARKER
+# (default vecreport_), or one outlined from it (OpenMP regions, lambdas), belongs to the kernel named after the marker,
+# e.g. vecreport_compute<soatl::PackedFieldArrays<...>,...> -> compute/PackedFieldArrays.
+# For each kernel, floating point arithmetic instructions are counted as packed or scalar, and the widest packed register is noted.
+# Results are printed and written to REPORT_FILE (default BINARY_FILE.vecreport) as lines "kernel width packed scalar packed_per_mille".
+# When BASELINE_FILE is given, entries "ISA NAME kernel width packed_per_mille" of that file are checked :
+# the script fails if a kernel is missing, uses narrower vectors, or its packed ratio drops by more than TOLERANCE per mille (default 50).
+# When EQUAL_KERNELS is given as "a=b,c=d", kernel a must use the same vector width and as many packed and scalar instructions as kernel b, and so on.
 
-execute_process(COMMAND ${SOATL_OBJDUMP} -D ${BINARY_FILE} OUTPUT_FILE ${BINARY_FILE}.asm OUTPUT_QUIET ERROR_QUIET)
+message("Analysing ${BINARY_FILE} ...")
 
-file(STRINGS ${BINARY_FILE}.asm BINARRY_ASSEMBLY)
+if(NOT MARKER)
+  set(MARKER vecreport_)
+endif()
+if(NOT REPORT_FILE)
+  set(REPORT_FILE ${BINARY_FILE}.vecreport)
+endif()
+if(NOT TOLERANCE)
+  set(TOLERANCE 50)
+endif()
 
-set(INSLIST vmov vmovapd vmovaps vmovupd vmovups sqrt vsqrtpd vrsqrtpd vsqrtps vrsqrtps vsqrtsd vrsqrtsd vsqrtss vrsqrtss vfmadd132sd vfmadd132pd vfmadd132ss vfmadd132ps)
+execute_process(COMMAND ${SOATL_OBJDUMP} -d -C --no-show-raw-insn ${BINARY_FILE} OUTPUT_FILE ${BINARY_FILE}.asm ERROR_QUIET)
 
-set(mova vmovapd vmovaps)
-set(movu vmovupd vmovups)
-set(sqrtp vsqrtpd vrsqrtpd vsqrtps vrsqrtps)
-set(sqrts vsqrtsd vrsqrtsd vsqrtss vrsqrtss)
-set(fmas vfmadd132sd vfmadd132ss)
-set(fmap vfmadd132pd vfmadd132ps)
-set(fma vfmadd132sd vfmadd132ss vfmadd132pd vfmadd132ps)
-set(INSSUM mova movu sqrtp sqrts fmas fmap)
+# function headers ("0000000000401136 <name>:") and instructions ("  401136:	vmulpd %zmm1,%zmm2,%zmm3")
+file(STRINGS ${BINARY_FILE}.asm BINARY_ASSEMBLY REGEX "^[0-9a-f]+ <.*>:$|^ +[0-9a-f]+:")
 
-set(INSREPORT mova movu sqrtp sqrts fmap fmas)
+set(KERNELS "")
+set(KERNEL "")
+foreach(line ${BINARY_ASSEMBLY})
+  if(line MATCHES "^[0-9a-f]+ <(.*)>:$")
+    set(KERNEL "")
+    set(func "${CMAKE_MATCH_1}")
+    if(func MATCHES "${MARKER}([A-Za-z0-9_]+)<soatl::([A-Za-z]+)<")
+      set(KERNEL "${CMAKE_MATCH_1}/${CMAKE_MATCH_2}")
+    elseif(func MATCHES "${MARKER}([A-Za-z0-9_]+)")
+      set(KERNEL "${CMAKE_MATCH_1}")
+    endif()
+    if(KERNEL)
+      string(MAKE_C_IDENTIFIER "${KERNEL}" KID)
+      if(NOT ";${KERNELS};" MATCHES ";${KERNEL};")
+        list(APPEND KERNELS "${KERNEL}")
+        set(${KID}_packed 0)
+        set(${KID}_scalar 0)
+        set(${KID}_width 0)
+      endif()
+    endif()
+  elseif(KERNEL AND line MATCHES "^ +[0-9a-f]+:[ \t]+([a-z0-9]+)[ \t]*(.*)$")
+    set(ins "${CMAKE_MATCH_1}")
+    set(operands "${CMAKE_MATCH_2}")
+    if(ins MATCHES "^v?(add|sub|mul|div|sqrt|rsqrt|rsqrt14|rcp|rcp14|max|min|fn?madd[0-9]*|fn?msub[0-9]*|fmaddsub[0-9]*|fmsubadd[0-9]*)([ps])[sd]$")
+      if(CMAKE_MATCH_2 STREQUAL "p")
+        math(EXPR ${KID}_packed "${${KID}_packed}+1")
+        set(width 128)
+        if(operands MATCHES "%zmm")
+          set(width 512)
+        elseif(operands MATCHES "%ymm")
+          set(width 256)
+        endif()
+        if(width GREATER ${${KID}_width})
+          set(${KID}_width ${width})
+        endif()
+      else()
+        math(EXPR ${KID}_scalar "${${KID}_scalar}+1")
+      endif()
+    endif()
+  endif()
+endforeach()
 
-foreach(ins ${INSLIST})
-  set(${ins} 0)
+set(REPORT "")
+foreach(kernel ${KERNELS})
+  string(MAKE_C_IDENTIFIER "${kernel}" KID)
+  math(EXPR total "${${KID}_packed}+${${KID}_scalar}")
+  set(${KID}_ratio 0)
+  if(total GREATER 0)
+    math(EXPR ${KID}_ratio "${${KID}_packed}*1000/${total}")
+  endif()
+  message("${kernel} : width=${${KID}_width} packed=${${KID}_packed} scalar=${${KID}_scalar} packed/total=${${KID}_ratio}/1000")
+  string(APPEND REPORT "${kernel} ${${KID}_width} ${${KID}_packed} ${${KID}_scalar} ${${KID}_ratio}\n")
 endforeach()
+file(WRITE ${REPORT_FILE} "${REPORT}")
 
-foreach(line ${BINARRY_ASSEMBLY})
-  foreach(ins ${INSLIST})
-    if(${line} MATCHES ".*${ins}.*")
-      math(EXPR ${ins} ${${ins}}+1)
+if(BASELINE_FILE)
+  file(STRINGS ${BASELINE_FILE} BASELINE REGEX "^${ISA} ${NAME} ")
+  if(NOT BASELINE)
+    message("no baseline for ${ISA} ${NAME}")
+  endif()
+  set(ERRORS "")
+  foreach(entry ${BASELINE})
+    string(REPLACE " " ";" fields "${entry}")
+    list(GET fields 2 kernel)
+    list(GET fields 3 base_width)
+    list(GET fields 4 base_ratio)
+    string(MAKE_C_IDENTIFIER "${kernel}" KID)
+    if(NOT ";${KERNELS};" MATCHES ";${kernel};")
+      string(APPEND ERRORS "  ${kernel} : not found\n")
+    else()
+      if(${KID}_width LESS base_width)
+        string(APPEND ERRORS "  ${kernel} : vector width ${${KID}_width}, baseline ${base_width}\n")
+      endif()
+      math(EXPR min_ratio "${base_ratio}-${TOLERANCE}")
+      if(${KID}_ratio LESS min_ratio)
+        string(APPEND ERRORS "  ${kernel} : packed ratio ${${KID}_ratio}/1000, baseline ${base_ratio}/1000\n")
+      endif()
     endif()
   endforeach()
-endforeach()
+  if(ERRORS)
+    message(FATAL_ERROR "vectorization regressions in ${BINARY_FILE} (${ISA} ${NAME}) :\n${ERRORS}")
+  endif()
+endif()
 
-foreach(tosum ${INSSUM})
-  set(tmplist ${${tosum}})
-  set(${tosum} 0)
-  foreach(ins ${tmplist})
-    math(EXPR ${tosum} ${${tosum}}+${${ins}})
+if(EQUAL_KERNELS)
+  string(REPLACE "," ";" pairs "${EQUAL_KERNELS}")
+  set(ERRORS "")
+  foreach(pair ${pairs})
+    string(REPLACE "=" ";" pair "${pair}")
+    list(GET pair 0 ka)
+    list(GET pair 1 kb)
+    string(MAKE_C_IDENTIFIER "${ka}" KA)
+    string(MAKE_C_IDENTIFIER "${kb}" KB)
+    if(NOT ";${KERNELS};" MATCHES ";${ka};" OR NOT ";${KERNELS};" MATCHES ";${kb};")
+      string(APPEND ERRORS "  ${ka} / ${kb} : not found\n")
+    elseif(NOT ${KA}_width EQUAL ${KB}_width OR NOT ${KA}_packed EQUAL ${KB}_packed OR NOT ${KA}_scalar EQUAL ${KB}_scalar)
+      string(APPEND ERRORS "  ${ka} : width=${${KA}_width} packed=${${KA}_packed} scalar=${${KA}_scalar}, ${kb} : width=${${KB}_width} packed=${${KB}_packed} scalar=${${KB}_scalar}\n")
+    endif()
   endforeach()
-endforeach()
-
-foreach(ins ${INSREPORT})
-  message("${ins} ${${ins}}")
-endforeach()
-
-
+  if(ERRORS)
+    message(FATAL_ERROR "kernels differ in ${BINARY_FILE} :\n${ERRORS}")
+  endif()
+endif()
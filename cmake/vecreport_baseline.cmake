@@ -0,0 +1,37 @@
+# Rewrites the entries of instruction set ISA in BASELINE_FILE from the reports (soatlbenchmark_<name>.vecreport)
+# found in REPORT_DIR, keeping comments and entries of other instruction sets.
+
+file(GLOB REPORTS ${REPORT_DIR}/soatlbenchmark_*.vecreport)
+list(SORT REPORTS)
+
+set(CONTENT "")
+if(EXISTS ${BASELINE_FILE})
+  file(STRINGS ${BASELINE_FILE} LINES)
+  foreach(line ${LINES})
+    if(NOT line MATCHES "^${ISA} ")
+      string(APPEND CONTENT "${line}\n")
+    endif()
+  endforeach()
+endif()
+
+set(NEW_ENTRIES "")
+foreach(report ${REPORTS})
+  get_filename_component(name ${report} NAME)
+  string(REGEX REPLACE "^soatlbenchmark_(.*)\\.vecreport$" "\\1" name "${name}")
+  file(STRINGS ${report} ENTRIES)
+  foreach(entry ${ENTRIES})
+    # kernel width packed scalar ratio -> ISA name kernel width ratio
+    string(REPLACE " " ";" fields "${entry}")
+    list(GET fields 0 kernel)
+    list(GET fields 1 width)
+    list(GET fields 4 ratio)
+    list(APPEND NEW_ENTRIES "${ISA} ${name} ${kernel} ${width} ${ratio}")
+  endforeach()
+endforeach()
+list(SORT NEW_ENTRIES)
+foreach(entry ${NEW_ENTRIES})
+  string(APPEND CONTENT "${entry}\n")
+endforeach()
+
+file(WRITE ${BASELINE_FILE} "${CONTENT}")
+message("updated ${ISA} entries of ${BASELINE_FILE}")
@@ -0,0 +1,238 @@
+#pragma once
+
+/*
+Optional allocation and copy statistics of field containers, enabled when SOATL_ALLOC_STATS is defined.
+Counted globally and per container type :
+	allocations, frees                   storage allocations and releases (one per field for FieldArrays)
+	live_bytes, peak_bytes               allocated storage, current and maximum
+	live_padding, peak_padding           alignment padding between the field stripes of packed containers (FieldArrays has none)
+	live_slack, peak_slack               storage of the elements between size and capacity, summed over fields (chunk slack)
+	reallocation_copies, ..._bytes       element moves done by reallocate when a non empty container changes capacity
+	copies, copy_bytes                   non empty soatl::copy calls (reallocate of packed containers included), counted for the destination type
+Query with alloc_stats() (global) or alloc_stats<ContainerT>(), print with alloc_registry().print(out).
+A summary is printed to stderr at exit, unless alloc_registry().dump_at_exit is cleared.
+When SOATL_ALLOC_STATS is not defined, the SOATL_ALLOC_STATS_* macros used by containers expand to nothing.
+*/
+
+#ifdef SOATL_ALLOC_STATS
+
+#include <cstdlib> // for size_t, std::atexit, std::free
+#include <atomic>
+#include <string>
+#include <map>
+#include <mutex>
+#include <typeinfo>
+#include <iostream>
+#include <iomanip>
+#include <cxxabi.h>
+
+namespace soatl
+{
+
+struct AllocStats
+{
+	size_t allocations = 0;
+	size_t frees = 0;
+	size_t live_bytes = 0;
+	size_t peak_bytes = 0;
+	size_t live_padding = 0;
+	size_t peak_padding = 0;
+	size_t live_slack = 0;
+	size_t peak_slack = 0;
+	size_t reallocation_copies = 0;
+	size_t reallocation_copy_bytes = 0;
+	size_t copies = 0;
+	size_t copy_bytes = 0;
+};
+
+struct AllocCounters
+{
+	std::atomic<size_t> allocations {0};
+	std::atomic<size_t> frees {0};
+	std::atomic<size_t> live_bytes {0};
+	std::atomic<size_t> peak_bytes {0};
+	std::atomic<size_t> live_padding {0};
+	std::atomic<size_t> peak_padding {0};
+	std::atomic<size_t> live_slack {0};
+	std::atomic<size_t> peak_slack {0};
+	std::atomic<size_t> reallocation_copies {0};
+	std::atomic<size_t> reallocation_copy_bytes {0};
+	std::atomic<size_t> copies {0};
+	std::atomic<size_t> copy_bytes {0};
+
+	static inline void update_peak( std::atomic<size_t>& peak, size_t value )
+	{
+		size_t p = peak.load( std::memory_order_relaxed );
+		while( value > p && ! peak.compare_exchange_weak( p, value, std::memory_order_relaxed ) ) {}
+	}
+
+	inline void allocate( size_t bytes, size_t padding )
+	{
+		allocations.fetch_add( 1, std::memory_order_relaxed );
+		update_peak( peak_bytes, live_bytes.fetch_add( bytes, std::memory_order_relaxed ) + bytes );
+		update_peak( peak_padding, live_padding.fetch_add( padding, std::memory_order_relaxed ) + padding );
+	}
+
+	inline void release( size_t bytes, size_t padding )
+	{
+		frees.fetch_add( 1, std::memory_order_relaxed );
+		live_bytes.fetch_sub( bytes, std::memory_order_relaxed );
+		live_padding.fetch_sub( padding, std::memory_order_relaxed );
+	}
+
+	// a container's slack changes on every resize
+	inline void slack( size_t old_bytes, size_t new_bytes )
+	{
+		update_peak( peak_slack, live_slack.fetch_add( new_bytes, std::memory_order_relaxed ) + new_bytes - old_bytes );
+		live_slack.fetch_sub( old_bytes, std::memory_order_relaxed );
+	}
+
+	inline void reallocation_copy( size_t bytes )
+	{
+		reallocation_copies.fetch_add( 1, std::memory_order_relaxed );
+		reallocation_copy_bytes.fetch_add( bytes, std::memory_order_relaxed );
+	}
+
+	inline void copy( size_t bytes )
+	{
+		copies.fetch_add( 1, std::memory_order_relaxed );
+		copy_bytes.fetch_add( bytes, std::memory_order_relaxed );
+	}
+
+	inline AllocStats snapshot() const
+	{
+		AllocStats s;
+		s.allocations = allocations.load();
+		s.frees = frees.load();
+		s.live_bytes = live_bytes.load();
+		s.peak_bytes = peak_bytes.load();
+		s.live_padding = live_padding.load();
+		s.peak_padding = peak_padding.load();
+		s.live_slack = live_slack.load();
+		s.peak_slack = peak_slack.load();
+		s.reallocation_copies = reallocation_copies.load();
+		s.reallocation_copy_bytes = reallocation_copy_bytes.load();
+		s.copies = copies.load();
+		s.copy_bytes = copy_bytes.load();
+		return s;
+	}
+
+	// clears event counts, peaks restart from the live footprint
+	inline void reset()
+	{
+		allocations = 0;
+		frees = 0;
+		peak_bytes = live_bytes.load();
+		peak_padding = live_padding.load();
+		peak_slack = live_slack.load();
+		reallocation_copies = 0;
+		reallocation_copy_bytes = 0;
+		copies = 0;
+		copy_bytes = 0;
+	}
+};
+
+struct AllocRegistry
+{
+	std::mutex mutex;
+	AllocCounters global;
+	std::map<std::string,AllocCounters*> types; // never freed, referenced by alloc_counters<T>()
+	bool dump_at_exit = true;
+
+	inline AllocCounters& type_counters( const std::string& name )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		AllocCounters*& c = types[name];
+		if( c == nullptr ) { c = new AllocCounters(); }
+		return *c;
+	}
+
+	inline void reset()
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		global.reset();
+		for(auto& t : types) { t.second->reset(); }
+	}
+
+	// one line per container type and a total line, sizes in KiB
+	inline void print( std::ostream& out )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		const AllocStats total = global.snapshot();
+		if( total.allocations == 0 && total.copies == 0 ) { return; }
+		const auto f = out.flags();
+		const auto p = out.precision();
+		out << std::right << std::setw(8) << "allocs" << std::setw(8) << "frees" << std::setw(12) << "live KiB" << std::setw(12) << "peak KiB"
+		    << std::setw(12) << "padding KiB" << std::setw(9) << "padding%" << std::setw(12) << "slack KiB" << std::setw(10) << "reallocs" << std::setw(14) << "realloc KiB"
+		    << std::setw(10) << "copies" << std::setw(14) << "copy KiB" << "  container\n" << std::fixed << std::setprecision(1);
+		auto line = [&out]( const AllocStats& s, const std::string& name )
+		{
+			out << std::setw(8) << s.allocations << std::setw(8) << s.frees << std::setw(12) << s.live_bytes/1024.0 << std::setw(12) << s.peak_bytes/1024.0
+			    << std::setw(12) << s.peak_padding/1024.0 << std::setw(9) << ( s.peak_bytes>0 ? 100.0*s.peak_padding/s.peak_bytes : 0.0 ) << std::setw(12) << s.peak_slack/1024.0
+			    << std::setw(10) << s.reallocation_copies << std::setw(14) << s.reallocation_copy_bytes/1024.0
+			    << std::setw(10) << s.copies << std::setw(14) << s.copy_bytes/1024.0 << "  " << name << '\n';
+		};
+		for(const auto& t : types) { line( t.second->snapshot(), t.first ); }
+		line( total, "total" );
+		out.flags( f );
+		out.precision( p );
+	}
+};
+
+// never destroyed, so that containers destroyed at exit are still counted. the summary is printed by an exit handler.
+inline AllocRegistry& alloc_registry()
+{
+	static AllocRegistry* registry = []()
+	{
+		std::atexit( []() { if( alloc_registry().dump_at_exit ) { alloc_registry().print( std::cerr ); } } );
+		return new AllocRegistry();
+	}();
+	return *registry;
+}
+
+template<typename ContainerT>
+inline std::string alloc_stats_type_name()
+{
+	int status = 0;
+	char* demangled = abi::__cxa_demangle( typeid(ContainerT).name(), nullptr, nullptr, &status );
+	std::string name = ( status == 0 && demangled != nullptr ) ? demangled : typeid(ContainerT).name();
+	std::free( demangled );
+	for(size_t pos=name.find("soatl::"); pos!=std::string::npos; pos=name.find("soatl::",pos)) { name.erase( pos, 7 ); }
+	return name;
+}
+
+template<typename ContainerT>
+inline AllocCounters& alloc_counters()
+{
+	static AllocCounters& counters = alloc_registry().type_counters( alloc_stats_type_name<ContainerT>() );
+	return counters;
+}
+
+inline AllocStats alloc_stats() { return alloc_registry().global.snapshot(); }
+
+template<typename ContainerT>
+inline AllocStats alloc_stats() { return alloc_counters<ContainerT>().snapshot(); }
+
+template<typename ContainerT> inline void alloc_stats_allocate( size_t bytes, size_t padding ) { alloc_registry().global.allocate( bytes, padding ); alloc_counters<ContainerT>().allocate( bytes, padding ); }
+template<typename ContainerT> inline void alloc_stats_release( size_t bytes, size_t padding ) { alloc_registry().global.release( bytes, padding ); alloc_counters<ContainerT>().release( bytes, padding ); }
+template<typename ContainerT> inline void alloc_stats_slack( size_t old_bytes, size_t new_bytes ) { alloc_registry().global.slack( old_bytes, new_bytes ); alloc_counters<ContainerT>().slack( old_bytes, new_bytes ); }
+template<typename ContainerT> inline void alloc_stats_reallocation_copy( size_t bytes ) { alloc_registry().global.reallocation_copy( bytes ); alloc_counters<ContainerT>().reallocation_copy( bytes ); }
+template<typename ContainerT> inline void alloc_stats_copy( size_t bytes ) { alloc_registry().global.copy( bytes ); alloc_counters<ContainerT>().copy( bytes ); }
+
+} // namespace soatl
+
+#define SOATL_ALLOC_STATS_ALLOCATE(ContainerT,bytes,padding) ::soatl::alloc_stats_allocate<ContainerT>( bytes, padding )
+#define SOATL_ALLOC_STATS_RELEASE(ContainerT,bytes,padding) ::soatl::alloc_stats_release<ContainerT>( bytes, padding )
+#define SOATL_ALLOC_STATS_SLACK(ContainerT,old_bytes,new_bytes) ::soatl::alloc_stats_slack<ContainerT>( old_bytes, new_bytes )
+#define SOATL_ALLOC_STATS_REALLOCATION_COPY(ContainerT,bytes) ::soatl::alloc_stats_reallocation_copy<ContainerT>( bytes )
+#define SOATL_ALLOC_STATS_COPY(ContainerT,bytes) ::soatl::alloc_stats_copy<ContainerT>( bytes )
+
+#else
+
+#define SOATL_ALLOC_STATS_ALLOCATE(ContainerT,bytes,padding) do{}while(0)
+#define SOATL_ALLOC_STATS_RELEASE(ContainerT,bytes,padding) do{}while(0)
+#define SOATL_ALLOC_STATS_SLACK(ContainerT,old_bytes,new_bytes) do{}while(0)
+#define SOATL_ALLOC_STATS_REALLOCATION_COPY(ContainerT,bytes) do{}while(0)
+#define SOATL_ALLOC_STATS_COPY(ContainerT,bytes) do{}while(0)
+
+#endif
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstddef> // for offsetof
+#include <cstring> // for std::memcpy
+#include <algorithm> // for std::min
+#include <type_traits>
+#include <utility> // for std::index_sequence
+#include <tuple>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/dirty_hooks.h"
+#include "soatl/instrument.h"
+#include "soatl/variadic_template_utils.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+Conversion between arrays of structures (AoS, e.g. struct Particle { double x,y,z; int type; } p[n]) and field containers.
+Members are mapped to fields at compile time with SOATL_AOS_MEMBER(Struct,member,field) :
+	soatl::import_aos( arrays, p, n, SOATL_AOS_MEMBER(Particle,x,particle_rx), SOATL_AOS_MEMBER(Particle,y,particle_ry), SOATL_AOS_MEMBER(Particle,z,particle_rz) );
+	soatl::export_aos( arrays, p, n, ...same members... );
+or at run time with a stride and member offsets in bytes :
+	soatl::import_aos( arrays, p, n, sizeof(Particle), offsets, particle_rx, particle_ry, particle_rz );
+Elements [0,n) of the fields are written (import) or read (export), the container must hold at least n elements.
+When 3 or 4 members of the same floating point type are consecutive in the structure, in this order, groups of structures are
+loaded as whole vectors and transposed in registers (SSE2 or AVX). Other member lists are gathered element by element,
+mixed structures are best converted with one call per group of consecutive members.
+parallel_import_aos and parallel_export_aos distribute blocks of AOS_BLOCK_SIZE elements to OpenMP threads.
+*/
+
+namespace soatl
+{
+
+template<typename S, size_t Offset, typename MemberT, typename id>
+struct AosMember
+{
+	static_assert( std::is_same< MemberT, typename FieldDescriptor<id>::value_type >::value, "member and field types differ" );
+	static constexpr size_t offset = Offset;
+	static constexpr size_t stride = sizeof(S);
+};
+
+#define SOATL_AOS_MEMBER(S,m,field) ::soatl::AosMember< S, offsetof(S,m), decltype(S::m), std::decay<decltype(field)>::type::Id >()
+
+static constexpr size_t AOS_BLOCK_SIZE = 1<<12;
+
+// in register transposition of groups of structures holding K consecutive members of type T.
+// width is the number of structures per group, 0 when there is no vector implementation.
+template<typename T, size_t K> struct AosTranspose { static constexpr size_t width = 0; };
+
+#if defined(__AVX__)
+
+template<size_t K>
+struct AosTransposeDouble
+{
+	static constexpr size_t width = 4;
+
+	static inline __m256i mask() { return _mm256_set_epi64x( K>3 ? -1 : 0, -1, -1, -1 ); }
+
+	static inline void import( const char* p, size_t stride, double* const* dst, size_t i )
+	{
+		const __m256i m = mask();
+		const __m256d r0 = _mm256_maskload_pd( reinterpret_cast<const double*>( p ), m );
+		const __m256d r1 = _mm256_maskload_pd( reinterpret_cast<const double*>( p + stride ), m );
+		const __m256d r2 = _mm256_maskload_pd( reinterpret_cast<const double*>( p + 2*stride ), m );
+		const __m256d r3 = _mm256_maskload_pd( reinterpret_cast<const double*>( p + 3*stride ), m );
+		const __m256d t0 = _mm256_unpacklo_pd( r0, r1 ); // x0 x1 z0 z1
+		const __m256d t1 = _mm256_unpackhi_pd( r0, r1 ); // y0 y1 w0 w1
+		const __m256d t2 = _mm256_unpacklo_pd( r2, r3 );
+		const __m256d t3 = _mm256_unpackhi_pd( r2, r3 );
+		_mm256_storeu_pd( dst[0]+i, _mm256_permute2f128_pd( t0, t2, 0x20 ) );
+		_mm256_storeu_pd( dst[1]+i, _mm256_permute2f128_pd( t1, t3, 0x20 ) );
+		_mm256_storeu_pd( dst[2]+i, _mm256_permute2f128_pd( t0, t2, 0x31 ) );
+		if( K > 3 ) { _mm256_storeu_pd( dst[K-1]+i, _mm256_permute2f128_pd( t1, t3, 0x31 ) ); }
+	}
+
+	static inline void export_( char* p, size_t stride, const double* const* src, size_t i )
+	{
+		const __m256i m = mask();
+		const __m256d x = _mm256_loadu_pd( src[0]+i );
+		const __m256d y = _mm256_loadu_pd( src[1]+i );
+		const __m256d z = _mm256_loadu_pd( src[2]+i );
+		const __m256d w = ( K > 3 ) ? _mm256_loadu_pd( src[K-1]+i ) : _mm256_setzero_pd();
+		const __m256d t0 = _mm256_permute2f128_pd( x, z, 0x20 ); // x0 x1 z0 z1
+		const __m256d t1 = _mm256_permute2f128_pd( y, w, 0x20 ); // y0 y1 w0 w1
+		const __m256d t2 = _mm256_permute2f128_pd( x, z, 0x31 );
+		const __m256d t3 = _mm256_permute2f128_pd( y, w, 0x31 );
+		_mm256_maskstore_pd( reinterpret_cast<double*>( p ), m, _mm256_unpacklo_pd( t0, t1 ) );
+		_mm256_maskstore_pd( reinterpret_cast<double*>( p + stride ), m, _mm256_unpackhi_pd( t0, t1 ) );
+		_mm256_maskstore_pd( reinterpret_cast<double*>( p + 2*stride ), m, _mm256_unpacklo_pd( t2, t3 ) );
+		_mm256_maskstore_pd( reinterpret_cast<double*>( p + 3*stride ), m, _mm256_unpackhi_pd( t2, t3 ) );
+	}
+};
+
+template<> struct AosTranspose<double,3> : public AosTransposeDouble<3> {};
+template<> struct AosTranspose<double,4> : public AosTransposeDouble<4> {};
+
+#elif defined(__SSE2__)
+
+template<size_t K>
+struct AosTransposeDouble
+{
+	static constexpr size_t width = 2;
+
+	// members 2 and 3 of a structure, member 3 only if K==4
+	static inline __m128d load_zw( const char* p ) { return ( K > 3 ) ? _mm_loadu_pd( reinterpret_cast<const double*>(p) + 2 ) : _mm_load_sd( reinterpret_cast<const double*>(p) + 2 ); }
+	static inline void store_zw( char* p, __m128d v )
+	{
+		if( K > 3 ) { _mm_storeu_pd( reinterpret_cast<double*>(p) + 2, v ); }
+		else { _mm_store_sd( reinterpret_cast<double*>(p) + 2, v ); }
+	}
+
+	static inline void import( const char* p, size_t stride, double* const* dst, size_t i )
+	{
+		const __m128d a0 = _mm_loadu_pd( reinterpret_cast<const double*>( p ) );
+		const __m128d a1 = _mm_loadu_pd( reinterpret_cast<const double*>( p + stride ) );
+		const __m128d b0 = load_zw( p );
+		const __m128d b1 = load_zw( p + stride );
+		_mm_storeu_pd( dst[0]+i, _mm_unpacklo_pd( a0, a1 ) );
+		_mm_storeu_pd( dst[1]+i, _mm_unpackhi_pd( a0, a1 ) );
+		_mm_storeu_pd( dst[2]+i, _mm_unpacklo_pd( b0, b1 ) );
+		if( K > 3 ) { _mm_storeu_pd( dst[K-1]+i, _mm_unpackhi_pd( b0, b1 ) ); }
+	}
+
+	static inline void export_( char* p, size_t stride, const double* const* src, size_t i )
+	{
+		const __m128d x = _mm_loadu_pd( src[0]+i );
+		const __m128d y = _mm_loadu_pd( src[1]+i );
+		const __m128d z = _mm_loadu_pd( src[2]+i );
+		const __m128d w = ( K > 3 ) ? _mm_loadu_pd( src[K-1]+i ) : _mm_setzero_pd();
+		_mm_storeu_pd( reinterpret_cast<double*>( p ), _mm_unpacklo_pd( x, y ) );
+		_mm_storeu_pd( reinterpret_cast<double*>( p + stride ), _mm_unpackhi_pd( x, y ) );
+		store_zw( p, _mm_unpacklo_pd( z, w ) );
+		store_zw( p + stride, _mm_unpackhi_pd( z, w ) );
+	}
+};
+
+template<> struct AosTranspose<double,3> : public AosTransposeDouble<3> {};
+template<> struct AosTranspose<double,4> : public AosTransposeDouble<4> {};
+
+#endif
+
+#if defined(__SSE2__)
+
+template<size_t K>
+struct AosTransposeFloat
+{
+	static constexpr size_t width = 4;
+
+	static inline __m128 load( const char* p )
+	{
+		const float* f = reinterpret_cast<const float*>( p );
+		if( K > 3 ) { return _mm_loadu_ps( f ); }
+		return _mm_movelh_ps( _mm_castsi128_ps( _mm_loadl_epi64( reinterpret_cast<const __m128i*>(f) ) ), _mm_load_ss( f + 2 ) );
+	}
+	static inline void store( char* p, __m128 v )
+	{
+		float* f = reinterpret_cast<float*>( p );
+		if( K > 3 ) { _mm_storeu_ps( f, v ); return; }
+		_mm_storel_epi64( reinterpret_cast<__m128i*>(f), _mm_castps_si128( v ) );
+		_mm_store_ss( f + 2, _mm_movehl_ps( v, v ) );
+	}
+
+	static inline void import( const char* p, size_t stride, float* const* dst, size_t i )
+	{
+		__m128 r0 = load( p );
+		__m128 r1 = load( p + stride );
+		__m128 r2 = load( p + 2*stride );
+		__m128 r3 = load( p + 3*stride );
+		_MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+		_mm_storeu_ps( dst[0]+i, r0 );
+		_mm_storeu_ps( dst[1]+i, r1 );
+		_mm_storeu_ps( dst[2]+i, r2 );
+		if( K > 3 ) { _mm_storeu_ps( dst[K-1]+i, r3 ); }
+	}
+
+	static inline void export_( char* p, size_t stride, const float* const* src, size_t i )
+	{
+		__m128 r0 = _mm_loadu_ps( src[0]+i );
+		__m128 r1 = _mm_loadu_ps( src[1]+i );
+		__m128 r2 = _mm_loadu_ps( src[2]+i );
+		__m128 r3 = ( K > 3 ) ? _mm_loadu_ps( src[K-1]+i ) : _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+		store( p, r0 );
+		store( p + stride, r1 );
+		store( p + 2*stride, r2 );
+		store( p + 3*stride, r3 );
+	}
+};
+
+template<> struct AosTranspose<float,3> : public AosTransposeFloat<3> {};
+template<> struct AosTranspose<float,4> : public AosTransposeFloat<4> {};
+
+#endif
+
+// one pass over the structures, member by member
+template<typename T>
+static inline T aos_load( const char* p ) { T v; std::memcpy( &v, p, sizeof(T) ); return v; }
+template<typename T>
+static inline void aos_store( char* p, T v ) { std::memcpy( p, &v, sizeof(T) ); }
+
+template<size_t... Is, typename... T>
+static inline void aos_import_gather( const char* aos, size_t stride, const size_t* offsets, size_t first, size_t count, std::index_sequence<Is...>, T* __restrict__ ... dst )
+{
+	for(size_t i=first;i<first+count;i++)
+	{
+		const char* p = aos + i * stride;
+		TEMPLATE_LIST_BEGIN
+			dst[i] = aos_load<T>( p + offsets[Is] )
+		TEMPLATE_LIST_END
+	}
+}
+
+template<size_t... Is, typename... T>
+static inline void aos_export_gather( char* aos, size_t stride, const size_t* offsets, size_t first, size_t count, std::index_sequence<Is...>, const T* __restrict__ ... src )
+{
+	for(size_t i=first;i<first+count;i++)
+	{
+		char* p = aos + i * stride;
+		TEMPLATE_LIST_BEGIN
+			aos_store<T>( p + offsets[Is], src[i] )
+		TEMPLATE_LIST_END
+	}
+}
+
+template<typename... ids>
+struct AosFields
+{
+	using T = typename std::tuple_element< 0, std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type;
+	static constexpr size_t K = sizeof...(ids);
+	static constexpr bool same_type = ! detail::any_of( { false, ! std::is_same< T, typename FieldDescriptor<ids>::value_type >::value ... } );
+	using Transpose = AosTranspose< T, same_type ? K : 0 >;
+
+	// members must also be consecutive, in field order
+	static inline bool transposable( const size_t* offsets )
+	{
+		if( Transpose::width == 0 ) { return false; }
+		for(size_t k=1;k<K;k++) { if( offsets[k] != offsets[0] + k * sizeof(T) ) { return false; } }
+		return true;
+	}
+};
+
+template<typename TransposeT, typename T>
+static inline size_t aos_import_transposed( const char* aos, size_t stride, size_t first, size_t count, T* const* dst, std::true_type )
+{
+	static constexpr size_t W = TransposeT::width;
+	size_t i = first;
+	for(; i+W<=first+count; i+=W) { TransposeT::import( aos + i * stride, stride, dst, i ); }
+	return i - first;
+}
+template<typename TransposeT, typename T>
+static inline size_t aos_import_transposed( const char*, size_t, size_t, size_t, T* const*, std::false_type ) { return 0; }
+
+template<typename TransposeT, typename T>
+static inline size_t aos_export_transposed( char* aos, size_t stride, size_t first, size_t count, const T* const* src, std::true_type )
+{
+	static constexpr size_t W = TransposeT::width;
+	size_t i = first;
+	for(; i+W<=first+count; i+=W) { TransposeT::export_( aos + i * stride, stride, src, i ); }
+	return i - first;
+}
+template<typename TransposeT, typename T>
+static inline size_t aos_export_transposed( char*, size_t, size_t, size_t, const T* const*, std::false_type ) { return 0; }
+
+// elements [first,first+count)
+template<typename FieldArraysT, typename... ids>
+static inline void aos_import_range( FieldArraysT& arrays, const char* aos, size_t stride, const size_t* offsets, size_t first, size_t count, const FieldId<ids>& ... fids )
+{
+	using Fields = AosFields<ids...>;
+	using T = typename Fields::T;
+	size_t done = 0;
+	if( Fields::transposable( offsets ) )
+	{
+		T* const dst[ sizeof...(ids) ] = { reinterpret_cast<T*>( arrays[fids] ) ... };
+		done = aos_import_transposed<typename Fields::Transpose>( aos + offsets[0], stride, first, count, dst, std::integral_constant<bool,( Fields::Transpose::width > 0 )>() );
+	}
+	aos_import_gather( aos, stride, offsets, first + done, count - done, std::index_sequence_for<ids...>(), arrays[fids] ... );
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline void aos_export_range( const FieldArraysT& arrays, char* aos, size_t stride, const size_t* offsets, size_t first, size_t count, const FieldId<ids>& ... fids )
+{
+	using Fields = AosFields<ids...>;
+	using T = typename Fields::T;
+	size_t done = 0;
+	if( Fields::transposable( offsets ) )
+	{
+		const T* const src[ sizeof...(ids) ] = { reinterpret_cast<const T*>( arrays[fids] ) ... };
+		done = aos_export_transposed<typename Fields::Transpose>( aos + offsets[0], stride, first, count, src, std::integral_constant<bool,( Fields::Transpose::width > 0 )>() );
+	}
+	aos_export_gather( aos, stride, offsets, first + done, count - done, std::index_sequence_for<ids...>(), static_cast<const typename FieldDescriptor<ids>::value_type*>( arrays[fids] ) ... );
+}
+
+// run time layout
+
+template<typename FieldArraysT, typename... ids>
+static inline void import_aos( FieldArraysT& arrays, const void* aos, size_t count, size_t stride, const size_t* offsets, const FieldId<ids>& ... fids )
+{
+	assert( count <= arrays.size() );
+	SOATL_INSTRUMENT_KERNEL("import_aos");
+	mark_written( arrays, 0, count, fids ... );
+	SOATL_TRACE_KERNEL("import_aos", count );
+	aos_import_range( arrays, static_cast<const char*>(aos), stride, offsets, 0, count, fids ... );
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline void export_aos( const FieldArraysT& arrays, void* aos, size_t count, size_t stride, const size_t* offsets, const FieldId<ids>& ... fids )
+{
+	assert( count <= arrays.size() );
+	SOATL_INSTRUMENT_KERNEL("export_aos");
+	SOATL_TRACE_FIELDS( count, ids... );
+	SOATL_TRACE_KERNEL("export_aos", count );
+	aos_export_range( arrays, static_cast<char*>(aos), stride, offsets, 0, count, fids ... );
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline void parallel_import_aos( FieldArraysT& arrays, const void* aos, size_t count, size_t stride, const size_t* offsets, const FieldId<ids>& ... fids )
+{
+	assert( count <= arrays.size() );
+	SOATL_INSTRUMENT_PARALLEL_KERNEL("parallel_import_aos");
+	mark_written( arrays, 0, count, fids ... );
+	SOATL_TRACE_KERNEL("parallel_import_aos", count );
+	const size_t nblocks = ( count + AOS_BLOCK_SIZE - 1 ) / AOS_BLOCK_SIZE;
+#	pragma omp parallel for schedule(static) if( nblocks > 1 )
+	for(size_t b=0;b<nblocks;b++)
+	{
+		const size_t first = b * AOS_BLOCK_SIZE;
+		aos_import_range( arrays, static_cast<const char*>(aos), stride, offsets, first, std::min(AOS_BLOCK_SIZE,count-first), fids ... );
+	}
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline void parallel_export_aos( const FieldArraysT& arrays, void* aos, size_t count, size_t stride, const size_t* offsets, const FieldId<ids>& ... fids )
+{
+	assert( count <= arrays.size() );
+	SOATL_INSTRUMENT_PARALLEL_KERNEL("parallel_export_aos");
+	SOATL_TRACE_FIELDS( count, ids... );
+	SOATL_TRACE_KERNEL("parallel_export_aos", count );
+	const size_t nblocks = ( count + AOS_BLOCK_SIZE - 1 ) / AOS_BLOCK_SIZE;
+#	pragma omp parallel for schedule(static) if( nblocks > 1 )
+	for(size_t b=0;b<nblocks;b++)
+	{
+		const size_t first = b * AOS_BLOCK_SIZE;
+		aos_export_range( arrays, static_cast<char*>(aos), stride, offsets, first, std::min(AOS_BLOCK_SIZE,count-first), fids ... );
+	}
+}
+
+// compile time layout, members of one structure type
+
+template<typename FieldArraysT, typename S, size_t... Os, typename... Ms, typename... ids>
+static inline void import_aos( FieldArraysT& arrays, const void* aos, size_t count, const AosMember<S,Os,Ms,ids>& ... )
+{
+	static constexpr size_t offsets[] = { Os ... };
+	import_aos( arrays, aos, count, sizeof(S), offsets, FieldId<ids>() ... );
+}
+
+template<typename FieldArraysT, typename S, size_t... Os, typename... Ms, typename... ids>
+static inline void export_aos( const FieldArraysT& arrays, void* aos, size_t count, const AosMember<S,Os,Ms,ids>& ... )
+{
+	static constexpr size_t offsets[] = { Os ... };
+	export_aos( arrays, aos, count, sizeof(S), offsets, FieldId<ids>() ... );
+}
+
+template<typename FieldArraysT, typename S, size_t... Os, typename... Ms, typename... ids>
+static inline void parallel_import_aos( FieldArraysT& arrays, const void* aos, size_t count, const AosMember<S,Os,Ms,ids>& ... )
+{
+	static constexpr size_t offsets[] = { Os ... };
+	parallel_import_aos( arrays, aos, count, sizeof(S), offsets, FieldId<ids>() ... );
+}
+
+template<typename FieldArraysT, typename S, size_t... Os, typename... Ms, typename... ids>
+static inline void parallel_export_aos( const FieldArraysT& arrays, void* aos, size_t count, const AosMember<S,Os,Ms,ids>& ... )
+{
+	static constexpr size_t offsets[] = { Os ... };
+	parallel_export_aos( arrays, aos, count, sizeof(S), offsets, FieldId<ids>() ... );
+}
+
+} // namespace soatl
+
@@ -0,0 +1,487 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstdint>
+#include <vector>
+#include <tuple>
+#include <utility> // for std::index_sequence
+#include <type_traits>
+#include <algorithm>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_access.h"
+#include "soatl/field_encoding.h"
+#include "soatl/dirty_hooks.h"
+#include "soatl/instrument.h"
+#include "soatl/vector_field.h"
+#include "soatl/variadic_template_utils.h"
+
+/*
+Bit fields : a field whose descriptor declares bits = n (see BitFieldId in field_descriptor.h) holds unsigned values
+below 2^n, stored in bit planes : for each block of 64 elements, n words, word k holding bit k of the 64 elements.
+1 bit fields of bool are masks. make_field_arrays( particle_rx, particle_flag ) stores particle_flag as the field BitPlanes<particle_flag_id>,
+taking n/8 bytes per element (rounded up to whole blocks) instead of sizeof(value_type).
+apply, parallel_apply, apply_simd and parallel_apply_simd accept bit field ids, alone or with read/write annotations, mixed with
+scalar fields. Drivers run block by block : planes of the block are unpacked into a local array (shifts by the element index, vectorized),
+the kernel is called on references to the local values, then written values are packed back (bits outside [first,first+N) are kept).
+	soatl::apply_simd( [](bool& selected, unsigned char t, double x) { selected = t==2 && x<0.5; }, cell, write(particle_flag), read(particle_atype_b), read(particle_rx) );
+Masks have helpers working on whole words : count_set (population count), mask_and/mask_or/mask_andnot, select_indices and select_copy.
+Copies, resizes and snapshots move bit planes, serialization functions reject them.
+*/
+
+namespace soatl
+{
+
+// access annotations of bit fields
+template<typename _id, typename _mode>
+struct BitFieldAccess
+{
+	using Id = _id;
+	using Mode = _mode;
+	static constexpr bool reads = _mode::reads;
+	static constexpr bool writes = _mode::writes;
+};
+
+template<typename id> static inline BitFieldAccess<id,access::read_only> read( const BitFieldId<id>& ) { return BitFieldAccess<id,access::read_only>(); }
+template<typename id> static inline BitFieldAccess<id,access::write_only> write( const BitFieldId<id>& ) { return BitFieldAccess<id,access::write_only>(); }
+template<typename id> static inline BitFieldAccess<id,access::read_write> readwrite( const BitFieldId<id>& ) { return BitFieldAccess<id,access::read_write>(); }
+
+// bits [lo,hi) of a block
+static inline uint64_t bit_block_mask( size_t lo, size_t hi )
+{
+	return ( ( hi >= BIT_PLANE_BLOCK ) ? ~uint64_t(0) : ( ( uint64_t(1) << hi ) - 1 ) ) & ~( ( uint64_t(1) << lo ) - 1 );
+}
+
+// unpack and pack loops work on an unsigned integer of the same size : loops storing or loading bool are not vectorized
+template<typename T> struct BitPlanesCarrier { using type = typename std::make_unsigned<T>::type; };
+template<> struct BitPlanesCarrier<bool> { using type = uint8_t; };
+
+// values of a block from its Bits planes
+template<size_t Bits, typename T>
+static inline void unpack_bit_planes( const uint64_t* __restrict__ planes, T* __restrict__ values )
+{
+	using U = typename BitPlanesCarrier<T>::type;
+	U* __restrict__ u = reinterpret_cast<U*>( values );
+#	pragma omp simd
+	for(size_t j=0;j<BIT_PLANE_BLOCK;j++)
+	{
+		U x = 0;
+		for(size_t k=0;k<Bits;k++) { x |= U( ( planes[k] >> j ) & 1 ) << k; }
+		u[j] = x;
+	}
+}
+
+// planes of a block from its values, only bits set in m are replaced
+template<size_t Bits, typename T>
+static inline void pack_bit_planes( const T* __restrict__ values, uint64_t m, uint64_t* __restrict__ planes )
+{
+	using U = typename BitPlanesCarrier<T>::type;
+	const U* __restrict__ u = reinterpret_cast<const U*>( values );
+	for(size_t k=0;k<Bits;k++)
+	{
+		uint64_t x = 0;
+#		pragma omp simd reduction(|:x)
+		for(size_t j=0;j<BIT_PLANE_BLOCK;j++) { x |= ( uint64_t( u[j] >> k ) & 1 ) << j; }
+		planes[k] = ( planes[k] & ~m ) | ( x & m );
+	}
+}
+
+// element access outside of kernels, bit_field(arrays,particle_flag)[i] = true
+template<typename T, size_t Bits>
+struct BitPlanesRef
+{
+	uint64_t* planes;
+	size_t j;
+	inline operator T () const
+	{
+		uint64_t x = 0;
+		for(size_t k=0;k<Bits;k++) { x |= ( ( planes[k] >> j ) & 1 ) << k; }
+		return T( x );
+	}
+	inline BitPlanesRef& operator = ( T v )
+	{
+		for(size_t k=0;k<Bits;k++) { planes[k] = ( planes[k] & ~( uint64_t(1) << j ) ) | ( ( ( uint64_t(v) >> k ) & 1 ) << j ); }
+		return *this;
+	}
+	inline BitPlanesRef& operator = ( const BitPlanesRef& r ) { return *this = T( r ); }
+};
+
+template<typename T, size_t Bits>
+struct BitPlanesPointer
+{
+	uint64_t* planes;
+	inline BitPlanesRef<T,Bits> operator [] ( size_t i ) const { return { planes + (i/BIT_PLANE_BLOCK)*Bits , i%BIT_PLANE_BLOCK }; }
+};
+
+template<typename FieldArraysT, typename id>
+static inline BitPlanesPointer< typename BitFieldId<id>::value_type , BitFieldId<id>::bits > bit_field( FieldArraysT& arrays, const BitFieldId<id>& )
+{
+	return { arrays[ FieldId< BitPlanes<id> >() ] };
+}
+
+
+// driver arguments : stripe of a scalar field, or a block of unpacked values
+
+template<typename F> struct BitFieldArg;
+
+template<typename id, typename mode>
+struct BitFieldArg< FieldAccess<id,mode> >
+{
+	static_assert( FieldEncoding<id>::type::native , "encoded fields are not handed to kernels with bit fields" );
+	using Stored = FieldAccess<id,mode>;
+	using stripe_type = typename FieldAccess<id,mode>::pointer_type;
+	template<typename FieldArraysT> static inline stripe_type stripe( FieldArraysT& arrays ) { return arrays[ FieldId<id>() ]; }
+
+	struct Block
+	{
+		inline stripe_type load( stripe_type s, size_t b ) { return s + b*BIT_PLANE_BLOCK; }
+		inline void store( stripe_type, size_t, uint64_t ) {}
+	};
+};
+
+template<typename id> struct BitFieldArg< FieldId<id> > : public BitFieldArg< FieldAccess<id,access::read_write> > {};
+
+template<typename id, typename mode>
+struct BitFieldArg< BitFieldAccess<id,mode> >
+{
+	using value_type = typename BitFieldId<id>::value_type;
+	static constexpr size_t bits = BitFieldId<id>::bits;
+	using Stored = FieldAccess< BitPlanes<id>, mode >;
+	using stripe_type = uint64_t*;
+	template<typename FieldArraysT> static inline stripe_type stripe( FieldArraysT& arrays ) { return arrays[ FieldId< BitPlanes<id> >() ]; }
+
+	// read only values are handed to kernels as their unsigned carrier : kernels reading bool converted from bytes are vectorized, kernels loading bool are not
+	using block_type = typename std::conditional< mode::writes , value_type , typename BitPlanesCarrier<value_type>::type >::type;
+
+	struct Block
+	{
+		alignas(64) block_type values[BIT_PLANE_BLOCK];
+
+		inline block_type* load( stripe_type s, size_t b ) { unpack( s + b*bits, std::integral_constant<bool,mode::reads>() ); return values; }
+		inline void unpack( const uint64_t* planes, std::true_type ) { unpack_bit_planes<bits>( planes, values ); }
+		inline void unpack( const uint64_t*, std::false_type ) { std::fill( values, values+BIT_PLANE_BLOCK, block_type(0) ); }
+
+		inline void store( stripe_type s, size_t b, uint64_t m ) { pack( s + b*bits, m, std::integral_constant<bool,mode::writes>() ); }
+		inline void pack( uint64_t* planes, uint64_t m, std::true_type ) { pack_bit_planes<bits>( values, m, planes ); }
+		inline void pack( uint64_t*, uint64_t, std::false_type ) {}
+	};
+};
+
+template<typename id> struct BitFieldArg< BitFieldId<id> > : public BitFieldArg< BitFieldAccess<id,access::read_write> > {};
+
+template<typename F> struct IsBitFieldDriverArg : public std::false_type {};
+template<typename id> struct IsBitFieldDriverArg< FieldId<id> > : public std::true_type {};
+template<typename id, typename mode> struct IsBitFieldDriverArg< FieldAccess<id,mode> > : public std::true_type {};
+template<typename id> struct IsBitFieldDriverArg< BitFieldId<id> > : public std::true_type {};
+template<typename id, typename mode> struct IsBitFieldDriverArg< BitFieldAccess<id,mode> > : public std::true_type {};
+template<typename F> struct IsBitFieldAccessArg : public std::false_type {};
+template<typename id> struct IsBitFieldAccessArg< BitFieldId<id> > : public std::true_type {};
+template<typename id, typename mode> struct IsBitFieldAccessArg< BitFieldAccess<id,mode> > : public std::true_type {};
+
+// field ids or access annotations only, at least one of them a bit field
+template<typename... F>
+struct HasBitFields
+{
+	static constexpr bool value = ! detail::any_of( { false, ! IsBitFieldDriverArg<F>::value ... } ) && detail::any_of( { false, IsBitFieldAccessArg<F>::value ... } );
+};
+
+// runs f on elements [first,first+N), one block of 64 elements at a time
+template<bool Simd, typename OperatorT, typename... F>
+struct BitFieldKernel
+{
+	using Stripes = std::tuple< typename BitFieldArg<F>::stripe_type ... >;
+	using Blocks = std::tuple< typename BitFieldArg<F>::Block ... >;
+
+	template<typename... P>
+	static inline void call( OperatorT& f, size_t lo, size_t hi, std::true_type, P* __restrict__ ... p )
+	{
+		if( lo == 0 && hi == BIT_PLANE_BLOCK )
+		{
+#			pragma omp simd
+			for(size_t j=0;j<BIT_PLANE_BLOCK;j++) { f( p[j] ... ); }
+		}
+		else
+		{
+#			pragma omp simd
+			for(size_t j=lo;j<hi;j++) { f( p[j] ... ); }
+		}
+	}
+
+	template<typename... P>
+	static inline void call( OperatorT& f, size_t lo, size_t hi, std::false_type, P* __restrict__ ... p )
+	{
+		for(size_t j=lo;j<hi;j++) { f( p[j] ... ); }
+	}
+
+	template<size_t... I>
+	static inline void block( OperatorT& f, const Stripes& stripes, size_t b, size_t first, size_t end, std::index_sequence<I...> )
+	{
+		const size_t lo = std::max( first, b*BIT_PLANE_BLOCK ) - b*BIT_PLANE_BLOCK;
+		const size_t hi = std::min( end, (b+1)*BIT_PLANE_BLOCK ) - b*BIT_PLANE_BLOCK;
+		Blocks blocks;
+		call( f, lo, hi, std::integral_constant<bool,Simd>(), std::get<I>(blocks).load( std::get<I>(stripes), b ) ... );
+		const uint64_t m = bit_block_mask( lo, hi );
+		TEMPLATE_LIST_BEGIN
+			std::get<I>(blocks).store( std::get<I>(stripes), b, m )
+		TEMPLATE_LIST_END
+	}
+
+	template<typename FieldArraysT>
+	static inline void apply( OperatorT f, size_t first, size_t N, FieldArraysT& arrays )
+	{
+		const Stripes stripes { BitFieldArg<F>::stripe( arrays ) ... };
+		const size_t end = first + N;
+		for(size_t b=first/BIT_PLANE_BLOCK; b*BIT_PLANE_BLOCK<end; b++)
+		{
+			block( f, stripes, b, first, end, std::index_sequence_for<F...>() );
+		}
+	}
+
+	// blocks are not shared by threads
+	template<typename FieldArraysT>
+	static inline void parallel_apply( OperatorT f, size_t first, size_t N, FieldArraysT& arrays )
+	{
+		const Stripes stripes { BitFieldArg<F>::stripe( arrays ) ... };
+		const size_t end = first + N;
+		const size_t first_block = first / BIT_PLANE_BLOCK;
+		const size_t nblocks = ( N > 0 ) ? ( ( end - 1 ) / BIT_PLANE_BLOCK - first_block + 1 ) : 0;
+#		pragma omp parallel for firstprivate(f)
+		for(size_t b=first_block;b<first_block+nblocks;b++)
+		{
+			block( f, stripes, b, first, end, std::index_sequence_for<F...>() );
+		}
+	}
+};
+
+
+// drivers
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type apply( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	SOATL_INSTRUMENT_KERNEL("apply");
+	mark_written( arrays, first, N, typename BitFieldArg<F>::Stored() ... );
+	SOATL_TRACE_KERNEL("apply", N );
+	BitFieldKernel<false,OperatorT,F...>::apply( f, first, N, arrays );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type apply( OperatorT f, size_t N, FieldArraysT& arrays, const F& ... fs )
+{
+	apply( f, 0, N, arrays, fs ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type apply( OperatorT f, FieldArraysT& arrays, const F& ... fs )
+{
+	apply( f, 0, arrays.size(), arrays, fs ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type parallel_apply( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	SOATL_INSTRUMENT_PARALLEL_KERNEL("parallel_apply");
+	mark_written( arrays, first, N, typename BitFieldArg<F>::Stored() ... );
+	SOATL_TRACE_KERNEL("parallel_apply", N );
+	BitFieldKernel<false,OperatorT,F...>::parallel_apply( f, first, N, arrays );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type parallel_apply( OperatorT f, size_t N, FieldArraysT& arrays, const F& ... fs )
+{
+	parallel_apply( f, 0, N, arrays, fs ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type parallel_apply( OperatorT f, FieldArraysT& arrays, const F& ... fs )
+{
+	parallel_apply( f, 0, arrays.size(), arrays, fs ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type apply_simd( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	SOATL_INSTRUMENT_KERNEL("apply_simd");
+	mark_written( arrays, first, N, typename BitFieldArg<F>::Stored() ... );
+	SOATL_TRACE_KERNEL("apply_simd", N );
+	BitFieldKernel<true,OperatorT,F...>::apply( f, first, N, arrays );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type apply_simd( OperatorT f, size_t N, FieldArraysT& arrays, const F& ... fs )
+{
+	apply_simd( f, 0, N, arrays, fs ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type apply_simd( OperatorT f, FieldArraysT& arrays, const F& ... fs )
+{
+	apply_simd( f, 0, arrays.size(), arrays, fs ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type parallel_apply_simd( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	SOATL_INSTRUMENT_PARALLEL_KERNEL("parallel_apply_simd");
+	mark_written( arrays, first, N, typename BitFieldArg<F>::Stored() ... );
+	SOATL_TRACE_KERNEL("parallel_apply_simd", N );
+	BitFieldKernel<true,OperatorT,F...>::parallel_apply( f, first, N, arrays );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type parallel_apply_simd( OperatorT f, size_t N, FieldArraysT& arrays, const F& ... fs )
+{
+	parallel_apply_simd( f, 0, N, arrays, fs ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasBitFields<F...>::value >::type parallel_apply_simd( OperatorT f, FieldArraysT& arrays, const F& ... fs )
+{
+	parallel_apply_simd( f, 0, arrays.size(), arrays, fs ... );
+}
+
+
+// masks : comparison kernels
+
+namespace detail
+{
+	template<typename id> static inline FieldAccess<id,access::read_only> read_only_arg( const FieldId<id>& ) { return FieldAccess<id,access::read_only>(); }
+	template<typename id, typename mode> static inline FieldAccess<id,access::read_only> read_only_arg( const FieldAccess<id,mode>& ) { return FieldAccess<id,access::read_only>(); }
+	template<typename id> static inline BitFieldAccess<id,access::read_only> read_only_arg( const BitFieldId<id>& ) { return BitFieldAccess<id,access::read_only>(); }
+	template<typename id, typename mode> static inline BitFieldAccess<id,access::read_only> read_only_arg( const BitFieldAccess<id,mode>& ) { return BitFieldAccess<id,access::read_only>(); }
+
+	template<typename OperatorT, typename TupleT, size_t... I>
+	static inline uint64_t call_on_words( OperatorT& op, const TupleT& src, size_t w, std::index_sequence<I...> ) { return op( std::get<I>(src)[w] ... ); }
+}
+
+// mask[i] = pred( fields[i] ... ), e.g. mask_where( cell, particle_flag, [](double x, double y) { return x < y; }, particle_rx, particle_ry )
+template<typename FieldArraysT, typename mask_id, typename PredicateT, typename... F>
+static inline void mask_where( FieldArraysT& arrays, const BitFieldId<mask_id>& mask, PredicateT pred, const F& ... fields )
+{
+	static_assert( BitFieldId<mask_id>::bits == 1 , "masks are 1 bit fields" );
+	apply_simd( [pred]( typename BitFieldId<mask_id>::value_type& m, const auto& ... x ) { m = pred( x ... ); }, arrays, write(mask), detail::read_only_arg(fields) ... );
+}
+
+// mask[i] = cmp( field[i], value ), e.g. mask_compare( cell, particle_flag, particle_atype_b, std::equal_to<>(), 3 )
+template<typename FieldArraysT, typename mask_id, typename F, typename CompareT, typename T>
+static inline void mask_compare( FieldArraysT& arrays, const BitFieldId<mask_id>& mask, const F& field, CompareT cmp, T value )
+{
+	mask_where( arrays, mask, [cmp,value]( const auto& x ) { return cmp( x, value ); }, field );
+}
+
+
+// masks : whole word operations on elements [0,size()), bits after the last element are not specified.
+// the destination may be one of the operands, e.g. mask_and( cell, sel, flag, sel ), each word is read before it is written
+
+template<typename FieldArraysT, typename OperatorT, typename dst_id, typename... mask_ids>
+static inline void mask_combine( FieldArraysT& arrays, OperatorT op, const BitFieldId<dst_id>&, const BitFieldId<mask_ids>& ... )
+{
+	static_assert( ! detail::any_of( { BitFieldId<dst_id>::bits != 1, BitFieldId<mask_ids>::bits != 1 ... } ) , "masks are 1 bit fields" );
+	SOATL_INSTRUMENT_KERNEL("mask_combine");
+	mark_written( arrays, 0, arrays.size(), FieldId< BitPlanes<dst_id> >() );
+	SOATL_TRACE_KERNEL("mask_combine", arrays.size() );
+	const size_t nwords = ( arrays.size() + BIT_PLANE_BLOCK - 1 ) / BIT_PLANE_BLOCK;
+	uint64_t* dst = arrays[ FieldId< BitPlanes<dst_id> >() ];
+	std::tuple< typename std::conditional< true, const uint64_t*, mask_ids >::type ... > src { arrays[ FieldId< BitPlanes<mask_ids> >() ] ... };
+	for(size_t w=0;w<nwords;w++) { dst[w] = detail::call_on_words( op, src, w, std::index_sequence_for<mask_ids...>() ); }
+}
+
+template<typename FieldArraysT, typename dst_id, typename a_id, typename b_id>
+static inline void mask_and( FieldArraysT& arrays, const BitFieldId<dst_id>& dst, const BitFieldId<a_id>& a, const BitFieldId<b_id>& b )
+{
+	mask_combine( arrays, [](uint64_t x, uint64_t y) { return x & y; }, dst, a, b );
+}
+
+template<typename FieldArraysT, typename dst_id, typename a_id, typename b_id>
+static inline void mask_or( FieldArraysT& arrays, const BitFieldId<dst_id>& dst, const BitFieldId<a_id>& a, const BitFieldId<b_id>& b )
+{
+	mask_combine( arrays, [](uint64_t x, uint64_t y) { return x | y; }, dst, a, b );
+}
+
+template<typename FieldArraysT, typename dst_id, typename a_id, typename b_id>
+static inline void mask_andnot( FieldArraysT& arrays, const BitFieldId<dst_id>& dst, const BitFieldId<a_id>& a, const BitFieldId<b_id>& b )
+{
+	mask_combine( arrays, [](uint64_t x, uint64_t y) { return x & ~y; }, dst, a, b );
+}
+
+
+// masks : population count and selection
+
+// number of set elements in [first,first+N)
+template<typename FieldArraysT, typename mask_id>
+static inline size_t count_set( const FieldArraysT& arrays, const BitFieldId<mask_id>&, size_t first, size_t N )
+{
+	static_assert( BitFieldId<mask_id>::bits == 1 , "masks are 1 bit fields" );
+	SOATL_INSTRUMENT_KERNEL("count_set");
+	SOATL_TRACE_KERNEL("count_set", N );
+	const uint64_t* __restrict__ words = arrays[ FieldId< BitPlanes<mask_id> >() ];
+	const size_t end = first + N;
+	size_t n = 0;
+	for(size_t b=first/BIT_PLANE_BLOCK; b*BIT_PLANE_BLOCK<end; b++)
+	{
+		const size_t lo = std::max( first, b*BIT_PLANE_BLOCK ) - b*BIT_PLANE_BLOCK;
+		const size_t hi = std::min( end, (b+1)*BIT_PLANE_BLOCK ) - b*BIT_PLANE_BLOCK;
+		n += __builtin_popcountll( words[b] & bit_block_mask( lo, hi ) );
+	}
+	return n;
+}
+
+template<typename FieldArraysT, typename mask_id>
+static inline size_t count_set( const FieldArraysT& arrays, const BitFieldId<mask_id>& mask )
+{
+	return count_set( arrays, mask, 0, arrays.size() );
+}
+
+// appends the indices of set elements, in increasing order (e.g. for apply_indexed)
+template<typename FieldArraysT, typename mask_id, typename IndexT>
+static inline void select_indices( const FieldArraysT& arrays, const BitFieldId<mask_id>&, std::vector<IndexT>& indices )
+{
+	static_assert( BitFieldId<mask_id>::bits == 1 , "masks are 1 bit fields" );
+	SOATL_INSTRUMENT_KERNEL("select_indices");
+	SOATL_TRACE_KERNEL("select_indices", arrays.size() );
+	const uint64_t* __restrict__ words = arrays[ FieldId< BitPlanes<mask_id> >() ];
+	const size_t N = arrays.size();
+	for(size_t b=0; b*BIT_PLANE_BLOCK<N; b++)
+	{
+		uint64_t w = words[b] & bit_block_mask( 0, N - b*BIT_PLANE_BLOCK );
+		while( w != 0 )
+		{
+			indices.push_back( IndexT( b*BIT_PLANE_BLOCK + __builtin_ctzll( w ) ) );
+			w &= w - 1;
+		}
+	}
+}
+
+namespace detail
+{
+	template<typename DstArraysT, typename SrcArraysT, typename id>
+	static inline void gather_selected( DstArraysT& dst, const SrcArraysT& src, const std::vector<size_t>& indices, const FieldId<id>& fid )
+	{
+		for(size_t k=0;k<indices.size();k++) { dst[fid][k] = src[fid][ indices[k] ]; }
+	}
+
+	template<typename DstArraysT, typename SrcArraysT, typename id>
+	static inline void gather_selected( DstArraysT& dst, const SrcArraysT& src, const std::vector<size_t>& indices, const BitFieldId<id>& bfid )
+	{
+		auto d = bit_field( dst, bfid );
+		auto s = bit_field( src, bfid );
+		for(size_t k=0;k<indices.size();k++) { d[k] = s[ indices[k] ]; }
+	}
+}
+
+// resizes dst to the number of set elements of mask in src, and copies them in order
+template<typename DstArraysT, typename SrcArraysT, typename mask_id, typename... F>
+static inline void select_copy( DstArraysT& dst, const SrcArraysT& src, const BitFieldId<mask_id>& mask, const F& ... fields )
+{
+	std::vector<size_t> indices;
+	select_indices( src, mask, indices );
+	SOATL_INSTRUMENT_KERNEL("select_copy");
+	dst.resize( indices.size() );
+	mark_written( dst, 0, indices.size(), typename BitFieldArg<F>::Stored() ... );
+	SOATL_TRACE_KERNEL("select_copy", indices.size() );
+	TEMPLATE_LIST_BEGIN
+		detail::gather_selected( dst, src, indices, fields )
+	TEMPLATE_LIST_END
+}
+
+} // namespace soatl
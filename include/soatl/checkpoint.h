@@ -0,0 +1,657 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstdint>
+#include <cstring>
+#include <algorithm> // for std::min
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fstream>
+
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/variadic_template_utils.h"
+#include "soatl/serialize.h" // for SerializedTypeCode
+
+/*
+Asynchronous checkpoints of field containers.
+CheckpointWriter::submit() records the selected fields of a container and returns immediately, a background thread
+encodes and writes them. Fields are not copied at submission : CheckpointHandle::detach() must be called before the
+container is modified (or resized, or destroyed), it copies only the blocks the background thread has not encoded yet.
+
+Each field is cut in blocks of CHECKPOINT_BLOCK_SIZE elements, encoded independently and in parallel :
+bytes are shuffled (byte j of every element stored together), each byte plane is delta encoded, then run length encoded.
+detach() only waits for the blocks being encoded at the time it is called.
+High order bytes of spatially sorted positions or of small integers are nearly constant, and end up as long runs of zeros.
+Blocks that do not compress are stored raw. File is written through an aligned buffer of CHECKPOINT_IO_SIZE bytes.
+
+File layout (native byte order) :
+	char magic[8] "SOATLCK", uint32_t version, uint64_t element count, uint32_t field count
+	field count times :
+		uint32_t name length, name characters, uint32_t element type (SerializedType), uint32_t element size, uint64_t block count
+		block count CheckpointBlock, followed by encoded blocks
+*/
+
+namespace soatl
+{
+
+static constexpr char CHECKPOINT_MAGIC[8] = { 'S','O','A','T','L','C','K','\0' };
+static constexpr uint32_t CHECKPOINT_VERSION = 1;
+static constexpr size_t CHECKPOINT_BLOCK_SIZE = 65536;
+static constexpr size_t CHECKPOINT_IO_SIZE = 4ul << 20;
+static constexpr size_t CHECKPOINT_IO_ALIGNMENT = 4096;
+
+enum CheckpointCodec : uint32_t
+{
+	CHECKPOINT_RAW = 0,
+	CHECKPOINT_SHUFFLE_DELTA_RLE = 1
+};
+
+struct CheckpointBlock
+{
+	uint64_t bytes;
+	uint32_t codec;
+	uint32_t reserved;
+};
+
+// ------------------ codec ------------------
+
+// out[j*n+i] = in[i*S+j] - in[(i-1)*S+j] : bytes are shuffled into S planes, and delta encoded along each plane
+template<size_t S>
+static inline void shuffle_delta_encode( const uint8_t* __restrict__ in, uint8_t* __restrict__ out, size_t n )
+{
+	if( n == 0 ) return;
+	for(size_t j=0;j<S;j++) { out[j*n] = in[j]; }
+	for(size_t i=1;i<n;i++)
+	{
+		for(size_t j=0;j<S;j++) { out[j*n+i] = in[i*S+j] - in[(i-1)*S+j]; }
+	}
+}
+
+template<size_t S>
+static inline void shuffle_delta_decode( const uint8_t* __restrict__ in, uint8_t* __restrict__ out, size_t n )
+{
+	if( n == 0 ) return;
+	for(size_t j=0;j<S;j++) { out[j] = in[j*n]; }
+	for(size_t i=1;i<n;i++)
+	{
+		for(size_t j=0;j<S;j++) { out[i*S+j] = out[(i-1)*S+j] + in[j*n+i]; }
+	}
+}
+
+static inline void shuffle_delta_encode( const uint8_t* __restrict__ in, uint8_t* __restrict__ out, size_t n, size_t s )
+{
+	switch( s )
+	{
+		case 1 : shuffle_delta_encode<1>( in, out, n ); break;
+		case 2 : shuffle_delta_encode<2>( in, out, n ); break;
+		case 4 : shuffle_delta_encode<4>( in, out, n ); break;
+		case 8 : shuffle_delta_encode<8>( in, out, n ); break;
+		default :
+			for(size_t j=0;j<s;j++)
+			{
+				uint8_t prev = 0;
+				for(size_t i=0;i<n;i++) { out[j*n+i] = in[i*s+j] - prev; prev = in[i*s+j]; }
+			}
+	}
+}
+
+static inline void shuffle_delta_decode( const uint8_t* __restrict__ in, uint8_t* __restrict__ out, size_t n, size_t s )
+{
+	switch( s )
+	{
+		case 1 : shuffle_delta_decode<1>( in, out, n ); break;
+		case 2 : shuffle_delta_decode<2>( in, out, n ); break;
+		case 4 : shuffle_delta_decode<4>( in, out, n ); break;
+		case 8 : shuffle_delta_decode<8>( in, out, n ); break;
+		default :
+			for(size_t j=0;j<s;j++)
+			{
+				uint8_t x = 0;
+				for(size_t i=0;i<n;i++) { x += in[j*n+i]; out[i*s+j] = x; }
+			}
+	}
+}
+
+// worst case size of rle_encode output
+static inline size_t rle_bound( size_t n ) { return n + ( n + 127 ) / 128; }
+
+// PackBits : control byte c < 128 is followed by c+1 literal bytes, c >= 128 is followed by one byte repeated c-125 times
+static inline size_t rle_encode( const uint8_t* __restrict__ in, size_t n, uint8_t* __restrict__ out )
+{
+	size_t o = 0;
+	size_t i = 0;
+	while( i < n )
+	{
+		size_t run = 1;
+		while( i+run < n && run < 130 && in[i+run] == in[i] ) { ++ run; }
+		if( run >= 3 )
+		{
+			out[o++] = static_cast<uint8_t>( run + 125 );
+			out[o++] = in[i];
+			i += run;
+		}
+		else
+		{
+			// literals, until the next run of 3 equal bytes
+			size_t lit = 0;
+			while( i+lit < n && lit < 128 && ! ( i+lit+2 < n && in[i+lit] == in[i+lit+1] && in[i+lit] == in[i+lit+2] ) ) { ++ lit; }
+			out[o++] = static_cast<uint8_t>( lit - 1 );
+			std::memcpy( out+o, in+i, lit );
+			o += lit;
+			i += lit;
+		}
+	}
+	return o;
+}
+
+// PackBits stream made of literals only
+static inline size_t rle_literals( const uint8_t* __restrict__ in, size_t n, uint8_t* __restrict__ out )
+{
+	size_t o = 0;
+	for(size_t i=0;i<n;i+=128)
+	{
+		const size_t lit = std::min( n-i , size_t(128) );
+		out[o++] = static_cast<uint8_t>( lit - 1 );
+		std::memcpy( out+o, in+i, lit );
+		o += lit;
+	}
+	return o;
+}
+
+// encodes a byte plane. planes where less than 1 byte in 8 repeats its predecessor (low order bytes of floating point values)
+// are stored as literals without searching for runs
+static inline size_t rle_encode_plane( const uint8_t* __restrict__ in, size_t n, uint8_t* __restrict__ out )
+{
+	size_t repeats = 0;
+#	pragma omp simd reduction(+:repeats)
+	for(size_t i=1;i<n;i++) { repeats += ( in[i] == in[i-1] ); }
+	return ( repeats*8 < n ) ? rle_literals( in, n, out ) : rle_encode( in, n, out );
+}
+
+// returns false if input is malformed or does not decode to exactly n bytes
+static inline bool rle_decode( const uint8_t* __restrict__ in, size_t bytes, uint8_t* __restrict__ out, size_t n )
+{
+	size_t o = 0;
+	size_t i = 0;
+	while( i < bytes )
+	{
+		const size_t c = in[i++];
+		if( c < 128 )
+		{
+			if( i+c+1 > bytes || o+c+1 > n ) { return false; }
+			std::memcpy( out+o, in+i, c+1 );
+			i += c+1;
+			o += c+1;
+		}
+		else
+		{
+			if( i >= bytes || o+c-125 > n ) { return false; }
+			std::memset( out+o, in[i++], c-125 );
+			o += c-125;
+		}
+	}
+	return o == n;
+}
+
+// ------------------ aligned output file ------------------
+
+struct CheckpointFile
+{
+	inline bool open( const std::string& filename )
+	{
+		m_fd = ::open( filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+		if( m_buffer == nullptr && posix_memalign( reinterpret_cast<void**>(&m_buffer), CHECKPOINT_IO_ALIGNMENT, CHECKPOINT_IO_SIZE ) != 0 ) { m_buffer = nullptr; }
+		m_fill = 0;
+		m_ok = ( m_fd >= 0 ) && ( m_buffer != nullptr );
+		return m_ok;
+	}
+
+	inline void append( const void* data, size_t bytes )
+	{
+		const uint8_t* p = static_cast<const uint8_t*>( data );
+		while( bytes > 0 && m_ok )
+		{
+			const size_t n = std::min( bytes , CHECKPOINT_IO_SIZE - m_fill );
+			std::memcpy( m_buffer + m_fill, p, n );
+			m_fill += n; p += n; bytes -= n;
+			if( m_fill == CHECKPOINT_IO_SIZE ) { flush(); }
+		}
+	}
+
+	template<typename T> inline void append( const T& x ) { append( &x, sizeof(T) ); }
+
+	inline void flush()
+	{
+		size_t done = 0;
+		while( m_ok && done < m_fill )
+		{
+			const ssize_t w = ::write( m_fd, m_buffer + done, m_fill - done );
+			if( w <= 0 ) { m_ok = false; }
+			else { done += w; }
+		}
+		m_fill = 0;
+	}
+
+	inline bool close()
+	{
+		if( m_fd >= 0 )
+		{
+			flush();
+			m_ok = ( ::close( m_fd ) == 0 ) && m_ok;
+			m_fd = -1;
+		}
+		return m_ok;
+	}
+
+	inline ~CheckpointFile()
+	{
+		close();
+		free( m_buffer );
+	}
+
+	int m_fd = -1;
+	uint8_t* m_buffer = nullptr;
+	size_t m_fill = 0;
+	bool m_ok = false;
+};
+
+// ------------------ checkpoint jobs ------------------
+
+struct CheckpointStats
+{
+	size_t raw_bytes = 0;      // field data
+	size_t file_bytes = 0;     // encoded data and headers
+	double encode_time = 0.0;  // seconds, in background thread
+	double write_time = 0.0;   // seconds, in background thread
+	double total_time = 0.0;   // seconds, from submission to completion
+	inline double compression_ratio() const { return file_bytes>0 ? double(raw_bytes)/file_bytes : 0.0; }
+};
+
+struct CheckpointColumn
+{
+	enum BlockState : uint8_t { PENDING, ENCODING, ENCODED };
+
+	std::string name;
+	uint32_t type = SERIALIZED_OPAQUE;
+	uint32_t element_size = 0;
+	const uint8_t* source = nullptr;
+	std::unique_ptr<uint8_t[]> copy;    // private copy of source blocks, made by detach()
+	std::vector<BlockState> state;      // per block
+	std::vector<bool> copied;           // per block, true if the block is read from copy
+};
+
+struct CheckpointJob
+{
+	std::string filename;
+	size_t count = 0;
+	size_t nblocks = 0;
+	int num_threads = 0;
+	std::vector<CheckpointColumn> columns;
+	std::chrono::high_resolution_clock::time_point submit_time;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool done = false;
+	bool ok = false;
+	CheckpointStats stats;
+
+	inline void encode_block( CheckpointColumn& col, size_t b, CheckpointBlock& block, std::vector<uint8_t>& out )
+	{
+		const size_t s = col.element_size;
+		const size_t first = b * CHECKPOINT_BLOCK_SIZE;
+		const size_t n = std::min( CHECKPOINT_BLOCK_SIZE , count - first );
+		const size_t raw = n * s;
+
+		const uint8_t* src = nullptr;
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			src = ( col.copied[b] ? col.copy.get() : col.source ) + first*s;
+			col.state[b] = CheckpointColumn::ENCODING;
+		}
+
+		std::vector<uint8_t> planes( raw );
+		shuffle_delta_encode( src, planes.data(), n, s );
+		// each of the s byte planes is encoded separately and may grow by its own control bytes
+		out.resize( s * rle_bound(n) );
+		size_t bytes = 0;
+		for(size_t j=0;j<s;j++) { bytes += rle_encode_plane( planes.data()+j*n, n, out.data()+bytes ); }
+		block.codec = CHECKPOINT_SHUFFLE_DELTA_RLE;
+		if( bytes >= raw )
+		{
+			bytes = raw;
+			std::memcpy( out.data(), src, raw );
+			block.codec = CHECKPOINT_RAW;
+		}
+		out.resize( bytes );
+		block.bytes = bytes;
+
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			col.state[b] = CheckpointColumn::ENCODED;
+		}
+		cond.notify_all();
+	}
+
+	inline void encode_column( CheckpointColumn& col, std::vector<CheckpointBlock>& table, std::vector< std::vector<uint8_t> >& blocks )
+	{
+		table.assign( nblocks, CheckpointBlock{0,CHECKPOINT_RAW,0} );
+		blocks.resize( nblocks );
+		if( num_threads > 0 )
+		{
+#			pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+			for(size_t b=0;b<nblocks;b++) { encode_block( col, b, table[b], blocks[b] ); }
+		}
+		else
+		{
+#			pragma omp parallel for schedule(dynamic)
+			for(size_t b=0;b<nblocks;b++) { encode_block( col, b, table[b], blocks[b] ); }
+		}
+		std::lock_guard<std::mutex> lock( mutex );
+		col.source = nullptr;
+		col.copy.reset();
+	}
+
+	// runs in the background thread
+	inline void run()
+	{
+		using clock = std::chrono::high_resolution_clock;
+		CheckpointFile file;
+		bool r = file.open( filename );
+		file.append( CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC) );
+		file.append( CHECKPOINT_VERSION );
+		file.append( static_cast<uint64_t>( count ) );
+		file.append( static_cast<uint32_t>( columns.size() ) );
+		size_t file_bytes = sizeof(CHECKPOINT_MAGIC) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t);
+
+		std::vector<CheckpointBlock> table;
+		std::vector< std::vector<uint8_t> > blocks;
+		double encode_time = 0.0, write_time = 0.0;
+		for(auto& col : columns)
+		{
+			auto t1 = clock::now();
+			encode_column( col, table, blocks );
+			auto t2 = clock::now();
+
+			file.append( static_cast<uint32_t>( col.name.size() ) );
+			file.append( col.name.data(), col.name.size() );
+			file.append( col.type );
+			file.append( col.element_size );
+			file.append( static_cast<uint64_t>( table.size() ) );
+			file.append( table.data(), table.size() * sizeof(CheckpointBlock) );
+			file_bytes += 3*sizeof(uint32_t) + col.name.size() + sizeof(uint64_t) + table.size() * sizeof(CheckpointBlock);
+			for(const auto& b : blocks) { file.append( b.data(), b.size() ); file_bytes += b.size(); }
+			auto t3 = clock::now();
+
+			encode_time += std::chrono::duration<double>(t2-t1).count();
+			write_time += std::chrono::duration<double>(t3-t2).count();
+			stats.raw_bytes += count * col.element_size;
+		}
+		auto t4 = clock::now();
+		r = file.close() && r;
+		auto t5 = clock::now();
+
+		std::lock_guard<std::mutex> lock( mutex );
+		stats.file_bytes = file_bytes;
+		stats.encode_time = encode_time;
+		stats.write_time = write_time + std::chrono::duration<double>(t5-t4).count();
+		stats.total_time = std::chrono::duration<double>(t5-submit_time).count();
+		ok = r;
+		done = true;
+		cond.notify_all();
+	}
+};
+
+class CheckpointHandle
+{
+public:
+	CheckpointHandle() = default;
+	inline CheckpointHandle( std::shared_ptr<CheckpointJob> job ) : m_job(job) {}
+
+	// must be called before the checkpointed container is modified. copies the blocks not yet encoded,
+	// and waits for the blocks being encoded.
+	inline void detach()
+	{
+		if( ! m_job ) return;
+		std::unique_lock<std::mutex> lock( m_job->mutex );
+		for(auto& col : m_job->columns)
+		{
+			for(size_t b=0;b<m_job->nblocks;b++)
+			{
+				m_job->cond.wait( lock, [&col,b]() { return col.state[b] != CheckpointColumn::ENCODING; } );
+				if( col.state[b] == CheckpointColumn::PENDING && ! col.copied[b] )
+				{
+					const size_t s = col.element_size;
+					const size_t first = b * CHECKPOINT_BLOCK_SIZE;
+					const size_t n = std::min( CHECKPOINT_BLOCK_SIZE , m_job->count - first );
+					if( ! col.copy ) { col.copy.reset( new uint8_t[ m_job->count * s ] ); }
+					std::memcpy( col.copy.get() + first*s, col.source + first*s, n*s );
+					col.copied[b] = true;
+				}
+			}
+		}
+	}
+
+	// waits until the checkpoint is written, returns false if writing failed
+	inline bool wait()
+	{
+		if( ! m_job ) return false;
+		std::unique_lock<std::mutex> lock( m_job->mutex );
+		m_job->cond.wait( lock, [this]() { return m_job->done; } );
+		return m_job->ok;
+	}
+
+	inline bool done() const
+	{
+		if( ! m_job ) return true;
+		std::lock_guard<std::mutex> lock( m_job->mutex );
+		return m_job->done;
+	}
+
+	// valid once wait() returned
+	inline const CheckpointStats& stats() const { return m_job->stats; }
+
+private:
+	std::shared_ptr<CheckpointJob> m_job;
+};
+
+class CheckpointWriter
+{
+public:
+	// num_threads : OpenMP threads used by the background thread to encode blocks (0 for OpenMP default)
+	inline CheckpointWriter( int num_threads = 0 ) : m_num_threads(num_threads)
+	{
+		m_thread = std::thread( [this]() { worker(); } );
+	}
+
+	inline ~CheckpointWriter()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_stop = true;
+		}
+		m_cond.notify_all();
+		m_thread.join();
+	}
+
+	template<typename FieldArraysT, typename... ids>
+	inline CheckpointHandle submit( const std::string& filename, const FieldArraysT& arrays, const FieldId<ids>& ... fids )
+	{
+		auto job = std::make_shared<CheckpointJob>();
+		job->filename = filename;
+		job->count = arrays.size();
+		job->nblocks = ( job->count + CHECKPOINT_BLOCK_SIZE - 1 ) / CHECKPOINT_BLOCK_SIZE;
+		job->num_threads = m_num_threads;
+		job->submit_time = std::chrono::high_resolution_clock::now();
+		TEMPLATE_LIST_BEGIN
+			job->columns.push_back( make_column( arrays, fids ) )
+		TEMPLATE_LIST_END
+		for(auto& col : job->columns)
+		{
+			col.state.assign( job->nblocks, CheckpointColumn::PENDING );
+			col.copied.assign( job->nblocks, false );
+		}
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			m_queue.push_back( job );
+		}
+		m_cond.notify_all();
+		return CheckpointHandle( job );
+	}
+
+	template<typename FieldArraysT, typename... ids>
+	inline CheckpointHandle submit( const std::string& filename, const FieldArraysT& arrays, const std::tuple< FieldId<ids> ... > & )
+	{
+		return submit( filename, arrays, FieldId<ids>() ... );
+	}
+
+	template<typename FieldArraysT>
+	inline CheckpointHandle submit( const std::string& filename, const FieldArraysT& arrays )
+	{
+		return submit( filename, arrays, typename FieldArraysT::FieldIdsTuple () );
+	}
+
+private:
+	template<typename FieldArraysT, typename id>
+	static inline CheckpointColumn make_column( const FieldArraysT& arrays, FieldId<id> fid )
+	{
+		using ValueType = typename FieldId<id>::value_type;
+		static_assert( ! IsBitPlanes<id>::value , "bit fields are not serialized" );
+		CheckpointColumn col;
+		col.name = FieldId<id>::name();
+		col.type = SerializedTypeCode<ValueType>::value;
+		col.element_size = sizeof(ValueType);
+		col.source = reinterpret_cast<const uint8_t*>( arrays[fid] );
+		return col;
+	}
+
+	inline void worker()
+	{
+		for(;;)
+		{
+			std::shared_ptr<CheckpointJob> job;
+			{
+				std::unique_lock<std::mutex> lock( m_mutex );
+				m_cond.wait( lock, [this]() { return m_stop || ! m_queue.empty(); } );
+				if( m_queue.empty() ) { return; }
+				job = m_queue.front();
+				m_queue.pop_front();
+			}
+			job->run();
+		}
+	}
+
+	int m_num_threads = 0;
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque< std::shared_ptr<CheckpointJob> > m_queue;
+	bool m_stop = false;
+};
+
+// ------------------ reader ------------------
+
+template<typename FieldArraysT, typename id>
+static inline bool checkpoint_find_field( const std::string& name, uint32_t type, uint32_t element_size, FieldArraysT& arrays, FieldId<id> fid, uint8_t*& dst )
+{
+	using ValueType = typename FieldId<id>::value_type;
+	static_assert( ! IsBitPlanes<id>::value , "bit fields are not serialized" );
+	if( name == FieldId<id>::name() && type == SerializedTypeCode<ValueType>::value && element_size == sizeof(ValueType) )
+	{
+		dst = reinterpret_cast<uint8_t*>( arrays[fid] );
+		return true;
+	}
+	return false;
+}
+
+// loads the given fields (all fields of arrays by default) from a checkpoint file, resizing arrays.
+// returns false if the file is invalid or a requested field is missing.
+template<typename FieldArraysT, typename... ids>
+static inline bool read_checkpoint( const std::string& filename, FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	std::ifstream in( filename, std::ios::binary );
+	char magic[sizeof(CHECKPOINT_MAGIC)];
+	uint32_t version = 0, nfields = 0;
+	uint64_t count = 0;
+	if( ! in.read( magic, sizeof(magic) ) || std::memcmp( magic, CHECKPOINT_MAGIC, sizeof(magic) ) != 0 ) { return false; }
+	if( ! deserialize_pod(in,version) || version != CHECKPOINT_VERSION || ! deserialize_pod(in,count) || ! deserialize_pod(in,nfields) ) { return false; }
+	arrays.resize( count );
+
+	size_t found = 0;
+	std::vector<CheckpointBlock> table;
+	std::vector<uint8_t> encoded;
+	for(uint32_t f=0;f<nfields;f++)
+	{
+		uint32_t len = 0, type = 0, element_size = 0;
+		uint64_t nblocks = 0;
+		std::string name;
+		if( ! deserialize_pod(in,len) ) { return false; }
+		name.resize( len );
+		if( ! in.read( &name[0], len ) || ! deserialize_pod(in,type) || ! deserialize_pod(in,element_size) || ! deserialize_pod(in,nblocks) ) { return false; }
+		if( nblocks != ( count + CHECKPOINT_BLOCK_SIZE - 1 ) / CHECKPOINT_BLOCK_SIZE ) { return false; }
+		table.resize( nblocks );
+		if( ! in.read( reinterpret_cast<char*>( table.data() ), nblocks * sizeof(CheckpointBlock) ) ) { return false; }
+		std::vector<size_t> offsets( nblocks+1, 0 );
+		for(size_t b=0;b<nblocks;b++) { offsets[b+1] = offsets[b] + table[b].bytes; }
+
+		uint8_t* dst = nullptr;
+		const bool match[] = { false, checkpoint_find_field( name, type, element_size, arrays, fids, dst ) ... };
+		bool requested = false;
+		for(bool m : match) { requested = requested || m; }
+		if( ! requested )
+		{
+			in.seekg( offsets[nblocks], std::ios::cur );
+			continue;
+		}
+
+		encoded.resize( offsets[nblocks] );
+		if( ! in.read( reinterpret_cast<char*>( encoded.data() ), encoded.size() ) ) { return false; }
+		bool ok = true;
+#		pragma omp parallel for schedule(dynamic) reduction(&&:ok)
+		for(size_t b=0;b<nblocks;b++)
+		{
+			const size_t first = b * CHECKPOINT_BLOCK_SIZE;
+			const size_t n = std::min( CHECKPOINT_BLOCK_SIZE , count - first );
+			const size_t raw = n * element_size;
+			const uint8_t* src = encoded.data() + offsets[b];
+			if( table[b].codec == CHECKPOINT_RAW )
+			{
+				ok = ok && table[b].bytes == raw;
+				if( ok ) { std::memcpy( dst + first*element_size, src, raw ); }
+			}
+			else
+			{
+				std::vector<uint8_t> planes( raw );
+				ok = ok && rle_decode( src, table[b].bytes, planes.data(), raw );
+				if( ok ) { shuffle_delta_decode( planes.data(), dst + first*element_size, n, element_size ); }
+			}
+		}
+		if( ! ok ) { return false; }
+		++ found;
+	}
+	return found == sizeof...(ids);
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline bool read_checkpoint( const std::string& filename, FieldArraysT& arrays, const std::tuple< FieldId<ids> ... > & )
+{
+	return read_checkpoint( filename, arrays, FieldId<ids>() ... );
+}
+
+template<typename FieldArraysT>
+static inline bool read_checkpoint( const std::string& filename, FieldArraysT& arrays )
+{
+	return read_checkpoint( filename, arrays, typename FieldArraysT::FieldIdsTuple () );
+}
+
+} // namespace soatl
+
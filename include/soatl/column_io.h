@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstdint>
+#include <algorithm> // for std::min
+#include <string>
+#include <vector>
+#include <tuple>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/serialize.h"
+
+/*
+Column projected file I/O, in the self describing format of serialize.h.
+load() reads only the requested fields of a file, each one at the offset given by the header, so that a pass needing
+3 fields out of 12 reads a quarter of the file. The target can be any container holding the requested fields.
+Fields are transferred with positioned reads and writes (pread/pwrite) split into blocks of COLUMN_IO_BLOCK_SIZE bytes,
+issued in parallel by OpenMP threads, so that several requests are in flight at once.
+*/
+
+namespace soatl
+{
+
+static constexpr size_t COLUMN_IO_BLOCK_SIZE = 1<<23; // bytes
+
+// reads or writes exactly bytes bytes at a given file offset, restarting on short transfers
+static inline bool pread_all( int fd, void* buffer, size_t bytes, uint64_t offset )
+{
+	char* dst = static_cast<char*>( buffer );
+	while( bytes > 0 )
+	{
+		const ssize_t r = pread( fd, dst, bytes, offset );
+		if( r <= 0 ) { return false; }
+		dst += r;
+		bytes -= r;
+		offset += r;
+	}
+	return true;
+}
+
+static inline bool pwrite_all( int fd, const void* buffer, size_t bytes, uint64_t offset )
+{
+	const char* src = static_cast<const char*>( buffer );
+	while( bytes > 0 )
+	{
+		const ssize_t r = pwrite( fd, src, bytes, offset );
+		if( r <= 0 ) { return false; }
+		src += r;
+		bytes -= r;
+		offset += r;
+	}
+	return true;
+}
+
+// contiguous piece of a field, transferred with a single pread or pwrite
+struct ColumnTransfer
+{
+	char* data;
+	size_t bytes;
+	uint64_t offset;
+};
+
+static inline void add_column_transfers( std::vector<ColumnTransfer>& transfers, char* data, size_t bytes, uint64_t offset )
+{
+	for(size_t b=0;b<bytes;b+=COLUMN_IO_BLOCK_SIZE)
+	{
+		transfers.push_back( ColumnTransfer{ data + b, std::min( COLUMN_IO_BLOCK_SIZE, bytes - b ), offset + b } );
+	}
+}
+
+// returns false if any of the transfers failed
+static inline bool run_column_transfers( int fd, const std::vector<ColumnTransfer>& transfers, bool write )
+{
+	const ssize_t n = transfers.size();
+	bool ok = true;
+#	pragma omp parallel for schedule(dynamic,1) reduction(&&:ok)
+	for(ssize_t i=0;i<n;i++)
+	{
+		const ColumnTransfer& t = transfers[i];
+		ok = ok && ( write ? pwrite_all( fd, t.data, t.bytes, t.offset ) : pread_all( fd, t.data, t.bytes, t.offset ) );
+	}
+	return ok;
+}
+
+template<typename FieldArraysT, typename id>
+static inline bool add_column_read( std::vector<ColumnTransfer>& transfers, const SerializedHeader& header, FieldArraysT& arrays, FieldId<id> fid )
+{
+	using ValueType = typename FieldId<id>::value_type;
+	static_assert( ! IsBitPlanes<id>::value , "bit fields are not serialized" );
+	const SerializedField* f = header.find( FieldId<id>::name() );
+	if( f == nullptr || f->type != SerializedTypeCode<ValueType>::value || f->element_size != sizeof(ValueType) ) { return false; }
+	add_column_transfers( transfers, reinterpret_cast<char*>( arrays[fid] ), sizeof(ValueType) * header.count, f->offset );
+	return true;
+}
+
+// writes size() elements of the given fields (all fields of arrays by default) to a new file
+template<typename FieldArraysT, typename... ids>
+static inline bool save( const std::string& filename, const FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	const SerializedHeader header = make_header( arrays, fids ... );
+	std::ostringstream header_stream;
+	write_header( header_stream, header );
+	const std::string header_bytes = header_stream.str();
+
+	std::vector<ColumnTransfer> transfers;
+	uint64_t file_size = header_bytes.size();
+	char* src[] = { nullptr, const_cast<char*>( reinterpret_cast<const char*>( arrays[fids] ) ) ... };
+	for(size_t i=0;i<header.fields.size();i++)
+	{
+		const SerializedField& f = header.fields[i];
+		add_column_transfers( transfers, src[i+1], f.element_size * header.count, f.offset );
+		file_size = std::max( file_size , f.offset + f.element_size * header.count );
+	}
+
+	int fd = open( filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+	if( fd < 0 ) { return false; }
+	bool ok = ftruncate( fd, file_size ) == 0
+	       && pwrite_all( fd, header_bytes.data(), header_bytes.size(), 0 )
+	       && run_column_transfers( fd, transfers, true );
+	ok = ( close( fd ) == 0 ) && ok;
+	return ok;
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline bool save( const std::string& filename, const FieldArraysT& arrays, const std::tuple< FieldId<ids> ... > & )
+{
+	return save( filename, arrays, FieldId<ids>() ... );
+}
+
+template<typename FieldArraysT>
+static inline bool save( const std::string& filename, const FieldArraysT& arrays )
+{
+	return save( filename, arrays, typename FieldArraysT::FieldIdsTuple () );
+}
+
+// resizes arrays to the stored element count and reads only the given fields (all fields of arrays by default).
+// returns false if the file cannot be read, or if a requested field is missing or has another type.
+template<typename FieldArraysT, typename... ids>
+static inline bool load( const std::string& filename, FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	SerializedHeader header;
+	{
+		std::ifstream in( filename, std::ios::binary );
+		if( ! read_header( in, header ) ) { return false; }
+	}
+	arrays.resize( header.count );
+
+	std::vector<ColumnTransfer> transfers;
+	const bool found[] = { true, add_column_read( transfers, header, arrays, fids ) ... };
+	for(bool b : found) { if( ! b ) return false; }
+
+	int fd = open( filename.c_str(), O_RDONLY );
+	if( fd < 0 ) { return false; }
+	const bool ok = run_column_transfers( fd, transfers, false );
+	close( fd );
+	return ok;
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline bool load( const std::string& filename, FieldArraysT& arrays, const std::tuple< FieldId<ids> ... > & )
+{
+	return load( filename, arrays, FieldId<ids>() ... );
+}
+
+template<typename FieldArraysT>
+static inline bool load( const std::string& filename, FieldArraysT& arrays )
+{
+	return load( filename, arrays, typename FieldArraysT::FieldIdsTuple () );
+}
+
+} // namespace soatl
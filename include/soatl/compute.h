@@ -1,8 +1,17 @@
 #pragma once
 
 #include "soatl/field_descriptor.h"
+#include "soatl/field_access.h"
+#include "soatl/field_encoding.h"
+#include "soatl/dirty_hooks.h"
 #include "soatl/variadic_template_utils.h"
 #include "soatl/simd.h"
+#include "soatl/non_temporal.h"
+#include "soatl/instrument.h"
+
+#include <tuple>
+#include <utility> // for std::index_sequence
+#include <algorithm> // for std::min
 
 // TODO: OpenMP parallel version for apply. with handling of alignment and chunksizes
 
@@ -14,6 +23,8 @@ namespace soatl
 template<typename OperatorT, typename... T>
 static inline void apply( OperatorT f, size_t N, T* __restrict__ ... arraypack )
 {
+	SOATL_INSTRUMENT_KERNEL("apply");
+	SOATL_TRACE_KERNEL("apply", N );
 #	ifndef NDEBUG
 	check_pointers_aliasing( N , arraypack ... );
 #	endif
@@ -33,19 +44,45 @@ static inline void apply( OperatorT f, size_t first, size_t N, T* __restrict__ .
 template<typename OperatorT, typename FieldArraysT, typename... ids>
 static inline void apply( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const FieldId<ids> & ... fids )
 {
-	apply( f, N, arrays[fids]+first ... );
+	mark_written( arrays, first, N, fids ... );
+	apply( field_kernel( f, arrays, fids ... ), N, arrays[fids]+first ... );
 }
 
 template<typename OperatorT, typename FieldArraysT, typename... ids>
 static inline void apply( OperatorT f, size_t N, FieldArraysT& arrays, const FieldId<ids> & ... fids )
 {
-	apply( f, N, arrays[fids] ... );
+	mark_written( arrays, 0, N, fids ... );
+	apply( field_kernel( f, arrays, fids ... ), N, arrays[fids] ... );
 }
 
 template<typename OperatorT, typename FieldArraysT, typename... ids>
 static inline void apply( OperatorT f, FieldArraysT& arrays, const FieldId<ids> & ... fids )
 {
-	apply( f, arrays.size(), arrays[fids] ... );
+	mark_written( arrays, 0, arrays.size(), fids ... );
+	apply( field_kernel( f, arrays, fids ... ), arrays.size(), arrays[fids] ... );
+}
+
+// field arrays with access annotations (read only fields are passed as const pointers)
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void apply( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	mark_written( arrays, first, N, fas ... );
+	apply( field_kernel( f, arrays, fas ... ), N, fas.pointer(arrays)+first ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void apply( OperatorT f, size_t N, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	mark_written( arrays, 0, N, fas ... );
+	apply( field_kernel( f, arrays, fas ... ), N, fas.pointer(arrays) ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void apply( OperatorT f, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	mark_written( arrays, 0, arrays.size(), fas ... );
+	apply( field_kernel( f, arrays, fas ... ), arrays.size(), fas.pointer(arrays) ... );
 }
 
 // Non-SIMD parallel versions
@@ -53,6 +90,8 @@ static inline void apply( OperatorT f, FieldArraysT& arrays, const FieldId<ids>
 template<typename OperatorT, typename... T>
 static inline void parallel_apply( OperatorT f, size_t N, T* __restrict__ ... arraypack )
 {
+	SOATL_INSTRUMENT_PARALLEL_KERNEL("parallel_apply");
+	SOATL_TRACE_KERNEL("parallel_apply", N );
 #	ifndef NDEBUG
 	check_pointers_aliasing( N , arraypack ... );
 #	endif
@@ -73,19 +112,45 @@ static inline void parallel_apply( OperatorT f, size_t first, size_t N, T* __res
 template<typename OperatorT, typename FieldArraysT, typename... ids>
 static inline void parallel_apply( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const FieldId<ids> & ... fids )
 {
-	parallel_apply( f, N, arrays[fids]+first ... );
+	mark_written( arrays, first, N, fids ... );
+	parallel_apply( field_kernel( f, arrays, fids ... ), N, arrays[fids]+first ... );
 }
 
 template<typename OperatorT, typename FieldArraysT, typename... ids>
 static inline void parallel_apply( OperatorT f, size_t N, FieldArraysT& arrays, const FieldId<ids> & ... fids )
 {
-	parallel_apply( f, N, arrays[fids] ... );
+	mark_written( arrays, 0, N, fids ... );
+	parallel_apply( field_kernel( f, arrays, fids ... ), N, arrays[fids] ... );
 }
 
 template<typename OperatorT, typename FieldArraysT, typename... ids>
 static inline void parallel_apply( OperatorT f, FieldArraysT& arrays, const FieldId<ids> & ... fids )
 {
-	parallel_apply( f, arrays.size(), arrays[fids] ... );
+	mark_written( arrays, 0, arrays.size(), fids ... );
+	parallel_apply( field_kernel( f, arrays, fids ... ), arrays.size(), arrays[fids] ... );
+}
+
+// field arrays with access annotations
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void parallel_apply( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	mark_written( arrays, first, N, fas ... );
+	parallel_apply( field_kernel( f, arrays, fas ... ), N, fas.pointer(arrays)+first ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void parallel_apply( OperatorT f, size_t N, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	mark_written( arrays, 0, N, fas ... );
+	parallel_apply( field_kernel( f, arrays, fas ... ), N, fas.pointer(arrays) ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void parallel_apply( OperatorT f, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	mark_written( arrays, 0, arrays.size(), fas ... );
+	parallel_apply( field_kernel( f, arrays, fas ... ), arrays.size(), fas.pointer(arrays) ... );
 }
 
 
@@ -97,6 +162,8 @@ static inline void parallel_apply( OperatorT f, FieldArraysT& arrays, const Fiel
 template<typename OperatorT, typename... T>
 static inline void apply_simd( OperatorT f, size_t N, T* __restrict__ ... arraypack )
 {
+	SOATL_INSTRUMENT_KERNEL("apply_simd");
+	SOATL_TRACE_KERNEL("apply_simd", N );
 #	ifndef NDEBUG
 	check_simd_pointers( N , arraypack ... );
 #	endif
@@ -111,6 +178,8 @@ static inline void apply_simd( OperatorT f, size_t N, T* __restrict__ ... arrayp
 template<typename OperatorT, size_t VECSIZE, typename... T>
 static inline void apply_simd( OperatorT f, size_t N, cst::chunk<VECSIZE>, T* __restrict__ ... arraypack )
 {
+	SOATL_INSTRUMENT_KERNEL("apply_simd");
+	SOATL_TRACE_KERNEL("apply_simd", N );
 #	ifndef NDEBUG
 	check_simd_pointers( N , arraypack ... );
 #	endif
@@ -138,13 +207,91 @@ static inline void apply_simd( OperatorT f, size_t first, size_t N, T* __restric
 }
 
 
+// non temporal stores : write only fields are computed tile by tile into local buffers, then streamed to memory
+
+template<size_t a, size_t b> struct StaticGCD { static constexpr size_t value = StaticGCD<b,a%b>::value; };
+template<size_t a> struct StaticGCD<a,0> { static constexpr size_t value = a; };
+
+template<typename OperatorT, size_t VECSIZE, typename... FieldAccessT>
+struct NonTemporalKernel
+{
+	// multiple of chunk size, keeping tiles of in place fields aligned
+	static constexpr size_t TileSize = NON_TEMPORAL_TILE_SIZE * ( VECSIZE / StaticGCD<NON_TEMPORAL_TILE_SIZE,VECSIZE>::value );
+	using Tiles = std::tuple< NonTemporalTile<FieldAccessT,TileSize> ... >;
+
+	// loops of apply_simd without instrumentation, only the driver traces its call
+	template<size_t V, typename... T>
+	static inline void tile_loop( OperatorT& f, size_t count, cst::chunk<V>, T* __restrict__ ... arraypack )
+	{
+		for(size_t i=0;i<count;i+=V)
+		{
+#			pragma omp simd
+			for(size_t j=0;j<V;j++)
+			{
+				f( arraypack[i+j] ... );
+			}
+		}
+	}
+
+	template<typename... T>
+	static inline void tile_loop( OperatorT& f, size_t count, cst::chunk<1>, T* __restrict__ ... arraypack )
+	{
+#		pragma omp simd
+		for(size_t i=0;i<count;i++)
+		{
+			f( arraypack[i] ... );
+		}
+	}
+
+	template<size_t... I>
+	static inline void apply_tile( OperatorT f, Tiles& tiles, size_t first, size_t count, std::index_sequence<I...>, typename FieldAccessT::pointer_type ... arraypack )
+	{
+		tile_loop( f, count, cst::chunk<VECSIZE>(), std::get<I>(tiles).tile(arraypack,first) ... );
+		TEMPLATE_LIST_BEGIN
+			std::get<I>(tiles).flush(arraypack,first,count)
+		TEMPLATE_LIST_END
+	}
+
+	static inline void apply( OperatorT f, size_t N, typename FieldAccessT::pointer_type ... arraypack )
+	{
+		SOATL_INSTRUMENT_KERNEL("apply_simd");
+		SOATL_TRACE_KERNEL("apply_simd", N );
+		Tiles tiles;
+		for(size_t first=0;first<N;first+=TileSize)
+		{
+			apply_tile( f, tiles, first, std::min( size_t(TileSize) , N-first ), std::index_sequence_for<FieldAccessT...>(), arraypack ... );
+		}
+		stream_fence();
+	}
+
+	static inline void parallel_apply( OperatorT f, size_t N, typename FieldAccessT::pointer_type ... arraypack )
+	{
+		SOATL_INSTRUMENT_PARALLEL_KERNEL("parallel_apply_simd");
+		SOATL_TRACE_KERNEL("parallel_apply_simd", N );
+		const size_t ntiles = ( N + TileSize - 1 ) / TileSize;
+#		pragma omp parallel
+		{
+			Tiles tiles;
+#			pragma omp for schedule(static)
+			for(size_t t=0;t<ntiles;t++)
+			{
+				const size_t first = t * TileSize;
+				apply_tile( f, tiles, first, std::min( size_t(TileSize) , N-first ), std::index_sequence_for<FieldAccessT...>(), arraypack ... );
+			}
+			stream_fence();
+		}
+	}
+};
+
+
 // field arrays
 
 template<typename OperatorT, typename FieldArraysT, typename... ids>
 static inline void apply_simd( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const FieldId<ids>& ... fids )
 {
 	// in this case chunk size  cannot be guaranted anymore (unless we check first value at runtime, which compiler will do better on its own)
-	apply_simd( f, N, arrays[fids]+first ... );
+	mark_written( arrays, first, N, fids ... );
+	apply_simd( field_kernel( f, arrays, fids ... ), N, arrays[fids]+first ... );
 }
 
 template<typename OperatorT, typename FieldArraysT, typename... ids>
@@ -156,7 +303,8 @@ static inline void apply_simd( OperatorT f, size_t N, FieldArraysT& arrays, cons
 	TEMPLATE_LIST_END
 #	endif
 
-	apply_simd( f, N, cst::chunk<FieldArraysT::ChunkSize>(), arrays[fids] ... );
+	mark_written( arrays, 0, N, fids ... );
+	apply_simd( field_kernel( f, arrays, fids ... ), N, cst::chunk<FieldArraysT::ChunkSize>(), arrays[fids] ... );
 }
 
 template<typename OperatorT, typename FieldArraysT, typename... ids>
@@ -168,7 +316,44 @@ static inline void apply_simd( OperatorT f, FieldArraysT& arrays, const FieldId<
 	TEMPLATE_LIST_END
 #	endif
 
-	apply_simd( f, arrays.size(), cst::chunk<FieldArraysT::ChunkSize>(), arrays[fids] ... );
+	mark_written( arrays, 0, arrays.size(), fids ... );
+	apply_simd( field_kernel( f, arrays, fids ... ), arrays.size(), cst::chunk<FieldArraysT::ChunkSize>(), arrays[fids] ... );
+}
+
+// field arrays with access annotations
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void apply_simd( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	mark_written( arrays, first, N, fas ... );
+	apply_simd( field_kernel( f, arrays, fas ... ), N, fas.pointer(arrays)+first ... );
+}
+
+// write only fields use streaming stores when the kernel's working set exceeds non_temporal_threshold()
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void apply_simd( OperatorT f, size_t N, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+#	ifndef NDEBUG
+	TEMPLATE_LIST_BEGIN
+		assert( ( arrays.alignment() % SimdRequirements< typename FieldAccess<ids,modes>::value_type >::alignment ) == 0 ) 
+	TEMPLATE_LIST_END
+#	endif
+
+	mark_written( arrays, 0, N, fas ... );
+	if( use_non_temporal_stores< FieldArraysT::Alignment, FieldAccess<ids,modes>... >( N ) )
+	{
+		NonTemporalKernel< decltype( field_kernel( f, arrays, fas ... ) ), FieldArraysT::ChunkSize, FieldAccess<ids,modes>... >::apply( field_kernel( f, arrays, fas ... ), N, fas.pointer(arrays) ... );
+	}
+	else
+	{
+		apply_simd( field_kernel( f, arrays, fas ... ), N, cst::chunk<FieldArraysT::ChunkSize>(), fas.pointer(arrays) ... );
+	}
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void apply_simd( OperatorT f, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	apply_simd( f, arrays.size(), arrays, fas ... );
 }
 
 
@@ -182,6 +367,8 @@ static inline void apply_simd( OperatorT f, FieldArraysT& arrays, const FieldId<
 template<typename OperatorT, typename... T>
 static inline void parallel_apply_simd( OperatorT f, size_t N, T* __restrict__ ... arraypack )
 {
+	SOATL_INSTRUMENT_PARALLEL_KERNEL("parallel_apply_simd");
+	SOATL_TRACE_KERNEL("parallel_apply_simd", N );
 #	ifndef NDEBUG
 	check_simd_pointers( N , arraypack ... );
 #	endif
@@ -196,6 +383,8 @@ static inline void parallel_apply_simd( OperatorT f, size_t N, T* __restrict__ .
 template<typename OperatorT, size_t VECSIZE, typename... T>
 static inline void parallel_apply_simd( OperatorT f, size_t N, cst::chunk<VECSIZE>, T* __restrict__ ... arraypack )
 {
+	SOATL_INSTRUMENT_PARALLEL_KERNEL("parallel_apply_simd");
+	SOATL_TRACE_KERNEL("parallel_apply_simd", N );
 #	ifndef NDEBUG
 	check_simd_pointers( N , arraypack ... );
 #	endif
@@ -232,7 +421,8 @@ template<typename OperatorT, typename FieldArraysT, typename... ids>
 static inline void parallel_apply_simd( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const FieldId<ids>& ... fids )
 {
 	// in this case chunk size  cannot be guaranted anymore (unless we check first value at runtime, which compiler will do better on its own)
-	parallel_apply_simd( f, N, arrays[fids]+first ... );
+	mark_written( arrays, first, N, fids ... );
+	parallel_apply_simd( field_kernel( f, arrays, fids ... ), N, arrays[fids]+first ... );
 }
 
 template<typename OperatorT, typename FieldArraysT, typename... ids>
@@ -244,7 +434,8 @@ static inline void parallel_apply_simd( OperatorT f, size_t N, FieldArraysT& arr
 	TEMPLATE_LIST_END
 #	endif
 
-	parallel_apply_simd( f, N, cst::chunk<FieldArraysT::ChunkSize>(), arrays[fids] ... );
+	mark_written( arrays, 0, N, fids ... );
+	parallel_apply_simd( field_kernel( f, arrays, fids ... ), N, cst::chunk<FieldArraysT::ChunkSize>(), arrays[fids] ... );
 }
 
 template<typename OperatorT, typename FieldArraysT, typename... ids>
@@ -256,7 +447,43 @@ static inline void parallel_apply_simd( OperatorT f, FieldArraysT& arrays, const
 	TEMPLATE_LIST_END
 #	endif
 
-	parallel_apply_simd( f, arrays.size(), cst::chunk<FieldArraysT::ChunkSize>(), arrays[fids] ... );
+	mark_written( arrays, 0, arrays.size(), fids ... );
+	parallel_apply_simd( field_kernel( f, arrays, fids ... ), arrays.size(), cst::chunk<FieldArraysT::ChunkSize>(), arrays[fids] ... );
+}
+
+// field arrays with access annotations
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void parallel_apply_simd( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	mark_written( arrays, first, N, fas ... );
+	parallel_apply_simd( field_kernel( f, arrays, fas ... ), N, fas.pointer(arrays)+first ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void parallel_apply_simd( OperatorT f, size_t N, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+#	ifndef NDEBUG
+	TEMPLATE_LIST_BEGIN
+		assert( ( arrays.alignment() % SimdRequirements< typename FieldAccess<ids,modes>::value_type >::alignment ) == 0 ) 
+	TEMPLATE_LIST_END
+#	endif
+
+	mark_written( arrays, 0, N, fas ... );
+	if( use_non_temporal_stores< FieldArraysT::Alignment, FieldAccess<ids,modes>... >( N ) )
+	{
+		NonTemporalKernel< decltype( field_kernel( f, arrays, fas ... ) ), FieldArraysT::ChunkSize, FieldAccess<ids,modes>... >::parallel_apply( field_kernel( f, arrays, fas ... ), N, fas.pointer(arrays) ... );
+	}
+	else
+	{
+		parallel_apply_simd( field_kernel( f, arrays, fas ... ), N, cst::chunk<FieldArraysT::ChunkSize>(), fas.pointer(arrays) ... );
+	}
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void parallel_apply_simd( OperatorT f, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	parallel_apply_simd( f, arrays.size(), arrays, fas ... );
 }
 
 } // namespace soatl
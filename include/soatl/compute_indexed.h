@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <algorithm> // for std::min
+#include <type_traits>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_access.h"
+#include "soatl/field_encoding.h"
+#include "soatl/dirty_hooks.h"
+#include "soatl/constants.h"
+#include "soatl/variadic_template_utils.h"
+#include "soatl/simd.h"
+#include "soatl/instrument.h"
+
+/*
+Index space versions of apply : the kernel is applied to elements named by an index list, i.e. f( array[indices[k]] ... ) for k in [0;count[.
+Index list is processed in blocks of INDEXED_BLOCK_SIZE. Blocks of consecutive indices use contiguous loads and stores,
+other blocks use gathers/scatters (when the target ISA has them). Elements of the block located cst::prefetch<D> indices ahead are prefetched.
+When a field is written, indices must be unique.
+*/
+
+namespace soatl
+{
+
+static constexpr size_t INDEXED_BLOCK_SIZE = 32;
+static constexpr size_t DEFAULT_PREFETCH_DISTANCE = 16;
+
+template<typename T>
+static inline void prefetch_element( T* ptr )
+{
+	__builtin_prefetch( ptr , std::is_const<T>::value ? 0 : 1 );
+}
+
+// processes indices [first;first+n[, with n <= INDEXED_BLOCK_SIZE
+template<size_t PD, typename OperatorT, typename IndexT, typename... T>
+static inline void apply_indexed_block( OperatorT f, const IndexT* __restrict__ indices, size_t first, size_t n, size_t count, T* __restrict__ ... arraypack )
+{
+	const IndexT* __restrict__ block = indices + first;
+
+	bool contiguous = true;
+#	pragma omp simd reduction(&&:contiguous)
+	for(size_t k=1;k<n;k++)
+	{
+		contiguous = contiguous && ( block[k] == static_cast<IndexT>( block[0] + k ) );
+	}
+
+	if( contiguous )
+	{
+		const size_t start = block[0];
+#		pragma omp simd
+		for(size_t k=0;k<n;k++)
+		{
+			f( arraypack[start+k] ... );
+		}
+	}
+	else
+	{
+		if( PD > 0 )
+		{
+			const size_t pf_end = std::min( first + n + PD , count );
+			for(size_t k=first+PD;k<pf_end;k++)
+			{
+				TEMPLATE_LIST_BEGIN
+					prefetch_element( arraypack + indices[k] )
+				TEMPLATE_LIST_END
+			}
+		}
+#		pragma omp simd
+		for(size_t k=0;k<n;k++)
+		{
+			f( arraypack[block[k]] ... );
+		}
+	}
+}
+
+// raw pointers
+
+template<typename OperatorT, typename IndexT, size_t PD, typename... T>
+static inline void apply_indexed( OperatorT f, const IndexT* __restrict__ indices, size_t count, cst::prefetch<PD>, T* __restrict__ ... arraypack )
+{
+	SOATL_INSTRUMENT_KERNEL("apply_indexed");
+	SOATL_TRACE_KERNEL("apply_indexed", count );
+	for(size_t i=0;i<count;i+=INDEXED_BLOCK_SIZE)
+	{
+		apply_indexed_block<PD>( f, indices, i, std::min(count-i,INDEXED_BLOCK_SIZE), count, arraypack ... );
+	}
+}
+
+template<typename OperatorT, typename IndexT, typename... T>
+static inline void apply_indexed( OperatorT f, const IndexT* __restrict__ indices, size_t count, T* __restrict__ ... arraypack )
+{
+	apply_indexed( f, indices, count, cst::prefetch<DEFAULT_PREFETCH_DISTANCE>(), arraypack ... );
+}
+
+template<typename OperatorT, typename IndexT, size_t PD, typename... T>
+static inline void parallel_apply_indexed( OperatorT f, const IndexT* __restrict__ indices, size_t count, cst::prefetch<PD>, T* __restrict__ ... arraypack )
+{
+	SOATL_INSTRUMENT_PARALLEL_KERNEL("parallel_apply_indexed");
+	SOATL_TRACE_KERNEL("parallel_apply_indexed", count );
+	const size_t nblocks = ( count + INDEXED_BLOCK_SIZE - 1 ) / INDEXED_BLOCK_SIZE;
+
+#	pragma omp parallel for schedule(static)
+	for(size_t b=0;b<nblocks;b++)
+	{
+		const size_t i = b * INDEXED_BLOCK_SIZE;
+		apply_indexed_block<PD>( f, indices, i, std::min(count-i,INDEXED_BLOCK_SIZE), count, arraypack ... );
+	}
+}
+
+template<typename OperatorT, typename IndexT, typename... T>
+static inline void parallel_apply_indexed( OperatorT f, const IndexT* __restrict__ indices, size_t count, T* __restrict__ ... arraypack )
+{
+	parallel_apply_indexed( f, indices, count, cst::prefetch<DEFAULT_PREFETCH_DISTANCE>(), arraypack ... );
+}
+
+// field arrays
+
+template<typename OperatorT, typename IndexT, size_t PD, typename FieldArraysT, typename... ids>
+static inline void apply_indexed( OperatorT f, const IndexT* indices, size_t count, cst::prefetch<PD> pd, FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	mark_written_indices( arrays, indices, count, fids ... );
+	apply_indexed( field_kernel( f, arrays, fids ... ), indices, count, pd, arrays[fids] ... );
+}
+
+template<typename OperatorT, typename IndexT, typename FieldArraysT, typename... ids>
+static inline void apply_indexed( OperatorT f, const IndexT* indices, size_t count, FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	mark_written_indices( arrays, indices, count, fids ... );
+	apply_indexed( field_kernel( f, arrays, fids ... ), indices, count, arrays[fids] ... );
+}
+
+template<typename OperatorT, typename IndexT, size_t PD, typename FieldArraysT, typename... ids>
+static inline void parallel_apply_indexed( OperatorT f, const IndexT* indices, size_t count, cst::prefetch<PD> pd, FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	mark_written_indices( arrays, indices, count, fids ... );
+	parallel_apply_indexed( field_kernel( f, arrays, fids ... ), indices, count, pd, arrays[fids] ... );
+}
+
+template<typename OperatorT, typename IndexT, typename FieldArraysT, typename... ids>
+static inline void parallel_apply_indexed( OperatorT f, const IndexT* indices, size_t count, FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	mark_written_indices( arrays, indices, count, fids ... );
+	parallel_apply_indexed( field_kernel( f, arrays, fids ... ), indices, count, arrays[fids] ... );
+}
+
+// field arrays with access annotations
+
+template<typename OperatorT, typename IndexT, size_t PD, typename FieldArraysT, typename... ids, typename... modes>
+static inline void apply_indexed( OperatorT f, const IndexT* indices, size_t count, cst::prefetch<PD> pd, FieldArraysT& arrays, const FieldAccess<ids,modes>& ... fas )
+{
+	mark_written_indices( arrays, indices, count, fas ... );
+	apply_indexed( field_kernel( f, arrays, fas ... ), indices, count, pd, fas.pointer(arrays) ... );
+}
+
+template<typename OperatorT, typename IndexT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void apply_indexed( OperatorT f, const IndexT* indices, size_t count, FieldArraysT& arrays, const FieldAccess<ids,modes>& ... fas )
+{
+	mark_written_indices( arrays, indices, count, fas ... );
+	apply_indexed( field_kernel( f, arrays, fas ... ), indices, count, fas.pointer(arrays) ... );
+}
+
+template<typename OperatorT, typename IndexT, size_t PD, typename FieldArraysT, typename... ids, typename... modes>
+static inline void parallel_apply_indexed( OperatorT f, const IndexT* indices, size_t count, cst::prefetch<PD> pd, FieldArraysT& arrays, const FieldAccess<ids,modes>& ... fas )
+{
+	mark_written_indices( arrays, indices, count, fas ... );
+	parallel_apply_indexed( field_kernel( f, arrays, fas ... ), indices, count, pd, fas.pointer(arrays) ... );
+}
+
+template<typename OperatorT, typename IndexT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void parallel_apply_indexed( OperatorT f, const IndexT* indices, size_t count, FieldArraysT& arrays, const FieldAccess<ids,modes>& ... fas )
+{
+	mark_written_indices( arrays, indices, count, fas ... );
+	parallel_apply_indexed( field_kernel( f, arrays, fas ... ), indices, count, fas.pointer(arrays) ... );
+}
+
+} // namespace soatl
+
@@ -11,6 +11,7 @@ namespace cst
 	template<size_t C> struct chunk { static inline void f(){ static_assert(C>0,"chunk size cannot be 0"); } };
 	template<size_t> struct at {};
 	template<size_t> struct count {};
+	template<size_t> struct prefetch {};
 
 	cst::align<1> unaligned;
 	cst::align<1> aligned_1;
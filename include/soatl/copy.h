@@ -1,20 +1,67 @@
 #pragma once
 
 #include "soatl/field_descriptor.h"
+#include "soatl/non_temporal.h"
+#include "soatl/dirty_hooks.h"
+#include "soatl/instrument.h"
+#include "soatl/alloc_stats.h"
+#include "soatl/variadic_template_utils.h"
 #include <cstdlib> // for size_t
+#include <cstdint>
 #include <cstring>
 #include <algorithm>
 #include <tuple>
 
 namespace soatl
 {
+	// bit planes of elements [start,start+count[ (see BitPlanes in field_descriptor.h), partially covered words are merged
+	static inline void copy_bit_planes( uint64_t* dst, const uint64_t* src, size_t bits, size_t start, size_t count )
+	{
+		const size_t end = start + count;
+		for(size_t b=start/BIT_PLANE_BLOCK; b*BIT_PLANE_BLOCK<end; b++)
+		{
+			const size_t lo = std::max( start, b*BIT_PLANE_BLOCK ) - b*BIT_PLANE_BLOCK;
+			const size_t hi = std::min( end, (b+1)*BIT_PLANE_BLOCK ) - b*BIT_PLANE_BLOCK;
+			const uint64_t m = ( ( hi == BIT_PLANE_BLOCK ) ? ~uint64_t(0) : ( ( uint64_t(1) << hi ) - 1 ) ) & ~( ( uint64_t(1) << lo ) - 1 );
+			for(size_t k=0;k<bits;k++) { dst[b*bits+k] = ( dst[b*bits+k] & ~m ) | ( src[b*bits+k] & m ); }
+		}
+	}
+
+	template<typename id>
+	struct FieldStripeCopy
+	{
+		template<typename T>
+		static inline void copy( T* dst, const T* src, size_t start, size_t count, bool stream )
+		{
+			// copy, version 1 : always work. streamed copies use non temporal stores above a size threshold (see non_temporal.h)
+			if( stream ) { non_temporal_copy( dst+start, src+start, sizeof(T)*count ); }
+			else { std::memcpy( dst+start, src+start, sizeof(T)*count ); }
+
+			// copy, version 2 : crashes if compiler generates aligned move instructions and arrays alignment is not sufficient. It happens with gcc 5.4 (-O3)
+			//for(size_t i=start; i<(start+count); i++) { dst[i] = src[i]; }
+
+			// copy, version 3 : always work, might be less efficient than memcpy
+			//uint8_t* d = reinterpret_cast<uint8_t*>( dst );
+			//const uint8_t* s = reinterpret_cast<const uint8_t*>( src );
+			//for(size_t i=start*sizeof(T); i<(start+count)*sizeof(T); i++) { d[i] = s[i]; }
+		}
+	};
+
+	template<typename id>
+	struct FieldStripeCopy< BitPlanes<id> >
+	{
+		static inline void copy( uint64_t* dst, const uint64_t* src, size_t start, size_t count, bool )
+		{
+			copy_bit_planes( dst, src, BitFieldId<id>::bits, start, count );
+		}
+	};
+
 	template<typename DstArrays, typename SrcArrays, typename... _ids> struct FieldArraysCopyHelper;
 	template<typename DstArrays, typename SrcArrays, typename id, typename... _ids>
 	struct FieldArraysCopyHelper<DstArrays,SrcArrays, id, _ids...>
 	{
-		static inline void copy( DstArrays& dst, const SrcArrays& src, size_t start, size_t count )
+		static inline void copy( DstArrays& dst, const SrcArrays& src, size_t start, size_t count, bool stream )
 		{
-			using ValueType = typename FieldDescriptor<id>::value_type;
 			/*
 			std::cout<<"copy : field='"<< FieldDescriptor<id>::name()
 				 <<"', range=["<<start<<";"<<start+count<<"[, d="
@@ -22,28 +69,16 @@ namespace soatl
 				 <<(void*)(src[FieldId<id>()]+start)
 				 << std::endl;
 			*/
+			FieldStripeCopy<id>::copy( dst[FieldId<id>()], src[FieldId<id>()], start, count, stream );
 
-			// copy, version 1 : always work
-			std::memcpy( dst[FieldId<id>()]+start, src[FieldId<id>()]+start, sizeof(ValueType)*count );			
-
-			// copy, version 2 : crashes if compiler generates aligned move instructions and arrays alignment is not sufficient. It happens with gcc 5.4 (-O3)
-			//auto d = dst[ FieldId<id>() ];
-			//auto s = src[ FieldId<id>() ];
-			//for(size_t i=start; i<(start+count); i++) { d[i] = s[i]; }
-			
-			// copy, version 3 : always work, might be less efficient than memcpy
-			//uint8_t* d = reinterpret_cast<uint8_t*>( dst[ FieldId<id>() ] );
-			//const uint8_t* s = reinterpret_cast<uint8_t*>( src[ FieldId<id>() ] );
-			//for(size_t i=start*sizeof(ValueType); i<(start+count)*sizeof(ValueType); i++) { d[i] = s[i]; }
-
-			FieldArraysCopyHelper<DstArrays,SrcArrays,_ids...>::copy(dst,src,start,count);
+			FieldArraysCopyHelper<DstArrays,SrcArrays,_ids...>::copy(dst,src,start,count,stream);
 		}
 	};
 
 	template<typename DstArrays, typename SrcArrays>
 	struct FieldArraysCopyHelper<DstArrays,SrcArrays>
 	{
-		static inline void copy(DstArrays&,const SrcArrays&,size_t,size_t) {}
+		static inline void copy(DstArrays&,const SrcArrays&,size_t,size_t,bool) {}
 	};
 
 	template<typename DstArrays, typename SrcArrays, typename... _ids>
@@ -51,7 +86,12 @@ namespace soatl
 	{
 		assert( (start+count) <= dst.size() );
 		assert( (start+count) <= src.size() );
-		FieldArraysCopyHelper<DstArrays,SrcArrays,_ids...>::copy(dst,src,start,count);
+		SOATL_INSTRUMENT_KERNEL("copy");
+		SOATL_TRACE_FIELDS( count, _ids... );
+		SOATL_TRACE_KERNEL("copy", count );
+		if( count > 0 ) { SOATL_ALLOC_STATS_COPY( DstArrays, detail::sum_of( { FieldStorage<_ids>::bytes(count) ... } ) ); }
+		mark_written( dst, start, count, std::tuple< FieldId<_ids> ... >() );
+		FieldArraysCopyHelper<DstArrays,SrcArrays,_ids...>::copy(dst,src,start,count,false);
 	}
 
 	template<typename DstArrays, typename SrcArrays, typename... _ids>
@@ -69,7 +109,7 @@ namespace soatl
 	template<typename DstArrays, typename SrcArrays, typename... _ids>
 	static inline void copy( DstArrays& dst, const SrcArrays& src, const FieldId<_ids>&... )
 	{
-		copy( dst, src, 0, std::min(dst.size(),src.size()), typename SrcArrays::FieldIdsTuple () );
+		copy( dst, src, 0, std::min(dst.size(),src.size()), std::tuple<FieldId<_ids>...>() );
 	}
 
 	template<typename DstArrays, typename SrcArrays>
@@ -77,5 +117,70 @@ namespace soatl
 	{
 		copy( dst, src, 0, std::min(dst.size(),src.size()), typename SrcArrays::FieldIdsTuple () );
 	}
-}
 
+	// same as copy, large fields are written with streaming stores, bypassing the cache.
+	// only worth it when dst is not read soon after the copy.
+	template<typename DstArrays, typename SrcArrays, typename... _ids>
+	static inline void stream_copy( DstArrays& dst, const SrcArrays& src, size_t start, size_t count, const std::tuple< FieldId<_ids> ... > & )
+	{
+		assert( (start+count) <= dst.size() );
+		assert( (start+count) <= src.size() );
+		SOATL_INSTRUMENT_KERNEL("stream_copy");
+		SOATL_TRACE_FIELDS( count, _ids... );
+		SOATL_TRACE_KERNEL("stream_copy", count );
+		if( count > 0 ) { SOATL_ALLOC_STATS_COPY( DstArrays, detail::sum_of( { FieldStorage<_ids>::bytes(count) ... } ) ); }
+		mark_written( dst, start, count, std::tuple< FieldId<_ids> ... >() );
+		FieldArraysCopyHelper<DstArrays,SrcArrays,_ids...>::copy(dst,src,start,count,true);
+	}
+
+	template<typename DstArrays, typename SrcArrays, typename... _ids>
+	static inline void stream_copy( DstArrays& dst, const SrcArrays& src, const FieldId<_ids>&... )
+	{
+		stream_copy( dst, src, 0, std::min(dst.size(),src.size()), std::tuple<FieldId<_ids>...>() );
+	}
+
+	template<typename DstArrays, typename SrcArrays>
+	static inline void stream_copy( DstArrays& dst, const SrcArrays& src)
+	{
+		stream_copy( dst, src, 0, std::min(dst.size(),src.size()), typename SrcArrays::FieldIdsTuple () );
+	}
+
+	// same as copy, blocks of PARALLEL_COPY_BLOCK_SIZE elements are distributed to OpenMP threads with a static schedule.
+	// copying into a freshly allocated container places its pages on the NUMA nodes of the threads (first touch).
+	// blocks start at multiples of PARALLEL_COPY_BLOCK_SIZE, threads never share a word of bit fields.
+	static constexpr size_t PARALLEL_COPY_BLOCK_SIZE = 1<<12;
+
+	template<typename DstArrays, typename SrcArrays, typename... _ids>
+	static inline void parallel_copy( DstArrays& dst, const SrcArrays& src, size_t start, size_t count, const std::tuple< FieldId<_ids> ... > & )
+	{
+		assert( (start+count) <= dst.size() );
+		assert( (start+count) <= src.size() );
+		SOATL_INSTRUMENT_PARALLEL_KERNEL("parallel_copy");
+		SOATL_TRACE_FIELDS( count, _ids... );
+		SOATL_TRACE_KERNEL("parallel_copy", count );
+		if( count > 0 ) { SOATL_ALLOC_STATS_COPY( DstArrays, detail::sum_of( { FieldStorage<_ids>::bytes(count) ... } ) ); }
+		mark_written( dst, start, count, std::tuple< FieldId<_ids> ... >() );
+		const size_t end = start + count;
+		const size_t first_block = start / PARALLEL_COPY_BLOCK_SIZE;
+		const size_t nblocks = ( count > 0 ) ? ( ( end - 1 ) / PARALLEL_COPY_BLOCK_SIZE - first_block + 1 ) : 0;
+#		pragma omp parallel for schedule(static) if( nblocks > 1 )
+		for(size_t b=0;b<nblocks;b++)
+		{
+			const size_t first = std::max( start, ( first_block + b ) * PARALLEL_COPY_BLOCK_SIZE );
+			const size_t last = std::min( end, ( first_block + b + 1 ) * PARALLEL_COPY_BLOCK_SIZE );
+			FieldArraysCopyHelper<DstArrays,SrcArrays,_ids...>::copy(dst,src,first,last-first,false);
+		}
+	}
+
+	template<typename DstArrays, typename SrcArrays, typename... _ids>
+	static inline void parallel_copy( DstArrays& dst, const SrcArrays& src, const FieldId<_ids>&... )
+	{
+		parallel_copy( dst, src, 0, std::min(dst.size(),src.size()), std::tuple<FieldId<_ids>...>() );
+	}
+
+	template<typename DstArrays, typename SrcArrays>
+	static inline void parallel_copy( DstArrays& dst, const SrcArrays& src)
+	{
+		parallel_copy( dst, src, 0, std::min(dst.size(),src.size()), typename SrcArrays::FieldIdsTuple () );
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <type_traits>
+#include <utility> // for std::declval
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_access.h"
+#include "soatl/variadic_template_utils.h"
+#include "soatl/instrument.h"
+
+/*
+Containers tracking modifications (see tracked_field_arrays.h) have a mark_dirty(FieldId,first,count) member.
+Drivers writing to containers (apply*, copy, ...) notify them with mark_written(), which does nothing for other containers.
+Fields passed without access annotation are considered written.
+Field level drivers all call them first, they also name the fields of the driver's trace event (see trace.h).
+*/
+
+namespace soatl
+{
+
+template<typename FieldArraysT, typename id, typename = void>
+struct DirtyTracking
+{
+	static constexpr bool enabled = false;
+	static inline void mark( FieldArraysT&, size_t, size_t ) {}
+};
+
+template<typename FieldArraysT, typename id>
+struct DirtyTracking< FieldArraysT, id, typename detail::make_void< decltype( std::declval<FieldArraysT&>().mark_dirty( FieldId<id>(), size_t(0), size_t(0) ) ) >::type >
+{
+	static constexpr bool enabled = true;
+	static inline void mark( FieldArraysT& arrays, size_t first, size_t count ) { arrays.mark_dirty( FieldId<id>(), first, count ); }
+};
+
+// marks elements [first,first+count) of written fields
+template<typename FieldArraysT, typename... ids, typename... modes>
+static inline void mark_written( FieldArraysT& arrays, size_t first, size_t count, const FieldAccess<ids,modes> & ... )
+{
+	SOATL_TRACE_FIELDS( count, ids... );
+	TEMPLATE_LIST_BEGIN
+		( modes::writes ? DirtyTracking<FieldArraysT,ids>::mark( arrays, first, count ) : void() )
+	TEMPLATE_LIST_END
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline void mark_written( FieldArraysT& arrays, size_t first, size_t count, const FieldId<ids> & ... )
+{
+	SOATL_TRACE_FIELDS( count, ids... );
+	TEMPLATE_LIST_BEGIN
+		DirtyTracking<FieldArraysT,ids>::mark( arrays, first, count )
+	TEMPLATE_LIST_END
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline void mark_written( FieldArraysT& arrays, size_t first, size_t count, const std::tuple< FieldId<ids> ... > & )
+{
+	mark_written( arrays, first, count, FieldId<ids>() ... );
+}
+
+// marks the elements at given indices, for kernels applied through an index list
+template<typename FieldArraysT, typename IndexT, typename... ids, typename... modes>
+static inline void mark_written_indices( FieldArraysT& arrays, const IndexT* indices, size_t count, const FieldAccess<ids,modes> & ... fas )
+{
+	if( detail::any_of( { false, ( modes::writes && DirtyTracking<FieldArraysT,ids>::enabled ) ... } ) )
+	{
+		for(size_t k=0;k<count;k++) { mark_written( arrays, indices[k], 1, fas ... ); }
+	}
+	SOATL_TRACE_FIELDS( count, ids... );
+}
+
+template<typename FieldArraysT, typename IndexT, typename... ids>
+static inline void mark_written_indices( FieldArraysT& arrays, const IndexT* indices, size_t count, const FieldId<ids> & ... fids )
+{
+	if( detail::any_of( { false, DirtyTracking<FieldArraysT,ids>::enabled ... } ) )
+	{
+		for(size_t k=0;k<count;k++) { mark_written( arrays, indices[k], 1, fids ... ); }
+	}
+	SOATL_TRACE_FIELDS( count, ids... );
+}
+
+} // namespace soatl
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <type_traits>
+
+#include "soatl/field_descriptor.h"
+
+namespace soatl
+{
+
+// access mode tags
+namespace access
+{
+	struct read_only { static constexpr bool reads = true; static constexpr bool writes = false; };
+	struct write_only { static constexpr bool reads = false; static constexpr bool writes = true; };
+	struct read_write { static constexpr bool reads = true; static constexpr bool writes = true; };
+}
+
+// a field id annotated with the way a kernel accesses it.
+// read only fields are handed to kernels through const pointers.
+template<typename _id, typename _mode>
+struct FieldAccess
+{
+	using Id = _id;
+	using Mode = _mode;
+	using value_type = typename FieldDescriptor<_id>::value_type;
+	using pointer_type = typename std::conditional< _mode::writes , value_type* , const value_type* >::type;
+
+	static constexpr bool reads = _mode::reads;
+	static constexpr bool writes = _mode::writes;
+
+	template<typename FieldArraysT>
+	static inline pointer_type pointer( FieldArraysT& arrays ) { return arrays[ FieldId<_id>() ]; }
+};
+
+template<typename id> static inline FieldAccess<id,access::read_only> read( const FieldId<id>& ) { return FieldAccess<id,access::read_only>(); }
+template<typename id> static inline FieldAccess<id,access::write_only> write( const FieldId<id>& ) { return FieldAccess<id,access::write_only>(); }
+template<typename id> static inline FieldAccess<id,access::read_write> readwrite( const FieldId<id>& ) { return FieldAccess<id,access::read_write>(); }
+
+} // namespace soatl
+
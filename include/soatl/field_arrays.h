@@ -10,6 +10,11 @@
 #include "soatl/constants.h"
 #include "soatl/memory.h"
 #include "soatl/simd.h"
+#include "soatl/instrument.h"
+#include "soatl/tuned_defaults.h"
+#include "soatl/alloc_stats.h"
+#include "soatl/variadic_template_utils.h"
+#include "soatl/field_rows.h"
 
 /*
 The  function posix_memalign() allocates size bytes and places the address of the allocated memory in *memptr.  The address of the allocated memory will be a multiple of alignment, which must
@@ -51,12 +56,14 @@ struct FieldArrays
 	{
 		if( s != m_size )
 		{
+			SOATL_ALLOC_STATS_SLACK( FieldArrays, slack_size(m_capacity,m_size), 0 );
 			size_t new_capacity = AllocStrategy::update_capacity(s,capacity(),chunksize());
 			if( new_capacity != m_capacity )
 			{
 				reallocate( new_capacity );
 			}
 			m_size = s;
+			SOATL_ALLOC_STATS_SLACK( FieldArrays, 0, slack_size(m_capacity,m_size) );
 		}
 	}
 
@@ -64,6 +71,20 @@ struct FieldArrays
 	inline size_t chunk_ceil() const { return ( (size()+chunksize()-1) / chunksize() ) * chunksize(); }
 	inline size_t capacity() const { return m_capacity; }
 
+	// storage of the elements between size and capacity, summed over fields
+	static inline size_t slack_size(size_t capacity, size_t size)
+	{
+		return detail::sum_of( { FieldStorage<ids>::bytes(capacity) - FieldStorage<ids>::bytes(size) ... } );
+	}
+
+	// proxies to element i of all fields, row iterators for standard algorithms (see field_rows.h)
+	inline FieldArraysRow<FieldArrays> row( size_t i ) { return FieldArraysRow<FieldArrays>( this, i ); }
+	inline FieldArraysRow<const FieldArrays> row( size_t i ) const { return FieldArraysRow<const FieldArrays>( this, i ); }
+	inline FieldArraysRowIterator<FieldArrays> begin() { return FieldArraysRowIterator<FieldArrays>( this, 0 ); }
+	inline FieldArraysRowIterator<FieldArrays> end() { return FieldArraysRowIterator<FieldArrays>( this, size() ); }
+	inline FieldArraysRowIterator<const FieldArrays> begin() const { return FieldArraysRowIterator<const FieldArrays>( this, 0 ); }
+	inline FieldArraysRowIterator<const FieldArrays> end() const { return FieldArraysRowIterator<const FieldArrays>( this, size() ); }
+
 	static inline constexpr size_t alignment() { return Alignment; }
 	static inline constexpr size_t chunksize() { return ChunkSize; }
 
@@ -81,6 +102,7 @@ private:
 	inline void reallocate_pointer( std::integral_constant<size_t,N> , size_t s )
 	{
 		using ValueType = typename std::decay< decltype( * std::get<N-1>( m_field_arrays ) ) >::type;
+		using Storage = FieldStorage< typename std::tuple_element< N-1 , std::tuple<ids...> >::type >;
 		ValueType * old_ptr = std::get<N-1>( m_field_arrays );
 		ValueType * new_ptr = nullptr;
 		if( s > 0 )
@@ -88,25 +110,34 @@ private:
 			// here, we use posix_memalign (and not realloc) to benefit from aligned memory allocation provided by system library
 			size_t a = std::max( alignment() , sizeof(void*) ); // this is required by posix_memalign.
 			void* memptr = nullptr;
-			int r = posix_memalign( &memptr, a, s*sizeof(ValueType) );
+			int r = posix_memalign( &memptr, a, Storage::bytes(s) );
 			assert( r == 0 );
 			new_ptr = reinterpret_cast<ValueType*>( memptr );
+			SOATL_ALLOC_STATS_ALLOCATE( FieldArrays, Storage::bytes(s), 0 );
 		}
 		if( old_ptr!=nullptr && new_ptr!=nullptr )
 		{
-			// we don't use realloc, so we have to copy elements
-			size_t cs = std::min(s,m_size);
+			// we don't use realloc, so we have to copy stored values (words of bit fields)
+			size_t cs = Storage::bytes( std::min(s,m_size) ) / sizeof(ValueType);
 			for(size_t i=0;i<cs;i++) { new_ptr[i] = old_ptr[i]; }
 		}
 		std::get<N-1>( m_field_arrays ) = new_ptr;
-		if( old_ptr != nullptr ) { free(old_ptr); }
+		if( old_ptr != nullptr )
+		{
+			free(old_ptr);
+			SOATL_ALLOC_STATS_RELEASE( FieldArrays, Storage::bytes(m_capacity), 0 );
+		}
 		reallocate_pointer( std::integral_constant<size_t,N-1>() , s ); // recursion to next array
 	}
 	inline void reallocate_pointer( std::integral_constant<size_t,0> , size_t s ) {}
 
 	inline void reallocate(size_t s)
 	{
+		SOATL_INSTRUMENT_KERNEL("reallocate");
+		SOATL_TRACE_FIELDS( s, ids... );
+		SOATL_TRACE_KERNEL("reallocate", s );
 		assert( ( s % ChunkSize ) == 0 );
+		if( std::min(s,m_size) > 0 ) { SOATL_ALLOC_STATS_REALLOCATION_COPY( FieldArrays, detail::sum_of( { FieldStorage<ids>::bytes( std::min(s,m_size) ) ... } ) ); }
 		reallocate_pointer( std::integral_constant<size_t,TupleSize>() , s );
 		m_capacity = s;
 	}
@@ -117,11 +148,12 @@ private:
 	size_t m_capacity = 0;
 };
 
+// alignment and chunk size from tuned_defaults.h
 template<typename... ids>
 inline
-FieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...> make_field_arrays(const FieldId<ids>& ...)
+FieldArrays<DefaultLayout<ids...>::alignment,DefaultLayout<ids...>::chunksize,ids...> make_field_arrays(const FieldId<ids>& ...)
 {
-	return FieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...>();
+	return FieldArrays<DefaultLayout<ids...>::alignment,DefaultLayout<ids...>::chunksize,ids...>();
 }
 
 template<size_t A, size_t C,typename... ids>
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdlib> // for size_t
+#include <cstdint>
+#include <string>
 #include <type_traits>
 
 namespace soatl
@@ -20,6 +22,77 @@ struct find_index_of_id<k,f,ids...> { static constexpr size_t index = std::is_sa
 template<typename k>
 struct find_index_of_id<k> { static constexpr size_t index = 0; };
 
+// vector fields : the descriptor of a vector field declares its number of components,
+// containers store component _k of vector field _vector_id as the scalar field VectorComponent<_vector_id,_k> (see vector_field.h)
+template<typename _vector_id, size_t _k> struct VectorComponent {};
+
+template<typename _vector_id, size_t _k> struct FieldDescriptor< VectorComponent<_vector_id,_k> >
+{
+  using value_type = typename FieldDescriptor<_vector_id>::value_type;
+  using Id = VectorComponent<_vector_id,_k>;
+  static const char* name()
+  {
+    static const std::string n = std::string( FieldDescriptor<_vector_id>::name() ) + ( _k<4 ? std::string(".") + "xyzw"[_k] : "[" + std::to_string(_k) + "]" );
+    return n.c_str();
+  }
+};
+
+template<typename _vector_id> struct VectorFieldId
+{
+  using value_type = typename FieldDescriptor<_vector_id>::value_type;
+  using Id = _vector_id;
+  static constexpr size_t components = FieldDescriptor<_vector_id>::components;
+};
+
+// scalar field of one component, e.g. copy( dst, src, component<0>(particle_r) )
+template<size_t k, typename id>
+static inline FieldDescriptor< VectorComponent<id,k> > component( const VectorFieldId<id>& )
+{
+  static_assert( k < VectorFieldId<id>::components , "component index out of range" );
+  return FieldDescriptor< VectorComponent<id,k> >();
+}
+
+// bit fields : the descriptor of a bit field declares its number of bits, values are stored in bit planes,
+// word k of block b holds bit k of elements 64*b to 64*b+63. containers store bit field _bit_id as the field BitPlanes<_bit_id> (see bit_field.h)
+static constexpr size_t BIT_PLANE_BLOCK = 64;
+
+template<typename _bit_id> struct BitPlanes {};
+
+template<typename _bit_id> struct FieldDescriptor< BitPlanes<_bit_id> >
+{
+  using value_type = uint64_t;
+  using Id = BitPlanes<_bit_id>;
+  static const char* name() { return FieldDescriptor<_bit_id>::name(); }
+};
+
+template<typename _bit_id> struct BitFieldId
+{
+  using value_type = typename FieldDescriptor<_bit_id>::value_type;
+  using Id = _bit_id;
+  static constexpr size_t bits = FieldDescriptor<_bit_id>::bits;
+  static_assert( std::is_integral<value_type>::value && std::is_unsigned<value_type>::value , "bit fields hold unsigned integers or bool" );
+  static_assert( bits >= 1 && bits <= 8*sizeof(value_type) , "bit count out of range" );
+};
+
+// stored field of a bit field, e.g. copy( dst, src, bit_planes(particle_flag) )
+template<typename id>
+static inline FieldDescriptor< BitPlanes<id> > bit_planes( const BitFieldId<id>& )
+{
+  return FieldDescriptor< BitPlanes<id> >();
 }
 
+template<typename _field_id> struct IsBitPlanes : public std::false_type {};
+template<typename _bit_id> struct IsBitPlanes< BitPlanes<_bit_id> > : public std::true_type {};
 
+// storage of a field in containers, in bytes for a given capacity
+template<typename _field_id> struct FieldStorage
+{
+  static inline constexpr size_t bytes( size_t capacity ) { return capacity * sizeof( typename FieldDescriptor<_field_id>::value_type ); }
+};
+
+template<typename _bit_id> struct FieldStorage< BitPlanes<_bit_id> >
+{
+  static inline constexpr size_t bytes( size_t capacity ) { return ( ( capacity + BIT_PLANE_BLOCK - 1 ) / BIT_PLANE_BLOCK ) * BitFieldId<_bit_id>::bits * sizeof(uint64_t); }
+};
+
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstdint>
+#include <cstring> // for std::memcpy
+#include <limits>
+#include <tuple>
+#include <utility> // for std::index_sequence
+#include <type_traits>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_access.h"
+#include "soatl/variadic_template_utils.h"
+
+/*
+Reduced precision storage : a field descriptor may declare an encoding, the type its kernels compute with
+and the way values are converted from and to the stored value_type, e.g.
+	template<> struct FieldDescriptor<particle_rx_q_id> {
+		using encoding = soatl::FixedPointEncoding<int32_t,double,-20>;
+		using value_type = encoding::stored_type; ... };
+Encodings :
+	NarrowEncoding<float,double>        float storage, double computation
+	HalfEncoding<float>                 IEEE binary16 storage (uint16_t), converted with integer operations that vectorize without F16C
+	FixedPointEncoding<int32_t,double,R> x = origin + q * 2^R, origin given per container by an origin(FieldId) member
+	                                     (see OriginFieldArrays), 0 otherwise. q covers the range of the stored integer,
+	                                     [origin - 2^(31+R), origin + 2^(31+R)) for int32_t : values outside are stored
+	                                     as the nearest bound (NaN as the lower one)
+Field level drivers (apply*, apply_indexed*, kernel graphs) hand such fields to kernels as compute type references :
+the driver loop loads and decodes each element into a local variable, calls the kernel, then encodes and stores it back
+if the field is written (fields without access annotation are read and written). Loops keep the conversions in vector registers.
+Other functions (copy, serialization, ...) move stored values.
+*/
+
+namespace soatl
+{
+
+template<typename T>
+struct NativeEncoding
+{
+	static constexpr bool native = true;
+	using stored_type = T;
+	using compute_type = T;
+};
+
+template<typename StoredT, typename ComputeT>
+struct NarrowEncoding
+{
+	static constexpr bool native = false;
+	using stored_type = StoredT;
+	using compute_type = ComputeT;
+	static inline compute_type decode( stored_type s, compute_type ) { return compute_type( s ); }
+	static inline stored_type encode( compute_type x, compute_type ) { return stored_type( x ); }
+};
+
+namespace detail
+{
+	static inline float bits_to_float( uint32_t u ) { float f; std::memcpy( &f, &u, sizeof(f) ); return f; }
+	static inline uint32_t float_to_bits( float f ) { uint32_t u; std::memcpy( &u, &f, sizeof(u) ); return u; }
+	static constexpr double pow2( int e ) { return ( e < 0 ) ? 1.0 / pow2( -e ) : ( ( e == 0 ) ? 1.0 : 2.0 * pow2( e - 1 ) ); }
+
+	// exponent rebias by a multiplication, subnormal halves become normal floats
+	static inline float half_to_float( uint16_t h )
+	{
+		const uint32_t em = uint32_t( h & 0x7fff ) << 13;
+		const uint32_t sign = uint32_t( h & 0x8000 ) << 16;
+		uint32_t bits = float_to_bits( bits_to_float( em ) * float( pow2( 112 ) ) );
+		bits |= ( em >= ( 0x7c00u << 13 ) ) ? 0x7f800000u : 0u; // infinity and NaN
+		return bits_to_float( bits | sign );
+	}
+
+	// round to nearest even
+	static inline uint16_t float_to_half( float f )
+	{
+		uint32_t x = float_to_bits( f );
+		const uint32_t sign = x & 0x80000000u;
+		x ^= sign;
+		const uint32_t overflow = ( x > 0x7f800000u ) ? 0x7e00u : 0x7c00u; // NaN, or infinity
+		const uint32_t subnormal = float_to_bits( bits_to_float( x ) + 0.5f ) - 0x3f000000u; // rounded by the addition
+		const uint32_t normal = ( x + ( uint32_t(15-127) << 23 ) + 0xfffu + ( ( x >> 13 ) & 1u ) ) >> 13;
+		const uint32_t h = ( x >= 0x47800000u ) ? overflow : ( ( x < 0x38800000u ) ? subnormal : normal );
+		return uint16_t( h | ( sign >> 16 ) );
+	}
+}
+
+template<typename ComputeT = float>
+struct HalfEncoding
+{
+	static constexpr bool native = false;
+	using stored_type = uint16_t;
+	using compute_type = ComputeT;
+	static inline compute_type decode( stored_type s, compute_type ) { return compute_type( detail::half_to_float( s ) ); }
+	static inline stored_type encode( compute_type x, compute_type ) { return detail::float_to_half( float( x ) ); }
+};
+
+// resolution 2^ResolutionLog2, values are rounded to the nearest multiple and clamped to the range of StoredT
+template<typename StoredT, typename ComputeT, int ResolutionLog2>
+struct FixedPointEncoding
+{
+	static_assert( std::is_integral<StoredT>::value && std::is_signed<StoredT>::value , "fixed point values are stored as signed integers" );
+	static constexpr bool native = false;
+	using stored_type = StoredT;
+	using compute_type = ComputeT;
+	static constexpr compute_type resolution = compute_type( detail::pow2( ResolutionLog2 ) );
+	static constexpr compute_type inverse_resolution = compute_type( detail::pow2( -ResolutionLog2 ) );
+	// bounds of the stored integers that compute_type represents exactly (the maximum of int32_t is not a float)
+	static constexpr int StoredDigits = std::numeric_limits<StoredT>::digits;
+	static constexpr int ComputeDigits = std::numeric_limits<ComputeT>::digits;
+	static constexpr compute_type lowest = compute_type( - detail::pow2( StoredDigits ) );
+	static constexpr compute_type highest = compute_type( detail::pow2( StoredDigits ) - detail::pow2( StoredDigits > ComputeDigits ? StoredDigits - ComputeDigits : 0 ) );
+	static inline compute_type decode( stored_type s, compute_type origin ) { return origin + compute_type( s ) * resolution; }
+	static inline stored_type encode( compute_type x, compute_type origin )
+	{
+		const compute_type lo = lowest, hi = highest;
+		const compute_type t = ( x - origin ) * inverse_resolution;
+		compute_type r = t + ( t < 0 ? compute_type(-0.5) : compute_type(0.5) );
+		r = ( r > lo ) ? r : lo; // also NaN
+		r = ( r < hi ) ? r : hi;
+		return stored_type( r );
+	}
+};
+
+template<typename id, typename = void>
+struct FieldEncoding { using type = NativeEncoding< typename FieldDescriptor<id>::value_type >; };
+
+template<typename id>
+struct FieldEncoding< id, typename detail::make_void< typename FieldDescriptor<id>::encoding >::type > { using type = typename FieldDescriptor<id>::encoding; };
+
+// components of an encoded vector field
+template<typename id, size_t k>
+struct FieldEncoding< VectorComponent<id,k>, void > : public FieldEncoding<id> {};
+
+template<typename id> using FieldComputeType = typename FieldEncoding<id>::type::compute_type;
+
+// per container origin of fixed point fields
+template<typename FieldArraysT, typename id, typename = void>
+struct FieldOrigin
+{
+	static inline FieldComputeType<id> get( const FieldArraysT& ) { return FieldComputeType<id>( 0 ); }
+};
+
+template<typename FieldArraysT, typename id>
+struct FieldOrigin< FieldArraysT, id, typename detail::make_void< decltype( std::declval<const FieldArraysT&>().origin( FieldId<id>() ) ) >::type >
+{
+	static inline FieldComputeType<id> get( const FieldArraysT& arrays ) { return arrays.origin( FieldId<id>() ); }
+};
+
+// container with an origin per field, for fixed point encodings
+template<typename BaseT> struct OriginFieldArrays;
+
+template< template<size_t,size_t,typename...> class ContainerT, size_t _Alignment, size_t _ChunkSize, typename... ids>
+struct OriginFieldArrays< ContainerT<_Alignment,_ChunkSize,ids...> > : public ContainerT<_Alignment,_ChunkSize,ids...>
+{
+	template<typename _id>
+	inline FieldComputeType<_id> origin( FieldId<_id> ) const { return std::get< find_index_of_id<_id,ids...>::index >( m_origins ); }
+
+	// stored values are kept, decoded values move with the origin
+	template<typename _id>
+	inline void set_origin( FieldId<_id>, FieldComputeType<_id> o ) { std::get< find_index_of_id<_id,ids...>::index >( m_origins ) = o; }
+
+private:
+	std::tuple< FieldComputeType<ids> ... > m_origins { FieldComputeType<ids>(0) ... };
+};
+
+template<typename FieldArraysT>
+static inline OriginFieldArrays<FieldArraysT> make_origin_field_arrays( const FieldArraysT& ) { return OriginFieldArrays<FieldArraysT>(); }
+
+
+// kernel arguments : stored references of native fields are passed through, encoded fields are decoded into locals
+
+template<typename FieldAccessT, typename EncodingT = typename FieldEncoding<typename FieldAccessT::Id>::type, bool native = EncodingT::native>
+struct EncodedArgument
+{
+	template<typename R> using local_type = R&;
+	template<typename R> static inline R& load( R& s, typename EncodingT::compute_type ) { return s; }
+	template<typename R> static inline void store( R&, R&, typename EncodingT::compute_type ) {}
+};
+
+template<typename FieldAccessT, typename EncodingT>
+struct EncodedArgument<FieldAccessT,EncodingT,false>
+{
+	using compute_type = typename EncodingT::compute_type;
+	template<typename R> using local_type = compute_type;
+
+	template<typename R> static inline compute_type load( R& s, compute_type origin ) { return load( s, origin, std::integral_constant<bool,FieldAccessT::reads>() ); }
+	template<typename R> static inline compute_type load( R& s, compute_type origin, std::true_type ) { return EncodingT::decode( s, origin ); }
+	template<typename R> static inline compute_type load( R&, compute_type, std::false_type ) { return compute_type( 0 ); }
+
+	template<typename R> static inline void store( R& s, compute_type x, compute_type origin ) { store( s, x, origin, std::integral_constant<bool,FieldAccessT::writes>() ); }
+	template<typename R> static inline void store( R& s, compute_type x, compute_type origin, std::true_type ) { s = EncodingT::encode( x, origin ); }
+	template<typename R> static inline void store( R&, compute_type, compute_type, std::false_type ) {}
+};
+
+template<typename OperatorT, typename... FieldAccessT>
+struct EncodedFieldKernel
+{
+	OperatorT f;
+	std::tuple< FieldComputeType<typename FieldAccessT::Id> ... > origins;
+
+	template<size_t... I, typename... R>
+	inline void call( std::index_sequence<I...>, R& ... stored )
+	{
+		std::tuple< typename EncodedArgument<FieldAccessT>::template local_type<R> ... > values { EncodedArgument<FieldAccessT>::load( stored, std::get<I>(origins) ) ... };
+		f( std::get<I>(values) ... );
+		TEMPLATE_LIST_BEGIN
+			EncodedArgument<FieldAccessT>::store( stored, std::get<I>(values), std::get<I>(origins) )
+		TEMPLATE_LIST_END
+	}
+
+	template<typename... R>
+	inline void operator () ( R& ... stored )
+	{
+		call( std::index_sequence_for<FieldAccessT...>(), stored ... );
+	}
+};
+
+template<typename... ids>
+struct HasEncodedFields
+{
+	static constexpr bool value = detail::any_of( { false, ! FieldEncoding<ids>::type::native ... } );
+};
+
+// kernel called by field level drivers : f itself, unless some fields are encoded
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline OperatorT field_kernel( OperatorT f, const FieldArraysT&, std::false_type, const FieldAccess<ids,modes> & ... )
+{
+	return f;
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline EncodedFieldKernel< OperatorT, FieldAccess<ids,modes>... > field_kernel( OperatorT f, const FieldArraysT& arrays, std::true_type, const FieldAccess<ids,modes> & ... )
+{
+	return { f, std::make_tuple( FieldOrigin<FieldArraysT,ids>::get( arrays ) ... ) };
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline auto field_kernel( OperatorT f, const FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	return field_kernel( f, arrays, std::integral_constant<bool,HasEncodedFields<ids...>::value>(), fas ... );
+}
+
+// fields without access annotation are read and written
+template<typename OperatorT, typename FieldArraysT, typename... ids>
+static inline auto field_kernel( OperatorT f, const FieldArraysT& arrays, const FieldId<ids> & ... )
+{
+	return field_kernel( f, arrays, std::integral_constant<bool,HasEncodedFields<ids...>::value>(), FieldAccess<ids,access::read_write>() ... );
+}
+
+} // namespace soatl
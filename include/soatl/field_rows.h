@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstddef> // for ptrdiff_t
+#include <cstdint>
+#include <algorithm> // for std::max
+#include <iterator>
+#include <tuple>
+#include <utility> // for std::swap
+#include <vector>
+#include <type_traits>
+
+#include <assert.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/dirty_hooks.h"
+#include "soatl/instrument.h"
+#include "soatl/variadic_template_utils.h"
+
+/*
+Rows : arrays.row(i) is a proxy reference to element i of every field of a container, arrays.row(i)[particle_rx] is arrays[particle_rx][i].
+Assigning a row copies all fields (from a row of a container with the same fields, or a RowValue), swap(row_a,row_b) exchanges all fields.
+A RowValue holds a copy of the values of a row. arrays.begin() and arrays.end() are random access iterators whose reference is a row
+and value_type a RowValue, so standard algorithms move whole elements :
+	std::sort( cell.begin(), cell.end(), [](const auto& a, const auto& b) { return a[particle_rx] < b[particle_rx]; } );
+	std::stable_partition( cell.begin(), cell.end(), [](const auto& r) { return r[particle_atype] == 0; } );
+Comparators and predicates are called with rows and RowValues, they take const auto& arguments and access fields by FieldId.
+Every move of an element touches one element of each stripe. For wide containers, sorting a vector of keys and indices and
+calling permute_rows( arrays, order ) moves each field once, stripe by stripe (see tests/rowbenchmark.cpp).
+Writes through rows are not tracked, as writes through arrays[field] : mark TrackedFieldArrays dirty after sorting them.
+Bit fields (see bit_field.h) have no rows.
+*/
+
+namespace soatl
+{
+
+template<typename IdsTuple> struct FieldArraysRowValue;
+
+template<typename... ids>
+struct FieldArraysRowValue< std::tuple< FieldId<ids> ... > >
+{
+	std::tuple< typename FieldDescriptor<ids>::value_type ... > values;
+
+	inline FieldArraysRowValue() = default;
+	inline FieldArraysRowValue( const FieldArraysRowValue& ) = default;
+	inline FieldArraysRowValue& operator = ( const FieldArraysRowValue& ) = default;
+	template<typename RowT> inline FieldArraysRowValue( const RowT& r ) : values( r[ FieldId<ids>() ] ... ) {}
+
+	template<typename _id> inline typename FieldDescriptor<_id>::value_type & operator [] ( FieldId<_id> ) { return std::get< find_index_of_id<_id,ids...>::index >( values ); }
+	template<typename _id> inline const typename FieldDescriptor<_id>::value_type & operator [] ( FieldId<_id> ) const { return std::get< find_index_of_id<_id,ids...>::index >( values ); }
+};
+
+template<typename ArraysT, typename IdsTuple = typename std::remove_const<ArraysT>::type::FieldIdsTuple> struct FieldArraysRow;
+
+template<typename ArraysT, typename... ids>
+struct FieldArraysRow< ArraysT, std::tuple< FieldId<ids> ... > >
+{
+	static_assert( ! detail::any_of( { false, IsBitPlanes<ids>::value ... } ) , "containers with bit fields have no rows" );
+
+	using value_type = FieldArraysRowValue< std::tuple< FieldId<ids> ... > >;
+	template<typename _id> using reference = typename std::conditional< std::is_const<ArraysT>::value , const typename FieldDescriptor<_id>::value_type & , typename FieldDescriptor<_id>::value_type & >::type;
+
+	ArraysT* m_arrays;
+	size_t m_index;
+
+	inline FieldArraysRow( ArraysT* arrays, size_t index ) : m_arrays(arrays), m_index(index) {}
+	inline FieldArraysRow( const FieldArraysRow& ) = default;
+
+	inline size_t index() const { return m_index; }
+
+	template<typename _id> inline reference<_id> operator [] ( FieldId<_id> fid ) const { return (*m_arrays)[fid][m_index]; }
+
+	// assignments copy the values of all fields, they do not rebind the row
+	inline const FieldArraysRow& operator = ( const FieldArraysRow& r ) const { assign( r ); return *this; }
+	template<typename RowT> inline const FieldArraysRow& operator = ( const RowT& r ) const { assign( r ); return *this; }
+
+	template<typename RowT> inline void assign( const RowT& r ) const
+	{
+		TEMPLATE_LIST_BEGIN
+			(*m_arrays)[ FieldId<ids>() ][m_index] = r[ FieldId<ids>() ]
+		TEMPLATE_LIST_END
+	}
+
+	friend inline void swap( FieldArraysRow a, FieldArraysRow b )
+	{
+		TEMPLATE_LIST_BEGIN
+			std::swap( a[ FieldId<ids>() ], b[ FieldId<ids>() ] )
+		TEMPLATE_LIST_END
+	}
+	friend inline void swap( FieldArraysRow a, value_type& b ) { value_type t( a ); a = b; b = t; }
+	friend inline void swap( value_type& a, FieldArraysRow b ) { swap( b, a ); }
+};
+
+template<typename ArraysT>
+struct FieldArraysRowIterator
+{
+	using iterator_category = std::random_access_iterator_tag;
+	using reference = FieldArraysRow<ArraysT>;
+	using value_type = typename reference::value_type;
+	using difference_type = ptrdiff_t;
+	using pointer = void;
+
+	ArraysT* m_arrays = nullptr;
+	size_t m_index = 0;
+
+	inline FieldArraysRowIterator() = default;
+	inline FieldArraysRowIterator( ArraysT* arrays, size_t index ) : m_arrays(arrays), m_index(index) {}
+
+	inline reference operator * () const { return reference( m_arrays, m_index ); }
+	inline reference operator [] ( difference_type n ) const { return reference( m_arrays, m_index + n ); }
+
+	inline FieldArraysRowIterator& operator ++ () { ++ m_index; return *this; }
+	inline FieldArraysRowIterator& operator -- () { -- m_index; return *this; }
+	inline FieldArraysRowIterator operator ++ (int) { FieldArraysRowIterator it = *this; ++ m_index; return it; }
+	inline FieldArraysRowIterator operator -- (int) { FieldArraysRowIterator it = *this; -- m_index; return it; }
+	inline FieldArraysRowIterator& operator += ( difference_type n ) { m_index += n; return *this; }
+	inline FieldArraysRowIterator& operator -= ( difference_type n ) { m_index -= n; return *this; }
+	inline FieldArraysRowIterator operator + ( difference_type n ) const { return FieldArraysRowIterator( m_arrays, m_index + n ); }
+	inline FieldArraysRowIterator operator - ( difference_type n ) const { return FieldArraysRowIterator( m_arrays, m_index - n ); }
+	friend inline FieldArraysRowIterator operator + ( difference_type n, const FieldArraysRowIterator& it ) { return it + n; }
+	inline difference_type operator - ( const FieldArraysRowIterator& it ) const { return difference_type(m_index) - difference_type(it.m_index); }
+
+	inline bool operator == ( const FieldArraysRowIterator& it ) const { return m_index == it.m_index; }
+	inline bool operator != ( const FieldArraysRowIterator& it ) const { return m_index != it.m_index; }
+	inline bool operator < ( const FieldArraysRowIterator& it ) const { return m_index < it.m_index; }
+	inline bool operator > ( const FieldArraysRowIterator& it ) const { return m_index > it.m_index; }
+	inline bool operator <= ( const FieldArraysRowIterator& it ) const { return m_index <= it.m_index; }
+	inline bool operator >= ( const FieldArraysRowIterator& it ) const { return m_index >= it.m_index; }
+};
+
+namespace detail
+{
+	template<typename FieldArraysT, typename IndexT, typename id>
+	static inline void permute_field( FieldArraysT& arrays, const std::vector<IndexT>& order, std::vector<uint8_t>& buffer, const FieldId<id>& fid )
+	{
+		using T = typename FieldDescriptor<id>::value_type;
+		static_assert( ! IsBitPlanes<id>::value , "bit fields are not permuted" );
+		T* __restrict__ a = arrays[fid];
+		T* __restrict__ tmp = reinterpret_cast<T*>( buffer.data() );
+		const size_t N = order.size();
+		for(size_t i=0;i<N;i++) { tmp[i] = a[ order[i] ]; }
+		for(size_t i=0;i<N;i++) { a[i] = tmp[i]; }
+	}
+
+	template<typename FieldArraysT, typename IndexT, typename... ids>
+	static inline void permute_rows( FieldArraysT& arrays, const std::vector<IndexT>& order, const std::tuple< FieldId<ids> ... > & )
+	{
+		std::vector<uint8_t> buffer( order.size() * std::max( { sizeof(typename FieldDescriptor<ids>::value_type) ... } ) );
+		TEMPLATE_LIST_BEGIN
+			permute_field( arrays, order, buffer, FieldId<ids>() )
+		TEMPLATE_LIST_END
+	}
+}
+
+// element i of every field becomes element order[i], order is a permutation of [0,arrays.size())
+template<typename FieldArraysT, typename IndexT>
+static inline void permute_rows( FieldArraysT& arrays, const std::vector<IndexT>& order )
+{
+	assert( order.size() == arrays.size() );
+	SOATL_INSTRUMENT_KERNEL("permute_rows");
+	mark_written( arrays, 0, order.size(), typename FieldArraysT::FieldIdsTuple() );
+	SOATL_TRACE_KERNEL("permute_rows", order.size() );
+	detail::permute_rows( arrays, order, typename FieldArraysT::FieldIdsTuple() );
+}
+
+} // namespace soatl
@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+Optional instrumentation of drivers (apply*, copy, reallocate) with hardware performance counters (see perf_counters.h).
+Enabled when SOATL_PERF_COUNTERS is defined, otherwise all macros expand to nothing.
+	SOATL_INSTRUMENT_SCOPE(label)            user region, prefixes the labels of the drivers called inside
+	SOATL_INSTRUMENT_PARALLEL_SCOPE(label)   same, measuring each thread of the OpenMP team
+	SOATL_INSTRUMENT_KERNEL(label)           used by drivers, only the outermost one of a thread measures
+	SOATL_INSTRUMENT_PARALLEL_KERNEL(label)  used by drivers running an OpenMP parallel region
+
+Optional timeline of the same drivers (see trace.h), enabled when SOATL_TRACE is defined, otherwise the macros expand to nothing.
+	SOATL_TRACE_KERNEL(label,count)          used by drivers, records an event covering the enclosing block
+	SOATL_TRACE_FIELDS(count,ids...)         used by field level drivers, names the fields of the next event of count elements
+*/
+
+#define SOATL_INSTRUMENT_CONCAT2(a,b) a##b
+#define SOATL_INSTRUMENT_CONCAT(a,b) SOATL_INSTRUMENT_CONCAT2(a,b)
+
+#ifdef SOATL_PERF_COUNTERS
+
+#include "soatl/perf_counters.h"
+
+#define SOATL_INSTRUMENT_SCOPE(label) ::soatl::PerfScope SOATL_INSTRUMENT_CONCAT(__soatl_perf_scope_,__LINE__)( label, false, false )
+#define SOATL_INSTRUMENT_PARALLEL_SCOPE(label) ::soatl::PerfScope SOATL_INSTRUMENT_CONCAT(__soatl_perf_scope_,__LINE__)( label, false, true )
+#define SOATL_INSTRUMENT_KERNEL(label) ::soatl::PerfScope SOATL_INSTRUMENT_CONCAT(__soatl_perf_scope_,__LINE__)( label, true, false )
+#define SOATL_INSTRUMENT_PARALLEL_KERNEL(label) ::soatl::PerfScope SOATL_INSTRUMENT_CONCAT(__soatl_perf_scope_,__LINE__)( label, true, true )
+
+#else
+
+#define SOATL_INSTRUMENT_SCOPE(label) do{}while(0)
+#define SOATL_INSTRUMENT_PARALLEL_SCOPE(label) do{}while(0)
+#define SOATL_INSTRUMENT_KERNEL(label) do{}while(0)
+#define SOATL_INSTRUMENT_PARALLEL_KERNEL(label) do{}while(0)
+
+#endif
+
+#ifdef SOATL_TRACE
+
+#include "soatl/trace.h"
+
+#define SOATL_TRACE_KERNEL(label,count) ::soatl::TraceScope SOATL_INSTRUMENT_CONCAT(__soatl_trace_scope_,__LINE__)( label, count )
+#define SOATL_TRACE_FIELDS(count,...) ::soatl::trace_fields< __VA_ARGS__ >( count )
+
+#else
+
+#define SOATL_TRACE_KERNEL(label,count) do{}while(0)
+#define SOATL_TRACE_FIELDS(count,...) do{}while(0)
+
+#endif
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <utility>
+
+#include <assert.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_access.h"
+#include "soatl/variadic_template_utils.h"
+#include "soatl/compute.h"
+
+/*
+A KernelGraph records apply kernels submitted with access annotated fields (see field_access.h).
+Kernels are element wise, so each submitted kernel is cut into blocks of block_size() elements,
+and block b of a kernel only depends on block b of kernels submitted earlier that touch the same field arrays
+(read after write, write after read and write after write).
+Nothing runs at submission time, submitted blocks are executed by wait(), independent blocks concurrently as OpenMP tasks.
+Containers used by submitted kernels must not be resized or destroyed until wait() returns.
+*/
+
+namespace soatl
+{
+
+struct KernelGraph
+{
+	static constexpr size_t DefaultBlockSize = 16384;
+
+	inline KernelGraph(size_t block_size = DefaultBlockSize) : m_block_size(block_size)
+	{
+		assert( m_block_size > 0 );
+	}
+
+	inline ~KernelGraph()
+	{
+		wait();
+	}
+
+	inline size_t block_size() const { return m_block_size; }
+	inline size_t task_count() const { return m_nodes.size(); }
+	inline size_t dependency_count() const { return m_edge_count; }
+
+	// access to elements [first;first+count[ of the field array starting at ptr, one block at a time
+	struct Access
+	{
+		const void* ptr;
+		bool reads;
+		bool writes;
+	};
+
+	// records a task covering elements of block 'block' for all accesses, and links it to its predecessors
+	inline void add_task( size_t block, const Access* accesses, size_t naccesses, std::function<void()> && run )
+	{
+		const size_t task = m_nodes.size();
+		m_nodes.push_back( Node() );
+		m_nodes.back().run = std::move( run );
+
+		std::set<size_t> preds;
+		for(size_t a=0;a<naccesses;a++)
+		{
+			ResourceState & res = m_resources[ std::make_pair(accesses[a].ptr,block) ];
+			if( res.last_writer != NoTask && res.last_writer != task ) { preds.insert( res.last_writer ); }
+			if( accesses[a].writes )
+			{
+				for(size_t r : res.readers) { if( r != task ) preds.insert( r ); }
+				res.readers.clear();
+				res.last_writer = task;
+			}
+			else
+			{
+				res.readers.push_back( task );
+			}
+		}
+
+		for(size_t p : preds) { m_nodes[p].successors.push_back( task ); }
+		m_nodes[task].npred = preds.size();
+		m_edge_count += preds.size();
+	}
+
+	// executes all submitted tasks, then clears the graph
+	inline void wait()
+	{
+		const size_t n = m_nodes.size();
+		if( n == 0 ) { return; }
+
+		std::unique_ptr< std::atomic<size_t>[] > pending( new std::atomic<size_t>[n] );
+		for(size_t i=0;i<n;i++) { pending[i] = m_nodes[i].npred; }
+		std::atomic<size_t>* pending_ptr = pending.get();
+
+#		pragma omp parallel
+		{
+#			pragma omp single
+			{
+				for(size_t i=0;i<n;i++)
+				{
+					if( m_nodes[i].npred == 0 ) { spawn( i , pending_ptr ); }
+				}
+			}
+		}
+
+		clear();
+	}
+
+	inline void clear()
+	{
+		m_nodes.clear();
+		m_resources.clear();
+		m_edge_count = 0;
+	}
+
+private:
+
+	static constexpr size_t NoTask = static_cast<size_t>(-1);
+
+	struct Node
+	{
+		std::function<void()> run;
+		std::vector<size_t> successors;
+		size_t npred = 0;
+	};
+
+	struct ResourceState
+	{
+		size_t last_writer = NoTask;
+		std::vector<size_t> readers;
+	};
+
+	inline void spawn( size_t i , std::atomic<size_t>* pending )
+	{
+#		pragma omp task firstprivate(i,pending)
+		{
+			m_nodes[i].run();
+			for(size_t s : m_nodes[i].successors)
+			{
+				if( --pending[s] == 0 ) { spawn( s , pending ); }
+			}
+		}
+	}
+
+	std::vector<Node> m_nodes;
+	std::map< std::pair<const void*,size_t> , ResourceState > m_resources;
+	size_t m_block_size;
+	size_t m_edge_count = 0;
+};
+
+template<typename FieldArraysT, typename id, typename mode>
+static inline void kernel_graph_access( KernelGraph::Access& access, FieldArraysT& arrays, const FieldAccess<id,mode> & fa )
+{
+	access.ptr = fa.pointer(arrays);
+	access.reads = FieldAccess<id,mode>::reads;
+	access.writes = FieldAccess<id,mode>::writes;
+}
+
+template<typename FieldArraysT, size_t... Is, typename... ids, typename... modes>
+static inline void kernel_graph_accesses( KernelGraph::Access* accesses, FieldArraysT& arrays, std::index_sequence<Is...>, const FieldAccess<ids,modes> & ... fas )
+{
+	TEMPLATE_LIST_BEGIN
+		kernel_graph_access( accesses[Is], arrays, fas )
+	TEMPLATE_LIST_END
+}
+
+template<typename FieldArraysT, typename... ids, typename... modes>
+static inline void kernel_graph_accesses( KernelGraph::Access* accesses, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	kernel_graph_accesses( accesses, arrays, std::make_index_sequence<sizeof...(ids)>(), fas... );
+}
+
+// asynchronous version of apply, kernel is executed by graph.wait()
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void submit_apply( KernelGraph& graph, OperatorT f, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	KernelGraph::Access accesses[ sizeof...(ids) ];
+	kernel_graph_accesses( accesses, arrays, fas... );
+	mark_written( arrays, 0, arrays.size(), fas ... );
+
+	const auto kernel = field_kernel( f, arrays, fas ... );
+	const size_t N = arrays.size();
+	const size_t B = graph.block_size();
+	for(size_t first=0, block=0; first<N; first+=B, block++)
+	{
+		const size_t count = std::min( B , N-first );
+		graph.add_task( block, accesses, sizeof...(ids), [=,&arrays]()
+			{
+				apply( kernel, count, fas.pointer(arrays)+first ... );
+			} );
+	}
+}
+
+// asynchronous version of apply_simd, kernel is executed by graph.wait()
+// graph's block size must be a multiple of the container's chunk size
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void submit_apply_simd( KernelGraph& graph, OperatorT f, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	assert( ( graph.block_size() % FieldArraysT::ChunkSize ) == 0 );
+#	ifndef NDEBUG
+	TEMPLATE_LIST_BEGIN
+		assert( ( arrays.alignment() % SimdRequirements< typename FieldAccess<ids,modes>::value_type >::alignment ) == 0 )
+	TEMPLATE_LIST_END
+#	endif
+
+	KernelGraph::Access accesses[ sizeof...(ids) ];
+	kernel_graph_accesses( accesses, arrays, fas... );
+	mark_written( arrays, 0, arrays.size(), fas ... );
+
+	const auto kernel = field_kernel( f, arrays, fas ... );
+	const size_t N = arrays.size();
+	const size_t B = graph.block_size();
+	for(size_t first=0, block=0; first<N; first+=B, block++)
+	{
+		const size_t count = std::min( B , N-first );
+		graph.add_task( block, accesses, sizeof...(ids), [=,&arrays]()
+			{
+				apply_simd( kernel, count, cst::chunk<FieldArraysT::ChunkSize>(), fas.pointer(arrays)+first ... );
+			} );
+	}
+}
+
+} // namespace soatl
+
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib> // for size_t
+#include <string>
+#include <tuple>
+#include <utility> // for std::swap
+
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "soatl/constants.h"
+#include "soatl/variadic_template_utils.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/packed_snapshot.h"
+
+/*
+Read only or copy on write view of a snapshot file (see packed_snapshot.h), mapped in memory.
+It has the same field access interface as PackedFieldArrays, so kernels run directly on the mapped file,
+and only the pages of the fields actually accessed are read from disk.
+Writing to a read only mapping is a segmentation fault : access it through a const view, whose fields are const pointers,
+and use read() access annotations for kernels running on them.
+Modifications of a copy on write mapping are private to the process and are not written back to the file.
+*/
+
+namespace soatl {
+
+enum MappedAccess
+{
+	MAPPED_READ_ONLY,
+	MAPPED_COPY_ON_WRITE
+};
+
+// access pattern hints, passed to madvise
+enum MappedAdvice : unsigned int
+{
+	MAPPED_ADVICE_NONE = 0,
+	MAPPED_ADVICE_SEQUENTIAL = 1,
+	MAPPED_ADVICE_WILLNEED = 2,
+	MAPPED_ADVICE_RANDOM = 4
+};
+
+static inline void mapped_advise( const void* ptr, size_t bytes, unsigned int advice )
+{
+	// madvise needs a page aligned address
+	const uintptr_t page = sysconf( _SC_PAGESIZE );
+	const uintptr_t first = reinterpret_cast<uintptr_t>(ptr) & ~( page - 1 );
+	bytes += reinterpret_cast<uintptr_t>(ptr) - first;
+	if( advice & MAPPED_ADVICE_SEQUENTIAL ) { madvise( reinterpret_cast<void*>(first), bytes, MADV_SEQUENTIAL ); }
+	if( advice & MAPPED_ADVICE_RANDOM ) { madvise( reinterpret_cast<void*>(first), bytes, MADV_RANDOM ); }
+	if( advice & MAPPED_ADVICE_WILLNEED ) { madvise( reinterpret_cast<void*>(first), bytes, MADV_WILLNEED ); }
+}
+
+template< size_t _Alignment, size_t _ChunkSize, typename... ids>
+struct MappedPackedFieldArrays
+{
+	using ArraysT = PackedFieldArrays<_Alignment,_ChunkSize,ids...>;
+	using Layout = PackedSnapshotLayout<_Alignment,_ChunkSize,ids...>;
+
+	static constexpr size_t Alignment = ArraysT::Alignment;
+	static constexpr size_t ChunkSize = ArraysT::ChunkSize;
+	static constexpr int TupleSize = sizeof...(ids);
+
+	using FieldIdsTuple = std::tuple< FieldId<ids> ... > ;
+
+	static constexpr size_t alignment() { return Alignment; }
+	static constexpr size_t chunksize() { return ChunkSize; }
+
+	MappedPackedFieldArrays() = default;
+	MappedPackedFieldArrays( const MappedPackedFieldArrays& ) = delete;
+	MappedPackedFieldArrays& operator = ( const MappedPackedFieldArrays& ) = delete;
+	inline MappedPackedFieldArrays( MappedPackedFieldArrays && other ) { *this = std::move(other); }
+	inline MappedPackedFieldArrays& operator = ( MappedPackedFieldArrays && other )
+	{
+		unmap();
+		std::swap( m_map_ptr, other.m_map_ptr );
+		std::swap( m_map_size, other.m_map_size );
+		std::swap( m_storage_ptr, other.m_storage_ptr );
+		std::swap( m_size, other.m_size );
+		std::swap( m_capacity, other.m_capacity );
+		return *this;
+	}
+
+	// const access gives const pointers, a read only mapping is only safely accessed through a const view
+	template<size_t index>
+	inline typename std::tuple_element<index,std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type * __restrict__ operator [] ( cst::at<index> )
+	{
+		using ValueType = typename std::tuple_element<index, std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type ;
+		uint8_t* aptr = static_cast<uint8_t*>( m_storage_ptr ) + PackedFieldArraysHelper<Alignment,index,ids...>::field_offset(capacity()) ;
+		return (ValueType* __restrict__) __builtin_assume_aligned( aptr , Alignment );
+	}
+
+	template<size_t index>
+	inline const typename std::tuple_element<index,std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type * __restrict__ operator [] ( cst::at<index> i ) const
+	{
+		return const_cast<MappedPackedFieldArrays*>( this )->operator [] ( i );
+	}
+
+	template<typename _id>
+	inline typename FieldDescriptor<_id>::value_type * __restrict__ operator [] ( FieldId<_id> )
+	{
+		static constexpr size_t index = find_index_of_id<_id,ids...>::index;
+		using ValueType = typename std::tuple_element<index, std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type ;
+		uint8_t* aptr = static_cast<uint8_t*>( m_storage_ptr ) + PackedFieldArraysHelper<Alignment,index,ids...>::field_offset(capacity()) ;
+		return (ValueType* __restrict__) __builtin_assume_aligned( aptr , Alignment );
+	}
+
+	template<typename _id>
+	inline const typename FieldDescriptor<_id>::value_type * __restrict__ operator [] ( FieldId<_id> fid ) const
+	{
+		return const_cast<MappedPackedFieldArrays*>( this )->operator [] ( fid );
+	}
+
+	// maps a snapshot file. returns false if the file cannot be mapped or does not have this container's layout.
+	inline bool map( const std::string& filename, MappedAccess access = MAPPED_READ_ONLY, unsigned int advice = MAPPED_ADVICE_NONE )
+	{
+		unmap();
+		int fd = open( filename.c_str(), O_RDONLY );
+		if( fd < 0 ) { return false; }
+		struct stat st;
+		if( fstat( fd, &st ) != 0 || static_cast<size_t>( st.st_size ) < Layout::DataOffset )
+		{
+			close( fd );
+			return false;
+		}
+
+		const int prot = ( access == MAPPED_READ_ONLY ) ? PROT_READ : ( PROT_READ | PROT_WRITE );
+		const int flags = ( access == MAPPED_READ_ONLY ) ? MAP_SHARED : MAP_PRIVATE;
+		void* ptr = mmap( nullptr, st.st_size, prot, flags, fd, 0 );
+		close( fd );
+		if( ptr == MAP_FAILED ) { return false; }
+
+		const PackedSnapshotHeader* header = static_cast<const PackedSnapshotHeader*>( ptr );
+		if( ! Layout::check_header( header ) || ( header->data_offset + header->data_size ) > static_cast<size_t>( st.st_size ) )
+		{
+			munmap( ptr, st.st_size );
+			return false;
+		}
+
+		m_map_ptr = ptr;
+		m_map_size = st.st_size;
+		m_storage_ptr = static_cast<uint8_t*>( ptr ) + header->data_offset;
+		m_size = header->size;
+		m_capacity = header->capacity;
+		if( advice != MAPPED_ADVICE_NONE ) { mapped_advise( m_storage_ptr, data_size(), advice ); }
+		return true;
+	}
+
+	// gives a hint for the elements of some fields only, e.g. MAPPED_ADVICE_WILLNEED for the fields of the next kernel
+	template<typename... _ids>
+	inline void advise( unsigned int advice, const FieldId<_ids>& ... fids ) const
+	{
+		TEMPLATE_LIST_BEGIN
+			mapped_advise( (*this)[fids], FieldStorage<_ids>::bytes( size() ), advice )
+		TEMPLATE_LIST_END
+	}
+
+	inline void unmap()
+	{
+		if( m_map_ptr != nullptr ) { munmap( m_map_ptr, m_map_size ); }
+		m_map_ptr = nullptr;
+		m_map_size = 0;
+		m_storage_ptr = nullptr;
+		m_size = 0;
+		m_capacity = 0;
+	}
+
+	inline bool is_mapped() const { return m_map_ptr != nullptr; }
+	inline void* data() const { return m_storage_ptr; }
+	inline size_t size() const { return m_size; }
+	inline size_t capacity() const { return m_capacity; }
+	inline size_t chunk_ceil() const { return ( (size()+chunksize()-1) / chunksize() ) * chunksize(); }
+	inline size_t data_size() const { return ArraysT::allocation_size( capacity() ); }
+
+	inline ~MappedPackedFieldArrays()
+	{
+		unmap();
+	}
+
+private:
+	void* m_map_ptr = nullptr;
+	size_t m_map_size = 0;
+	void* m_storage_ptr = nullptr;
+	size_t m_size = 0;
+	size_t m_capacity = 0;
+};
+
+template<typename... ids>
+inline
+MappedPackedFieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...>
+make_mapped_packed_field_arrays(const FieldId<ids>& ...)
+{
+	return MappedPackedFieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...>();
+}
+
+template<size_t A, size_t C, typename... ids>
+inline
+MappedPackedFieldArrays<A,C,ids...>
+make_mapped_packed_field_arrays( cst::align<A>, cst::chunk<C>, const FieldId<ids>& ...)
+{
+	return MappedPackedFieldArrays<A,C,ids...>();
+}
+
+} // namespace soatl
+
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstdint> // for uintptr_t
+#include <cstring> // for std::memcpy
+#include <unistd.h> // for sysconf
+
+#include "soatl/variadic_template_utils.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+Non temporal (streaming) stores write whole cache lines to memory without reading them first (no read for ownership),
+and without polluting the cache. They only pay off when the written data would not stay in cache anyway,
+so they are used above a size threshold, which defaults to the last level cache size.
+*/
+
+namespace soatl
+{
+
+#if defined(__AVX512F__)
+static constexpr size_t NON_TEMPORAL_ALIGNMENT = 64;
+#elif defined(__AVX__)
+static constexpr size_t NON_TEMPORAL_ALIGNMENT = 32;
+#else
+static constexpr size_t NON_TEMPORAL_ALIGNMENT = 16;
+#endif
+
+// number of elements per tile when a kernel's write only fields are buffered before being streamed out
+static constexpr size_t NON_TEMPORAL_TILE_SIZE = 512;
+
+static inline size_t default_non_temporal_threshold()
+{
+#	ifdef SOATL_NON_TEMPORAL_THRESHOLD
+	return SOATL_NON_TEMPORAL_THRESHOLD;
+#	else
+	long llc = -1;
+#	ifdef _SC_LEVEL3_CACHE_SIZE
+	llc = sysconf( _SC_LEVEL3_CACHE_SIZE );
+#	endif
+	return ( llc > 0 ) ? static_cast<size_t>(llc) : ( 8ul << 20 );
+#	endif
+}
+
+// working set size (in bytes) above which streaming stores are used. can be changed at runtime.
+inline size_t& non_temporal_threshold()
+{
+	static size_t threshold = default_non_temporal_threshold();
+	return threshold;
+}
+
+// copies bytes from src to dst, using streaming stores for the aligned part of dst.
+// stream_fence() must be called before another thread reads dst.
+static inline void stream_store( void* dst, const void* src, size_t bytes )
+{
+	uint8_t* d = static_cast<uint8_t*>( dst );
+	const uint8_t* s = static_cast<const uint8_t*>( src );
+
+#	if defined(__SSE2__)
+	size_t head = ( NON_TEMPORAL_ALIGNMENT - ( reinterpret_cast<uintptr_t>(d) % NON_TEMPORAL_ALIGNMENT ) ) % NON_TEMPORAL_ALIGNMENT;
+	if( head > bytes ) { head = bytes; }
+	std::memcpy( d, s, head );
+	d += head; s += head; bytes -= head;
+
+	for(; bytes>=NON_TEMPORAL_ALIGNMENT; d+=NON_TEMPORAL_ALIGNMENT, s+=NON_TEMPORAL_ALIGNMENT, bytes-=NON_TEMPORAL_ALIGNMENT)
+	{
+#		if defined(__AVX512F__)
+		_mm512_stream_si512( reinterpret_cast<__m512i*>(d), _mm512_loadu_si512( reinterpret_cast<const void*>(s) ) );
+#		elif defined(__AVX__)
+		_mm256_stream_si256( reinterpret_cast<__m256i*>(d), _mm256_loadu_si256( reinterpret_cast<const __m256i*>(s) ) );
+#		else
+		_mm_stream_si128( reinterpret_cast<__m128i*>(d), _mm_loadu_si128( reinterpret_cast<const __m128i*>(s) ) );
+#		endif
+	}
+#	endif
+
+	std::memcpy( d, s, bytes );
+}
+
+// orders streaming stores issued by the calling thread before subsequent stores
+static inline void stream_fence()
+{
+#	if defined(__SSE2__)
+	_mm_sfence();
+#	endif
+}
+
+// same as memcpy, with streaming stores when size reaches non_temporal_threshold()
+static inline void non_temporal_copy( void* dst, const void* src, size_t bytes )
+{
+	if( bytes >= non_temporal_threshold() )
+	{
+		stream_store( dst, src, bytes );
+		stream_fence();
+	}
+	else
+	{
+		std::memcpy( dst, src, bytes );
+	}
+}
+
+// per field tile storage used by non temporal kernels.
+// write only fields are computed into an aligned local buffer, which is then streamed to the field array.
+// other fields are accessed in place.
+template<typename FieldAccessT, size_t TileSize, bool stream = ( FieldAccessT::writes && ! FieldAccessT::reads ) >
+struct NonTemporalTile
+{
+	using pointer_type = typename FieldAccessT::pointer_type;
+	inline pointer_type tile( pointer_type base, size_t first ) { return base + first; }
+	inline void flush( pointer_type, size_t, size_t ) {}
+};
+
+template<typename FieldAccessT, size_t TileSize>
+struct NonTemporalTile<FieldAccessT,TileSize,true>
+{
+	using value_type = typename FieldAccessT::value_type;
+	inline value_type* tile( value_type*, size_t ) { return m_buffer; }
+	inline void flush( value_type* base, size_t first, size_t count ) { stream_store( base+first, m_buffer, count*sizeof(value_type) ); }
+	alignas(64) value_type m_buffer[TileSize];
+};
+
+template<typename... FieldAccessT>
+static inline constexpr bool has_write_only_field()
+{
+	return detail::any_of( { false, ( FieldAccessT::writes && ! FieldAccessT::reads ) ... } );
+}
+
+template<typename... FieldAccessT>
+static inline constexpr size_t element_bytes()
+{
+	return detail::sum_of( { size_t(0), sizeof( typename FieldAccessT::value_type ) ... } );
+}
+
+// decides if a kernel over N elements uses streaming stores for its write only fields
+template<size_t Alignment, typename... FieldAccessT>
+static inline bool use_non_temporal_stores( size_t N )
+{
+	return has_write_only_field<FieldAccessT...>()
+	    && Alignment >= NON_TEMPORAL_ALIGNMENT
+	    && ( N * element_bytes<FieldAccessT...>() ) >= non_temporal_threshold();
+}
+
+} // namespace soatl
+
@@ -11,6 +11,11 @@
 #include "soatl/copy.h"
 #include "soatl/memory.h"
 #include "soatl/simd.h"
+#include "soatl/instrument.h"
+#include "soatl/tuned_defaults.h"
+#include "soatl/alloc_stats.h"
+#include "soatl/variadic_template_utils.h"
+#include "soatl/field_rows.h"
 
 namespace soatl {
 
@@ -20,12 +25,12 @@ struct PackedFieldArraysHelper
 	static constexpr size_t Alignment = A;
 	static constexpr size_t AlignmentLowMask = Alignment - 1;
 	static constexpr size_t AlignmentHighMask = ~AlignmentLowMask;
-	using ElementType = typename std::tuple_element< TI-1 , std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type ;
+	using ElementId = typename std::tuple_element< TI-1 , std::tuple< ids ... > >::type ;
 
 	static inline size_t field_offset( size_t capacity )
 	{
 		return PackedFieldArraysHelper<Alignment,TI-1,ids...>::field_offset( capacity )
-		       + ( ( capacity * sizeof(ElementType) ) + AlignmentLowMask ) & AlignmentHighMask;
+		       + ( FieldStorage<ElementId>::bytes( capacity ) + AlignmentLowMask ) & AlignmentHighMask;
 	}
 };
 
@@ -78,18 +83,28 @@ struct PackedFieldArrays
 	{
 		if( s != m_size )
 		{
+			SOATL_ALLOC_STATS_SLACK( PackedFieldArrays, slack_size(m_capacity,m_size), 0 );
 			size_t new_capacity = AllocStrategy::update_capacity(s,capacity(),chunksize());
 			if( new_capacity != m_capacity )
 			{
 				reallocate( new_capacity );
 			}
 			m_size = s;
+			SOATL_ALLOC_STATS_SLACK( PackedFieldArrays, 0, slack_size(m_capacity,m_size) );
 		}
 	}
 
 	inline void* data() const { return m_storage_ptr; }
 	inline size_t size() const { return m_size; }
 	inline size_t capacity() const { return m_capacity; }
+
+	// proxies to element i of all fields, row iterators for standard algorithms (see field_rows.h)
+	inline FieldArraysRow<PackedFieldArrays> row( size_t i ) { return FieldArraysRow<PackedFieldArrays>( this, i ); }
+	inline FieldArraysRow<const PackedFieldArrays> row( size_t i ) const { return FieldArraysRow<const PackedFieldArrays>( this, i ); }
+	inline FieldArraysRowIterator<PackedFieldArrays> begin() { return FieldArraysRowIterator<PackedFieldArrays>( this, 0 ); }
+	inline FieldArraysRowIterator<PackedFieldArrays> end() { return FieldArraysRowIterator<PackedFieldArrays>( this, size() ); }
+	inline FieldArraysRowIterator<const PackedFieldArrays> begin() const { return FieldArraysRowIterator<const PackedFieldArrays>( this, 0 ); }
+	inline FieldArraysRowIterator<const PackedFieldArrays> end() const { return FieldArraysRowIterator<const PackedFieldArrays>( this, size() ); }
 	inline size_t chunk_ceil() const { return ( (size()+chunksize()-1) / chunksize() ) * chunksize(); }
 	inline size_t data_size() const { return allocation_size( capacity() ); }
 
@@ -98,16 +113,32 @@ struct PackedFieldArrays
 		resize(0);
 	}
 
-private:
-
+	// size in bytes of the storage for a given capacity
 	static inline size_t allocation_size(size_t capacity)
 	{
-		using ValueType = typename std::tuple_element<TupleSize-1,std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type ;
-		return PackedFieldArraysHelper<Alignment,TupleSize-1,ids...>::field_offset(capacity) + capacity * sizeof(ValueType);
+		using LastId = typename std::tuple_element<TupleSize-1,std::tuple< ids ... > >::type ;
+		return PackedFieldArraysHelper<Alignment,TupleSize-1,ids...>::field_offset(capacity) + FieldStorage<LastId>::bytes(capacity);
 	}
 
+	// part of allocation_size(capacity) used by alignment padding between field stripes
+	static inline size_t padding_size(size_t capacity)
+	{
+		return allocation_size(capacity) - detail::sum_of( { FieldStorage<ids>::bytes(capacity) ... } );
+	}
+
+	// part of allocation_size(capacity) holding the elements between size and capacity
+	static inline size_t slack_size(size_t capacity, size_t size)
+	{
+		return detail::sum_of( { FieldStorage<ids>::bytes(capacity) - FieldStorage<ids>::bytes(size) ... } );
+	}
+
+private:
+
 	inline void reallocate(size_t s)
 	{
+		SOATL_INSTRUMENT_KERNEL("reallocate");
+		SOATL_TRACE_FIELDS( s, ids... );
+		SOATL_TRACE_KERNEL("reallocate", s );
 		assert( ( s % ChunkSize ) == 0 );
 
 		size_t total_space = allocation_size( s );
@@ -120,12 +151,14 @@ private:
 			size_t a = std::max( alignment() , sizeof(void*) ); // this is required by posix_memalign.
 			int r = posix_memalign( &new_ptr, a, total_space );
 			assert( r == 0 );
+			SOATL_ALLOC_STATS_ALLOCATE( PackedFieldArrays, total_space, padding_size(s) );
 		}
 
 		size_t cs = std::min(s,m_size);
 		assert( ( m_storage_ptr!=nullptr && new_ptr!=nullptr ) || ( cs == 0 ) );
 		
 		// copy here
+		if( cs > 0 ) { SOATL_ALLOC_STATS_REALLOCATION_COPY( PackedFieldArrays, detail::sum_of( { FieldStorage<ids>::bytes(cs) ... } ) ); }
 		PackedFieldArrays tmp;
 		tmp.m_storage_ptr = new_ptr;
 		tmp.m_size = cs;
@@ -135,7 +168,11 @@ private:
 		tmp.m_size = 0;
 		tmp.m_capacity = 0;
 
-		if( m_storage_ptr!=nullptr ) { free(m_storage_ptr); }
+		if( m_storage_ptr!=nullptr )
+		{
+			free(m_storage_ptr);
+			SOATL_ALLOC_STATS_RELEASE( PackedFieldArrays, allocation_size(m_capacity), padding_size(m_capacity) );
+		}
 		m_storage_ptr = new_ptr;
 		m_capacity = s;
 		assert( m_storage_ptr!=nullptr || m_capacity==0 );
@@ -146,12 +183,13 @@ private:
 	size_t m_capacity = 0;
 };
 
+// alignment and chunk size from tuned_defaults.h
 template<typename... ids>
 inline
-PackedFieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...>
+PackedFieldArrays<DefaultLayout<ids...>::alignment,DefaultLayout<ids...>::chunksize,ids...>
 make_packed_field_arrays(const FieldId<ids>& ...)
 {
-	return PackedFieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...>();
+	return PackedFieldArrays<DefaultLayout<ids...>::alignment,DefaultLayout<ids...>::chunksize,ids...>();
 }
 
 template<size_t A, size_t C, typename... ids>
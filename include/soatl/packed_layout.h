@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <tuple>
+#include <type_traits>
+
+#include "soatl/constants.h"
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/tuned_defaults.h"
+#include "soatl/variadic_template_utils.h"
+
+/*
+Storage order of PackedFieldArrays : the ids of PackedFieldArrays<A,C,ids...> are stored in this order, one stripe after the other in
+a single allocation. A layout computes this order at compile time from the fields given to make_packed_field_arrays :
+	auto cell = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), soatl::layout::by_size(), atype, rx, mid, ry );
+	// cell is a PackedFieldArrays<64,16,rx_id,ry_id,mid_id,atype_id>
+Fields are still accessed by FieldId, cell[rx] does not depend on the layout. Positional access (cst::at<i>), FieldIdsTuple and
+the order of copies, snapshots and serialized fields follow the storage order.
+	layout::declared : order of the arguments.
+	layout::by_size : decreasing value size, in order of the arguments for values of the same size.
+	layout::groups( layout::group(rx,ry,rz), layout::group(e,fx) ) : fields of a group are adjacent, groups are stored in the given order,
+	  then fields of no group in order of the arguments. The first group holds the hot fields, fields read by the same kernels share a group.
+Every stripe starts on a multiple of the container alignment, the padding after a stripe only depends on its own size and the capacity.
+Only the padding of the last stripe is not allocated, so a layout saves less than one alignment per container : by_size stores the
+smallest values last, they have the most padding for most capacities. Layouts mostly change locality, a group of co-accessed
+fields is one contiguous range of memory instead of stripes scattered among cold ones.
+*/
+
+namespace soatl
+{
+
+namespace layout
+{
+	struct declared {};
+	struct by_size {};
+	template<typename... ids> struct field_group {};
+	template<typename... G> struct grouped {};
+
+	template<typename... ids> static inline field_group<ids...> group( const FieldId<ids>& ... ) { return field_group<ids...>(); }
+	template<typename... ids, typename... G> static inline grouped< field_group<ids...>, G... > groups( const field_group<ids...>&, const G& ... ) { return grouped< field_group<ids...>, G... >(); }
+}
+
+namespace detail
+{
+	template<typename... T> struct TupleConcat;
+	template<> struct TupleConcat<> { using type = std::tuple<>; };
+	template<typename... a> struct TupleConcat< std::tuple<a...> > { using type = std::tuple<a...>; };
+	template<typename... a, typename... b, typename... T>
+	struct TupleConcat< std::tuple<a...>, std::tuple<b...>, T... > { using type = typename TupleConcat< std::tuple<a...,b...>, T... >::type; };
+
+	template<typename id, typename TupleT> struct TupleContains;
+	template<typename id, typename... ids>
+	struct TupleContains< id, std::tuple<ids...> > { static constexpr bool value = any_of( { false, std::is_same<id,ids>::value ... } ); };
+
+	// ids of the list that are not in TupleT, in order
+	template<typename TupleT, typename... ids>
+	struct TupleExclude
+	{
+		using type = typename TupleConcat< typename std::conditional< TupleContains<ids,TupleT>::value , std::tuple<> , std::tuple<ids> >::type ... >::type;
+	};
+
+	// inserts id after the ids with values at least as large
+	template<typename id, typename TupleT> struct InsertBySize;
+	template<typename id> struct InsertBySize< id, std::tuple<> > { using type = std::tuple<id>; };
+	template<typename id, typename f, typename... ids>
+	struct InsertBySize< id, std::tuple<f,ids...> >
+	{
+		using type = typename std::conditional< ( sizeof(typename FieldDescriptor<id>::value_type) > sizeof(typename FieldDescriptor<f>::value_type) )
+		                                       , std::tuple<id,f,ids...>
+		                                       , typename TupleConcat< std::tuple<f> , typename InsertBySize< id, std::tuple<ids...> >::type >::type >::type;
+	};
+
+	template<typename TupleT, typename... ids> struct SortBySize { using type = TupleT; };
+	template<typename TupleT, typename id, typename... ids>
+	struct SortBySize<TupleT,id,ids...> { using type = typename SortBySize< typename InsertBySize<id,TupleT>::type, ids... >::type; };
+
+	template<size_t A, size_t C, typename TupleT> struct PackedFieldArraysOf;
+	template<size_t A, size_t C, typename... ids> struct PackedFieldArraysOf< A, C, std::tuple<ids...> > { using type = PackedFieldArrays<A,C,ids...>; };
+}
+
+// storage order of fields ids... under a layout, as a std::tuple of ids
+template<typename LayoutT, typename... ids> struct StorageOrder;
+
+template<typename... ids>
+struct StorageOrder< layout::declared, ids... > { using type = std::tuple<ids...>; };
+
+template<typename... ids>
+struct StorageOrder< layout::by_size, ids... > { using type = typename detail::SortBySize< std::tuple<>, ids... >::type; };
+
+template<typename... G, typename... ids>
+struct StorageOrder< layout::grouped<G...>, ids... >
+{
+	template<typename g> struct GroupIds;
+	template<typename... gids> struct GroupIds< layout::field_group<gids...> > { using type = std::tuple<gids...>; };
+	using Grouped = typename detail::TupleConcat< typename GroupIds<G>::type ... >::type;
+	using type = typename detail::TupleConcat< Grouped, typename detail::TupleExclude<Grouped,ids...>::type >::type;
+
+	static_assert( std::tuple_size<type>::value == sizeof...(ids) , "grouped fields must be fields of the container, in at most one group" );
+};
+
+template<typename LayoutT, size_t A, size_t C, typename... ids>
+using LayoutPackedFieldArrays = typename detail::PackedFieldArraysOf< A, C, typename StorageOrder<LayoutT,ids...>::type >::type;
+
+// alignment and chunk size from tuned_defaults.h
+template<typename LayoutT, typename... ids>
+inline
+LayoutPackedFieldArrays<LayoutT,DefaultLayout<ids...>::alignment,DefaultLayout<ids...>::chunksize,ids...>
+make_packed_field_arrays( LayoutT, const FieldId<ids>& ...)
+{
+	return LayoutPackedFieldArrays<LayoutT,DefaultLayout<ids...>::alignment,DefaultLayout<ids...>::chunksize,ids...>();
+}
+
+template<size_t A, size_t C, typename LayoutT, typename... ids>
+inline
+LayoutPackedFieldArrays<LayoutT,A,C,ids...>
+make_packed_field_arrays( cst::align<A>, cst::chunk<C>, LayoutT, const FieldId<ids>& ...)
+{
+	return LayoutPackedFieldArrays<LayoutT,A,C,ids...>();
+}
+
+} // namespace soatl
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <utility> // for std::index_sequence
+
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+
+/*
+Snapshot files store a PackedFieldArrays storage exactly as it is laid out in memory (alignment padding and capacity included),
+so that they can be mapped and used in place (see mapped_packed_field_arrays.h).
+The file starts with a header describing the layout, padded to a multiple of PACKED_SNAPSHOT_PAGE_SIZE,
+followed by data_size() bytes of storage. Layout and field names are checked when loading.
+*/
+
+namespace soatl
+{
+
+static constexpr char PACKED_SNAPSHOT_MAGIC[8] = { 'S','O','A','T','L','P','K','\0' };
+static constexpr uint32_t PACKED_SNAPSHOT_VERSION = 2;
+static constexpr size_t PACKED_SNAPSHOT_PAGE_SIZE = 4096;
+static constexpr size_t PACKED_SNAPSHOT_NAME_SIZE = 64;
+
+struct PackedSnapshotField
+{
+	char name[PACKED_SNAPSHOT_NAME_SIZE]; // truncated to PACKED_SNAPSHOT_NAME_SIZE-1 characters
+	uint64_t storage_size; // FieldStorage bytes of the stripe at the snapshot capacity, bit planes included
+	uint64_t offset; // relative to the beginning of the storage
+};
+
+struct PackedSnapshotHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t field_count;
+	uint64_t alignment;
+	uint64_t chunksize;
+	uint64_t size;
+	uint64_t capacity;
+	uint64_t data_offset; // relative to the beginning of the header
+	uint64_t data_size;
+	// followed by field_count PackedSnapshotField
+
+	inline PackedSnapshotField* fields() { return reinterpret_cast<PackedSnapshotField*>( this + 1 ); }
+	inline const PackedSnapshotField* fields() const { return reinterpret_cast<const PackedSnapshotField*>( this + 1 ); }
+};
+
+template<size_t A, size_t C, typename... ids>
+struct PackedSnapshotLayout
+{
+	using ArraysT = PackedFieldArrays<A,C,ids...>;
+	static constexpr size_t FieldCount = sizeof...(ids);
+	static constexpr size_t HeaderBytes = sizeof(PackedSnapshotHeader) + FieldCount * sizeof(PackedSnapshotField);
+	static constexpr size_t DataOffset = ( ( HeaderBytes + PACKED_SNAPSHOT_PAGE_SIZE - 1 ) / PACKED_SNAPSHOT_PAGE_SIZE ) * PACKED_SNAPSHOT_PAGE_SIZE;
+	static_assert( ArraysT::Alignment <= PACKED_SNAPSHOT_PAGE_SIZE , "alignment larger than snapshot page size" );
+
+	template<size_t... Is>
+	static inline void field_offsets( size_t capacity, uint64_t* offsets, std::index_sequence<Is...> )
+	{
+		const uint64_t o[] = { 0, PackedFieldArraysHelper<ArraysT::Alignment,Is,ids...>::field_offset(capacity) ... };
+		for(size_t i=0;i<FieldCount;i++) { offsets[i] = o[i+1]; }
+	}
+
+	// fills a header of DataOffset bytes for a storage of given size and capacity
+	static inline void make_header( void* buffer, size_t size, size_t capacity )
+	{
+		std::memset( buffer, 0, DataOffset );
+		PackedSnapshotHeader* header = static_cast<PackedSnapshotHeader*>( buffer );
+		std::memcpy( header->magic, PACKED_SNAPSHOT_MAGIC, sizeof(PACKED_SNAPSHOT_MAGIC) );
+		header->version = PACKED_SNAPSHOT_VERSION;
+		header->field_count = FieldCount;
+		header->alignment = ArraysT::Alignment;
+		header->chunksize = ArraysT::ChunkSize;
+		header->size = size;
+		header->capacity = capacity;
+		header->data_offset = DataOffset;
+		header->data_size = ArraysT::allocation_size( capacity );
+
+		const char* names[] = { "", FieldDescriptor<ids>::name() ... };
+		const size_t sizes[] = { 0, FieldStorage<ids>::bytes( capacity ) ... };
+		uint64_t offsets[FieldCount+1];
+		field_offsets( capacity, offsets, std::make_index_sequence<FieldCount>() );
+		for(size_t i=0;i<FieldCount;i++)
+		{
+			PackedSnapshotField& f = header->fields()[i];
+			std::strncpy( f.name, names[i+1], PACKED_SNAPSHOT_NAME_SIZE-1 );
+			f.storage_size = sizes[i+1];
+			f.offset = offsets[i];
+		}
+	}
+
+	// checks that a header (of at least HeaderBytes bytes) describes a storage with this container's layout
+	static inline bool check_header( const void* buffer )
+	{
+		const PackedSnapshotHeader* header = static_cast<const PackedSnapshotHeader*>( buffer );
+		if( std::memcmp( header->magic, PACKED_SNAPSHOT_MAGIC, sizeof(PACKED_SNAPSHOT_MAGIC) ) != 0
+		 || header->version != PACKED_SNAPSHOT_VERSION
+		 || header->field_count != FieldCount
+		 || header->alignment != ArraysT::Alignment
+		 || header->chunksize != ArraysT::ChunkSize
+		 || header->size > header->capacity
+		 || header->data_offset != DataOffset
+		 || header->data_size != ArraysT::allocation_size( header->capacity ) ) { return false; }
+
+		const char* names[] = { "", FieldDescriptor<ids>::name() ... };
+		const size_t sizes[] = { 0, FieldStorage<ids>::bytes( header->capacity ) ... };
+		uint64_t offsets[FieldCount+1];
+		field_offsets( header->capacity, offsets, std::make_index_sequence<FieldCount>() );
+		for(size_t i=0;i<FieldCount;i++)
+		{
+			const PackedSnapshotField& f = header->fields()[i];
+			if( std::strncmp( f.name, names[i+1], PACKED_SNAPSHOT_NAME_SIZE-1 ) != 0 || f.storage_size != sizes[i+1] || f.offset != offsets[i] ) { return false; }
+		}
+		return true;
+	}
+};
+
+// writes arrays' storage, capacity included, as a snapshot file
+template<size_t A, size_t C, typename... ids>
+static inline bool write_snapshot( const std::string& filename, const PackedFieldArrays<A,C,ids...>& arrays )
+{
+	using Layout = PackedSnapshotLayout<A,C,ids...>;
+	std::vector<char> header( Layout::DataOffset );
+	Layout::make_header( header.data(), arrays.size(), arrays.capacity() );
+	std::ofstream out( filename, std::ios::binary | std::ios::trunc );
+	out.write( header.data(), header.size() );
+	out.write( static_cast<const char*>( arrays.data() ), arrays.data_size() );
+	return bool( out );
+}
+
+// loads a snapshot file into arrays, with a single read if arrays ends up with the capacity of the snapshot, one read per field otherwise
+template<size_t A, size_t C, typename... ids>
+static inline bool read_snapshot( const std::string& filename, PackedFieldArrays<A,C,ids...>& arrays )
+{
+	using Layout = PackedSnapshotLayout<A,C,ids...>;
+	std::ifstream in( filename, std::ios::binary );
+	std::vector<char> header( Layout::DataOffset );
+	if( ! in.read( header.data(), header.size() ) || ! Layout::check_header( header.data() ) ) { return false; }
+	const PackedSnapshotHeader* h = reinterpret_cast<const PackedSnapshotHeader*>( header.data() );
+
+	arrays.resize( h->size );
+	if( arrays.capacity() == h->capacity )
+	{
+		return bool( in.read( static_cast<char*>( arrays.data() ), h->data_size ) );
+	}
+
+	// the first FieldStorage::bytes(size) bytes of a stripe hold its size elements, bit planes are stored block after block
+	char* dst[] = { nullptr, reinterpret_cast<char*>( arrays[FieldId<ids>()] ) ... };
+	const size_t bytes[] = { 0, FieldStorage<ids>::bytes( h->size ) ... };
+	for(size_t i=0;i<Layout::FieldCount;i++)
+	{
+		const PackedSnapshotField& f = h->fields()[i];
+		in.seekg( h->data_offset + f.offset );
+		if( ! in.read( dst[i+1], bytes[i+1] ) ) { return false; }
+	}
+	return true;
+}
+
+} // namespace soatl
+
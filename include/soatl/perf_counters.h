@@ -0,0 +1,383 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib> // for size_t, getenv
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <algorithm> // for std::max
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+Hardware performance counters read with Linux perf_event_open, accumulated per label.
+Each thread opens its own counters (user space only) the first time it is measured. Counters that cannot be opened
+(no PMU, e.g. in a virtual machine, or perf_event_paranoid too high) are reported as n/a, time and call counts are still collected.
+Retired vector instructions have no generic event : a raw event is taken from the SOATL_PERF_VECTOR_EVENT environment
+variable (hexadecimal, e.g. 0xfcc7), and defaults to FP_ARITH_INST_RETIRED, packed umasks, on Intel processors.
+The aggregated table is printed to stderr at exit, unless perf_registry().dump_at_exit is cleared.
+Normally used through the macros of instrument.h.
+*/
+
+namespace soatl
+{
+
+enum PerfCounterId
+{
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_LLC_MISSES,
+	PERF_L1D_MISSES,
+	PERF_DTLB_MISSES,
+	PERF_VECTOR_INSTRUCTIONS,
+	PERF_COUNTER_COUNT
+};
+
+static inline const char* perf_counter_name( int c )
+{
+	static const char* names[PERF_COUNTER_COUNT] = { "cycles", "instructions", "LLC-misses", "L1D-misses", "dTLB-misses", "vector-ins" };
+	return names[c];
+}
+
+struct PerfValues
+{
+	double count[PERF_COUNTER_COUNT] = { 0.0 };
+	double seconds = 0.0;
+
+	inline PerfValues& operator += ( const PerfValues& v )
+	{
+		for(int c=0;c<PERF_COUNTER_COUNT;c++) { count[c] += v.count[c]; }
+		seconds += v.seconds;
+		return *this;
+	}
+};
+
+// counters of the calling thread
+struct PerfThreadCounters
+{
+	inline PerfThreadCounters()
+	{
+		for(int c=0;c<PERF_COUNTER_COUNT;c++)
+		{
+			uint32_t type = PERF_TYPE_HARDWARE;
+			uint64_t config = 0;
+			if( ! event_config( c, type, config ) ) { m_fd[c] = -1; continue; }
+			struct perf_event_attr attr;
+			std::memset( &attr, 0, sizeof(attr) );
+			attr.size = sizeof(attr);
+			attr.type = type;
+			attr.config = config;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			m_fd[c] = static_cast<int>( syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 ) );
+		}
+	}
+
+	inline ~PerfThreadCounters()
+	{
+		for(int c=0;c<PERF_COUNTER_COUNT;c++) { if( m_fd[c] >= 0 ) { close( m_fd[c] ); } }
+		destroyed() = true;
+	}
+
+	PerfThreadCounters( const PerfThreadCounters& ) = delete;
+	PerfThreadCounters& operator = ( const PerfThreadCounters& ) = delete;
+
+	inline bool available( int c ) const { return m_fd[c] >= 0; }
+
+	// current values, scaled when counters are multiplexed
+	inline void read( PerfValues& v ) const
+	{
+		for(int c=0;c<PERF_COUNTER_COUNT;c++)
+		{
+			uint64_t data[3] = { 0, 0, 0 }; // value, time enabled, time running
+			if( m_fd[c] >= 0 && ::read( m_fd[c], data, sizeof(data) ) == sizeof(data) && data[2] > 0 )
+			{
+				v.count[c] = static_cast<double>( data[0] ) * ( static_cast<double>( data[1] ) / data[2] );
+			}
+			else { v.count[c] = 0.0; }
+		}
+		v.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	// counters of the calling thread. after they are destroyed at thread exit (e.g. when containers with static storage
+	// are destroyed after the main thread's thread_local objects), a set without counters is returned.
+	static inline PerfThreadCounters& local()
+	{
+		if( destroyed() )
+		{
+			static PerfThreadCounters* none = new PerfThreadCounters( NoCounters() );
+			return *none;
+		}
+		static thread_local PerfThreadCounters counters;
+		return counters;
+	}
+
+private:
+	struct NoCounters {};
+	inline PerfThreadCounters( NoCounters ) { for(int c=0;c<PERF_COUNTER_COUNT;c++) { m_fd[c] = -1; } }
+
+	static inline bool& destroyed()
+	{
+		static thread_local bool flag = false;
+		return flag;
+	}
+
+	static inline bool event_config( int c, uint32_t& type, uint64_t& config )
+	{
+		switch( c )
+		{
+			case PERF_CYCLES : config = PERF_COUNT_HW_CPU_CYCLES; return true;
+			case PERF_INSTRUCTIONS : config = PERF_COUNT_HW_INSTRUCTIONS; return true;
+			case PERF_LLC_MISSES : config = PERF_COUNT_HW_CACHE_MISSES; return true;
+			case PERF_L1D_MISSES :
+				type = PERF_TYPE_HW_CACHE;
+				config = PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+				return true;
+			case PERF_DTLB_MISSES :
+				type = PERF_TYPE_HW_CACHE;
+				config = PERF_COUNT_HW_CACHE_DTLB | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+				return true;
+			case PERF_VECTOR_INSTRUCTIONS :
+				type = PERF_TYPE_RAW;
+				if( const char* env = std::getenv( "SOATL_PERF_VECTOR_EVENT" ) ) { config = std::strtoull( env, nullptr, 16 ); return config != 0; }
+#				if defined(__x86_64__) || defined(__i386__)
+				if( __builtin_cpu_is( "intel" ) ) { config = 0xfcc7; return true; }
+#				endif
+				return false;
+		}
+		return false;
+	}
+
+	int m_fd[PERF_COUNTER_COUNT];
+};
+
+struct PerfSiteStats
+{
+	size_t calls = 0;
+	PerfValues total;
+	std::vector<PerfValues> per_thread;
+	std::vector<size_t> thread_calls;
+	bool available[PERF_COUNTER_COUNT] = { false };
+};
+
+struct PerfRegistry
+{
+	std::mutex mutex;
+	std::map<std::string,PerfSiteStats> sites;
+	bool dump_at_exit = true;
+
+	inline void add( const std::string& label, size_t thread, const PerfValues& delta, bool new_call )
+	{
+		const PerfThreadCounters& counters = PerfThreadCounters::local();
+		std::lock_guard<std::mutex> lock( mutex );
+		PerfSiteStats& site = sites[label];
+		if( new_call ) { ++ site.calls; }
+		// time of a parallel scope is the time of one thread
+		for(int c=0;c<PERF_COUNTER_COUNT;c++) { site.total.count[c] += delta.count[c]; }
+		if( new_call ) { site.total.seconds += delta.seconds; }
+		if( site.per_thread.size() <= thread ) { site.per_thread.resize( thread + 1 ); site.thread_calls.resize( thread + 1, 0 ); }
+		site.per_thread[thread] += delta;
+		++ site.thread_calls[thread];
+		for(int c=0;c<PERF_COUNTER_COUNT;c++) { site.available[c] = site.available[c] || counters.available(c); }
+	}
+
+	inline void clear()
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		sites.clear();
+	}
+
+	// one line per label with time and counters per call, followed by per thread lines when several threads contributed
+	inline void print( std::ostream& out )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		if( sites.empty() ) { return; }
+		const auto f = out.flags();
+		const auto p = out.precision();
+		out << std::left << std::setw(40) << "label" << std::right << std::setw(8) << "calls" << std::setw(12) << "ms/call";
+		for(int c=0;c<PERF_COUNTER_COUNT;c++) { out << std::setw(15) << perf_counter_name(c); }
+		out << '\n' << std::fixed << std::setprecision(3);
+		auto line = [&]( const std::string& name, size_t calls, const PerfValues& v, const PerfSiteStats& site )
+		{
+			const double n = static_cast<double>( std::max( calls, size_t(1) ) );
+			out << std::left << std::setw(40) << name << std::right << std::setw(8) << calls << std::setw(12) << v.seconds * 1.e3 / n;
+			for(int c=0;c<PERF_COUNTER_COUNT;c++)
+			{
+				if( site.available[c] ) { out << std::setw(15) << std::setprecision(0) << v.count[c] / n << std::setprecision(3); }
+				else { out << std::setw(15) << "n/a"; }
+			}
+			out << '\n';
+		};
+		for(const auto& s : sites)
+		{
+			line( s.first, s.second.calls, s.second.total, s.second );
+			if( s.second.per_thread.size() > 1 )
+			{
+				for(size_t t=0;t<s.second.per_thread.size();t++) { line( "  thread " + std::to_string(t), s.second.thread_calls[t], s.second.per_thread[t], s.second ); }
+			}
+		}
+		out.flags( f );
+		out.precision( p );
+	}
+
+};
+
+// never destroyed, so that containers destroyed at exit can still be measured. the table is printed by an exit handler.
+inline PerfRegistry& perf_registry()
+{
+	static PerfRegistry* registry = []()
+	{
+		std::atexit( []() { if( perf_registry().dump_at_exit ) { perf_registry().print( std::cerr ); } } );
+		return new PerfRegistry();
+	}();
+	return *registry;
+}
+
+// label of the innermost user scope of the calling thread (owned by the scope), and nesting of library kernel scopes.
+// trivially destructible, it can be used until the process exits.
+struct PerfThreadState
+{
+	const std::string* prefix = nullptr;
+	int kernel_depth = 0;
+
+	static inline PerfThreadState& local()
+	{
+		static thread_local PerfThreadState state;
+		return state;
+	}
+};
+
+static inline size_t perf_thread_num()
+{
+#	ifdef _OPENMP
+	return omp_get_thread_num();
+#	else
+	return 0;
+#	endif
+}
+
+// without OpenMP, every scope measures the calling thread only
+static inline bool perf_in_parallel()
+{
+#	ifdef _OPENMP
+	return omp_in_parallel();
+#	else
+	return true;
+#	endif
+}
+
+/*
+Measures its lifetime, and accounts it to a label.
+User scopes name a region, and prefix the labels of kernels called inside ("integrate/apply_simd").
+Kernel scopes are placed in library drivers, only the outermost one of a thread measures.
+Parallel scopes measure each thread of the OpenMP team separately, reading counters in a parallel region
+at both ends (it assumes the runtime keeps thread numbers attached to the same threads between regions, as its thread pool does).
+Their label prefix and kernel nesting are passed to the other threads of the team.
+Inside a parallel region, a scope measures the calling thread only.
+*/
+struct PerfScope
+{
+	inline PerfScope( const char* label, bool kernel, bool parallel ) : m_kernel(kernel)
+	{
+		PerfThreadState& state = PerfThreadState::local();
+		if( kernel && state.kernel_depth++ > 0 ) { m_active = false; return; }
+		m_label = ( state.prefix == nullptr ) ? std::string(label) : ( *state.prefix + "/" + label );
+		if( ! kernel )
+		{
+			m_saved_prefix = state.prefix;
+			state.prefix = &m_label;
+		}
+		m_parallel = parallel && ! perf_in_parallel();
+		if( m_parallel )
+		{
+#			ifdef _OPENMP
+			m_start.resize( omp_get_max_threads() );
+#			pragma omp parallel
+			{
+				const size_t t = omp_get_thread_num();
+				if( t > 0 ) { enter_team(); }
+				if( t < m_start.size() ) { PerfThreadCounters::local().read( m_start[t] ); }
+			}
+#			endif
+		}
+		else
+		{
+			m_start.resize( 1 );
+			PerfThreadCounters::local().read( m_start[0] );
+		}
+	}
+
+	inline ~PerfScope()
+	{
+		PerfThreadState& state = PerfThreadState::local();
+		if( m_kernel ) { -- state.kernel_depth; }
+		if( ! m_active ) { return; }
+		if( m_parallel )
+		{
+#			ifdef _OPENMP
+#			pragma omp parallel
+			{
+				const size_t t = omp_get_thread_num();
+				if( t < m_start.size() ) { record( t, t == 0 ); }
+				if( t > 0 ) { leave_team(); }
+			}
+#			endif
+		}
+		else
+		{
+			record( 0, true );
+		}
+		if( ! m_kernel ) { state.prefix = m_saved_prefix; }
+	}
+
+	PerfScope( const PerfScope& ) = delete;
+	PerfScope& operator = ( const PerfScope& ) = delete;
+
+private:
+	// other threads of the team see the label prefix of a user scope, and the nesting of a kernel scope
+	inline void enter_team()
+	{
+		PerfThreadState& state = PerfThreadState::local();
+		if( m_kernel ) { ++ state.kernel_depth; }
+		else { state.prefix = &m_label; }
+	}
+
+	inline void leave_team()
+	{
+		PerfThreadState& state = PerfThreadState::local();
+		if( m_kernel ) { -- state.kernel_depth; }
+		else { state.prefix = m_saved_prefix; }
+	}
+
+	inline void record( size_t slot, bool new_call )
+	{
+		PerfValues end;
+		PerfThreadCounters::local().read( end );
+		const PerfValues& start = m_start[slot];
+		for(int c=0;c<PERF_COUNTER_COUNT;c++) { end.count[c] -= start.count[c]; }
+		end.seconds -= start.seconds;
+		perf_registry().add( m_label, m_parallel ? slot : perf_thread_num(), end, new_call );
+	}
+
+	std::string m_label;
+	const std::string* m_saved_prefix = nullptr;
+	std::vector<PerfValues> m_start;
+	bool m_kernel = false;
+	bool m_parallel = false;
+	bool m_active = true;
+};
+
+} // namespace soatl
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <string>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <unistd.h> // for sysconf
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/variadic_template_utils.h"
+
+/*
+Roofline style measurements of kernels : memory traffic per element is derived at compile time from the value types
+and access modes of the fields passed to the kernel (fields without access annotation count as read and written),
+the FLOP count per element is given by the user. A KernelRoofline accumulates calls, and reports achieved GB/s, GFLOP/s
+and arithmetic intensity (flop/byte), compared to the bandwidth measured by stream_bandwidth().
+Traffic is what the kernel loads and stores, ignoring caches : a kernel running out of cache can exceed the
+memory bandwidth, and write only fields may cost an extra read (read for ownership) unless streaming stores are used.
+*/
+
+namespace soatl
+{
+
+// bytes read and written per element for one field argument of a kernel
+template<typename FieldAccessT> struct FieldTraffic;
+
+template<typename id, typename mode>
+struct FieldTraffic< FieldAccess<id,mode> >
+{
+	static constexpr size_t read_bytes = mode::reads ? sizeof(typename FieldDescriptor<id>::value_type) : 0;
+	static constexpr size_t write_bytes = mode::writes ? sizeof(typename FieldDescriptor<id>::value_type) : 0;
+};
+
+template<typename id>
+struct FieldTraffic< FieldId<id> > : public FieldTraffic< FieldAccess<id,access::read_write> > {};
+
+// bytes read and written per element by a kernel accessing the given fields
+template<typename... FieldAccessT>
+struct KernelTraffic
+{
+	static constexpr size_t read_bytes = detail::sum_of( { size_t(0), FieldTraffic<FieldAccessT>::read_bytes ... } );
+	static constexpr size_t write_bytes = detail::sum_of( { size_t(0), FieldTraffic<FieldAccessT>::write_bytes ... } );
+	static constexpr size_t bytes = read_bytes + write_bytes;
+};
+
+struct KernelRoofline
+{
+	std::string name;
+	double flops_per_element = 0.0;
+	size_t calls = 0;
+	double elements = 0.0;
+	double bytes_read = 0.0;
+	double bytes_written = 0.0;
+	double seconds = 0.0;
+
+	inline KernelRoofline( const std::string& n = "kernel", double flops = 0.0 ) : name(n), flops_per_element(flops) {}
+
+	// accounts for one call processing N elements of the given fields (FieldAccess or FieldId) in s seconds
+	template<typename... FieldAccessT>
+	inline void add( size_t N, double s, const FieldAccessT& ... )
+	{
+		++ calls;
+		elements += N;
+		bytes_read += static_cast<double>( N ) * KernelTraffic<FieldAccessT...>::read_bytes;
+		bytes_written += static_cast<double>( N ) * KernelTraffic<FieldAccessT...>::write_bytes;
+		seconds += s;
+	}
+
+	inline void reset() { calls = 0; elements = bytes_read = bytes_written = seconds = 0.0; }
+
+	inline double bytes() const { return bytes_read + bytes_written; }
+	inline double flops() const { return flops_per_element * elements; }
+	inline double gbps() const { return seconds > 0.0 ? bytes() * 1.e-9 / seconds : 0.0; }
+	inline double gflops() const { return seconds > 0.0 ? flops() * 1.e-9 / seconds : 0.0; }
+	inline double intensity() const { return bytes() > 0.0 ? flops() / bytes() : 0.0; }
+
+	// peak_gbps = 0 omits the comparison to the memory bandwidth
+	inline void print( std::ostream& out, double peak_gbps = 0.0 ) const
+	{
+		const auto f = out.flags();
+		const auto p = out.precision();
+		out << std::fixed << std::setprecision(3)
+		    << name << " : " << calls << " calls, " << static_cast<size_t>( elements / std::max( calls, size_t(1) ) ) << " elements, "
+		    << seconds * 1.e3 / std::max( calls, size_t(1) ) << " ms per call, "
+		    << gbps() << " GB/s, " << gflops() << " GFLOP/s, AI=" << intensity() << " flop/byte";
+		if( peak_gbps > 0.0 )
+		{
+			// bandwidth roof at this intensity
+			out << ", " << gbps() * 100.0 / peak_gbps << "% of peak bandwidth, memory roof " << intensity() * peak_gbps << " GFLOP/s";
+		}
+		out << std::endl;
+		out.flags( f );
+		out.precision( p );
+	}
+};
+
+// times the enclosing scope, and accounts it to a KernelRoofline
+template<typename... FieldAccessT>
+struct RooflineScope
+{
+	inline RooflineScope( KernelRoofline& r, size_t N ) : m_roofline(r), m_count(N), m_start( std::chrono::steady_clock::now() ) {}
+	inline RooflineScope( RooflineScope && other ) : m_roofline(other.m_roofline), m_count(other.m_count), m_start(other.m_start) { other.m_active = false; }
+	RooflineScope( const RooflineScope& ) = delete;
+	inline ~RooflineScope()
+	{
+		if( ! m_active ) { return; }
+		m_roofline.add( m_count, std::chrono::duration<double>( std::chrono::steady_clock::now() - m_start ).count(), FieldAccessT() ... );
+	}
+	KernelRoofline& m_roofline;
+	size_t m_count;
+	std::chrono::steady_clock::time_point m_start;
+	bool m_active = true;
+};
+
+template<typename... FieldAccessT>
+static inline RooflineScope<FieldAccessT...> make_roofline_scope( KernelRoofline& r, size_t N, const FieldAccessT& ... )
+{
+	return RooflineScope<FieldAccessT...>( r, N );
+}
+
+// measured versions of the whole container drivers of compute.h
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void roofline_apply( KernelRoofline& r, OperatorT f, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	RooflineScope< FieldAccess<ids,modes> ... > scope( r, arrays.size() );
+	apply( f, arrays, fas ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void roofline_apply_simd( KernelRoofline& r, OperatorT f, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	RooflineScope< FieldAccess<ids,modes> ... > scope( r, arrays.size() );
+	apply_simd( f, arrays, fas ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void roofline_parallel_apply( KernelRoofline& r, OperatorT f, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	RooflineScope< FieldAccess<ids,modes> ... > scope( r, arrays.size() );
+	parallel_apply( f, arrays, fas ... );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... ids, typename... modes>
+static inline void roofline_parallel_apply_simd( KernelRoofline& r, OperatorT f, FieldArraysT& arrays, const FieldAccess<ids,modes> & ... fas )
+{
+	RooflineScope< FieldAccess<ids,modes> ... > scope( r, arrays.size() );
+	parallel_apply_simd( f, arrays, fas ... );
+}
+
+// STREAM like measurement of the memory bandwidth, in GB/s, best of reps runs.
+// bytes are counted as in STREAM (no read for ownership) : copy and scale move 16 bytes per element, add and triad 24.
+// all values are 0 if the arrays cannot be allocated.
+struct StreamBandwidth
+{
+	double copy = 0.0;
+	double scale = 0.0;
+	double add = 0.0;
+	double triad = 0.0;
+};
+
+// default array length : 4 times the last level cache, and at least 2M elements
+static inline size_t default_stream_elements()
+{
+	long llc = -1;
+#	ifdef _SC_LEVEL3_CACHE_SIZE
+	llc = sysconf( _SC_LEVEL3_CACHE_SIZE );
+#	endif
+	const size_t cache = ( llc > 0 ) ? static_cast<size_t>(llc) : ( 8ul << 20 );
+	return std::max( 4 * cache / sizeof(double), size_t(1) << 21 );
+}
+
+static inline StreamBandwidth stream_bandwidth( size_t N = 0, int reps = 5 )
+{
+	if( N == 0 ) { N = default_stream_elements(); }
+	void* ptr[3] = { nullptr, nullptr, nullptr };
+	for(int k=0;k<3;k++)
+	{
+		if( posix_memalign( &ptr[k], 64, N * sizeof(double) ) != 0 ) { ptr[k] = nullptr; }
+	}
+	if( ptr[0]==nullptr || ptr[1]==nullptr || ptr[2]==nullptr )
+	{
+		for(int k=0;k<3;k++) { free( ptr[k] ); }
+		return StreamBandwidth();
+	}
+	double* __restrict__ a = static_cast<double*>( ptr[0] );
+	double* __restrict__ b = static_cast<double*>( ptr[1] );
+	double* __restrict__ c = static_cast<double*>( ptr[2] );
+	const double s = 3.0;
+
+	// first touch by the threads that run the kernels
+#	pragma omp parallel for schedule(static)
+	for(size_t i=0;i<N;i++) { a[i] = 1.0; b[i] = 2.0; c[i] = 0.0; }
+
+	using clock = std::chrono::steady_clock;
+	auto best = [N]( double bytes_per_element, double& result, clock::time_point t1 )
+	{
+		const double t = std::chrono::duration<double>( clock::now() - t1 ).count();
+		if( t > 0.0 ) { result = std::max( result, bytes_per_element * N * 1.e-9 / t ); }
+	};
+
+	StreamBandwidth bw;
+	for(int r=0;r<reps;r++)
+	{
+		auto t1 = clock::now();
+#		pragma omp parallel for simd schedule(static)
+		for(size_t i=0;i<N;i++) { c[i] = a[i]; }
+		best( 16.0, bw.copy, t1 );
+
+		t1 = clock::now();
+#		pragma omp parallel for simd schedule(static)
+		for(size_t i=0;i<N;i++) { b[i] = s * c[i]; }
+		best( 16.0, bw.scale, t1 );
+
+		t1 = clock::now();
+#		pragma omp parallel for simd schedule(static)
+		for(size_t i=0;i<N;i++) { c[i] = a[i] + b[i]; }
+		best( 24.0, bw.add, t1 );
+
+		t1 = clock::now();
+#		pragma omp parallel for simd schedule(static)
+		for(size_t i=0;i<N;i++) { a[i] = b[i] + s * c[i]; }
+		best( 24.0, bw.triad, t1 );
+	}
+	for(int k=0;k<3;k++) { free( ptr[k] ); }
+	return bw;
+}
+
+// peak memory bandwidth (GB/s) used for comparisons : STREAM triad, measured once, unless SOATL_PEAK_BANDWIDTH is defined
+static inline double default_peak_bandwidth()
+{
+#	ifdef SOATL_PEAK_BANDWIDTH
+	return SOATL_PEAK_BANDWIDTH;
+#	else
+	return stream_bandwidth().triad;
+#	endif
+}
+
+// can be changed at runtime
+inline double& peak_bandwidth()
+{
+	static double peak = default_peak_bandwidth();
+	return peak;
+}
+
+} // namespace soatl
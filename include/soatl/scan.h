@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <algorithm> // for std::min
+#include <vector>
+
+#include "soatl/field_descriptor.h"
+
+/*
+Prefix scans and histograms over fields.
+Scans are computed in two passes over blocks of SCAN_BLOCK_SIZE elements : block sums are computed in parallel,
+then scanned sequentially, then each block is scanned in parallel starting from its offset.
+Histograms are privatized per thread, and each thread spreads consecutive values over HISTOGRAM_COPIES sub-histograms
+so that runs of equal values do not serialize on the same counter.
+*/
+
+// OpenMP 5.0 scan directive, needed to vectorize the in-block scan loop
+#if defined(_OPENMP) && ( ( defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 10 ) || ( defined(__clang__) && __clang_major__ >= 11 ) )
+#define SOATL_OMP_SIMD_SCAN 1
+#endif
+
+namespace soatl
+{
+
+static constexpr size_t SCAN_BLOCK_SIZE = 16384;
+static constexpr size_t HISTOGRAM_COPIES = 8;
+
+// scans in[0;N[ into out[0;N[ starting from init. in and out may be the same array. returns the sum of init and all input values.
+template<bool inclusive, typename InT, typename OutT>
+static inline OutT scan_block( size_t N, const InT* in, OutT* out, OutT init )
+{
+	OutT acc = init;
+	if( inclusive )
+	{
+#		ifdef SOATL_OMP_SIMD_SCAN
+#		pragma omp simd reduction(inscan,+:acc)
+#		endif
+		for(size_t i=0;i<N;i++)
+		{
+			acc += in[i];
+#			ifdef SOATL_OMP_SIMD_SCAN
+#			pragma omp scan inclusive(acc)
+#			endif
+			out[i] = acc;
+		}
+	}
+	else if( static_cast<const void*>(in) == static_cast<const void*>(out) )
+	{
+		// in place : in[i] is loaded before out[i] is stored. the scan directive cannot carry a value
+		// from its input phase to its scan phase, and may run the scan phase of an iteration first.
+		for(size_t i=0;i<N;i++)
+		{
+			const OutT x = in[i];
+			out[i] = acc;
+			acc += x;
+		}
+	}
+	else
+	{
+#		ifdef SOATL_OMP_SIMD_SCAN
+#		pragma omp simd reduction(inscan,+:acc)
+#		endif
+		for(size_t i=0;i<N;i++)
+		{
+			out[i] = acc;
+#			ifdef SOATL_OMP_SIMD_SCAN
+#			pragma omp scan exclusive(acc)
+#			endif
+			acc += in[i];
+		}
+	}
+	return acc;
+}
+
+template<bool inclusive, typename InT, typename OutT>
+static inline OutT parallel_scan( size_t N, const InT* in, OutT* out, OutT init )
+{
+	const size_t nblocks = ( N + SCAN_BLOCK_SIZE - 1 ) / SCAN_BLOCK_SIZE;
+	if( nblocks <= 1 )
+	{
+		return scan_block<inclusive>( N, in, out, init );
+	}
+
+	std::vector<OutT> offsets( nblocks+1 );
+
+	// pass 1 : block sums
+#	pragma omp parallel for schedule(static)
+	for(size_t b=0;b<nblocks;b++)
+	{
+		const size_t first = b * SCAN_BLOCK_SIZE;
+		const size_t n = std::min( SCAN_BLOCK_SIZE , N - first );
+		const InT* __restrict__ block = in + first;
+		OutT s = 0;
+#		pragma omp simd reduction(+:s)
+		for(size_t i=0;i<n;i++) { s += block[i]; }
+		offsets[b+1] = s;
+	}
+
+	offsets[0] = init;
+	for(size_t b=0;b<nblocks;b++) { offsets[b+1] += offsets[b]; }
+
+	// pass 2 : each block is scanned from its offset
+#	pragma omp parallel for schedule(static)
+	for(size_t b=0;b<nblocks;b++)
+	{
+		const size_t first = b * SCAN_BLOCK_SIZE;
+		scan_block<inclusive>( std::min( SCAN_BLOCK_SIZE , N - first ), in+first, out+first, offsets[b] );
+	}
+
+	return offsets[nblocks];
+}
+
+// raw pointers
+
+template<typename InT, typename OutT>
+static inline OutT inclusive_scan( size_t N, const InT* in, OutT* out, OutT init = OutT(0) )
+{
+	return parallel_scan<true>( N, in, out, init );
+}
+
+template<typename InT, typename OutT>
+static inline OutT exclusive_scan( size_t N, const InT* in, OutT* out, OutT init = OutT(0) )
+{
+	return parallel_scan<false>( N, in, out, init );
+}
+
+// field arrays
+
+template<typename FieldArraysT, typename in_id, typename out_id>
+static inline typename FieldId<out_id>::value_type inclusive_scan( FieldArraysT& arrays, const FieldId<in_id>& in, const FieldId<out_id>& out
+                                                                 , typename FieldId<out_id>::value_type init = 0 )
+{
+	return inclusive_scan( arrays.size(), static_cast<const typename FieldId<in_id>::value_type*>( arrays[in] ), arrays[out], init );
+}
+
+template<typename FieldArraysT, typename in_id, typename out_id>
+static inline typename FieldId<out_id>::value_type exclusive_scan( FieldArraysT& arrays, const FieldId<in_id>& in, const FieldId<out_id>& out
+                                                                 , typename FieldId<out_id>::value_type init = 0 )
+{
+	return exclusive_scan( arrays.size(), static_cast<const typename FieldId<in_id>::value_type*>( arrays[in] ), arrays[out], init );
+}
+
+// histograms : bins[v] is incremented for each value v in [0;nbins[, other values are ignored. bins are not reset.
+
+template<typename T, typename CountT>
+static inline void histogram( size_t N, const T* values, CountT* bins, size_t nbins )
+{
+	const size_t nblocks = ( N + SCAN_BLOCK_SIZE - 1 ) / SCAN_BLOCK_SIZE;
+
+#	pragma omp parallel if( nblocks > 1 )
+	{
+		std::vector<CountT> local( HISTOGRAM_COPIES * nbins , 0 );
+		CountT* __restrict__ h = local.data();
+
+#		pragma omp for schedule(static) nowait
+		for(size_t b=0;b<nblocks;b++)
+		{
+			const size_t first = b * SCAN_BLOCK_SIZE;
+			const size_t end = std::min( first + SCAN_BLOCK_SIZE , N );
+			const T* __restrict__ v = values;
+			size_t i = first;
+			for(; i+HISTOGRAM_COPIES<=end; i+=HISTOGRAM_COPIES)
+			{
+				for(size_t c=0;c<HISTOGRAM_COPIES;c++)
+				{
+					const size_t x = static_cast<size_t>( v[i+c] );
+					if( x < nbins ) { ++ h[ c*nbins + x ]; }
+				}
+			}
+			for(; i<end; i++)
+			{
+				const size_t x = static_cast<size_t>( v[i] );
+				if( x < nbins ) { ++ h[x]; }
+			}
+		}
+
+		for(size_t c=1;c<HISTOGRAM_COPIES;c++)
+		{
+#			pragma omp simd
+			for(size_t x=0;x<nbins;x++) { h[x] += h[c*nbins+x]; }
+		}
+
+		for(size_t x=0;x<nbins;x++)
+		{
+			if( h[x] != 0 )
+			{
+#				pragma omp atomic
+				bins[x] += h[x];
+			}
+		}
+	}
+}
+
+template<typename FieldArraysT, typename id, typename CountT>
+static inline void histogram( FieldArraysT& arrays, const FieldId<id>& fid, CountT* bins, size_t nbins )
+{
+	histogram( arrays.size(), static_cast<const typename FieldId<id>::value_type*>( arrays[fid] ), bins, nbins );
+}
+
+template<typename FieldArraysT, typename id, typename CountT>
+static inline void histogram( FieldArraysT& arrays, const FieldId<id>& fid, std::vector<CountT>& bins )
+{
+	histogram( arrays, fid, bins.data(), bins.size() );
+}
+
+} // namespace soatl
+
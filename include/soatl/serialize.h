@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstdint>
+#include <cstring>
+#include <algorithm> // for std::max
+#include <string>
+#include <vector>
+#include <tuple>
+#include <istream>
+#include <ostream>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/variadic_template_utils.h"
+
+/*
+Self describing binary format for field containers. Layout (native byte order) :
+
+	char     magic[8]         "SOATLFA"
+	uint32_t version
+	uint32_t byte order mark  0x01020304
+	uint64_t element count
+	uint32_t field count
+	field count times :
+		uint32_t name length, followed by name characters (FieldDescriptor::name())
+		uint32_t element type (SerializedType)
+		uint32_t element size in bytes
+		uint64_t offset of field data, relative to the beginning of the header
+	field data, element count values per field, without padding
+
+Fields are mapped by name when reading, so a file can be loaded into any container holding fields of the same names and types,
+regardless of field order, alignment or chunk size. Each field is loaded with a single read.
+*/
+
+namespace soatl
+{
+
+static constexpr char SERIALIZE_MAGIC[8] = { 'S','O','A','T','L','F','A','\0' };
+static constexpr uint32_t SERIALIZE_VERSION = 1;
+static constexpr uint32_t SERIALIZE_BYTE_ORDER_MARK = 0x01020304;
+
+enum SerializedType : uint32_t
+{
+	SERIALIZED_OPAQUE = 0, // non arithmetic types, only checked by size
+	SERIALIZED_INT8, SERIALIZED_UINT8, SERIALIZED_INT16, SERIALIZED_UINT16,
+	SERIALIZED_INT32, SERIALIZED_UINT32, SERIALIZED_INT64, SERIALIZED_UINT64,
+	SERIALIZED_FLOAT, SERIALIZED_DOUBLE, SERIALIZED_BOOL, SERIALIZED_CHAR
+};
+
+template<typename T> struct SerializedTypeCode { static constexpr uint32_t value = SERIALIZED_OPAQUE; };
+template<> struct SerializedTypeCode<int8_t> { static constexpr uint32_t value = SERIALIZED_INT8; };
+template<> struct SerializedTypeCode<uint8_t> { static constexpr uint32_t value = SERIALIZED_UINT8; };
+template<> struct SerializedTypeCode<int16_t> { static constexpr uint32_t value = SERIALIZED_INT16; };
+template<> struct SerializedTypeCode<uint16_t> { static constexpr uint32_t value = SERIALIZED_UINT16; };
+template<> struct SerializedTypeCode<int32_t> { static constexpr uint32_t value = SERIALIZED_INT32; };
+template<> struct SerializedTypeCode<uint32_t> { static constexpr uint32_t value = SERIALIZED_UINT32; };
+template<> struct SerializedTypeCode<int64_t> { static constexpr uint32_t value = SERIALIZED_INT64; };
+template<> struct SerializedTypeCode<uint64_t> { static constexpr uint32_t value = SERIALIZED_UINT64; };
+template<> struct SerializedTypeCode<float> { static constexpr uint32_t value = SERIALIZED_FLOAT; };
+template<> struct SerializedTypeCode<double> { static constexpr uint32_t value = SERIALIZED_DOUBLE; };
+template<> struct SerializedTypeCode<bool> { static constexpr uint32_t value = SERIALIZED_BOOL; };
+template<> struct SerializedTypeCode<char> { static constexpr uint32_t value = SERIALIZED_CHAR; };
+
+struct SerializedField
+{
+	std::string name;
+	uint32_t type = SERIALIZED_OPAQUE;
+	uint32_t element_size = 0;
+	uint64_t offset = 0;
+
+	template<typename id>
+	static inline SerializedField make( FieldId<id> )
+	{
+		using ValueType = typename FieldId<id>::value_type;
+		static_assert( ! IsBitPlanes<id>::value , "bit fields are not serialized" );
+		SerializedField f;
+		f.name = FieldId<id>::name();
+		f.type = SerializedTypeCode<ValueType>::value;
+		f.element_size = sizeof(ValueType);
+		return f;
+	}
+
+	// size of this field's record in the header
+	inline size_t header_bytes() const { return sizeof(uint32_t) + name.size() + 2*sizeof(uint32_t) + sizeof(uint64_t); }
+};
+
+struct SerializedHeader
+{
+	uint64_t count = 0;
+	std::vector<SerializedField> fields;
+
+	inline size_t header_bytes() const
+	{
+		size_t s = sizeof(SERIALIZE_MAGIC) + 2*sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t);
+		for(const auto& f : fields) { s += f.header_bytes(); }
+		return s;
+	}
+
+	inline const SerializedField* find( const char* name ) const
+	{
+		for(const auto& f : fields) { if( f.name == name ) return &f; }
+		return nullptr;
+	}
+};
+
+template<typename T>
+static inline void serialize_pod( std::ostream& out, const T& x ) { out.write( reinterpret_cast<const char*>(&x), sizeof(T) ); }
+
+template<typename T>
+static inline bool deserialize_pod( std::istream& in, T& x ) { return bool( in.read( reinterpret_cast<char*>(&x), sizeof(T) ) ); }
+
+static inline void write_header( std::ostream& out, const SerializedHeader& header )
+{
+	out.write( SERIALIZE_MAGIC, sizeof(SERIALIZE_MAGIC) );
+	serialize_pod( out, SERIALIZE_VERSION );
+	serialize_pod( out, SERIALIZE_BYTE_ORDER_MARK );
+	serialize_pod( out, header.count );
+	serialize_pod( out, static_cast<uint32_t>( header.fields.size() ) );
+	for(const auto& f : header.fields)
+	{
+		serialize_pod( out, static_cast<uint32_t>( f.name.size() ) );
+		out.write( f.name.data(), f.name.size() );
+		serialize_pod( out, f.type );
+		serialize_pod( out, f.element_size );
+		serialize_pod( out, f.offset );
+	}
+}
+
+// reads and checks a header. returns false if the stream does not start with a valid header.
+static inline bool read_header( std::istream& in, SerializedHeader& header )
+{
+	char magic[sizeof(SERIALIZE_MAGIC)];
+	uint32_t version = 0, bom = 0, nfields = 0;
+	if( ! in.read( magic, sizeof(magic) ) || std::memcmp( magic, SERIALIZE_MAGIC, sizeof(magic) ) != 0 ) { return false; }
+	if( ! deserialize_pod(in,version) || version != SERIALIZE_VERSION ) { return false; }
+	if( ! deserialize_pod(in,bom) || bom != SERIALIZE_BYTE_ORDER_MARK ) { return false; }
+	if( ! deserialize_pod(in,header.count) || ! deserialize_pod(in,nfields) ) { return false; }
+	header.fields.resize( nfields );
+	for(auto& f : header.fields)
+	{
+		uint32_t len = 0;
+		if( ! deserialize_pod(in,len) ) { return false; }
+		f.name.resize( len );
+		if( ! in.read( &f.name[0], len ) ) { return false; }
+		if( ! deserialize_pod(in,f.type) || ! deserialize_pod(in,f.element_size) || ! deserialize_pod(in,f.offset) ) { return false; }
+	}
+	return true;
+}
+
+// builds the header describing the given fields of arrays, with data offsets
+template<typename FieldArraysT, typename... ids>
+static inline SerializedHeader make_header( const FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	SerializedHeader header;
+	header.count = arrays.size();
+	header.fields = { SerializedField::make(fids) ... };
+	uint64_t offset = header.header_bytes();
+	for(auto& f : header.fields)
+	{
+		f.offset = offset;
+		offset += f.element_size * header.count;
+	}
+	return header;
+}
+
+template<typename FieldArraysT, typename id>
+static inline bool read_field( std::istream& in, std::streampos base, const SerializedHeader& header, FieldArraysT& arrays, FieldId<id> fid )
+{
+	using ValueType = typename FieldId<id>::value_type;
+	static_assert( ! IsBitPlanes<id>::value , "bit fields are not serialized" );
+	const SerializedField* f = header.find( FieldId<id>::name() );
+	if( f == nullptr || f->type != SerializedTypeCode<ValueType>::value || f->element_size != sizeof(ValueType) ) { return false; }
+	in.seekg( base + static_cast<std::streamoff>( f->offset ) );
+	return bool( in.read( reinterpret_cast<char*>( arrays[fid] ), sizeof(ValueType) * header.count ) );
+}
+
+// writes size() elements of the given fields (all fields of arrays by default)
+template<typename FieldArraysT, typename... ids>
+static inline bool write( std::ostream& out, const FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	const SerializedHeader header = make_header( arrays, fids ... );
+	write_header( out, header );
+	TEMPLATE_LIST_BEGIN
+		out.write( reinterpret_cast<const char*>( arrays[fids] ), sizeof( typename FieldId<ids>::value_type ) * header.count )
+	TEMPLATE_LIST_END
+	return bool( out );
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline bool write( std::ostream& out, const FieldArraysT& arrays, const std::tuple< FieldId<ids> ... > & )
+{
+	return write( out, arrays, FieldId<ids>() ... );
+}
+
+template<typename FieldArraysT>
+static inline bool write( std::ostream& out, const FieldArraysT& arrays )
+{
+	return write( out, arrays, typename FieldArraysT::FieldIdsTuple () );
+}
+
+// resizes arrays to the stored element count and loads the given fields (all fields of arrays by default).
+// fields stored in the stream but not requested are skipped. returns false if a requested field is missing or has another type.
+template<typename FieldArraysT, typename... ids>
+static inline bool read( std::istream& in, FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	const std::streampos base = in.tellg();
+	SerializedHeader header;
+	if( ! read_header( in, header ) ) { return false; }
+	arrays.resize( header.count );
+	const bool ok[] = { true, read_field( in, base, header, arrays, fids ) ... };
+	bool r = true;
+	for(bool b : ok) { r = r && b; }
+
+	// leave the stream after the data, so that several containers can be stored one after the other
+	uint64_t end = header.header_bytes();
+	for(const auto& f : header.fields) { end = std::max( end , f.offset + f.element_size * header.count ); }
+	in.seekg( base + static_cast<std::streamoff>( end ) );
+	return r && bool( in );
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline bool read( std::istream& in, FieldArraysT& arrays, const std::tuple< FieldId<ids> ... > & )
+{
+	return read( in, arrays, FieldId<ids>() ... );
+}
+
+template<typename FieldArraysT>
+static inline bool read( std::istream& in, FieldArraysT& arrays )
+{
+	return read( in, arrays, typename FieldArraysT::FieldIdsTuple () );
+}
+
+} // namespace soatl
+
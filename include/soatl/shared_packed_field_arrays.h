@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib> // for size_t
+#include <algorithm> // for std::min
+#include <string>
+#include <tuple>
+#include <atomic>
+#include <new> // for placement new
+#include <thread>
+#include <utility> // for std::swap
+
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "soatl/constants.h"
+#include "soatl/variadic_template_utils.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/packed_snapshot.h"
+
+/*
+PackedFieldArrays storage in a POSIX shared memory object, so that another process on the same machine
+(e.g. an in-situ analysis next to a simulation) can run kernels on the live data without copying it.
+The owner create()s the object with a fixed capacity, other processes attach() a read only view.
+Segment layout :
+	page 0                     SharedFieldArraysControl, holding the generation counter
+	page 1                     PackedSnapshotHeader and field records (see packed_snapshot.h), padded to a page multiple
+	data                       storage of a PackedFieldArrays of the given capacity
+Consistency is checked with a sequence lock : the owner brackets modifications with write_begin()/write_end(),
+which make the generation odd while data is being modified. Readers note the generation with read_begin(), run
+their kernel, and keep its result only if read_validate() finds the generation unchanged (read_consistent() does the retries).
+*/
+
+namespace soatl {
+
+struct SharedFieldArraysControl
+{
+	std::atomic<uint64_t> generation; // odd while the owner modifies the data
+	uint64_t segment_size;
+};
+
+template< size_t _Alignment, size_t _ChunkSize, typename... ids>
+struct SharedPackedFieldArrays
+{
+	using ArraysT = PackedFieldArrays<_Alignment,_ChunkSize,ids...>;
+	using Layout = PackedSnapshotLayout<_Alignment,_ChunkSize,ids...>;
+
+	static constexpr size_t Alignment = ArraysT::Alignment;
+	static constexpr size_t ChunkSize = ArraysT::ChunkSize;
+	static constexpr int TupleSize = sizeof...(ids);
+	static constexpr size_t HeaderOffset = PACKED_SNAPSHOT_PAGE_SIZE;
+	static constexpr size_t DataOffset = HeaderOffset + Layout::DataOffset;
+	static_assert( sizeof(SharedFieldArraysControl) <= HeaderOffset , "control block larger than a page" );
+
+	using FieldIdsTuple = std::tuple< FieldId<ids> ... > ;
+
+	static constexpr size_t alignment() { return Alignment; }
+	static constexpr size_t chunksize() { return ChunkSize; }
+
+	SharedPackedFieldArrays() = default;
+	SharedPackedFieldArrays( const SharedPackedFieldArrays& ) = delete;
+	SharedPackedFieldArrays& operator = ( const SharedPackedFieldArrays& ) = delete;
+	inline SharedPackedFieldArrays( SharedPackedFieldArrays && other ) { *this = std::move(other); }
+	inline SharedPackedFieldArrays& operator = ( SharedPackedFieldArrays && other )
+	{
+		detach();
+		std::swap( m_name, other.m_name );
+		std::swap( m_owner, other.m_owner );
+		std::swap( m_map_ptr, other.m_map_ptr );
+		std::swap( m_map_size, other.m_map_size );
+		std::swap( m_size, other.m_size );
+		std::swap( m_capacity, other.m_capacity );
+		return *this;
+	}
+
+	template<size_t index>
+	inline typename std::tuple_element<index,std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type * __restrict__ operator [] ( cst::at<index> ) const
+	{
+		using ValueType = typename std::tuple_element<index, std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type ;
+		uint8_t* aptr = static_cast<uint8_t*>( data() ) + PackedFieldArraysHelper<Alignment,index,ids...>::field_offset(capacity()) ;
+		return (ValueType* __restrict__) __builtin_assume_aligned( aptr , Alignment );
+	}
+
+	template<typename _id>
+	inline typename FieldDescriptor<_id>::value_type * __restrict__ operator [] ( FieldId<_id> ) const
+	{
+		static constexpr size_t index = find_index_of_id<_id,ids...>::index;
+		using ValueType = typename std::tuple_element<index, std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type ;
+		uint8_t* aptr = static_cast<uint8_t*>( data() ) + PackedFieldArraysHelper<Alignment,index,ids...>::field_offset(capacity()) ;
+		return (ValueType* __restrict__) __builtin_assume_aligned( aptr , Alignment );
+	}
+
+	// creates (or replaces) the shared memory object name (e.g. "/simulation_particles"), with room for capacity elements.
+	// the object is removed when the owner is destroyed.
+	inline bool create( const std::string& name, size_t capacity )
+	{
+		detach();
+		capacity = ( ( capacity + ChunkSize - 1 ) / ChunkSize ) * ChunkSize;
+		const size_t segment_size = DataOffset + ArraysT::allocation_size( capacity );
+		int fd = shm_open( name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600 );
+		if( fd < 0 ) { return false; }
+		if( ftruncate( fd, segment_size ) != 0 )
+		{
+			close( fd );
+			shm_unlink( name.c_str() );
+			return false;
+		}
+		void* ptr = mmap( nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+		close( fd );
+		if( ptr == MAP_FAILED )
+		{
+			shm_unlink( name.c_str() );
+			return false;
+		}
+
+		m_name = name;
+		m_owner = true;
+		m_map_ptr = ptr;
+		m_map_size = segment_size;
+		m_size = 0;
+		m_capacity = capacity;
+		SharedFieldArraysControl* ctrl = new( ptr ) SharedFieldArraysControl;
+		ctrl->generation.store( 0, std::memory_order_relaxed );
+		ctrl->segment_size = segment_size;
+		Layout::make_header( header(), 0, capacity );
+		return true;
+	}
+
+	// maps a read only view of a shared memory object created by another container with the same layout
+	inline bool attach( const std::string& name )
+	{
+		detach();
+		int fd = shm_open( name.c_str(), O_RDONLY, 0 );
+		if( fd < 0 ) { return false; }
+		struct stat st;
+		if( fstat( fd, &st ) != 0 || static_cast<size_t>( st.st_size ) < DataOffset )
+		{
+			close( fd );
+			return false;
+		}
+		void* ptr = mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+		close( fd );
+		if( ptr == MAP_FAILED ) { return false; }
+
+		const PackedSnapshotHeader* h = reinterpret_cast<const PackedSnapshotHeader*>( static_cast<uint8_t*>( ptr ) + HeaderOffset );
+		if( ! Layout::check_header( h ) || ( DataOffset + h->data_size ) > static_cast<size_t>( st.st_size ) )
+		{
+			munmap( ptr, st.st_size );
+			return false;
+		}
+
+		m_name = name;
+		m_owner = false;
+		m_map_ptr = ptr;
+		m_map_size = st.st_size;
+		m_capacity = h->capacity;
+		m_size = h->size;
+		return true;
+	}
+
+	inline void detach()
+	{
+		if( m_map_ptr != nullptr ) { munmap( m_map_ptr, m_map_size ); }
+		if( m_owner ) { shm_unlink( m_name.c_str() ); }
+		m_name.clear();
+		m_owner = false;
+		m_map_ptr = nullptr;
+		m_map_size = 0;
+		m_size = 0;
+		m_capacity = 0;
+	}
+
+	// owner only. size cannot exceed the capacity given at creation. call it between write_begin() and write_end().
+	inline void resize( size_t s )
+	{
+		assert( m_owner && s <= m_capacity );
+		m_size = s;
+		header()->size = s;
+	}
+
+	// owner only. brackets modifications of the data, including resize()
+	inline void write_begin()
+	{
+		assert( m_owner );
+		control()->generation.fetch_add( 1, std::memory_order_relaxed );
+		std::atomic_thread_fence( std::memory_order_release );
+	}
+
+	inline void write_end()
+	{
+		control()->generation.fetch_add( 1, std::memory_order_release );
+	}
+
+	// readers : waits until no modification is in progress, updates size(), and returns the generation to pass to read_validate()
+	inline uint64_t read_begin()
+	{
+		uint64_t g = control()->generation.load( std::memory_order_acquire );
+		while( g & 1 )
+		{
+			std::this_thread::yield();
+			g = control()->generation.load( std::memory_order_acquire );
+		}
+		m_size = std::min( static_cast<size_t>( header()->size ), m_capacity );
+		return g;
+	}
+
+	// true if the data did not change since read_begin() returned g, i.e. what has been read is consistent
+	inline bool read_validate( uint64_t g ) const
+	{
+		std::atomic_thread_fence( std::memory_order_acquire );
+		return control()->generation.load( std::memory_order_relaxed ) == g;
+	}
+
+	// runs func(*this) until it completes without concurrent modification (or max_attempts is reached, if not 0).
+	// func must only read the data, and be safe to run on data being modified (its result is discarded then).
+	// returns the number of attempts, or 0 if none was consistent.
+	template<typename FuncT>
+	inline size_t read_consistent( FuncT func, size_t max_attempts = 0 )
+	{
+		for(size_t attempt=1; max_attempts==0 || attempt<=max_attempts ; attempt++)
+		{
+			const uint64_t g = read_begin();
+			func( *this );
+			if( read_validate( g ) ) { return attempt; }
+		}
+		return 0;
+	}
+
+	inline uint64_t generation() const { return control()->generation.load( std::memory_order_acquire ); }
+	inline bool is_owner() const { return m_owner; }
+	inline bool is_attached() const { return m_map_ptr != nullptr; }
+	inline void* data() const { return static_cast<uint8_t*>( m_map_ptr ) + DataOffset; }
+	inline size_t size() const { return m_size; }
+	inline size_t capacity() const { return m_capacity; }
+	inline size_t chunk_ceil() const { return ( (size()+chunksize()-1) / chunksize() ) * chunksize(); }
+	inline size_t data_size() const { return ArraysT::allocation_size( capacity() ); }
+
+	inline ~SharedPackedFieldArrays()
+	{
+		detach();
+	}
+
+private:
+	inline SharedFieldArraysControl* control() const { return static_cast<SharedFieldArraysControl*>( m_map_ptr ); }
+	inline PackedSnapshotHeader* header() const { return reinterpret_cast<PackedSnapshotHeader*>( static_cast<uint8_t*>( m_map_ptr ) + HeaderOffset ); }
+
+	std::string m_name;
+	bool m_owner = false;
+	void* m_map_ptr = nullptr;
+	size_t m_map_size = 0;
+	size_t m_size = 0;
+	size_t m_capacity = 0;
+};
+
+template<typename... ids>
+inline
+SharedPackedFieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...>
+make_shared_packed_field_arrays(const FieldId<ids>& ...)
+{
+	return SharedPackedFieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...>();
+}
+
+template<size_t A, size_t C, typename... ids>
+inline
+SharedPackedFieldArrays<A,C,ids...>
+make_shared_packed_field_arrays( cst::align<A>, cst::chunk<C>, const FieldId<ids>& ...)
+{
+	return SharedPackedFieldArrays<A,C,ids...>();
+}
+
+} // namespace soatl
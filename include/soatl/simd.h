@@ -3,6 +3,7 @@
 #include <cstdlib> // for size_t
 #include <cstdint> // for int64_t, int32_t, etc.
 #include <algorithm> // for std::sort
+#include <type_traits> // for std::remove_cv
 #include <assert.h>
 #include "soatl/variadic_template_utils.h"
 
@@ -100,7 +101,7 @@ static inline void check_simd_pointers( size_t N, T* ... arraypack )
 	size_t addr;
 	TEMPLATE_LIST_BEGIN
 		addr = reinterpret_cast<size_t>(arraypack) ,
-		assert( ( addr % SimdRequirements<T>::alignment ) == 0 && "Address does not have correct alignment" )
+		assert( ( addr % SimdRequirements< typename std::remove_cv<T>::type >::alignment ) == 0 && "Address does not have correct alignment" )
 	TEMPLATE_LIST_END
 }
 
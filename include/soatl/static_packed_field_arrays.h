@@ -20,9 +20,9 @@ struct StaticPackedFieldArraysHelper
 	static constexpr size_t Alignment = A;
 	static constexpr size_t AlignmentLowMask = Alignment - 1;
 	static constexpr size_t AlignmentHighMask = ~AlignmentLowMask;
-	using ElementType = typename std::tuple_element< TI-1 , std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type ;
+	using ElementId = typename std::tuple_element< TI-1 , std::tuple< ids ... > >::type ;
 	static constexpr size_t offset = StaticPackedFieldArraysHelper<Alignment,TI-1,capacity,ids...>::offset
-				        + ( ( capacity * sizeof(ElementType) ) + AlignmentLowMask ) & AlignmentHighMask;
+				        + ( FieldStorage<ElementId>::bytes( capacity ) + AlignmentLowMask ) & AlignmentHighMask;
 };
 
 template<size_t A, size_t capacity, typename... ids>
@@ -46,8 +46,8 @@ struct alignas(_Alignment) StaticPackedFieldArrays
 	
 	using FieldIdsTuple = std::tuple< FieldId<ids> ... > ;
 
-	using LastValueType = typename std::tuple_element<TupleSize-1,std::tuple< typename FieldDescriptor<ids>::value_type ... > >::type ;
-	static constexpr size_t AllocationSize = StaticPackedFieldArraysHelper<Alignment,TupleSize-1,Size,ids...>::offset + Size * sizeof(LastValueType);
+	using LastId = typename std::tuple_element<TupleSize-1,std::tuple< ids ... > >::type ;
+	static constexpr size_t AllocationSize = StaticPackedFieldArraysHelper<Alignment,TupleSize-1,Size,ids...>::offset + FieldStorage<LastId>::bytes(Size);
 
 	template<typename _id>
 	inline typename FieldDescriptor<_id>::value_type * __restrict__ operator [] ( FieldId<_id> ) 
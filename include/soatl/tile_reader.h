@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstdint>
+#include <cstring>
+#include <algorithm> // for std::min, std::max
+#include <string>
+#include <fstream>
+#include <future>
+#include <utility> // for std::swap
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "soatl/constants.h"
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/serialize.h"
+#include "soatl/column_io.h" // for pread_all
+
+/*
+Out of core traversal of a file written with soatl::write (see serialize.h), for datasets that do not fit in memory.
+The selected fields are loaded by tiles of a fixed number of elements (a multiple of the chunk size) into one of two
+PackedFieldArrays buffers, so that only 2 tiles are ever held in memory. While the user function runs on tile k,
+tile k+1 is read in the other buffer by an asynchronous task, with one positioned read (pread) per field.
+The file may hold more fields than the selected ones, other fields are never read.
+*/
+
+namespace soatl
+{
+
+static constexpr size_t TILE_READER_DEFAULT_TILE_SIZE = 1<<18; // elements
+
+template< size_t _Alignment, size_t _ChunkSize, typename... ids>
+class FieldTileReader
+{
+public:
+	using TileT = PackedFieldArrays<_Alignment,_ChunkSize,ids...>;
+	using FieldIdsTuple = std::tuple< FieldId<ids> ... > ;
+	static constexpr size_t FieldCount = sizeof...(ids);
+
+	FieldTileReader() = default;
+	FieldTileReader( const FieldTileReader& ) = delete;
+	FieldTileReader& operator = ( const FieldTileReader& ) = delete;
+	inline FieldTileReader( FieldTileReader && other ) { *this = std::move(other); }
+	inline FieldTileReader& operator = ( FieldTileReader && other )
+	{
+		close();
+		std::swap( m_fd, other.m_fd );
+		std::swap( m_size, other.m_size );
+		std::swap( m_tile_size, other.m_tile_size );
+		for(size_t i=0;i<FieldCount;i++) { m_offsets[i] = other.m_offsets[i]; }
+		return *this;
+	}
+
+	// reads the file header. tile_size is rounded up to a multiple of the chunk size.
+	// returns false if the file cannot be opened, or if a selected field is missing or has another type.
+	inline bool open( const std::string& filename, size_t tile_size = TILE_READER_DEFAULT_TILE_SIZE )
+	{
+		close();
+		SerializedHeader header;
+		{
+			std::ifstream in( filename, std::ios::binary );
+			if( ! read_header( in, header ) ) { return false; }
+		}
+		const SerializedField* fields[] = { nullptr, header.find( FieldId<ids>::name() ) ... };
+		const uint32_t types[] = { 0, SerializedTypeCode< typename FieldId<ids>::value_type >::value ... };
+		const uint32_t sizes[] = { 0, sizeof( typename FieldId<ids>::value_type ) ... };
+		for(size_t i=0;i<FieldCount;i++)
+		{
+			const SerializedField* f = fields[i+1];
+			if( f == nullptr || f->type != types[i+1] || f->element_size != sizes[i+1] ) { return false; }
+			m_offsets[i] = f->offset;
+		}
+
+		m_fd = ::open( filename.c_str(), O_RDONLY );
+		if( m_fd < 0 ) { return false; }
+		posix_fadvise( m_fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+		m_size = header.count;
+		m_tile_size = ( ( std::max( tile_size, size_t(1) ) + _ChunkSize - 1 ) / _ChunkSize ) * _ChunkSize;
+		return true;
+	}
+
+	inline void close()
+	{
+		if( m_fd >= 0 ) { ::close( m_fd ); }
+		m_fd = -1;
+		m_size = 0;
+		m_tile_size = 0;
+	}
+
+	inline bool is_open() const { return m_fd >= 0; }
+	inline size_t size() const { return m_size; }
+	inline size_t tile_size() const { return m_tile_size; }
+	inline size_t tile_count() const { return m_tile_size==0 ? 0 : ( m_size + m_tile_size - 1 ) / m_tile_size; }
+
+	// loads elements [first,first+tile.size()) of the selected fields, after resizing tile to the size of the tile starting at first.
+	// padding elements up to tile.chunk_ceil(), which apply_simd also processes, are zeroed.
+	inline bool load_tile( TileT& tile, size_t first ) const
+	{
+		const size_t n = std::min( m_tile_size, m_size - first );
+		tile.resize( n );
+		char* dst[] = { nullptr, reinterpret_cast<char*>( tile[FieldId<ids>()] ) ... };
+		const size_t sizes[] = { 0, sizeof( typename FieldId<ids>::value_type ) ... };
+		for(size_t i=0;i<FieldCount;i++)
+		{
+			if( ! pread_all( m_fd, dst[i+1], n * sizes[i+1], m_offsets[i] + first * sizes[i+1] ) ) { return false; }
+			std::memset( dst[i+1] + n * sizes[i+1], 0, ( tile.chunk_ceil() - n ) * sizes[i+1] );
+		}
+		return true;
+	}
+
+	// calls func(tile,first) for each tile, in order, where tile holds elements [first,first+tile.size()) of the file.
+	// with double_buffered, the next tile is read while func runs. returns false on read error (func is not called on the failing tile).
+	template<typename FuncT>
+	inline bool for_each_tile( FuncT func, bool double_buffered = true ) const
+	{
+		const size_t ntiles = tile_count();
+		if( ntiles == 0 ) { return true; }
+		TileT tiles[2];
+		bool ok = load_tile( tiles[0], 0 );
+		for(size_t k=0;k<ntiles && ok;k++)
+		{
+			TileT& current = tiles[k%2];
+			TileT& next = tiles[(k+1)%2];
+			const size_t next_first = (k+1) * m_tile_size;
+			std::future<bool> pending;
+			if( double_buffered && (k+1) < ntiles )
+			{
+				pending = std::async( std::launch::async, [this,&next,next_first]() { return load_tile( next, next_first ); } );
+			}
+			func( current, k * m_tile_size );
+			if( (k+1) < ntiles ) { ok = double_buffered ? pending.get() : load_tile( next, next_first ); }
+		}
+		return ok;
+	}
+
+	inline ~FieldTileReader()
+	{
+		close();
+	}
+
+private:
+	int m_fd = -1;
+	size_t m_size = 0;
+	size_t m_tile_size = 0;
+	uint64_t m_offsets[FieldCount] = {}; // relative to the beginning of the file
+};
+
+template<typename... ids>
+inline
+FieldTileReader<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...>
+make_field_tile_reader(const FieldId<ids>& ...)
+{
+	return FieldTileReader<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...>();
+}
+
+template<size_t A, size_t C, typename... ids>
+inline
+FieldTileReader<A,C,ids...>
+make_field_tile_reader( cst::align<A>, cst::chunk<C>, const FieldId<ids>& ...)
+{
+	return FieldTileReader<A,C,ids...>();
+}
+
+} // namespace soatl
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib> // for size_t, getenv, std::atexit
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm> // for std::min
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "soatl/field_descriptor.h"
+
+/*
+Timeline of library calls, exported in Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+Each thread records complete events (label, begin, duration, element count, field names) into its own ring buffer
+of SOATL_TRACE_BUFFER_EVENTS events, without locks. When a buffer is full, its oldest events are overwritten.
+Drivers of parallel kernels record one event on the thread that starts the parallel region, and calls made
+inside a user parallel region are recorded on the calling thread. Only the outermost driver of a thread records.
+Buffers are written to the file named by the SOATL_TRACE_FILE environment variable (default soatl_trace.json) at exit,
+unless trace_registry().dump_at_exit is cleared. write_chrome_trace() expects recording threads to be idle.
+Normally used through the macros of instrument.h, enabled when SOATL_TRACE is defined.
+*/
+
+#ifndef SOATL_TRACE_BUFFER_EVENTS
+#define SOATL_TRACE_BUFFER_EVENTS (1<<16)
+#endif
+
+namespace soatl
+{
+
+struct TraceEvent
+{
+	const char* label;
+	const char* fields; // comma separated names, or nullptr
+	uint64_t begin_ns;
+	uint64_t end_ns;
+	uint64_t count;
+};
+
+struct TraceBuffer
+{
+	static constexpr size_t Capacity = SOATL_TRACE_BUFFER_EVENTS;
+
+	TraceEvent events[Capacity];
+	std::atomic<uint64_t> head {0}; // events ever recorded, written by the owner thread only
+	size_t index = 0;  // registration order
+	long os_tid = 0;
+
+	inline void push( const TraceEvent& e )
+	{
+		const uint64_t h = head.load( std::memory_order_relaxed );
+		events[ h % Capacity ] = e;
+		head.store( h + 1, std::memory_order_release );
+	}
+};
+
+struct TraceRegistry
+{
+	std::mutex mutex;
+	std::vector<TraceBuffer*> buffers; // never freed, threads may exit before the trace is written
+	const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+	bool dump_at_exit = true;
+
+	inline uint64_t now_ns() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - origin ).count();
+	}
+
+	inline TraceBuffer* add_buffer()
+	{
+		TraceBuffer* b = new TraceBuffer();
+		b->os_tid = syscall( SYS_gettid );
+		std::lock_guard<std::mutex> lock( mutex );
+		b->index = buffers.size();
+		buffers.push_back( b );
+		return b;
+	}
+
+	// forgets recorded events, buffers stay attached to their threads
+	inline void clear()
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		for(TraceBuffer* b : buffers) { b->head.store( 0, std::memory_order_release ); }
+	}
+
+	inline size_t event_count()
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		size_t n = 0;
+		for(TraceBuffer* b : buffers) { n += std::min( b->head.load( std::memory_order_acquire ), uint64_t(TraceBuffer::Capacity) ); }
+		return n;
+	}
+
+	static inline void write_json_string( std::ostream& out, const char* s )
+	{
+		out << '"';
+		for(; s!=nullptr && *s!='\0'; ++s)
+		{
+			if( *s=='"' || *s=='\\' ) { out << '\\' << *s; }
+			else if( static_cast<unsigned char>(*s) < 0x20 ) { out << ' '; }
+			else { out << *s; }
+		}
+		out << '"';
+	}
+
+	// complete ("X") events in microseconds, one track per recording thread
+	inline void write_chrome_trace( std::ostream& out )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		const long pid = getpid();
+		const auto f = out.flags();
+		const auto p = out.precision();
+		out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		bool first = true;
+		for(TraceBuffer* b : buffers)
+		{
+			out << ( first ? "\n" : ",\n" ) << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << b->os_tid
+			    << ",\"args\":{\"name\":\"soatl thread " << b->index << "\"}}";
+			first = false;
+			const uint64_t head = b->head.load( std::memory_order_acquire );
+			const uint64_t start = ( head > TraceBuffer::Capacity ) ? head - TraceBuffer::Capacity : 0;
+			for(uint64_t i=start;i<head;i++)
+			{
+				const TraceEvent& e = b->events[ i % TraceBuffer::Capacity ];
+				out << ",\n{\"name\":";
+				write_json_string( out, e.label );
+				out << ",\"cat\":\"soatl\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << b->os_tid
+				    << ",\"ts\":" << e.begin_ns * 1.e-3 << ",\"dur\":" << ( e.end_ns - e.begin_ns ) * 1.e-3
+				    << ",\"args\":{\"count\":" << e.count;
+				if( e.fields != nullptr ) { out << ",\"fields\":"; write_json_string( out, e.fields ); }
+				out << "}}";
+			}
+		}
+		out << "\n]}\n";
+		out.flags( f );
+		out.precision( p );
+	}
+
+	inline bool write_chrome_trace( const std::string& filename )
+	{
+		std::ofstream out( filename );
+		write_chrome_trace( out );
+		return out.good();
+	}
+};
+
+// never destroyed, so that calls made at exit are still recorded. the trace is written by an exit handler.
+inline TraceRegistry& trace_registry()
+{
+	static TraceRegistry* registry = []()
+	{
+		std::atexit( []()
+		{
+			if( ! trace_registry().dump_at_exit ) { return; }
+			const char* env = std::getenv( "SOATL_TRACE_FILE" );
+			const std::string filename = ( env != nullptr ) ? env : "soatl_trace.json";
+			if( trace_registry().write_chrome_trace( filename ) ) { std::cerr << "soatl trace written to " << filename << std::endl; }
+		} );
+		return new TraceRegistry();
+	}();
+	return *registry;
+}
+
+// buffer of the calling thread, fields named by the last field level driver, and nesting of traced drivers.
+// trivially destructible, it can be used until the process exits.
+struct TraceThreadState
+{
+	TraceBuffer* buffer = nullptr;
+	const char* fields = nullptr;
+	size_t fields_count = 0;
+	int depth = 0;
+
+	static inline TraceThreadState& local()
+	{
+		static thread_local TraceThreadState state;
+		return state;
+	}
+};
+
+template<typename... ids>
+inline const char* trace_field_names()
+{
+	static const std::string names = []()
+	{
+		std::string s;
+		for(const char* n : { FieldDescriptor<ids>::name() ... }) { s += ( s.empty() ? "" : "," ); s += n; }
+		return s;
+	}();
+	return names.c_str();
+}
+
+// names the fields of the next event of the calling thread, if it covers count elements
+template<typename... ids>
+inline void trace_fields( size_t count )
+{
+	TraceThreadState& state = TraceThreadState::local();
+	state.fields = trace_field_names<ids...>();
+	state.fields_count = count;
+}
+
+// records its lifetime, only the outermost scope of a thread records
+struct TraceScope
+{
+	inline TraceScope( const char* label, size_t count )
+	{
+		TraceThreadState& state = TraceThreadState::local();
+		m_active = ( state.depth++ == 0 );
+		if( ! m_active ) { return; }
+		m_event.label = label;
+		m_event.fields = ( state.fields_count == count ) ? state.fields : nullptr;
+		m_event.count = count;
+		state.fields = nullptr;
+		m_event.begin_ns = trace_registry().now_ns();
+	}
+
+	inline ~TraceScope()
+	{
+		TraceThreadState& state = TraceThreadState::local();
+		-- state.depth;
+		if( ! m_active ) { return; }
+		m_event.end_ns = trace_registry().now_ns();
+		if( state.buffer == nullptr ) { state.buffer = trace_registry().add_buffer(); }
+		state.buffer->push( m_event );
+	}
+
+	TraceScope( const TraceScope& ) = delete;
+	TraceScope& operator = ( const TraceScope& ) = delete;
+
+private:
+	TraceEvent m_event;
+	bool m_active;
+};
+
+} // namespace soatl
+
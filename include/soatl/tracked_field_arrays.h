@@ -0,0 +1,341 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <algorithm> // for std::min
+#include <istream>
+#include <ostream>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/variadic_template_utils.h"
+#include "soatl/dirty_hooks.h"
+#include "soatl/copy.h"
+#include "soatl/serialize.h"
+
+/*
+Field containers with per field dirty bitmaps, one bit per block of BlockSize elements.
+Bits are set by apply* drivers and copy for written fields (see dirty_hooks.h), by users with mark_dirty(),
+and for all fields when the container grows. incremental_copy() and write_incremental() transfer dirty blocks only,
+then clear their bits, so that a mirror (a halo copy, or a base checkpoint followed by increments) is kept up to date.
+There is a single set of bits per container, so only one mirror can be kept up to date incrementally.
+
+Incremental records (native byte order) :
+
+	char     magic[8]         "SOATLFI"
+	uint32_t version
+	uint32_t byte order mark  0x01020304
+	uint64_t element count
+	uint32_t field count
+	field count times :
+		uint32_t name length, followed by name characters
+		uint32_t element type (SerializedType)
+		uint32_t element size in bytes
+		uint64_t range count
+		range count times uint64_t first, uint64_t count (elements)
+		element data of the ranges, one after the other
+*/
+
+namespace soatl
+{
+
+static constexpr size_t DIRTY_BLOCK_SIZE = 4096; // elements
+static constexpr char INCREMENTAL_MAGIC[8] = { 'S','O','A','T','L','F','I','\0' };
+static constexpr uint32_t INCREMENTAL_VERSION = 1;
+
+template<typename BaseT, size_t _BlockSize = DIRTY_BLOCK_SIZE> struct TrackedFieldArrays;
+
+template< template<size_t,size_t,typename...> class ContainerT, size_t _Alignment, size_t _ChunkSize, typename... ids, size_t _BlockSize>
+struct TrackedFieldArrays< ContainerT<_Alignment,_ChunkSize,ids...> , _BlockSize > : public ContainerT<_Alignment,_ChunkSize,ids...>
+{
+	using BaseT = ContainerT<_Alignment,_ChunkSize,ids...>;
+	static constexpr size_t BlockSize = _BlockSize;
+	static constexpr size_t FieldCount = sizeof...(ids);
+	static_assert( BlockSize > 0 && ( BlockSize % _ChunkSize ) == 0 , "block size must be a multiple of chunk size" );
+
+	using BaseT::size;
+
+	// new elements are dirty
+	inline void resize( size_t s )
+	{
+		const size_t old_size = size();
+		BaseT::resize( s );
+		const size_t words = ( block_count() + 63 ) / 64;
+		for(size_t f=0;f<FieldCount;f++)
+		{
+			m_dirty[f].resize( words, 0 );
+			// bits of blocks past the end are kept cleared
+			if( words > 0 && ( block_count() % 64 ) != 0 ) { m_dirty[f][words-1] &= ( uint64_t(1) << ( block_count() % 64 ) ) - 1; }
+		}
+		if( s > old_size ) { mark_range( old_size, s - old_size ); }
+	}
+
+	inline size_t block_count() const { return ( size() + BlockSize - 1 ) / BlockSize; }
+
+	template<typename _id>
+	inline void mark_dirty( FieldId<_id>, size_t first, size_t count )
+	{
+		mark_field( find_index_of_id<_id,ids...>::index, first, count );
+	}
+
+	template<typename _id>
+	inline void mark_dirty( FieldId<_id> fid ) { mark_dirty( fid, 0, size() ); }
+
+	inline void mark_all_dirty() { mark_range( 0, size() ); }
+
+	template<typename _id>
+	inline void clear_dirty( FieldId<_id> )
+	{
+		auto& bits = m_dirty[ find_index_of_id<_id,ids...>::index ];
+		std::fill( bits.begin(), bits.end(), 0 );
+	}
+
+	inline void clear_dirty()
+	{
+		for(auto& bits : m_dirty) { std::fill( bits.begin(), bits.end(), 0 ); }
+	}
+
+	template<typename _id>
+	inline bool is_dirty( FieldId<_id>, size_t block ) const
+	{
+		const auto& bits = m_dirty[ find_index_of_id<_id,ids...>::index ];
+		return ( bits[block/64] >> (block%64) ) & 1;
+	}
+
+	template<typename _id>
+	inline size_t dirty_block_count( FieldId<_id> ) const
+	{
+		size_t n = 0;
+		for(uint64_t w : m_dirty[ find_index_of_id<_id,ids...>::index ]) { n += __builtin_popcountll( w ); }
+		return n;
+	}
+
+	// calls func(first,count) for each run of consecutive dirty blocks of a field, in elements, clipped to size()
+	template<typename _id, typename FuncT>
+	inline void for_each_dirty_range( FieldId<_id>, FuncT func ) const
+	{
+		const auto& bits = m_dirty[ find_index_of_id<_id,ids...>::index ];
+		const size_t nblocks = block_count();
+		size_t b = 0;
+		while( b < nblocks )
+		{
+			const uint64_t w = bits[b/64] >> (b%64);
+			if( w == 0 ) { b = ( b/64 + 1 ) * 64; continue; }
+			b += __builtin_ctzll( w );
+			size_t e = b;
+			while( e < nblocks && ( ( bits[e/64] >> (e%64) ) & 1 ) ) { ++ e; }
+			const size_t first = b * BlockSize;
+			func( first, std::min( e * BlockSize, size() ) - first );
+			b = e;
+		}
+	}
+
+private:
+	inline void mark_field( size_t f, size_t first, size_t count )
+	{
+		if( count == 0 ) { return; }
+		const size_t b1 = first / BlockSize;
+		const size_t b2 = std::min( ( first + count - 1 ) / BlockSize + 1 , block_count() );
+		auto& bits = m_dirty[f];
+		for(size_t b=b1;b<b2;)
+		{
+			if( ( b % 64 ) == 0 && b + 64 <= b2 ) { bits[b/64] = ~uint64_t(0); b += 64; }
+			else { bits[b/64] |= uint64_t(1) << (b%64); ++ b; }
+		}
+	}
+
+	inline void mark_range( size_t first, size_t count )
+	{
+		for(size_t f=0;f<FieldCount;f++) { mark_field( f, first, count ); }
+	}
+
+	std::vector<uint64_t> m_dirty[FieldCount];
+};
+
+template<typename... ids>
+inline TrackedFieldArrays< FieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...> > make_tracked_field_arrays(const FieldId<ids>& ...)
+{
+	return TrackedFieldArrays< FieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...> >();
+}
+
+template<size_t A, size_t C, typename... ids>
+inline TrackedFieldArrays< FieldArrays<A,C,ids...> > make_tracked_field_arrays(cst::align<A>, cst::chunk<C>, const FieldId<ids>& ...)
+{
+	return TrackedFieldArrays< FieldArrays<A,C,ids...> >();
+}
+
+template<typename... ids>
+inline TrackedFieldArrays< PackedFieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...> > make_tracked_packed_field_arrays(const FieldId<ids>& ...)
+{
+	return TrackedFieldArrays< PackedFieldArrays<DEFAULT_ALIGNMENT,DEFAULT_CHUNK_SIZE,ids...> >();
+}
+
+template<size_t A, size_t C, typename... ids>
+inline TrackedFieldArrays< PackedFieldArrays<A,C,ids...> > make_tracked_packed_field_arrays(cst::align<A>, cst::chunk<C>, const FieldId<ids>& ...)
+{
+	return TrackedFieldArrays< PackedFieldArrays<A,C,ids...> >();
+}
+
+// ***** incremental copy *****
+
+template<typename DstArrays, typename TrackedArraysT, typename id>
+static inline size_t incremental_copy_field( DstArrays& dst, TrackedArraysT& src, FieldId<id> fid )
+{
+	size_t bytes = 0;
+	src.for_each_dirty_range( fid, [&](size_t first, size_t count)
+		{
+			copy( dst, src, first, count, fid );
+			bytes += count * sizeof( typename FieldId<id>::value_type );
+		} );
+	src.clear_dirty( fid );
+	return bytes;
+}
+
+// copies dirty blocks of the given fields (all fields of src by default) to dst, resized to src's size, and clears their dirty bits.
+// dst must hold a copy of src as of the previous incremental copy. returns the number of bytes copied.
+template<typename DstArrays, typename TrackedArraysT, typename... _ids>
+static inline size_t incremental_copy( DstArrays& dst, TrackedArraysT& src, const FieldId<_ids>& ... fids )
+{
+	if( dst.size() != src.size() ) { dst.resize( src.size() ); }
+	const size_t bytes[] = { 0, incremental_copy_field( dst, src, fids ) ... };
+	size_t total = 0;
+	for(size_t b : bytes) { total += b; }
+	return total;
+}
+
+template<typename DstArrays, typename TrackedArraysT, typename... _ids>
+static inline size_t incremental_copy( DstArrays& dst, TrackedArraysT& src, const std::tuple< FieldId<_ids> ... > & )
+{
+	return incremental_copy( dst, src, FieldId<_ids>() ... );
+}
+
+template<typename DstArrays, typename TrackedArraysT>
+static inline size_t incremental_copy( DstArrays& dst, TrackedArraysT& src )
+{
+	return incremental_copy( dst, src, typename TrackedArraysT::FieldIdsTuple () );
+}
+
+// ***** incremental write / read *****
+
+template<typename TrackedArraysT, typename id>
+static inline void write_incremental_field( std::ostream& out, TrackedArraysT& arrays, FieldId<id> fid )
+{
+	using ValueType = typename FieldId<id>::value_type;
+	const SerializedField f = SerializedField::make( fid );
+	serialize_pod( out, static_cast<uint32_t>( f.name.size() ) );
+	out.write( f.name.data(), f.name.size() );
+	serialize_pod( out, f.type );
+	serialize_pod( out, f.element_size );
+
+	std::vector<uint64_t> ranges;
+	arrays.for_each_dirty_range( fid, [&ranges](size_t first, size_t count) { ranges.push_back( first ); ranges.push_back( count ); } );
+	serialize_pod( out, static_cast<uint64_t>( ranges.size() / 2 ) );
+	out.write( reinterpret_cast<const char*>( ranges.data() ), ranges.size() * sizeof(uint64_t) );
+	for(size_t r=0;r<ranges.size();r+=2)
+	{
+		out.write( reinterpret_cast<const char*>( arrays[fid] + ranges[r] ), ranges[r+1] * sizeof(ValueType) );
+	}
+	arrays.clear_dirty( fid );
+}
+
+// writes dirty blocks of the given fields (all fields of arrays by default), and clears their dirty bits
+template<typename TrackedArraysT, typename... ids>
+static inline bool write_incremental( std::ostream& out, TrackedArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	out.write( INCREMENTAL_MAGIC, sizeof(INCREMENTAL_MAGIC) );
+	serialize_pod( out, INCREMENTAL_VERSION );
+	serialize_pod( out, SERIALIZE_BYTE_ORDER_MARK );
+	serialize_pod( out, static_cast<uint64_t>( arrays.size() ) );
+	serialize_pod( out, static_cast<uint32_t>( sizeof...(ids) ) );
+	TEMPLATE_LIST_BEGIN
+		write_incremental_field( out, arrays, fids )
+	TEMPLATE_LIST_END
+	return bool( out );
+}
+
+template<typename TrackedArraysT, typename... ids>
+static inline bool write_incremental( std::ostream& out, TrackedArraysT& arrays, const std::tuple< FieldId<ids> ... > & )
+{
+	return write_incremental( out, arrays, FieldId<ids>() ... );
+}
+
+template<typename TrackedArraysT>
+static inline bool write_incremental( std::ostream& out, TrackedArraysT& arrays )
+{
+	return write_incremental( out, arrays, typename TrackedArraysT::FieldIdsTuple () );
+}
+
+template<typename FieldArraysT, typename id>
+static inline bool read_incremental_field( std::istream& in, const SerializedField& f, const std::vector<uint64_t>& ranges, FieldArraysT& arrays, FieldId<id> fid, bool& found )
+{
+	using ValueType = typename FieldId<id>::value_type;
+	static_assert( ! IsBitPlanes<id>::value , "bit fields are not serialized" );
+	if( found || f.name != FieldId<id>::name() ) { return true; }
+	found = true;
+	if( f.type != SerializedTypeCode<ValueType>::value || f.element_size != sizeof(ValueType) ) { return false; }
+	for(size_t r=0;r<ranges.size();r+=2)
+	{
+		if( ranges[r] + ranges[r+1] > arrays.size() ) { return false; }
+		if( ! in.read( reinterpret_cast<char*>( arrays[fid] + ranges[r] ), ranges[r+1] * sizeof(ValueType) ) ) { return false; }
+		mark_written( arrays, ranges[r], ranges[r+1], fid );
+	}
+	return true;
+}
+
+// applies an incremental record to arrays, which must hold the state the record was computed from (resized to the stored count).
+// records of fields not requested (all fields of arrays by default) are skipped. returns false on a malformed record or a type mismatch.
+template<typename FieldArraysT, typename... ids>
+static inline bool read_incremental( std::istream& in, FieldArraysT& arrays, const FieldId<ids>& ... fids )
+{
+	char magic[sizeof(INCREMENTAL_MAGIC)];
+	uint32_t version = 0, bom = 0, nfields = 0;
+	uint64_t count = 0;
+	if( ! in.read( magic, sizeof(magic) ) || std::memcmp( magic, INCREMENTAL_MAGIC, sizeof(magic) ) != 0 ) { return false; }
+	if( ! deserialize_pod(in,version) || version != INCREMENTAL_VERSION ) { return false; }
+	if( ! deserialize_pod(in,bom) || bom != SERIALIZE_BYTE_ORDER_MARK ) { return false; }
+	if( ! deserialize_pod(in,count) || ! deserialize_pod(in,nfields) ) { return false; }
+	if( arrays.size() != count ) { arrays.resize( count ); }
+
+	for(uint32_t i=0;i<nfields;i++)
+	{
+		SerializedField f;
+		uint32_t len = 0;
+		uint64_t nranges = 0;
+		if( ! deserialize_pod(in,len) ) { return false; }
+		f.name.resize( len );
+		if( ! in.read( &f.name[0], len ) ) { return false; }
+		if( ! deserialize_pod(in,f.type) || ! deserialize_pod(in,f.element_size) || ! deserialize_pod(in,nranges) ) { return false; }
+		std::vector<uint64_t> ranges( 2 * nranges );
+		if( ! in.read( reinterpret_cast<char*>( ranges.data() ), ranges.size() * sizeof(uint64_t) ) ) { return false; }
+
+		bool found = false;
+		const bool ok[] = { true, read_incremental_field( in, f, ranges, arrays, fids, found ) ... };
+		for(bool b : ok) { if( ! b ) return false; }
+		if( ! found )
+		{
+			uint64_t bytes = 0;
+			for(size_t r=0;r<ranges.size();r+=2) { bytes += ranges[r+1] * f.element_size; }
+			in.seekg( bytes, std::ios::cur );
+		}
+	}
+	return bool( in );
+}
+
+template<typename FieldArraysT, typename... ids>
+static inline bool read_incremental( std::istream& in, FieldArraysT& arrays, const std::tuple< FieldId<ids> ... > & )
+{
+	return read_incremental( in, arrays, FieldId<ids>() ... );
+}
+
+template<typename FieldArraysT>
+static inline bool read_incremental( std::istream& in, FieldArraysT& arrays )
+{
+	return read_incremental( in, arrays, typename FieldArraysT::FieldIdsTuple () );
+}
+
+} // namespace soatl
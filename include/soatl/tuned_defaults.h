@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+
+#include "soatl/field_descriptor.h"
+#include "soatl/simd.h"
+
+/*
+Alignment and chunk size of containers built without cst::align and cst::chunk, i.e. make_field_arrays(fields...) and make_packed_field_arrays(fields...).
+TunedDefaults<T> holds the preferred values for fields of value type T, a container takes the largest alignment and chunk size over its fields.
+Untuned value types use DEFAULT_ALIGNMENT and DEFAULT_CHUNK_SIZE.
+The autotune target (tests/autotune.cpp) measures the best values on the build machine and writes soatl_tuned_defaults.h,
+which is included here when SOATL_TUNED_DEFAULTS is defined (cmake -DSOATL_TUNED_DEFAULTS=ON).
+*/
+
+namespace soatl
+{
+
+template<typename T>
+struct TunedDefaults
+{
+	static constexpr size_t alignment = DEFAULT_ALIGNMENT;
+	static constexpr size_t chunksize = DEFAULT_CHUNK_SIZE;
+};
+
+template<size_t... values> struct StaticMax;
+template<size_t a> struct StaticMax<a> { static constexpr size_t value = a; };
+template<size_t a, size_t... b> struct StaticMax<a,b...> { static constexpr size_t value = ( a > StaticMax<b...>::value ) ? a : StaticMax<b...>::value; };
+
+template<typename... ids>
+struct DefaultLayout
+{
+	static constexpr size_t alignment = StaticMax< TunedDefaults< typename FieldDescriptor<ids>::value_type >::alignment ... >::value;
+	static constexpr size_t chunksize = StaticMax< TunedDefaults< typename FieldDescriptor<ids>::value_type >::chunksize ... >::value;
+};
+
+} // namespace soatl
+
+// to be used at global scope
+#define SOATL_SET_TUNED_DEFAULTS(_T,_a,_c) \
+	namespace soatl { template<> struct TunedDefaults<_T> { \
+	static constexpr size_t alignment=_a; \
+	static constexpr size_t chunksize=_c; }; }
+
+#ifdef SOATL_TUNED_DEFAULTS
+#include "soatl_tuned_defaults.h"
+#endif
+
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdlib> // for size_t
+#include <initializer_list>
 
 namespace soatl {
 
@@ -8,6 +10,27 @@ struct __pass
     template<typename ...T> __pass(T...) {}
 };
 
+namespace detail {
+
+// void_t, for detection of member functions
+template<typename...> struct make_void { using type = void; };
+
+// folds over pack expansions, e.g. any_of( { false, pred<T>::value ... } )
+static constexpr bool any_of( std::initializer_list<bool> l )
+{
+    for(bool b : l) { if( b ) return true; }
+    return false;
+}
+
+static constexpr size_t sum_of( std::initializer_list<size_t> l )
+{
+    size_t s = 0;
+    for(size_t x : l) { s += x; }
+    return s;
+}
+
+}
+
 }
 
 #define TEMPLATE_LIST_BEGIN 	soatl::__pass{(
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <cstdlib> // for size_t
+#include <tuple>
+#include <utility> // for std::index_sequence
+#include <type_traits>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/compute.h"
+#include "soatl/variadic_template_utils.h"
+
+/*
+Vector fields : a field whose descriptor declares components = N (see VectorFieldId in field_descriptor.h) is stored
+as N scalar component fields, each in its own aligned stripe, e.g. make_field_arrays( particle_r, particle_e ) is a
+FieldArrays< A, C, VectorComponent<particle_r_id,0>, VectorComponent<particle_r_id,1>, VectorComponent<particle_r_id,2>, particle_e_id >.
+apply, parallel_apply, apply_simd and parallel_apply_simd accept vector field ids : kernels receive a VecRef<T,N>,
+a proxy holding a reference to each component, in place of the N scalar references :
+	soatl::apply_simd( [](soatl::VecRef<double,3> r, soatl::VecRef<double,3> v) { r += dt * v; }, cell, particle_r, particle_v );
+The drivers are called with the component fields and a kernel that groups its arguments back,
+so that the loops are the ones generated for the same kernel written with scalar fields.
+Other functions (copy, access annotations, ...) take the component fields, component<k>( particle_r ).
+*/
+
+namespace soatl
+{
+
+// small vector value
+template<typename T, size_t N>
+struct Vec
+{
+	using value_type = T;
+	static constexpr size_t size = N;
+	T c[N];
+
+	inline T& operator [] ( size_t k ) { return c[k]; }
+	inline const T& operator [] ( size_t k ) const { return c[k]; }
+};
+
+// references to the components of an element of a vector field.
+// assignments write through the references.
+template<typename T, size_t N>
+struct VecRef
+{
+	using value_type = typename std::remove_const<T>::type;
+	static constexpr size_t size = N;
+	T* c[N];
+
+	inline VecRef() = default;
+	inline VecRef( T* const (&p)[N] ) { for(size_t k=0;k<N;k++) { c[k] = p[k]; } }
+	inline VecRef( const VecRef& ) = default;
+
+	inline T& operator [] ( size_t k ) const { return *c[k]; }
+	inline T& x() const { return *c[0]; }
+	inline T& y() const { return *c[1]; }
+	inline T& z() const { static_assert( N >= 3 , "no z component" ); return *c[2]; }
+
+	inline operator Vec<value_type,N> () const
+	{
+		Vec<value_type,N> v;
+		for(size_t k=0;k<N;k++) { v[k] = *c[k]; }
+		return v;
+	}
+
+	inline const VecRef& operator = ( const VecRef& v ) const { for(size_t k=0;k<N;k++) { *c[k] = *v.c[k]; } return *this; }
+	inline const VecRef& operator = ( const Vec<value_type,N>& v ) const { for(size_t k=0;k<N;k++) { *c[k] = v[k]; } return *this; }
+	inline const VecRef& operator += ( const Vec<value_type,N>& v ) const { for(size_t k=0;k<N;k++) { *c[k] += v[k]; } return *this; }
+	inline const VecRef& operator -= ( const Vec<value_type,N>& v ) const { for(size_t k=0;k<N;k++) { *c[k] -= v[k]; } return *this; }
+	inline const VecRef& operator *= ( value_type s ) const { for(size_t k=0;k<N;k++) { *c[k] *= s; } return *this; }
+};
+
+template<typename T> using Vec3 = Vec<T,3>;
+template<typename T> using Vec3Ref = VecRef<T,3>;
+
+template<typename A> struct IsVec : public std::false_type {};
+template<typename T, size_t N> struct IsVec< Vec<T,N> > : public std::true_type {};
+template<typename T, size_t N> struct IsVec< VecRef<T,N> > : public std::true_type {};
+
+template<typename A, typename B>
+using VecResult = typename std::enable_if< IsVec<A>::value && IsVec<B>::value && A::size==B::size ,
+                                           Vec< decltype( std::declval<typename A::value_type>() + std::declval<typename B::value_type>() ) , A::size > >::type;
+template<typename A, typename S>
+using VecScaled = typename std::enable_if< IsVec<A>::value && std::is_arithmetic<S>::value ,
+                                           Vec< decltype( std::declval<typename A::value_type>() * std::declval<S>() ) , A::size > >::type;
+
+template<typename A, typename B> static inline VecResult<A,B> operator + ( const A& a, const B& b ) { VecResult<A,B> r; for(size_t k=0;k<A::size;k++) { r[k] = a[k] + b[k]; } return r; }
+template<typename A, typename B> static inline VecResult<A,B> operator - ( const A& a, const B& b ) { VecResult<A,B> r; for(size_t k=0;k<A::size;k++) { r[k] = a[k] - b[k]; } return r; }
+template<typename A, typename S> static inline VecScaled<A,S> operator * ( const A& a, S s ) { VecScaled<A,S> r; for(size_t k=0;k<A::size;k++) { r[k] = a[k] * s; } return r; }
+template<typename A, typename S> static inline VecScaled<A,S> operator * ( S s, const A& a ) { return a * s; }
+
+template<typename A, typename B>
+static inline typename VecResult<A,B>::value_type dot( const A& a, const B& b )
+{
+	typename VecResult<A,B>::value_type r = a[0] * b[0];
+	for(size_t k=1;k<A::size;k++) { r += a[k] * b[k]; }
+	return r;
+}
+template<typename A> static inline typename VecResult<A,A>::value_type norm2( const A& a ) { return dot( a, a ); }
+
+// pointers to the component stripes of a vector field, for element access outside of kernels
+template<typename T, size_t N>
+struct VecPointer
+{
+	T* c[N];
+	inline VecRef<T,N> operator [] ( size_t i ) const
+	{
+		VecRef<T,N> r;
+		for(size_t k=0;k<N;k++) { r.c[k] = c[k] + i; }
+		return r;
+	}
+};
+
+
+// expansion of field lists and kernel arguments
+
+template<typename... ids> struct FieldList {};
+
+template<typename... L> struct ConcatFieldLists;
+template<> struct ConcatFieldLists<> { using type = FieldList<>; };
+template<typename... a> struct ConcatFieldLists< FieldList<a...> > { using type = FieldList<a...>; };
+template<typename... a, typename... b, typename... L>
+struct ConcatFieldLists< FieldList<a...>, FieldList<b...>, L... > { using type = typename ConcatFieldLists< FieldList<a...,b...>, L... >::type; };
+
+template<typename F> struct IsFieldArg : public std::false_type {};
+template<typename id> struct IsFieldArg< FieldId<id> > : public std::true_type {};
+template<typename id> struct IsFieldArg< VectorFieldId<id> > : public std::true_type {};
+template<typename id> struct IsFieldArg< BitFieldId<id> > : public std::true_type {};
+template<typename F> struct IsVectorFieldArg : public std::false_type {};
+template<typename id> struct IsVectorFieldArg< VectorFieldId<id> > : public std::true_type {};
+template<typename F> struct IsBitFieldArg : public std::false_type {};
+template<typename id> struct IsBitFieldArg< BitFieldId<id> > : public std::true_type {};
+
+// field ids only, at least one of them a vector field, none a bit field (see bit_field.h)
+template<typename... F>
+struct HasVectorFields
+{
+	static constexpr bool value = ! detail::any_of( { false, ! IsFieldArg<F>::value || IsBitFieldArg<F>::value ... } ) && detail::any_of( { false, IsVectorFieldArg<F>::value ... } );
+};
+
+// field ids only, at least one of them stored under other ids (containers)
+template<typename... F>
+struct HasExpandedFields
+{
+	static constexpr bool value = ! detail::any_of( { false, ! IsFieldArg<F>::value ... } ) && detail::any_of( { false, IsVectorFieldArg<F>::value || IsBitFieldArg<F>::value ... } );
+};
+
+// stored fields of a field id, and the kernel argument built from as many scalar references
+template<typename F> struct VectorFieldArg;
+
+template<typename id>
+struct VectorFieldArg< FieldId<id> >
+{
+	using Fields = FieldList<id>;
+	static constexpr size_t width = 1;
+	template<size_t O, typename TupleT> static inline decltype(auto) get( const TupleT& t ) { return std::get<O>( t ); }
+};
+
+template<typename id>
+struct VectorFieldArg< BitFieldId<id> >
+{
+	using Fields = FieldList< BitPlanes<id> >;
+	static constexpr size_t width = 1;
+};
+
+template<typename id>
+struct VectorFieldArg< VectorFieldId<id> >
+{
+	static constexpr size_t width = VectorFieldId<id>::components;
+
+	template<typename S> struct ComponentList;
+	template<size_t... K> struct ComponentList< std::index_sequence<K...> > { using type = FieldList< VectorComponent<id,K> ... >; };
+	using Fields = typename ComponentList< std::make_index_sequence<width> >::type;
+
+	template<size_t O, typename TupleT, size_t... K>
+	static inline auto make( const TupleT& t, std::index_sequence<K...> )
+	{
+		using T = typename std::remove_reference< typename std::tuple_element<O,TupleT>::type >::type;
+		return VecRef<T,width> { { & std::get<O+K>( t ) ... } };
+	}
+	template<size_t O, typename TupleT> static inline auto get( const TupleT& t ) { return make<O>( t, std::make_index_sequence<width>() ); }
+};
+
+template<typename... F>
+struct VectorFieldArgs
+{
+	using Fields = typename ConcatFieldLists< typename VectorFieldArg<F>::Fields ... >::type;
+
+	// position of the first scalar reference of argument i
+	static constexpr size_t offset( size_t i )
+	{
+		const size_t w[] = { VectorFieldArg<F>::width ... };
+		size_t o = 0;
+		for(size_t k=0;k<i;k++) { o += w[k]; }
+		return o;
+	}
+};
+
+// called with the scalar references of all stored fields, calls f with one argument per field id
+template<typename OperatorT, typename... F>
+struct VectorFieldKernel
+{
+	OperatorT f;
+
+	template<typename TupleT, size_t... I>
+	inline void call( const TupleT& t, std::index_sequence<I...> )
+	{
+		f( VectorFieldArg<F>::template get< VectorFieldArgs<F...>::offset(I) >( t ) ... );
+	}
+
+	template<typename... R>
+	inline void operator () ( R& ... refs )
+	{
+		call( std::forward_as_tuple( refs ... ), std::index_sequence_for<F...>() );
+	}
+};
+
+template<typename DriverT, typename... ids>
+static inline void call_with_fields( FieldList<ids...>, DriverT driver )
+{
+	driver( FieldId<ids>() ... );
+}
+
+
+// containers, vector fields are stored as their components, bit fields as their bit planes
+
+template<bool, template<size_t,size_t,typename...> class ContainerT, typename ListT> struct VectorFieldContainer {};
+template<template<size_t,size_t,typename...> class ContainerT, typename... ids>
+struct VectorFieldContainer< true, ContainerT, FieldList<ids...> >
+{
+	using type = ContainerT< DefaultLayout<ids...>::alignment, DefaultLayout<ids...>::chunksize, ids... >;
+	template<size_t A, size_t C> using layout = ContainerT<A,C,ids...>;
+};
+
+template<bool, typename... F> struct VectorFieldList {};
+template<typename... F> struct VectorFieldList<true,F...> { using type = typename VectorFieldArgs<F...>::Fields; };
+
+template<template<size_t,size_t,typename...> class ContainerT, typename... F>
+using VectorFieldContainerT = typename VectorFieldContainer< HasExpandedFields<F...>::value, ContainerT, typename VectorFieldList< HasExpandedFields<F...>::value, F... >::type >::type;
+template<template<size_t,size_t,typename...> class ContainerT, size_t A, size_t C, typename... F>
+using VectorFieldContainerLayoutT = typename VectorFieldContainer< HasExpandedFields<F...>::value, ContainerT, typename VectorFieldList< HasExpandedFields<F...>::value, F... >::type >::template layout<A,C>;
+
+template<typename... F>
+inline VectorFieldContainerT<FieldArrays,F...> make_field_arrays( const F& ... ) { return VectorFieldContainerT<FieldArrays,F...>(); }
+
+template<size_t A, size_t C, typename... F>
+inline VectorFieldContainerLayoutT<FieldArrays,A,C,F...> make_field_arrays( cst::align<A>, cst::chunk<C>, const F& ... ) { return VectorFieldContainerLayoutT<FieldArrays,A,C,F...>(); }
+
+template<typename... F>
+inline VectorFieldContainerT<PackedFieldArrays,F...> make_packed_field_arrays( const F& ... ) { return VectorFieldContainerT<PackedFieldArrays,F...>(); }
+
+template<size_t A, size_t C, typename... F>
+inline VectorFieldContainerLayoutT<PackedFieldArrays,A,C,F...> make_packed_field_arrays( cst::align<A>, cst::chunk<C>, const F& ... ) { return VectorFieldContainerLayoutT<PackedFieldArrays,A,C,F...>(); }
+
+template<typename FieldArraysT, typename id, size_t... K>
+static inline VecPointer< typename VectorFieldId<id>::value_type , sizeof...(K) > vector_field( FieldArraysT& arrays, const VectorFieldId<id>&, std::index_sequence<K...> )
+{
+	return { { arrays[ FieldId< VectorComponent<id,K> >() ] ... } };
+}
+
+// component stripes of a vector field, vector_field(arrays,particle_r)[i].x()
+template<typename FieldArraysT, typename id>
+static inline VecPointer< typename VectorFieldId<id>::value_type , VectorFieldId<id>::components > vector_field( FieldArraysT& arrays, const VectorFieldId<id>& fid )
+{
+	return vector_field( arrays, fid, std::make_index_sequence< VectorFieldId<id>::components >() );
+}
+
+
+// drivers : the same driver is called with the component fields
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type apply( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { apply( kernel, first, N, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type apply( OperatorT f, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { apply( kernel, N, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type apply( OperatorT f, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { apply( kernel, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type parallel_apply( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { parallel_apply( kernel, first, N, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type parallel_apply( OperatorT f, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { parallel_apply( kernel, N, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type parallel_apply( OperatorT f, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { parallel_apply( kernel, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type apply_simd( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { apply_simd( kernel, first, N, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type apply_simd( OperatorT f, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { apply_simd( kernel, N, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type apply_simd( OperatorT f, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { apply_simd( kernel, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type parallel_apply_simd( OperatorT f, size_t first, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { parallel_apply_simd( kernel, first, N, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type parallel_apply_simd( OperatorT f, size_t N, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { parallel_apply_simd( kernel, N, arrays, fids ... ); } );
+}
+
+template<typename OperatorT, typename FieldArraysT, typename... F>
+static inline typename std::enable_if< HasVectorFields<F...>::value >::type parallel_apply_simd( OperatorT f, FieldArraysT& arrays, const F& ... )
+{
+	VectorFieldKernel<OperatorT,F...> kernel { f };
+	call_with_fields( typename VectorFieldArgs<F...>::Fields(), [&](auto... fids) { parallel_apply_simd( kernel, arrays, fids ... ); } );
+}
+
+} // namespace soatl
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Compares two result files of soatlbenchsuite (JSON or CSV) and flags regressions.
+
+usage: compare_benchmarks.py baseline current [--metric median_ns] [--threshold 0.05] [--all]
+
+Entries are matched on (benchmark, container, precision, size_class, threads). An entry
+regresses when its metric grows by more than the threshold (relative) compared to the
+baseline. The exit status is 1 if any entry regressed, so that the script can gate a CI job.
+"""
+
+import argparse
+import csv
+import json
+import sys
+
+KEY = ("benchmark", "container", "precision", "size_class", "threads")
+
+
+def load(filename):
+    with open(filename) as f:
+        if filename.endswith(".csv"):
+            rows = list(csv.DictReader(f))
+        else:
+            rows = json.load(f)["benchmarks"]
+    results = {}
+    for row in rows:
+        results[tuple(str(row[k]) for k in KEY)] = row
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--metric", default="median_ns", help="time column to compare (default: median_ns)")
+    parser.add_argument("--threshold", type=float, default=0.05, help="relative slowdown flagged as a regression (default: 0.05)")
+    parser.add_argument("--all", action="store_true", help="print unchanged entries too")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = 0
+    improvements = 0
+    header = "%-22s %-5s %-7s %-5s %4s %14s %14s %9s  %s" % ("benchmark", "cont.", "prec.", "size", "thr", "baseline", "current", "change", "")
+    print(header)
+    for key in sorted(set(baseline) & set(current)):
+        before = float(baseline[key][args.metric])
+        after = float(current[key][args.metric])
+        change = (after - before) / before if before > 0.0 else 0.0
+        status = ""
+        if change > args.threshold:
+            status = "REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            status = "improved"
+            improvements += 1
+        if status or args.all:
+            print("%-22s %-5s %-7s %-5s %4s %14.1f %14.1f %+8.1f%%  %s" % (key + (before, after, change * 100.0, status)))
+
+    for key in sorted(set(baseline) - set(current)):
+        print("missing in %s: %s" % (args.current, " ".join(key)))
+    for key in sorted(set(current) - set(baseline)):
+        print("new in %s: %s" % (args.current, " ".join(key)))
+
+    print("%d compared, %d regressions, %d improvements (threshold %.1f%% on %s)"
+          % (len(set(baseline) & set(current)), regressions, improvements, args.threshold * 100.0, args.metric))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
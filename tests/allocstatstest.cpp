@@ -0,0 +1,94 @@
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <algorithm>
+
+#define SOATL_ALLOC_STATS 1
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/copy.h"
+#include "soatl/alloc_stats.h"
+
+#include "declare_fields.h"
+
+int main(int argc, char* argv[])
+{
+	size_t N = 10000;
+	if(argc>=2) { N = atoi(argv[1]); }
+
+	// mixed size fields, each stripe padded to 64 bytes
+	auto packed = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_atype, particle_rx, particle_mid, particle_ry );
+	auto fields = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_atype, particle_rx, particle_mid, particle_ry );
+	using PackedT = decltype(packed);
+	using FieldsT = decltype(fields);
+	const size_t element_bytes = sizeof(unsigned char) + sizeof(double) + sizeof(int32_t) + sizeof(double);
+
+	bool ok = true;
+
+	packed.resize( N );
+	const size_t cap1 = packed.capacity();
+	soatl::AllocStats p = soatl::alloc_stats<PackedT>();
+	ok = ok && p.allocations == 1 && p.frees == 0 && p.live_bytes == PackedT::allocation_size(cap1) && p.live_padding == PackedT::padding_size(cap1);
+	ok = ok && p.live_padding == PackedT::allocation_size(cap1) - cap1 * element_bytes && p.reallocation_copies == 0;
+	ok = ok && p.live_slack == PackedT::slack_size(cap1,N) && p.live_slack == ( cap1 - N ) * element_bytes;
+
+	// growing moves the N elements to the new storage
+	packed.resize( 2*N );
+	const size_t cap2 = packed.capacity();
+	p = soatl::alloc_stats<PackedT>();
+	ok = ok && p.allocations == 2 && p.frees == 1 && p.live_bytes == PackedT::allocation_size(cap2);
+	ok = ok && p.peak_bytes == PackedT::allocation_size(cap1) + PackedT::allocation_size(cap2);
+	ok = ok && p.reallocation_copies == 1 && p.reallocation_copy_bytes == N * element_bytes && p.copies == 1 && p.copy_bytes == N * element_bytes;
+
+	// one allocation per field, no padding between fields
+	fields.resize( N );
+	const size_t fcap = fields.capacity();
+	soatl::AllocStats f = soatl::alloc_stats<FieldsT>();
+	ok = ok && f.allocations == 4 && f.live_bytes == fcap * element_bytes && f.live_padding == 0;
+
+	soatl::copy( fields, packed );
+	f = soatl::alloc_stats<FieldsT>();
+	ok = ok && f.copies == 1 && f.copy_bytes == N * element_bytes;
+
+	fields.resize( 0 );
+	f = soatl::alloc_stats<FieldsT>();
+	ok = ok && f.frees == 4 && f.live_bytes == 0 && f.peak_bytes == fcap * element_bytes;
+
+	// chunk slack, elements between size and capacity in every stripe, follows resizes that keep the capacity
+	packed.resize( 2*N - 5 );
+	p = soatl::alloc_stats<PackedT>();
+	ok = ok && packed.capacity() == cap2 && p.live_slack == PackedT::slack_size(cap2,2*N-5) && p.live_slack == ( cap2 - (2*N-5) ) * element_bytes;
+	ok = ok && p.live_padding == PackedT::padding_size(cap2);
+	fields.resize( 5 );
+	f = soatl::alloc_stats<FieldsT>();
+	ok = ok && f.live_slack == ( fields.capacity() - 5 ) * element_bytes && f.live_padding == 0;
+	fields.resize( 0 );
+	f = soatl::alloc_stats<FieldsT>();
+	ok = ok && f.live_slack == 0 && f.peak_slack == std::max( fcap - N , fields.chunksize() - 5 ) * element_bytes;
+
+	// global counters sum all container types
+	soatl::AllocStats g = soatl::alloc_stats();
+	p = soatl::alloc_stats<PackedT>();
+	ok = ok && g.allocations == p.allocations + f.allocations && g.live_bytes == p.live_bytes && g.copy_bytes == p.copy_bytes + f.copy_bytes;
+
+	soatl::alloc_registry().print( std::cout );
+
+	// reset keeps the live footprint
+	soatl::alloc_registry().reset();
+	p = soatl::alloc_stats<PackedT>();
+	ok = ok && p.allocations == 0 && p.copies == 0 && p.live_bytes == PackedT::allocation_size(cap2) && p.peak_bytes == p.live_bytes && p.peak_slack == p.live_slack;
+
+	std::cout<<"alignment padding of "<<packed.size()<<" packed elements : "<<PackedT::padding_size(cap2)<<" bytes, "
+	         <<100.0*PackedT::padding_size(cap2)/PackedT::allocation_size(cap2)<<"% of storage, chunk slack : "
+	         <<PackedT::slack_size(cap2,packed.size())<<" bytes"<<std::endl;
+
+	soatl::alloc_registry().dump_at_exit = false;
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
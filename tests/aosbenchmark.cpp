@@ -0,0 +1,173 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/aos.h"
+
+#include "declare_fields.h"
+#include "benchsuite.h"
+
+/*
+Round trip checks of AoS import/export (see aos.h) for transposed member groups (3 and 4 consecutive doubles or floats),
+gathered mixed members and run time offsets, over odd element counts, then timings against a naive element loop.
+usage : soatlaosbenchmark [N] [reps]
+*/
+
+struct ParticleD
+{
+	double x, y, z, e;
+	int32_t mid;
+	unsigned char type;
+};
+
+struct ParticleF
+{
+	float x, y, z, e;
+	int16_t tmp;
+};
+
+static inline void fill( std::vector<ParticleD>& p )
+{
+	for(size_t i=0;i<p.size();i++) { p[i] = ParticleD{ i*1.0, i*2.0+0.5, i*3.0+0.25, -1.0*i, int32_t(i*7), (unsigned char)(i%251) }; }
+}
+
+static inline void fill( std::vector<ParticleF>& p )
+{
+	for(size_t i=0;i<p.size();i++) { p[i] = ParticleF{ i*1.0f, i*2.0f+0.5f, i*3.0f+0.25f, -1.0f*i, int16_t(i%1000) }; }
+}
+
+static inline bool same( const ParticleD& a, const ParticleD& b ) { return a.x==b.x && a.y==b.y && a.z==b.z && a.e==b.e && a.mid==b.mid && a.type==b.type; }
+static inline bool same( const ParticleF& a, const ParticleF& b ) { return a.x==b.x && a.y==b.y && a.z==b.z && a.e==b.e && a.tmp==b.tmp; }
+
+// imports p, exports into a copy of p whose selected members were cleared, and compares
+template<typename FieldArraysT, typename S, typename ClearT, typename ImportT, typename ExportT>
+static inline bool round_trip( FieldArraysT& arrays, const std::vector<S>& p, ClearT clear, ImportT import, ExportT export_ )
+{
+	arrays.resize( p.size() );
+	import( arrays, p.data(), p.size() );
+	std::vector<S> q = p;
+	for(auto& s : q) { clear( s ); }
+	export_( arrays, q.data(), q.size() );
+	bool ok = true;
+	for(size_t i=0;i<p.size();i++) { ok = ok && same( p[i], q[i] ); }
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 1000003;
+	size_t reps = 5;
+	if(argc>=2) { N = atoll(argv[1]); }
+	if(argc>=3) { reps = atoi(argv[2]); }
+
+	std::cout<<"transposed groups of "<<soatl::AosTranspose<double,3>::width<<" doubles, "<<soatl::AosTranspose<float,3>::width<<" floats"<<std::endl;
+
+	auto cell = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_e, particle_mid, particle_atype );
+	auto cellf = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx_f, particle_ry_f, particle_rz_f, particle_e_f, particle_tmp1 );
+
+	const size_t offsets[] = { offsetof(ParticleD,e), offsetof(ParticleD,mid) };
+
+	bool ok = true;
+	for(size_t n : { size_t(0), size_t(1), size_t(2), size_t(3), size_t(5), size_t(7), size_t(17), size_t(1001), N, N+1 })
+	{
+		std::vector<ParticleD> p( n );
+		fill( p );
+		std::vector<ParticleF> pf( n );
+		fill( pf );
+
+		// 3 doubles, then the remaining members gathered
+		const bool ok_d3 = round_trip( cell, p, [](ParticleD& s) { s.x = s.y = s.z = s.e = 0.0; s.mid = 0; s.type = 0; },
+			[](decltype(cell)& a, const ParticleD* s, size_t c)
+			{
+				soatl::import_aos( a, s, c, SOATL_AOS_MEMBER(ParticleD,x,particle_rx), SOATL_AOS_MEMBER(ParticleD,y,particle_ry), SOATL_AOS_MEMBER(ParticleD,z,particle_rz) );
+				soatl::import_aos( a, s, c, SOATL_AOS_MEMBER(ParticleD,e,particle_e), SOATL_AOS_MEMBER(ParticleD,mid,particle_mid), SOATL_AOS_MEMBER(ParticleD,type,particle_atype) );
+			},
+			[](const decltype(cell)& a, ParticleD* s, size_t c)
+			{
+				soatl::export_aos( a, s, c, SOATL_AOS_MEMBER(ParticleD,x,particle_rx), SOATL_AOS_MEMBER(ParticleD,y,particle_ry), SOATL_AOS_MEMBER(ParticleD,z,particle_rz) );
+				soatl::export_aos( a, s, c, SOATL_AOS_MEMBER(ParticleD,e,particle_e), SOATL_AOS_MEMBER(ParticleD,mid,particle_mid), SOATL_AOS_MEMBER(ParticleD,type,particle_atype) );
+			} );
+
+		// 4 doubles in parallel, the other members must be left untouched by the masked stores
+		const bool ok_d4 = round_trip( cell, p, [](ParticleD& s) { s.x = s.y = s.z = s.e = 0.0; },
+			[](decltype(cell)& a, const ParticleD* s, size_t c)
+			{
+				soatl::parallel_import_aos( a, s, c, SOATL_AOS_MEMBER(ParticleD,x,particle_rx), SOATL_AOS_MEMBER(ParticleD,y,particle_ry), SOATL_AOS_MEMBER(ParticleD,z,particle_rz), SOATL_AOS_MEMBER(ParticleD,e,particle_e) );
+			},
+			[](const decltype(cell)& a, ParticleD* s, size_t c)
+			{
+				soatl::parallel_export_aos( a, s, c, SOATL_AOS_MEMBER(ParticleD,x,particle_rx), SOATL_AOS_MEMBER(ParticleD,y,particle_ry), SOATL_AOS_MEMBER(ParticleD,z,particle_rz), SOATL_AOS_MEMBER(ParticleD,e,particle_e) );
+			} );
+
+		// run time offsets
+		const bool ok_rt = round_trip( cell, p, [](ParticleD& s) { s.e = 0.0; s.mid = 0; },
+			[&offsets](decltype(cell)& a, const ParticleD* s, size_t c) { soatl::import_aos( a, s, c, sizeof(ParticleD), offsets, particle_e, particle_mid ); },
+			[&offsets](const decltype(cell)& a, ParticleD* s, size_t c) { soatl::export_aos( a, s, c, sizeof(ParticleD), offsets, particle_e, particle_mid ); } );
+
+		// 3 floats, the 4th float must survive the partial stores
+		const bool ok_f3 = round_trip( cellf, pf, [](ParticleF& s) { s.x = s.y = s.z = 0.0f; },
+			[](decltype(cellf)& a, const ParticleF* s, size_t c) { soatl::import_aos( a, s, c, SOATL_AOS_MEMBER(ParticleF,x,particle_rx_f), SOATL_AOS_MEMBER(ParticleF,y,particle_ry_f), SOATL_AOS_MEMBER(ParticleF,z,particle_rz_f) ); },
+			[](const decltype(cellf)& a, ParticleF* s, size_t c) { soatl::export_aos( a, s, c, SOATL_AOS_MEMBER(ParticleF,x,particle_rx_f), SOATL_AOS_MEMBER(ParticleF,y,particle_ry_f), SOATL_AOS_MEMBER(ParticleF,z,particle_rz_f) ); } );
+
+		// 4 floats
+		const bool ok_f4 = round_trip( cellf, pf, [](ParticleF& s) { s.x = s.y = s.z = s.e = 0.0f; },
+			[](decltype(cellf)& a, const ParticleF* s, size_t c) { soatl::parallel_import_aos( a, s, c, SOATL_AOS_MEMBER(ParticleF,x,particle_rx_f), SOATL_AOS_MEMBER(ParticleF,y,particle_ry_f), SOATL_AOS_MEMBER(ParticleF,z,particle_rz_f), SOATL_AOS_MEMBER(ParticleF,e,particle_e_f) ); },
+			[](const decltype(cellf)& a, ParticleF* s, size_t c) { soatl::parallel_export_aos( a, s, c, SOATL_AOS_MEMBER(ParticleF,x,particle_rx_f), SOATL_AOS_MEMBER(ParticleF,y,particle_ry_f), SOATL_AOS_MEMBER(ParticleF,z,particle_rz_f), SOATL_AOS_MEMBER(ParticleF,e,particle_e_f) ); } );
+
+		if( !ok_d3 || !ok_d4 || !ok_rt || !ok_f3 || !ok_f4 )
+		{
+			std::cerr<<"n="<<n<<" : d3="<<ok_d3<<" d4="<<ok_d4<<" runtime="<<ok_rt<<" f3="<<ok_f3<<" f4="<<ok_f4<<std::endl;
+			ok = false;
+		}
+	}
+
+	// timings, positions of N particles
+	{
+		std::vector<ParticleD> p( N );
+		fill( p );
+		cell.resize( N );
+		double* __restrict__ rx = cell[particle_rx];
+		double* __restrict__ ry = cell[particle_ry];
+		double* __restrict__ rz = cell[particle_rz];
+		const ParticleD* s = p.data();
+		const double naive = best_time( reps, [&]() { for(size_t i=0;i<N;i++) { rx[i] = s[i].x; ry[i] = s[i].y; rz[i] = s[i].z; } } );
+		const double imported = best_time( reps, [&]() { soatl::import_aos( cell, s, N, SOATL_AOS_MEMBER(ParticleD,x,particle_rx), SOATL_AOS_MEMBER(ParticleD,y,particle_ry), SOATL_AOS_MEMBER(ParticleD,z,particle_rz) ); } );
+		const double parallel = best_time( reps, [&]() { soatl::parallel_import_aos( cell, s, N, SOATL_AOS_MEMBER(ParticleD,x,particle_rx), SOATL_AOS_MEMBER(ParticleD,y,particle_ry), SOATL_AOS_MEMBER(ParticleD,z,particle_rz) ); } );
+		const double exported = best_time( reps, [&]() { soatl::export_aos( cell, p.data(), N, SOATL_AOS_MEMBER(ParticleD,x,particle_rx), SOATL_AOS_MEMBER(ParticleD,y,particle_ry), SOATL_AOS_MEMBER(ParticleD,z,particle_rz) ); } );
+		const double naive_export = best_time( reps, [&]() { ParticleD* d = p.data(); for(size_t i=0;i<N;i++) { d[i].x = rx[i]; d[i].y = ry[i]; d[i].z = rz[i]; } } );
+		const double bytes = N * ( sizeof(ParticleD) + 3 * sizeof(double) );
+		std::cout<<std::fixed<<std::setprecision(2)
+		         <<"import xyz : naive "<<bytes/naive*1.e-9<<" GB/s, import_aos "<<bytes/imported*1.e-9<<" GB/s, parallel_import_aos "<<bytes/parallel*1.e-9<<" GB/s"<<std::endl
+		         <<"export xyz : naive "<<bytes/naive_export*1.e-9<<" GB/s, export_aos "<<bytes/exported*1.e-9<<" GB/s"<<std::endl;
+	}
+	{
+		std::vector<ParticleF> p( N );
+		fill( p );
+		cellf.resize( N );
+		float* __restrict__ rx = cellf[particle_rx_f];
+		float* __restrict__ ry = cellf[particle_ry_f];
+		float* __restrict__ rz = cellf[particle_rz_f];
+		float* __restrict__ e = cellf[particle_e_f];
+		const ParticleF* s = p.data();
+		const double naive = best_time( reps, [&]() { for(size_t i=0;i<N;i++) { rx[i] = s[i].x; ry[i] = s[i].y; rz[i] = s[i].z; e[i] = s[i].e; } } );
+		const double imported = best_time( reps, [&]() { soatl::import_aos( cellf, s, N, SOATL_AOS_MEMBER(ParticleF,x,particle_rx_f), SOATL_AOS_MEMBER(ParticleF,y,particle_ry_f), SOATL_AOS_MEMBER(ParticleF,z,particle_rz_f), SOATL_AOS_MEMBER(ParticleF,e,particle_e_f) ); } );
+		const double bytes = N * ( sizeof(ParticleF) + 4 * sizeof(float) );
+		std::cout<<"import xyze (float) : naive "<<bytes/naive*1.e-9<<" GB/s, import_aos "<<bytes/imported*1.e-9<<" GB/s"<<std::endl;
+	}
+
+	cell.resize( 0 );
+	cellf.resize( 0 );
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,214 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <limits>
+#include <cstdint>
+#include <cmath>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/compute.h"
+#include "soatl/copy.h"
+
+#include "benchsuite.h"
+
+/*
+Alignment and chunk size tuning : for each value type, runs representative kernels (a distance like apply_simd kernel,
+a streaming update and a container copy) over 4 fields for every alignment x chunk size x container type (fa, pfa),
+then writes the fastest alignment and chunk size per value type (summed over both containers) as a header for tuned_defaults.h.
+usage : soatlautotune [output header] [elements] [reps]
+with no output header, the generated lines are printed only.
+*/
+
+template<typename T, int I> struct tune_field_id {};
+namespace soatl
+{
+template<typename T, int I> struct FieldDescriptor< tune_field_id<T,I> >
+{
+	using value_type = T;
+	using Id = tune_field_id<T,I>;
+	static const char* name() { return "tuning field"; }
+};
+}
+
+template<typename T> struct TuneType;
+template<> struct TuneType<double> { static const char* name() { return "double"; } };
+template<> struct TuneType<float> { static const char* name() { return "float"; } };
+template<> struct TuneType<int64_t> { static const char* name() { return "int64_t"; } };
+template<> struct TuneType<int32_t> { static const char* name() { return "int32_t"; } };
+
+struct TuneResult
+{
+	std::string type;
+	size_t alignment;
+	size_t chunksize;
+	std::string container;
+	double ns; // sum of kernels' median time
+};
+
+template<typename T>
+static inline T tune_distance( T x, T y, T z )
+{
+	const T dx = x - T(1);
+	const T dy = y - T(2);
+	const T dz = z - T(3);
+	return dx*dx + dy*dy + dz*dz;
+}
+
+template<typename ArraysT, typename T>
+static inline double tune_kernels( const BenchOptions& opt, size_t N, bool& ok )
+{
+	soatl::FieldId< tune_field_id<T,0> > fx;
+	soatl::FieldId< tune_field_id<T,1> > fy;
+	soatl::FieldId< tune_field_id<T,2> > fz;
+	soatl::FieldId< tune_field_id<T,3> > fd;
+
+	ArraysT arrays;
+	ArraysT copy_dst;
+	arrays.resize( N );
+	copy_dst.resize( N );
+	for(size_t i=0;i<N;i++)
+	{
+		arrays[fx][i] = static_cast<T>( i % 101 );
+		arrays[fy][i] = static_cast<T>( i % 37 );
+		arrays[fz][i] = static_cast<T>( i % 13 );
+		arrays[fd][i] = 0;
+	}
+
+	size_t inner = 1;
+	double ns = 0.0;
+
+	// gather like distance kernel, 3 reads 1 write
+	auto s = bench_samples( opt, inner, [&arrays,fx,fy,fz,fd]()
+	{
+		soatl::apply_simd( [](T& d, T x, T y, T z) { d = tune_distance(x,y,z); }, arrays, fd, fx, fy, fz );
+	} );
+	ns += s[ s.size() / 2 ];
+	for(size_t i=0;i<N;i++)
+	{
+		const double expected = tune_distance( arrays[fx][i], arrays[fy][i], arrays[fz][i] );
+		ok = ok && std::abs( arrays[fd][i] - expected ) <= 1.e-5 * std::abs( expected );
+	}
+
+	// streaming update, 3 reads 1 write, values do not grow across calls
+	s = bench_samples( opt, inner, [&arrays,fx,fy,fz,fd]()
+	{
+		soatl::apply_simd( [](T& z, T x, T y, T d) { z = x * y - d; }, arrays, fz, fx, fy, fd );
+	} );
+	ns += s[ s.size() / 2 ];
+
+	s = bench_samples( opt, inner, [&arrays,&copy_dst]() { soatl::copy( copy_dst, arrays ); } );
+	ns += s[ s.size() / 2 ];
+	for(size_t i=0;i<N;i++)
+	{
+		ok = ok && copy_dst[fz][i] == arrays[fz][i] && copy_dst[fd][i] == arrays[fd][i];
+	}
+
+	release( arrays );
+	release( copy_dst );
+	return ns;
+}
+
+// alignments below the SIMD requirement of T are rejected by apply_simd
+template<typename T, size_t A, size_t C>
+static inline void tune_layout( std::vector<TuneResult>& results, const BenchOptions& opt, size_t N, bool& ok, std::false_type ) {}
+
+template<typename T, size_t A, size_t C>
+static inline void tune_layout( std::vector<TuneResult>& results, const BenchOptions& opt, size_t N, bool& ok, std::true_type )
+{
+	using X = tune_field_id<T,0>;
+	using Y = tune_field_id<T,1>;
+	using Z = tune_field_id<T,2>;
+	using D = tune_field_id<T,3>;
+	results.push_back( { TuneType<T>::name(), A, C, "fa", tune_kernels< soatl::FieldArrays<A,C,X,Y,Z,D>, T >( opt, N, ok ) } );
+	results.push_back( { TuneType<T>::name(), A, C, "pfa", tune_kernels< soatl::PackedFieldArrays<A,C,X,Y,Z,D>, T >( opt, N, ok ) } );
+}
+
+template<typename T, size_t A, size_t... Cs>
+static inline void tune_chunks( std::vector<TuneResult>& results, const BenchOptions& opt, size_t N, bool& ok )
+{
+	TEMPLATE_LIST_BEGIN
+		tune_layout<T,A,Cs>( results, opt, N, ok, std::integral_constant<bool, ( A >= soatl::SimdRequirements<T>::alignment ) >() )
+	TEMPLATE_LIST_END
+}
+
+template<typename T>
+static inline void tune_type( std::vector<TuneResult>& results, const BenchOptions& opt, size_t N, bool& ok )
+{
+	tune_chunks<T,16,1,4,8,16,32>( results, opt, N, ok );
+	tune_chunks<T,32,1,4,8,16,32>( results, opt, N, ok );
+	tune_chunks<T,64,1,4,8,16,32>( results, opt, N, ok );
+	tune_chunks<T,128,1,4,8,16,32>( results, opt, N, ok );
+}
+
+int main(int argc, char* argv[])
+{
+	std::string output;
+	size_t N = 1 << 16;
+	BenchOptions opt;
+	if(argc>=2) { output = argv[1]; }
+	if(argc>=3) { N = atoi(argv[2]); }
+	if(argc>=4) { opt.reps = atoi(argv[3]); }
+
+	bool ok = true;
+	std::vector<TuneResult> results;
+	tune_type<double>( results, opt, N, ok );
+	tune_type<float>( results, opt, N, ok );
+	tune_type<int64_t>( results, opt, N, ok );
+	tune_type<int32_t>( results, opt, N, ok );
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+
+	std::cout << std::left << std::setw(10) << "type" << std::setw(6) << "cont." << std::right << std::setw(7) << "align" << std::setw(7) << "chunk" << std::setw(14) << "ns" << '\n';
+	std::cout << std::fixed << std::setprecision(1);
+	for(const TuneResult& r : results)
+	{
+		std::cout << std::left << std::setw(10) << r.type << std::setw(6) << r.container << std::right << std::setw(7) << r.alignment << std::setw(7) << r.chunksize << std::setw(14) << r.ns << '\n';
+	}
+	std::cout << std::defaultfloat;
+
+	// best layout per value type, both containers having the same defaults
+	std::vector<std::string> types;
+	std::map< std::string, std::map< std::pair<size_t,size_t>, double > > total;
+	for(const TuneResult& r : results)
+	{
+		if( total.find(r.type) == total.end() ) { types.push_back( r.type ); }
+		total[r.type][ std::make_pair(r.alignment,r.chunksize) ] += r.ns;
+	}
+
+	std::ostringstream header;
+	header << "// generated by soatlautotune : SIMD arch=" << soatl::simd_arch() << ", " << N << " elements, " << opt.reps << " reps\n";
+	header << "// included by soatl/tuned_defaults.h\n";
+	for(const std::string& type : types)
+	{
+		std::pair<size_t,size_t> best;
+		double best_ns = std::numeric_limits<double>::max();
+		for(const auto& layout : total[type])
+		{
+			if( layout.second < best_ns ) { best = layout.first; best_ns = layout.second; }
+		}
+		header << "SOATL_SET_TUNED_DEFAULTS(" << type << "," << best.first << "," << best.second << ")\n";
+	}
+	std::cout << header.str();
+
+	if( ! output.empty() )
+	{
+		std::ofstream out( output );
+		out << "#pragma once\n\n" << header.str();
+		if( ! out )
+		{
+			std::cerr << "cannot write " << output << std::endl;
+			return 1;
+		}
+		std::cout << "written to " << output << std::endl;
+	}
+
+	return 0;
+}
@@ -13,8 +13,10 @@
 #include "soatl/field_pointers.h"
 #include "soatl/static_packed_field_arrays.h"
 #include "soatl/compute.h"
+#include "soatl/roofline.h"
 
 #include "declare_fields.h"
+#include "compute_kernel.h"
 
 #ifndef TEST_ALIGNMENT
 #define TEST_ALIGNMENT 64
@@ -50,17 +52,41 @@ auto field_rz = particle_rz_f;
 
 std::default_random_engine rng;
 
+// not inlined : vecreport (cmake/vecreport.cmake) attributes instructions of functions named vecreport_* to kernels
+template<typename ArraysT, typename PosT, typename idDist, typename idRx, typename idRy, typename idRz>
+__attribute__((noinline)) void vecreport_compute(ArraysT& arrays, PosT ax, PosT ay, PosT az, soatl::FieldId<idDist> dist, soatl::FieldId<idRx> rx, soatl::FieldId<idRy> ry, soatl::FieldId<idRz> rz)
+{
+  using DistT = typename soatl::FieldDescriptor<idDist>::value_type;
+# if TEST_USE_SIMD
+#   if TEST_ENABLE_OPENMP
+    soatl::parallel_apply_simd( [ax,ay,az](DistT& d, PosT x, PosT y, PosT z) { COMPUTE_KERNEL; }
+                                , arrays, dist, rx, ry, rz );
+#   else
+    soatl::apply_simd( [ax,ay,az](DistT& d, PosT x, PosT y, PosT z) { COMPUTE_KERNEL; }
+                       , arrays, dist, rx, ry, rz );
+#   endif
+# else
+#   if TEST_ENABLE_OPENMP
+    soatl::parallel_apply( [ax,ay,az](DistT& d, PosT x, PosT y, PosT z) { COMPUTE_KERNEL; }
+                           , arrays, dist, rx, ry, rz );
+#   else
+    soatl::apply( [ax,ay,az](DistT& d, PosT x, PosT y, PosT z) { COMPUTE_KERNEL; }
+                  , arrays, dist, rx, ry, rz );
+#   endif
+# endif
+}
+
 template<typename ArraysT, typename idDist, typename idRx, typename idRy, typename idRz>
 inline double benchmark(ArraysT& arrays, size_t N, soatl::FieldId<idDist> dist, soatl::FieldId<idRx> rx, soatl::FieldId<idRy> ry, soatl::FieldId<idRz> rz)
 {
   static constexpr size_t nCycles = 10;
-  using DistT = typename soatl::FieldDescriptor<idDist>::value_type;
   using PosT = typename soatl::FieldDescriptor<idRx>::value_type;
 
   std::uniform_real_distribution<> rdist(0.0,1.0);
   double result = 0.0;
 
   std::chrono::nanoseconds timens(0);
+  soatl::KernelRoofline roofline( "compute", 15 ); // flops of COMPUTE_KERNEL, counting sqrt and divisions as one
 
   for(size_t cycle=0;cycle<nCycles;cycle++)
   {
@@ -76,36 +102,11 @@ inline double benchmark(ArraysT& arrays, size_t N, soatl::FieldId<idDist> dist,
     PosT ay = arrays[ry][0];
     PosT az = arrays[rz][0];
 
-#define COMPUTE_KERNEL \
-  x = x - ax; \
-	y = y - ay; \
-	z = z - az; \
-	d = std::sqrt( x*x + y*y + z*z ); \
-	x /= d; \
-	y /= d; \
-	z /= d; \
-	d += x/(y*z)
-
     auto t1 = std::chrono::high_resolution_clock::now();
-#   if TEST_USE_SIMD
-#     if TEST_ENABLE_OPENMP
-	    soatl::parallel_apply_simd( [ax,ay,az](DistT& d, PosT x, PosT y, PosT z) { COMPUTE_KERNEL; }
-		                            , arrays, dist, rx, ry, rz );
-#     else
-	    soatl::apply_simd( [ax,ay,az](DistT& d, PosT x, PosT y, PosT z) { COMPUTE_KERNEL; }
-		                   , arrays, dist, rx, ry, rz );
-#     endif
-#   else
-#     if TEST_ENABLE_OPENMP
-	    soatl::parallel_apply( [ax,ay,az](DistT& d, PosT x, PosT y, PosT z) { COMPUTE_KERNEL; }
-		                       , arrays, dist, rx, ry, rz );
-#     else
-	    soatl::apply( [ax,ay,az](DistT& d, PosT x, PosT y, PosT z) { COMPUTE_KERNEL; }
-		              , arrays, dist, rx, ry, rz );
-#     endif
-#   endif
+    vecreport_compute( arrays, ax, ay, az, dist, rx, ry, rz );
     auto t2 = std::chrono::high_resolution_clock::now();
     timens += t2-t1;
+    roofline.add( N, std::chrono::duration<double>(t2-t1).count(), soatl::write(dist), soatl::read(rx), soatl::read(ry), soatl::read(rz) );
 
     // try to optimize this out, compiler !
     for(size_t i=0;i<N;i++)
@@ -115,6 +116,7 @@ inline double benchmark(ArraysT& arrays, size_t N, soatl::FieldId<idDist> dist,
 	}
 
   std::cout<<"time = "<<timens.count()/nCycles<<std::endl;
+  roofline.print( std::cout );
 
   return result;
 }
@@ -0,0 +1,299 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <new>
+#include <omp.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/static_packed_field_arrays.h"
+#include "soatl/compute.h"
+#include "soatl/copy.h"
+
+#include "declare_fields.h"
+#include "benchsuite.h"
+
+/*
+Benchmark suite : resize, copy variants, apply, apply_simd and parallel_apply_simd on 4 fields,
+kernels take plain field ids so that large working sets are not redirected to streaming stores (see non_temporal.h),
+for each container type (fa, pfa, spfa), precision, and working set size (fitting in L1, L2, LLC, or DRAM).
+usage : soatlbenchsuite [--format text|csv|json] [--output file] [--reps R] [--warmup W] [--min-sample-us T]
+                        [--sizes L1,L2,LLC,DRAM] [--containers fa,pfa,spfa] [--precisions double,float]
+                        [--threads 1,2,...] [--benchmarks resize,copy,...]
+compare two result files with scripts/compare_benchmarks.py
+*/
+
+enum ArraysImplementation
+{
+	FIELD_ARRAYS,
+	PACKED_FIELD_ARRAYS,
+	STATIC_PACKED_FIELD_ARRAYS
+};
+
+// working set of the 4 fields, sizes are compile time constants because of StaticPackedFieldArrays
+static constexpr size_t WORKING_SET_L1 = 16ul << 10;
+static constexpr size_t WORKING_SET_L2 = 256ul << 10;
+static constexpr size_t WORKING_SET_LLC = 4ul << 20;
+static constexpr size_t WORKING_SET_DRAM = 256ul << 20;
+
+template<typename T> struct BenchFields;
+template<> struct BenchFields<double>
+{
+	using X = particle_rx_id; using Y = particle_ry_id; using Z = particle_rz_id; using E = particle_e_id;
+	static const char* name() { return "double"; }
+};
+template<> struct BenchFields<float>
+{
+	using X = particle_rx_f_id; using Y = particle_ry_f_id; using Z = particle_rz_f_id; using E = particle_e_f_id;
+	static const char* name() { return "float"; }
+};
+
+template<ArraysImplementation impl, size_t N, typename... ids> struct BenchArrays;
+template<size_t N, typename... ids> struct BenchArrays<FIELD_ARRAYS,N,ids...>
+{
+	using type = soatl::FieldArrays<soatl::DEFAULT_ALIGNMENT,soatl::DEFAULT_CHUNK_SIZE,ids...>;
+	static const char* name() { return "fa"; }
+};
+template<size_t N, typename... ids> struct BenchArrays<PACKED_FIELD_ARRAYS,N,ids...>
+{
+	using type = soatl::PackedFieldArrays<soatl::DEFAULT_ALIGNMENT,soatl::DEFAULT_CHUNK_SIZE,ids...>;
+	static const char* name() { return "pfa"; }
+};
+template<size_t N, typename... ids> struct BenchArrays<STATIC_PACKED_FIELD_ARRAYS,N,ids...>
+{
+	using type = soatl::StaticPackedFieldArrays<soatl::DEFAULT_ALIGNMENT,soatl::DEFAULT_CHUNK_SIZE,(N+soatl::DEFAULT_CHUNK_SIZE-1)/soatl::DEFAULT_CHUNK_SIZE,ids...>;
+	static const char* name() { return "spfa"; }
+};
+
+// aligned heap storage, so that large static containers do not live on the stack
+template<typename ArraysT>
+struct HeapArrays
+{
+	inline HeapArrays()
+	{
+		void* p = nullptr;
+		if( posix_memalign( &p, std::max( ArraysT::alignment(), sizeof(void*) ), sizeof(ArraysT) ) != 0 ) { throw std::bad_alloc(); }
+		m_ptr = new(p) ArraysT();
+	}
+	inline ~HeapArrays()
+	{
+		release( *m_ptr );
+		m_ptr->~ArraysT();
+		free( m_ptr );
+	}
+	inline ArraysT& operator * () { return *m_ptr; }
+	ArraysT* m_ptr = nullptr;
+};
+
+struct BenchSuite
+{
+	BenchOptions options;
+	BenchReport report;
+	std::vector<std::string> sizes = { "L1", "L2", "LLC", "DRAM" };
+	std::vector<std::string> containers = { "fa", "pfa", "spfa" };
+	std::vector<std::string> precisions = { "double", "float" };
+	std::vector<std::string> benchmarks = { "resize", "copy", "copy_fields", "copy_range", "apply", "apply_simd", "parallel_apply_simd" };
+	std::vector<size_t> threads;
+	bool ok = true;
+
+	static inline bool contains( const std::vector<std::string>& v, const std::string& s ) { return std::find( v.begin(), v.end(), s ) != v.end(); }
+
+	template<typename FuncT, typename SetupT>
+	inline void run( const std::string& benchmark, const char* container, const char* precision, const char* size_class,
+	                 size_t elements, size_t nthreads, size_t bytes, FuncT func, SetupT setup )
+	{
+		BenchResult r;
+		r.benchmark = benchmark; r.container = container; r.precision = precision; r.size_class = size_class;
+		r.elements = elements; r.threads = nthreads; r.bytes = bytes;
+		r.samples = bench_samples( options, r.inner, func, setup );
+		report.results.push_back( r );
+		std::cerr << benchmark << " " << container << " " << precision << " " << size_class << " t=" << nthreads << " : " << r.median() << " ns" << std::endl;
+	}
+
+	template<typename FuncT>
+	inline void run( const std::string& benchmark, const char* container, const char* precision, const char* size_class,
+	                 size_t elements, size_t nthreads, size_t bytes, FuncT func )
+	{
+		run( benchmark, container, precision, size_class, elements, nthreads, bytes, func, [](){} );
+	}
+};
+
+template<typename ArraysT, typename T, typename X, typename Y, typename Z, typename E>
+static inline void fill( ArraysT& a, size_t N )
+{
+	a.resize( N );
+	for(size_t i=0;i<a.chunk_ceil();i++)
+	{
+		a[soatl::FieldId<X>()][i] = static_cast<T>( i % 7 );
+		a[soatl::FieldId<Y>()][i] = static_cast<T>( i % 5 );
+		a[soatl::FieldId<Z>()][i] = static_cast<T>( i % 3 );
+		a[soatl::FieldId<E>()][i] = 0;
+	}
+}
+
+template<ArraysImplementation impl, typename T, size_t WorkingSet>
+static inline void run_arrays( BenchSuite& suite, const char* size_class )
+{
+	using Fields = BenchFields<T>;
+	using X = typename Fields::X; using Y = typename Fields::Y; using Z = typename Fields::Z; using E = typename Fields::E;
+	static constexpr size_t N = WorkingSet / ( 4 * sizeof(T) );
+	using Impl = BenchArrays<impl,N,X,Y,Z,E>;
+	using ArraysT = typename Impl::type;
+	const char* container = Impl::name();
+	const char* precision = Fields::name();
+	const soatl::FieldId<X> fx{}; const soatl::FieldId<Y> fy{}; const soatl::FieldId<Z> fz{}; const soatl::FieldId<E> fe{};
+	auto selected = [&suite](const char* b) { return BenchSuite::contains( suite.benchmarks, b ); };
+
+	HeapArrays<ArraysT> src_holder, dst_holder;
+	ArraysT& src = *src_holder;
+	ArraysT& dst = *dst_holder;
+
+	// shrink to half and grow back : two reallocations, each copying N/2 elements
+	if( selected("resize") && impl != STATIC_PACKED_FIELD_ARRAYS )
+	{
+		suite.run( "resize", container, precision, size_class, N, 1, 2 * N * 4 * sizeof(T),
+		           [&]() { src.resize( N / 2 ); src.resize( N ); }, [&]() { src.resize( N ); } );
+	}
+
+	fill<ArraysT,T,X,Y,Z,E>( src, N );
+	fill<ArraysT,T,X,Y,Z,E>( dst, N );
+
+	if( selected("copy") )
+	{
+		suite.run( "copy", container, precision, size_class, N, 1, 2 * N * 4 * sizeof(T), [&]() { soatl::copy( dst, src ); } );
+		suite.ok = suite.ok && dst[fx][N-1] == src[fx][N-1] && dst[fz][N/2] == src[fz][N/2];
+	}
+	if( selected("copy_fields") )
+	{
+		suite.run( "copy_fields", container, precision, size_class, N, 1, 2 * N * 2 * sizeof(T), [&]() { soatl::copy( dst, src, fx, fy ); } );
+	}
+	if( selected("copy_range") )
+	{
+		const size_t start = ( N / 4 / ArraysT::ChunkSize ) * ArraysT::ChunkSize;
+		suite.run( "copy_range", container, precision, size_class, N, 1, 2 * ( N / 2 ) * 4 * sizeof(T), [&]() { soatl::copy( dst, src, start, N / 2 ); } );
+	}
+
+	auto kernel = [](T x, T y, T z, T& e) { e = x*x + y*y + z*z; };
+	auto check = [&]()
+	{
+		for(size_t i : { size_t(0), N/2, N-1 })
+		{
+			suite.ok = suite.ok && src[fe][i] == src[fx][i]*src[fx][i] + src[fy][i]*src[fy][i] + src[fz][i]*src[fz][i];
+		}
+	};
+	if( selected("apply") )
+	{
+		suite.run( "apply", container, precision, size_class, N, 1, N * 4 * sizeof(T),
+		           [&]() { soatl::apply( kernel, src, fx, fy, fz, fe ); } );
+		check();
+	}
+	if( selected("apply_simd") )
+	{
+		suite.run( "apply_simd", container, precision, size_class, N, 1, N * 4 * sizeof(T),
+		           [&]() { soatl::apply_simd( kernel, src, fx, fy, fz, fe ); } );
+		check();
+	}
+	if( selected("parallel_apply_simd") )
+	{
+		const int max_threads = omp_get_max_threads();
+		for(size_t t : suite.threads)
+		{
+			omp_set_num_threads( t );
+			suite.run( "parallel_apply_simd", container, precision, size_class, N, t, N * 4 * sizeof(T),
+			           [&]() { soatl::parallel_apply_simd( kernel, src, fx, fy, fz, fe ); } );
+			check();
+		}
+		omp_set_num_threads( max_threads );
+	}
+}
+
+template<typename T, size_t WorkingSet>
+static inline void run_size( BenchSuite& suite, const char* size_class )
+{
+	if( ! BenchSuite::contains( suite.sizes, size_class ) ) { return; }
+	if( BenchSuite::contains( suite.containers, "fa" ) ) { run_arrays<FIELD_ARRAYS,T,WorkingSet>( suite, size_class ); }
+	if( BenchSuite::contains( suite.containers, "pfa" ) ) { run_arrays<PACKED_FIELD_ARRAYS,T,WorkingSet>( suite, size_class ); }
+	if( BenchSuite::contains( suite.containers, "spfa" ) ) { run_arrays<STATIC_PACKED_FIELD_ARRAYS,T,WorkingSet>( suite, size_class ); }
+}
+
+template<typename T>
+static inline void run_precision( BenchSuite& suite )
+{
+	if( ! BenchSuite::contains( suite.precisions, BenchFields<T>::name() ) ) { return; }
+	run_size<T,WORKING_SET_L1>( suite, "L1" );
+	run_size<T,WORKING_SET_L2>( suite, "L2" );
+	run_size<T,WORKING_SET_LLC>( suite, "LLC" );
+	run_size<T,WORKING_SET_DRAM>( suite, "DRAM" );
+}
+
+int main(int argc, char* argv[])
+{
+	BenchSuite suite;
+	std::string format = "text";
+	std::string output;
+
+	for(int a=1;a<argc;a++)
+	{
+		const std::string arg = argv[a];
+		if( a+1 >= argc )
+		{
+			std::cerr<<"usage: "<<argv[0]<<" [--format text|csv|json] [--output file] [--reps R] [--warmup W] [--min-sample-us T] [--sizes L1,L2,LLC,DRAM]"
+			         <<" [--containers fa,pfa,spfa] [--precisions double,float] [--threads 1,2,...] [--benchmarks names]"<<std::endl;
+			return 1;
+		}
+		const std::string value = argv[++a];
+		if( arg == "--format" ) { format = value; }
+		else if( arg == "--output" ) { output = value; }
+		else if( arg == "--reps" ) { suite.options.reps = std::max( 1, atoi( value.c_str() ) ); }
+		else if( arg == "--warmup" ) { suite.options.warmup = atoi( value.c_str() ); }
+		else if( arg == "--min-sample-us" ) { suite.options.min_sample_ns = atof( value.c_str() ) * 1000.0; }
+		else if( arg == "--sizes" ) { suite.sizes = split_list( value ); }
+		else if( arg == "--containers" ) { suite.containers = split_list( value ); }
+		else if( arg == "--precisions" ) { suite.precisions = split_list( value ); }
+		else if( arg == "--benchmarks" ) { suite.benchmarks = split_list( value ); }
+		else if( arg == "--threads" ) { for(const auto& t : split_list( value )) { suite.threads.push_back( std::max( 1, atoi( t.c_str() ) ) ); } }
+		else { std::cerr<<"unknown option "<<arg<<std::endl; return 1; }
+	}
+
+	// default thread counts : powers of 2 up to the maximum, and the maximum
+	const size_t max_threads = omp_get_max_threads();
+	if( suite.threads.empty() )
+	{
+		for(size_t t=1;t<max_threads;t*=2) { suite.threads.push_back( t ); }
+		suite.threads.push_back( max_threads );
+	}
+
+	suite.report.context = {
+		{ "simd_arch", soatl::simd_arch() },
+		{ "alignment", std::to_string( soatl::DEFAULT_ALIGNMENT ) },
+		{ "chunk_size", std::to_string( soatl::DEFAULT_CHUNK_SIZE ) },
+		{ "omp_max_threads", std::to_string( max_threads ) },
+		{ "compiler", __VERSION__ },
+		{ "reps", std::to_string( suite.options.reps ) },
+		{ "warmup", std::to_string( suite.options.warmup ) } };
+
+	run_precision<double>( suite );
+	run_precision<float>( suite );
+
+	bool written = false;
+	if( output.empty() ) { written = suite.report.write( std::cout, format ); }
+	else
+	{
+		std::ofstream out( output );
+		written = suite.report.write( out, format ) && out.good();
+	}
+	if( ! written )
+	{
+		std::cerr<<"cannot write "<<format<<" results"<<std::endl;
+		return 1;
+	}
+
+	if( ! suite.ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
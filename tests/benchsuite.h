@@ -0,0 +1,233 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "soatl/field_arrays.h"
+
+/*
+Timing and reporting helpers for benchmark programs producing machine readable results.
+A benchmark is warmed up, then sampled reps times. Kernels shorter than min_sample_ns are
+repeated inside each sample (the inner count is calibrated during warmup) and the sample is the time per call.
+Results are printed as a text table, CSV or JSON (see scripts/compare_benchmarks.py).
+Benchmarks printing their own tables use best_time, and release() frees containers at the end of a run.
+*/
+
+struct BenchOptions
+{
+	size_t warmup = 2;
+	size_t reps = 15;
+	double min_sample_ns = 50000.0;
+};
+
+struct BenchResult
+{
+	std::string benchmark;
+	std::string container;
+	std::string precision;
+	std::string size_class;
+	size_t elements = 0;
+	size_t threads = 1;
+	size_t bytes = 0;  // memory traffic of one call, used for the bandwidth column
+	size_t inner = 1;
+	std::vector<double> samples; // nanoseconds per call, sorted
+
+	// nearest rank percentile, q in [0,1]
+	inline double percentile(double q) const
+	{
+		if( samples.empty() ) return 0.0;
+		const size_t r = static_cast<size_t>( std::ceil( q * samples.size() ) );
+		return samples[ std::min( samples.size(), std::max( r, size_t(1) ) ) - 1 ];
+	}
+	inline double min() const { return samples.empty() ? 0.0 : samples.front(); }
+	inline double max() const { return samples.empty() ? 0.0 : samples.back(); }
+	inline double median() const { return percentile(0.5); }
+	inline double mean() const
+	{
+		double s = 0.0;
+		for(double x : samples) { s += x; }
+		return samples.empty() ? 0.0 : s / samples.size();
+	}
+	inline double gbps() const { return median() > 0.0 ? bytes / median() : 0.0; }
+};
+
+// runs func() warmup times, then collects reps samples. setup() runs before each batch of calls and is not timed.
+template<typename FuncT, typename SetupT>
+static inline std::vector<double> bench_samples( const BenchOptions& opt, size_t& inner, FuncT func, SetupT setup )
+{
+	using clock = std::chrono::steady_clock;
+	auto batch = [&](size_t n) -> double
+	{
+		setup();
+		auto t1 = clock::now();
+		for(size_t k=0;k<n;k++) { func(); }
+		return std::chrono::duration<double,std::nano>( clock::now() - t1 ).count();
+	};
+
+	inner = 1;
+	for(size_t w=0;w<opt.warmup;w++)
+	{
+		const double t = batch( inner );
+		if( t < opt.min_sample_ns )
+		{
+			inner = std::max( inner, static_cast<size_t>( std::ceil( inner * opt.min_sample_ns / std::max( t, 1.0 ) ) ) );
+		}
+	}
+
+	std::vector<double> samples;
+	for(size_t r=0;r<opt.reps;r++) { samples.push_back( batch( inner ) / inner ); }
+	std::sort( samples.begin(), samples.end() );
+	return samples;
+}
+
+template<typename FuncT>
+static inline std::vector<double> bench_samples( const BenchOptions& opt, size_t& inner, FuncT func )
+{
+	return bench_samples( opt, inner, func, [](){} );
+}
+
+// best time in seconds over reps calls of func
+template<typename FuncT>
+static inline double best_time( size_t reps, FuncT func )
+{
+	double best = std::numeric_limits<double>::max();
+	for(size_t r=0;r<reps;r++)
+	{
+		auto t1 = std::chrono::high_resolution_clock::now();
+		func();
+		auto t2 = std::chrono::high_resolution_clock::now();
+		best = std::min( best , std::chrono::duration<double>(t2-t1).count() );
+	}
+	return best;
+}
+
+// same, prepare() runs before each call and is not timed
+template<typename PrepareT, typename FuncT>
+static inline double best_time( size_t reps, PrepareT prepare, FuncT func )
+{
+	double best = std::numeric_limits<double>::max();
+	for(size_t r=0;r<reps;r++)
+	{
+		prepare();
+		auto t1 = std::chrono::high_resolution_clock::now();
+		func();
+		auto t2 = std::chrono::high_resolution_clock::now();
+		best = std::min( best , std::chrono::duration<double>(t2-t1).count() );
+	}
+	return best;
+}
+
+// FieldArrays has no destructor
+template<size_t A, size_t C, typename... ids>
+static inline void release( soatl::FieldArrays<A,C,ids...>& arrays ) { arrays.resize(0); }
+template<typename ArraysT>
+static inline void release( ArraysT& ) {}
+
+struct BenchReport
+{
+	std::vector< std::pair<std::string,std::string> > context;
+	std::vector<BenchResult> results;
+
+	static inline std::string json_string(const std::string& s)
+	{
+		std::string r = "\"";
+		for(char c : s)
+		{
+			if( c=='"' || c=='\\' ) { r += '\\'; r += c; }
+			else if( static_cast<unsigned char>(c) < 0x20 ) { r += ' '; }
+			else { r += c; }
+		}
+		return r + "\"";
+	}
+
+	inline void write_json(std::ostream& out) const
+	{
+		out << std::setprecision(9);
+		out << "{\n  \"context\": {";
+		for(size_t i=0;i<context.size();i++)
+		{
+			out << ( i ? ",\n" : "\n" ) << "    " << json_string(context[i].first) << ": " << json_string(context[i].second);
+		}
+		out << "\n  },\n  \"benchmarks\": [";
+		for(size_t i=0;i<results.size();i++)
+		{
+			const BenchResult& r = results[i];
+			out << ( i ? ",\n" : "\n" ) << "    {"
+			    << "\"benchmark\": " << json_string(r.benchmark)
+			    << ", \"container\": " << json_string(r.container)
+			    << ", \"precision\": " << json_string(r.precision)
+			    << ", \"size_class\": " << json_string(r.size_class)
+			    << ", \"elements\": " << r.elements
+			    << ", \"threads\": " << r.threads
+			    << ", \"bytes\": " << r.bytes
+			    << ", \"reps\": " << r.samples.size()
+			    << ", \"inner\": " << r.inner
+			    << ", \"min_ns\": " << r.min()
+			    << ", \"p10_ns\": " << r.percentile(0.1)
+			    << ", \"median_ns\": " << r.median()
+			    << ", \"p90_ns\": " << r.percentile(0.9)
+			    << ", \"max_ns\": " << r.max()
+			    << ", \"mean_ns\": " << r.mean()
+			    << ", \"gbps\": " << r.gbps()
+			    << "}";
+		}
+		out << "\n  ]\n}\n";
+	}
+
+	inline void write_csv(std::ostream& out) const
+	{
+		out << std::setprecision(9);
+		out << "benchmark,container,precision,size_class,elements,threads,bytes,reps,inner,min_ns,p10_ns,median_ns,p90_ns,max_ns,mean_ns,gbps\n";
+		for(const BenchResult& r : results)
+		{
+			out << r.benchmark << ',' << r.container << ',' << r.precision << ',' << r.size_class << ','
+			    << r.elements << ',' << r.threads << ',' << r.bytes << ',' << r.samples.size() << ',' << r.inner << ','
+			    << r.min() << ',' << r.percentile(0.1) << ',' << r.median() << ',' << r.percentile(0.9) << ','
+			    << r.max() << ',' << r.mean() << ',' << r.gbps() << '\n';
+		}
+	}
+
+	inline void write_text(std::ostream& out) const
+	{
+		for(const auto& c : context) { out << c.first << " = " << c.second << '\n'; }
+		out << std::left << std::setw(22) << "benchmark" << std::setw(6) << "cont." << std::setw(8) << "prec." << std::setw(6) << "size"
+		    << std::right << std::setw(11) << "elements" << std::setw(5) << "thr"
+		    << std::setw(14) << "p10 ns" << std::setw(14) << "median ns" << std::setw(14) << "p90 ns" << std::setw(10) << "GB/s" << '\n';
+		out << std::fixed << std::setprecision(1);
+		for(const BenchResult& r : results)
+		{
+			out << std::left << std::setw(22) << r.benchmark << std::setw(6) << r.container << std::setw(8) << r.precision << std::setw(6) << r.size_class
+			    << std::right << std::setw(11) << r.elements << std::setw(5) << r.threads
+			    << std::setw(14) << r.percentile(0.1) << std::setw(14) << r.median() << std::setw(14) << r.percentile(0.9)
+			    << std::setw(10) << std::setprecision(2) << r.gbps() << std::setprecision(1) << '\n';
+		}
+		out << std::defaultfloat;
+	}
+
+	// format is one of "text", "csv" or "json"
+	inline bool write(std::ostream& out, const std::string& format) const
+	{
+		if( format == "json" ) { write_json(out); }
+		else if( format == "csv" ) { write_csv(out); }
+		else if( format == "text" ) { write_text(out); }
+		else { return false; }
+		return true;
+	}
+};
+
+// splits a comma separated list
+static inline std::vector<std::string> split_list(const std::string& s)
+{
+	std::vector<std::string> items;
+	std::istringstream in(s);
+	std::string item;
+	while( std::getline(in,item,',') ) { if( ! item.empty() ) items.push_back(item); }
+	return items;
+}
@@ -0,0 +1,209 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/copy.h"
+#include "soatl/bit_field.h"
+#include "soatl/packed_snapshot.h"
+
+#include "declare_fields.h"
+#include "benchsuite.h"
+
+/*
+Bit fields (see bit_field.h) : a container of positions, an atom type (< 50) and a flag, with the type and the flag
+stored in bytes, then as a 6 bits field and a 1 bit mask. Reports the storage of both containers and the bandwidth of
+a mask producing comparison kernel, a population count and a kernel reading the mask. Also checks partial ranges,
+copies, resizes, snapshots, selection helpers and the parallel drivers.
+usage : soatlbitfieldbenchmark [N] [reps]
+*/
+
+using soatl::read;
+using soatl::write;
+
+template<typename CellT>
+__attribute__((noinline)) void vecreport_byte_mask( CellT& cell )
+{
+	soatl::apply_simd( [](bool& f, unsigned char t, double x) { f = t < 25 && x < 0.5; }, cell, write(particle_flag_byte), read(particle_atype), read(particle_rx) );
+}
+
+template<typename CellT>
+__attribute__((noinline)) void vecreport_bit_mask( CellT& cell )
+{
+	soatl::mask_where( cell, particle_flag, [](unsigned char t, double x) { return t < 25 && x < 0.5; }, particle_atype_b, particle_rx );
+}
+
+template<typename CellT>
+__attribute__((noinline)) size_t vecreport_byte_count( CellT& cell )
+{
+	const bool* __restrict__ f = cell[particle_flag_byte];
+	size_t n = 0;
+	for(size_t i=0;i<cell.size();i++) { n += f[i]; }
+	return n;
+}
+
+template<typename CellT>
+__attribute__((noinline)) size_t vecreport_bit_count( CellT& cell )
+{
+	return soatl::count_set( cell, particle_flag );
+}
+
+template<typename CellT>
+__attribute__((noinline)) void vecreport_byte_masked_update( CellT& cell )
+{
+	soatl::apply_simd( [](double& y, bool f) { y += f ? 0.5 : 0.0; }, cell, readwrite(particle_ry), read(particle_flag_byte) );
+}
+
+template<typename CellT>
+__attribute__((noinline)) void vecreport_bit_masked_update( CellT& cell )
+{
+	soatl::apply_simd( [](double& y, bool f) { y += f ? 0.5 : 0.0; }, cell, readwrite(particle_ry), read(particle_flag) );
+}
+
+static inline void report( const char* name, double bytes_per_element, size_t N, double t )
+{
+	std::cout<<"  "<<std::setw(16)<<std::left<<name<<std::right<<std::fixed<<std::setprecision(3)<<std::setw(7)<<bytes_per_element<<" bytes/element, "
+	         <<std::setprecision(2)<<std::setw(8)<<N*bytes_per_element/t*1.e-9<<" GB/s, "<<std::setw(8)<<N/t*1.e-6<<" Melements/s"<<std::defaultfloat<<std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 1000003;
+	size_t reps = 5;
+	if(argc>=2) { N = atoll(argv[1]); }
+	if(argc>=3) { reps = atoi(argv[2]); }
+
+	bool ok = true;
+
+	auto bytes = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_atype, particle_flag_byte );
+	auto bits = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_atype_b, particle_flag );
+	bytes.resize( N );
+	bits.resize( N );
+
+	std::default_random_engine rng;
+	std::uniform_real_distribution<> rdist(0.0,1.0);
+	std::uniform_int_distribution<> tdist(0,49);
+	auto atype_b = soatl::bit_field( bits, particle_atype_b );
+	for(size_t i=0;i<N;i++)
+	{
+		const double x = rdist(rng), y = rdist(rng), z = rdist(rng);
+		const unsigned char t = tdist(rng);
+		bytes[particle_rx][i] = x; bytes[particle_ry][i] = y; bytes[particle_rz][i] = z; bytes[particle_atype][i] = t;
+		bits[particle_rx][i] = x; bits[particle_ry][i] = y; bits[particle_rz][i] = z; atype_b[i] = t;
+	}
+
+	// storage
+	std::cout<<N<<" elements, 3 double fields, atom type and flag"<<std::endl;
+	std::cout<<"  bytes : "<<bytes.data_size()<<" bytes ("<<double(bytes.data_size())/N<<" per element)"<<std::endl;
+	std::cout<<"  bits  : "<<bits.data_size()<<" bytes ("<<double(bits.data_size())/N<<" per element), "
+	         <<std::setprecision(3)<<100.0*(1.0-double(bits.data_size())/bytes.data_size())<<"% less"<<std::defaultfloat<<std::endl;
+	ok = ok && bits.data_size() < bytes.data_size();
+	ok = ok && bits.allocation_size( 64 ) == 3*64*8 + 64 + 8; // 6 words padded to 64 bytes, then 1 word
+
+	// comparison kernel writing a mask
+	const double tmy = best_time( reps, [&]() { vecreport_byte_mask( bytes ); } );
+	const double tmb = best_time( reps, [&]() { vecreport_bit_mask( bits ); } );
+	// population count
+	size_t ny = 0, nb = 0;
+	const double tcy = best_time( reps, [&]() { ny = vecreport_byte_count( bytes ); } );
+	const double tcb = best_time( reps, [&]() { nb = vecreport_bit_count( bits ); } );
+	// kernel reading a mask
+	const double tuy = best_time( reps, [&]() { vecreport_byte_masked_update( bytes ); } );
+	const double tub = best_time( reps, [&]() { vecreport_bit_masked_update( bits ); } );
+
+	std::cout<<"comparison kernel ( flag = atype < 25 && rx < 0.5 )"<<std::endl;
+	report( "bytes", 8+1+1, N, tmy );
+	report( "bits", 8+(6+1)/8.0, N, tmb );
+	std::cout<<"population count ( "<<nb<<" set )"<<std::endl;
+	report( "bytes", 1, N, tcy );
+	report( "bits", 1/8.0, N, tcb );
+	std::cout<<"masked update ( ry += flag ? 0.5 : 0 )"<<std::endl;
+	report( "bytes", 16+1, N, tuy );
+	report( "bits", 16+1/8.0, N, tub );
+
+	ok = ok && ny == nb && nb > 0 && nb < N;
+	auto flag = soatl::bit_field( bits, particle_flag );
+	for(size_t i=0;i<N;i++)
+	{
+		ok = ok && bool( flag[i] ) == bytes[particle_flag_byte][i] && atype_b[i] == bytes[particle_atype][i] && bits[particle_ry][i] == bytes[particle_ry][i];
+	}
+
+	// partial ranges keep the bits of other elements, non SIMD and parallel drivers give the same results
+	soatl::apply_simd( [](unsigned char& t) { t = 63; }, 37, 100, bits, write(particle_atype_b) );
+	ok = ok && atype_b[36] == bytes[particle_atype][36] && atype_b[37] == 63 && atype_b[136] == 63 && atype_b[137] == bytes[particle_atype][137];
+	soatl::apply( [](unsigned char& t, unsigned char s) { t = s; }, 30, 110, bits, particle_atype_b, read(particle_atype_b) );
+	soatl::parallel_apply( [](unsigned char& t, double x) { t = ( x < 0.5 ) ? 1 : 2; }, 0, N/3, bits, write(particle_atype_b), read(particle_rx) );
+	soatl::parallel_apply_simd( [](unsigned char& t, double x) { t = ( x < 0.5 ) ? 1 : 2; }, N/3, N-N/3, bits, write(particle_atype_b), read(particle_rx) );
+	for(size_t i=0;i<N;i++) { ok = ok && atype_b[i] == ( ( bits[particle_rx][i] < 0.5 ) ? 1 : 2 ); }
+
+	// mask helpers
+	soatl::mask_compare( bits, particle_flag, particle_atype_b, std::equal_to<>(), 1 );
+	ok = ok && soatl::count_set( bits, particle_flag ) == size_t( std::count_if( bits[particle_rx], bits[particle_rx]+N, [](double x) { return x < 0.5; } ) );
+	ok = ok && soatl::count_set( bits, particle_flag, 3, 200 ) == size_t( std::count_if( bits[particle_rx]+3, bits[particle_rx]+203, [](double x) { return x < 0.5; } ) );
+
+	auto sel = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_flag, particle_selected );
+	sel.resize( 100 );
+	soatl::apply_simd( [](double& x, bool& f, bool& s) { x = 0.0; f = false; s = false; }, sel, write(particle_rx), write(particle_flag), write(particle_selected) );
+	soatl::apply( [](double& x, bool& f, bool& s) { x = 1.0; f = true; s = true; }, 70, 30, sel, write(particle_rx), write(particle_flag), write(particle_selected) );
+	sel.resize( 1000 ); // reallocation copies bit planes
+	soatl::apply_simd( [](double& x, bool& f, bool& s) { x = 2.0; f = true; s = false; }, 100, 900, sel, write(particle_rx), write(particle_flag), write(particle_selected) );
+	soatl::mask_compare( sel, particle_selected, particle_rx, std::less<>(), 1.5 );
+	std::vector<size_t> both, expected;
+	soatl::mask_and( sel, particle_selected, particle_flag, particle_selected ); // elements 70 to 99
+	soatl::select_indices( sel, particle_selected, both );
+	for(size_t i=70;i<100;i++) { expected.push_back( i ); }
+	ok = ok && both == expected;
+	soatl::mask_andnot( sel, particle_selected, particle_flag, particle_selected ); // elements 100 to 999
+	ok = ok && soatl::count_set( sel, particle_selected ) == 900;
+	soatl::mask_or( sel, particle_selected, particle_selected, particle_flag ); // elements 70 to 999
+	ok = ok && soatl::count_set( sel, particle_selected ) == 930;
+
+	auto dst = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_flag, particle_selected );
+	soatl::apply_simd( [](bool& s, double x) { s = x > 1.5; }, sel, write(particle_selected), read(particle_rx) );
+	soatl::select_copy( dst, sel, particle_selected, particle_rx, particle_flag );
+	ok = ok && dst.size() == 900 && dst[particle_rx][0] == 2.0 && dst[particle_rx][899] == 2.0 && soatl::count_set( dst, particle_flag ) == 900;
+
+	// copy of an unaligned range
+	dst.resize( 1000 );
+	soatl::apply_simd( [](bool& f) { f = false; }, dst, write(particle_flag) );
+	soatl::copy( dst, sel, 65, 20, soatl::bit_planes(particle_flag) );
+	ok = ok && soatl::count_set( dst, particle_flag ) == 15 && soatl::count_set( dst, particle_flag, 70, 15 ) == 15;
+	soatl::parallel_copy( dst, sel, soatl::bit_planes(particle_flag) );
+	ok = ok && soatl::count_set( dst, particle_flag ) == 930;
+
+	// snapshot written at capacity 1024 and read at capacity 1008, bit planes are read stripe by stripe
+	auto snap = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_atype_b, particle_flag );
+	snap.resize( 1024 );
+	soatl::apply_simd( [](double& x, unsigned char& t, bool& f) { x = 0.0; t = 0; f = false; }, snap, write(particle_rx), write(particle_atype_b), write(particle_flag) );
+	snap.resize( 1000 );
+	auto snap_atype = soatl::bit_field( snap, particle_atype_b );
+	auto snap_flag = soatl::bit_field( snap, particle_flag );
+	for(size_t i=0;i<snap.size();i++) { snap[particle_rx][i] = i; snap_atype[i] = i % 50; snap_flag[i] = ( i % 3 ) == 0; }
+	const std::string filename = "bitfield_snapshot.dat";
+	ok = ok && snap.capacity() == 1024 && soatl::write_snapshot( filename, snap );
+	auto loaded = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_atype_b, particle_flag );
+	ok = ok && soatl::read_snapshot( filename, loaded ) && loaded.size() == 1000 && loaded.capacity() == 1008;
+	auto loaded_atype = soatl::bit_field( loaded, particle_atype_b );
+	auto loaded_flag = soatl::bit_field( loaded, particle_flag );
+	for(size_t i=0;i<loaded.size();i++) { ok = ok && loaded[particle_rx][i] == i && loaded_atype[i] == i % 50 && bool( loaded_flag[i] ) == ( ( i % 3 ) == 0 ); }
+	ok = ok && soatl::count_set( loaded, particle_flag ) == 334;
+	std::remove( filename.c_str() );
+
+	sel.resize( 0 );
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
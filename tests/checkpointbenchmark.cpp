@@ -0,0 +1,199 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <random>
+#include <cmath>
+#include <chrono>
+#include <vector>
+
+#include <unistd.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/copy.h"
+#include "soatl/serialize.h"
+#include "soatl/checkpoint.h"
+
+#include "declare_fields.h"
+
+using soatl::read;
+using soatl::readwrite;
+
+// particles on a lattice, sorted by cell, with small velocities
+template<typename ArraysT>
+static inline void initialize( ArraysT& cell, size_t N )
+{
+	std::default_random_engine gen( 0 );
+	std::uniform_real_distribution<> rdist(-0.05,0.05);
+	std::normal_distribution<> vdist(0.0,0.01);
+	const size_t side = std::ceil( std::cbrt( double(N) ) );
+	cell.resize(N);
+	for(size_t i=0;i<N;i++)
+	{
+		cell[particle_rx][i] = ( i % side ) + rdist(gen);
+		cell[particle_ry][i] = ( (i/side) % side ) + rdist(gen);
+		cell[particle_rz][i] = ( i/(side*side) ) + rdist(gen);
+		cell[particle_vx][i] = vdist(gen);
+		cell[particle_vy][i] = vdist(gen);
+		cell[particle_vz][i] = vdist(gen);
+		cell[particle_e][i] = 0.0;
+		cell[particle_atype][i] = ( i / 1000 ) % 4;
+		cell[particle_mid][i] = i / 3;
+	}
+}
+
+// read only analysis (a few tens of flops per particle), followed by a position update
+template<typename ArraysT>
+static inline double analysis( ArraysT& cell )
+{
+	double sum = 0.0;
+	soatl::apply_simd( [&sum](double x, double y, double z, double vx, double vy, double vz)
+		{
+			const double r2 = x*x + y*y + z*z;
+			double s = 0.5 * ( vx*vx + vy*vy + vz*vz );
+			for(int k=1;k<=8;k++) { s += 1.0 / std::sqrt( r2 + k ); }
+			sum += s;
+		}
+		, cell, read(particle_rx), read(particle_ry), read(particle_rz), read(particle_vx), read(particle_vy), read(particle_vz) );
+	return sum;
+}
+
+template<typename ArraysT>
+static inline void update( ArraysT& cell )
+{
+	const double dt = 0.1;
+	soatl::apply_simd( [dt](double& x, double& y, double& z, double vx, double vy, double vz) { x += dt*vx; y += dt*vy; z += dt*vz; }
+	                 , cell, readwrite(particle_rx), readwrite(particle_ry), readwrite(particle_rz), read(particle_vx), read(particle_vy), read(particle_vz) );
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 2000000;
+	size_t nsteps = 12;
+	size_t period = 3;
+	if(argc>=2) { N = atoi(argv[1]); }
+	if(argc>=3) { nsteps = atoi(argv[2]); }
+
+	auto make_cell = []() { return soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(),
+		particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_e, particle_atype, particle_mid ); };
+	using clock = std::chrono::high_resolution_clock;
+	auto seconds = [](clock::duration d) { return std::chrono::duration<double>(d).count(); };
+
+	std::cout<<"N="<<N<<", steps="<<nsteps<<", checkpoint every "<<period<<" steps"<<std::endl;
+
+	// synchronous write of the self describing format
+	double sync_stall = 0.0, sync_total = 0.0;
+	size_t sync_bytes = 0;
+	{
+		auto cell = make_cell();
+		initialize( cell, N );
+		auto t1 = clock::now();
+		for(size_t step=0;step<nsteps;step++)
+		{
+			if( step % period == 0 )
+			{
+				auto c1 = clock::now();
+				std::ofstream out( "checkpoint_sync.dat", std::ios::binary );
+				soatl::write( out, cell );
+				sync_bytes = out.tellp();
+				out.close();
+				sync_stall += seconds( clock::now() - c1 );
+			}
+			analysis( cell );
+			update( cell );
+		}
+		sync_total = seconds( clock::now() - t1 );
+	}
+
+	// asynchronous checkpoints, detached right before positions are modified
+	double async_stall = 0.0, async_total = 0.0;
+	std::vector<soatl::CheckpointHandle> handles;
+	auto last = make_cell();
+	bool ok = true;
+	{
+		soatl::CheckpointWriter writer;
+		auto cell = make_cell();
+		initialize( cell, N );
+		auto t1 = clock::now();
+		for(size_t step=0;step<nsteps;step++)
+		{
+			soatl::CheckpointHandle handle;
+			if( step % period == 0 )
+			{
+				auto c1 = clock::now();
+				handle = writer.submit( "checkpoint_" + std::to_string(handles.size()) + ".dat", cell );
+				async_stall += seconds( clock::now() - c1 );
+				handles.push_back( handle );
+				last.resize( cell.size() );
+				soatl::copy( last, cell );
+			}
+			analysis( cell );
+			auto c2 = clock::now();
+			handle.detach();
+			async_stall += seconds( clock::now() - c2 );
+			update( cell );
+		}
+		for(auto& h : handles) { ok = ok && h.wait(); }
+		async_total = seconds( clock::now() - t1 );
+	}
+
+	soatl::CheckpointStats total;
+	for(auto& h : handles)
+	{
+		total.raw_bytes += h.stats().raw_bytes;
+		total.file_bytes += h.stats().file_bytes;
+		total.encode_time += h.stats().encode_time;
+		total.write_time += h.stats().write_time;
+	}
+
+	// last checkpoint is read back and compared to the state it was taken from
+	{
+		auto check = soatl::make_field_arrays( particle_mid, particle_rz, particle_ry, particle_rx, particle_atype, particle_e, particle_vz, particle_vy, particle_vx );
+		ok = ok && soatl::read_checkpoint( "checkpoint_" + std::to_string(handles.size()-1) + ".dat", check ) && check.size() == N;
+		for(size_t i=0;i<N && ok;i++)
+		{
+			ok = check[particle_rx][i]==last[particle_rx][i] && check[particle_ry][i]==last[particle_ry][i] && check[particle_rz][i]==last[particle_rz][i]
+			  && check[particle_vx][i]==last[particle_vx][i] && check[particle_vy][i]==last[particle_vy][i] && check[particle_vz][i]==last[particle_vz][i]
+			  && check[particle_e][i]==last[particle_e][i] && check[particle_atype][i]==last[particle_atype][i] && check[particle_mid][i]==last[particle_mid][i];
+		}
+	}
+
+	// incompressible values, element count not a multiple of the RLE literal length
+	{
+		const size_t n = soatl::CHECKPOINT_BLOCK_SIZE + 1;
+		std::default_random_engine gen( 1 );
+		std::uniform_real_distribution<> rdist(0.0,1.0);
+		auto noise = soatl::make_field_arrays( particle_e );
+		auto check = soatl::make_field_arrays( particle_e );
+		noise.resize( n );
+		for(size_t i=0;i<n;i++) { noise[particle_e][i] = rdist(gen); }
+		soatl::CheckpointWriter writer;
+		ok = ok && writer.submit( "checkpoint_noise.dat", noise ).wait();
+		ok = ok && soatl::read_checkpoint( "checkpoint_noise.dat", check ) && check.size() == n;
+		for(size_t i=0;i<n && ok;i++) { ok = check[particle_e][i] == noise[particle_e][i]; }
+		unlink( "checkpoint_noise.dat" );
+	}
+
+	const size_t ncheckpoints = handles.size();
+	std::cout<<std::fixed<<std::setprecision(3);
+	std::cout<<"checkpoints            : "<<ncheckpoints<<" x "<<total.raw_bytes/ncheckpoints<<" bytes"<<std::endl;
+	std::cout<<"compression ratio      : "<<total.compression_ratio()<<" (synchronous file "<<sync_bytes<<" bytes)"<<std::endl;
+	std::cout<<"background bandwidth   : "<<total.raw_bytes*1.e-9/(total.encode_time+total.write_time)<<" GB/s (encode "<<total.encode_time<<" s, write "<<total.write_time<<" s)"<<std::endl;
+	std::cout<<"stall per checkpoint   : sync "<<sync_stall*1.e3/ncheckpoints<<" ms, async "<<async_stall*1.e3/ncheckpoints<<" ms"<<std::endl;
+	std::cout<<"total time             : sync "<<sync_total<<" s, async "<<async_total<<" s"<<std::endl;
+
+	unlink( "checkpoint_sync.dat" );
+	for(size_t i=0;i<ncheckpoints;i++) { unlink( ( "checkpoint_" + std::to_string(i) + ".dat" ).c_str() ); }
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
+
@@ -0,0 +1,149 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/serialize.h"
+#include "soatl/column_io.h"
+
+#include "declare_fields.h"
+
+// asks the kernel to drop the file from the page cache, to time loads from disk (best effort)
+static inline void evict_file( const std::string& filename )
+{
+	int fd = open( filename.c_str(), O_RDONLY );
+	if( fd < 0 ) return;
+	fdatasync( fd );
+	posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+	close( fd );
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 4000000;
+	std::string filename = "column_fields.dat";
+	if(argc>=2) { N = atoi(argv[1]); }
+	if(argc>=3) { filename = argv[2]; }
+
+	auto make_cell = []() { return soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(),
+		particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_fx, particle_fy, particle_fz, particle_e, particle_mid, particle_offset ); };
+
+	auto cell = make_cell();
+	cell.resize(N);
+	{
+		std::default_random_engine gen( 0 );
+		std::uniform_real_distribution<> rdist(0.0,1.0);
+		for(size_t i=0;i<N;i++)
+		{
+			cell[particle_rx][i] = rdist(gen); cell[particle_ry][i] = rdist(gen); cell[particle_rz][i] = rdist(gen);
+			cell[particle_vx][i] = rdist(gen); cell[particle_vy][i] = rdist(gen); cell[particle_vz][i] = rdist(gen);
+			cell[particle_fx][i] = rdist(gen); cell[particle_fy][i] = rdist(gen); cell[particle_fz][i] = rdist(gen);
+			cell[particle_e][i] = rdist(gen);
+			cell[particle_mid][i] = i / 3;
+			cell[particle_offset][i] = i;
+		}
+	}
+
+	using clock = std::chrono::high_resolution_clock;
+	auto milliseconds = [](clock::duration d) { return std::chrono::duration<double,std::milli>(d).count(); };
+
+	bool ok = true;
+	double write_time = 0.0, save_time = 0.0;
+	{
+		auto t1 = clock::now();
+		std::ofstream out( filename, std::ios::binary | std::ios::trunc );
+		ok = ok && soatl::write( out, cell );
+		out.close();
+		write_time = milliseconds( clock::now() - t1 );
+		t1 = clock::now();
+		ok = ok && soatl::save( filename, cell );
+		save_time = milliseconds( clock::now() - t1 );
+	}
+	std::cout<<"N="<<N<<", file size="<<N*88/(1<<20)<<" MB, 12 fields"<<std::endl;
+
+	auto check_positions = [&](const auto& arrays)
+	{
+		ok = ok && arrays.size() == N;
+		for(size_t i=0;i<N && ok;i++) { ok = arrays[particle_rx][i]==cell[particle_rx][i] && arrays[particle_ry][i]==cell[particle_ry][i] && arrays[particle_rz][i]==cell[particle_rz][i]; }
+	};
+	auto check_all = [&](const auto& arrays)
+	{
+		check_positions( arrays );
+		for(size_t i=0;i<N && ok;i++)
+		{
+			ok = arrays[particle_vx][i]==cell[particle_vx][i] && arrays[particle_vy][i]==cell[particle_vy][i] && arrays[particle_vz][i]==cell[particle_vz][i]
+			  && arrays[particle_fx][i]==cell[particle_fx][i] && arrays[particle_fy][i]==cell[particle_fy][i] && arrays[particle_fz][i]==cell[particle_fz][i]
+			  && arrays[particle_e][i]==cell[particle_e][i] && arrays[particle_mid][i]==cell[particle_mid][i] && arrays[particle_offset][i]==cell[particle_offset][i];
+		}
+	};
+
+	// load time in ms, with the file in the page cache (best of 3, warm) and evicted from it (cold).
+	// targets are reused, so that page faults of their first touch are not timed, checks are not timed either.
+	auto time_load = [&](bool cold, auto& target, auto load_func, auto check_func)
+	{
+		load_func( target );
+		double t = 1.e30;
+		for(int r=0;r<(cold?1:3);r++)
+		{
+			if( cold ) { evict_file( filename ); }
+			auto t1 = clock::now();
+			load_func( target );
+			t = std::min( t, milliseconds( clock::now() - t1 ) );
+			check_func( target );
+		}
+		return t;
+	};
+
+	// full loads into a container of another layout, and loads of rx,ry,rz only into a container of 3 fields
+	auto all = soatl::make_packed_field_arrays( particle_offset, particle_mid, particle_e, particle_fz, particle_fy, particle_fx, particle_vz, particle_vy, particle_vx, particle_rz, particle_ry, particle_rx );
+	auto positions = soatl::make_packed_field_arrays( particle_rx, particle_ry, particle_rz );
+	auto read_func = [&](auto& arrays) { std::ifstream in( filename, std::ios::binary ); ok = ok && soatl::read( in, arrays ); };
+	auto load_func = [&](auto& arrays) { ok = ok && soatl::load( filename, arrays ); };
+
+	const double read_all_warm = time_load( false, all, read_func, check_all ), read_all_cold = time_load( true, all, read_func, check_all );
+	const double load_all_warm = time_load( false, all, load_func, check_all ), load_all_cold = time_load( true, all, load_func, check_all );
+	const double read_pos_warm = time_load( false, positions, read_func, check_positions ), read_pos_cold = time_load( true, positions, read_func, check_positions );
+	const double load_pos_warm = time_load( false, positions, load_func, check_positions ), load_pos_cold = time_load( true, positions, load_func, check_positions );
+
+	std::cout<<std::fixed<<std::setprecision(2);
+	std::cout<<"write "<<write_time<<" ms, save "<<save_time<<" ms"<<std::endl;
+	std::cout<<std::setw(32)<<"load"<<std::setw(12)<<"warm (ms)"<<std::setw(12)<<"cold (ms)"<<std::endl;
+	std::cout<<std::setw(32)<<"read, 12 fields"<<std::setw(12)<<read_all_warm<<std::setw(12)<<read_all_cold<<std::endl;
+	std::cout<<std::setw(32)<<"load, 12 fields"<<std::setw(12)<<load_all_warm<<std::setw(12)<<load_all_cold<<std::endl;
+	std::cout<<std::setw(32)<<"read, 3 fields"<<std::setw(12)<<read_pos_warm<<std::setw(12)<<read_pos_cold<<std::endl;
+	std::cout<<std::setw(32)<<"load, 3 fields"<<std::setw(12)<<load_pos_warm<<std::setw(12)<<load_pos_cold<<std::endl;
+
+	// subset into a container holding other fields too, and subset saves
+	{
+		auto arrays = soatl::make_packed_field_arrays( particle_e_f, particle_rz, particle_ry, particle_rx );
+		ok = ok && soatl::load( filename, arrays, particle_rx, particle_ry, particle_rz );
+		check_positions( arrays );
+		ok = ok && soatl::save( filename, arrays, particle_rx, particle_ry, particle_rz );
+		auto reloaded = soatl::make_field_arrays( particle_rx, particle_ry, particle_rz );
+		ok = ok && soatl::load( filename, reloaded );
+		check_positions( reloaded );
+	}
+
+	// missing field is detected
+	{
+		auto arrays = soatl::make_field_arrays( particle_rx, particle_e );
+		ok = ok && ! soatl::load( filename, arrays );
+	}
+
+	unlink( filename.c_str() );
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
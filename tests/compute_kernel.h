@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cmath>
+
+// kernel of benchmark.cpp, with ax,ay,az the reference position, x,y,z a particle position and d the result
+#define COMPUTE_KERNEL \
+  x = x - ax; \
+	y = y - ay; \
+	z = z - az; \
+	d = std::sqrt( x*x + y*y + z*z ); \
+	x /= d; \
+	y /= d; \
+	z /= d; \
+	d += x/(y*z)
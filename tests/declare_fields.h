@@ -1,6 +1,7 @@
 #pragma once
 
 #include "soatl/field_descriptor.h"
+#include "soatl/field_encoding.h"
 
 #define SOATL_DECLARE_FIELD(__type,__name,__desc) \
 struct __name##_id {}; \
@@ -12,6 +13,39 @@ template<> struct FieldDescriptor<__name##_id> { \
 }; } \
 soatl::FieldDescriptor<__name##_id> __name
 
+#define SOATL_DECLARE_VECTOR_FIELD(__type,__components,__name,__desc) \
+struct __name##_id {}; \
+namespace soatl { \
+template<> struct FieldDescriptor<__name##_id> { \
+	using value_type = __type; \
+	using Id = __name##_id; \
+	static constexpr size_t components = __components; \
+	static const char* name() { return __desc ; } \
+}; } \
+soatl::VectorFieldId<__name##_id> __name
+
+#define SOATL_DECLARE_ENCODED_FIELD(__encoding,__name,__desc) \
+struct __name##_id {}; \
+namespace soatl { \
+template<> struct FieldDescriptor<__name##_id> { \
+	using encoding = __encoding; \
+	using value_type = encoding::stored_type; \
+	using Id = __name##_id; \
+	static const char* name() { return __desc ; } \
+}; } \
+soatl::FieldDescriptor<__name##_id> __name
+
+#define SOATL_DECLARE_BIT_FIELD(__type,__bits,__name,__desc) \
+struct __name##_id {}; \
+namespace soatl { \
+template<> struct FieldDescriptor<__name##_id> { \
+	using value_type = __type; \
+	using Id = __name##_id; \
+	static constexpr size_t bits = __bits; \
+	static const char* name() { return __desc ; } \
+}; } \
+soatl::BitFieldId<__name##_id> __name
+
 SOATL_DECLARE_FIELD(double	,particle_rx	,"Particle position X");
 SOATL_DECLARE_FIELD(double	,particle_ry	,"Particle position Y");
 SOATL_DECLARE_FIELD(double	,particle_rz	,"Particle position Z");
@@ -21,12 +55,44 @@ SOATL_DECLARE_FIELD(int32_t	,particle_mid	,"Particle molecule id");
 SOATL_DECLARE_FIELD(float	,particle_dist	,"Particle pair distance");
 SOATL_DECLARE_FIELD(int16_t	,particle_tmp1	,"Particle Temporary 1");
 SOATL_DECLARE_FIELD(int8_t	,particle_tmp2	,"Particle Temporary 2");
+SOATL_DECLARE_FIELD(double	,particle_vx	,"Particle velocity X");
+SOATL_DECLARE_FIELD(double	,particle_vy	,"Particle velocity Y");
+SOATL_DECLARE_FIELD(double	,particle_vz	,"Particle velocity Z");
+SOATL_DECLARE_FIELD(double	,particle_fx	,"Particle force X");
+SOATL_DECLARE_FIELD(double	,particle_fy	,"Particle force Y");
+SOATL_DECLARE_FIELD(double	,particle_fz	,"Particle force Z");
+SOATL_DECLARE_FIELD(uint32_t	,particle_offset	,"Particle offset");
 
 SOATL_DECLARE_FIELD(float	,particle_rx_f	,"Particle position X (single precision)");
 SOATL_DECLARE_FIELD(float	,particle_ry_f	,"Particle position Y (single precision)");
 SOATL_DECLARE_FIELD(float	,particle_rz_f	,"Particle position Z (single precision)");
 SOATL_DECLARE_FIELD(float	,particle_e_f	,"Particle energy (single precision)");
 
+SOATL_DECLARE_VECTOR_FIELD(double	,3	,particle_r	,"Particle position");
+SOATL_DECLARE_VECTOR_FIELD(double	,3	,particle_v	,"Particle velocity");
+SOATL_DECLARE_VECTOR_FIELD(float	,3	,particle_r_f	,"Particle position (single precision)");
+
+SOATL_DECLARE_FIELD(bool	,particle_flag_byte	,"Particle flag (byte)");
+SOATL_DECLARE_BIT_FIELD(bool	,1	,particle_flag	,"Particle flag");
+SOATL_DECLARE_BIT_FIELD(bool	,1	,particle_selected	,"Particle selected");
+SOATL_DECLARE_BIT_FIELD(unsigned char	,6	,particle_atype_b	,"Particle atom type (6 bits)");
+
+using double_as_float = soatl::NarrowEncoding<float,double>;
+using double_as_half = soatl::HalfEncoding<double>;
+using double_as_fixed_point = soatl::FixedPointEncoding<int32_t,double,-24>;
+SOATL_DECLARE_ENCODED_FIELD(double_as_float	,particle_rx_sf	,"Particle position X (double stored as float)");
+SOATL_DECLARE_ENCODED_FIELD(double_as_float	,particle_ry_sf	,"Particle position Y (double stored as float)");
+SOATL_DECLARE_ENCODED_FIELD(double_as_float	,particle_rz_sf	,"Particle position Z (double stored as float)");
+SOATL_DECLARE_ENCODED_FIELD(double_as_half	,particle_rx_h	,"Particle position X (double stored as half)");
+SOATL_DECLARE_ENCODED_FIELD(double_as_half	,particle_ry_h	,"Particle position Y (double stored as half)");
+SOATL_DECLARE_ENCODED_FIELD(double_as_half	,particle_rz_h	,"Particle position Z (double stored as half)");
+SOATL_DECLARE_ENCODED_FIELD(double_as_fixed_point	,particle_rx_q	,"Particle position X (fixed point)");
+SOATL_DECLARE_ENCODED_FIELD(double_as_fixed_point	,particle_ry_q	,"Particle position Y (fixed point)");
+SOATL_DECLARE_ENCODED_FIELD(double_as_fixed_point	,particle_rz_q	,"Particle position Z (fixed point)");
+
 #undef SOATL_DECLARE_FIELD
+#undef SOATL_DECLARE_ENCODED_FIELD
+#undef SOATL_DECLARE_VECTOR_FIELD
+#undef SOATL_DECLARE_BIT_FIELD
 
 
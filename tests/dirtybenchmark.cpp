@@ -0,0 +1,176 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <vector>
+
+#include <unistd.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/copy.h"
+#include "soatl/serialize.h"
+#include "soatl/tracked_field_arrays.h"
+
+#include "declare_fields.h"
+
+using soatl::read;
+using soatl::readwrite;
+
+// moves particles of random ranges of 1000 elements, until a fraction rate of the particles has moved
+template<typename ArraysT>
+static inline void modify( ArraysT& cell, double rate, std::default_random_engine& gen )
+{
+	const size_t N = cell.size();
+	const size_t range = 1000;
+	const size_t nranges = std::max( size_t(1), static_cast<size_t>( rate * N / range ) );
+	std::uniform_int_distribution<size_t> start( 0, N > range ? N - range : 0 );
+	auto move = [](double& x, double& y, double& z, double vx, double vy, double vz) { x += 0.01*vx; y += 0.01*vy; z += 0.01*vz; };
+	if( rate >= 1.0 )
+	{
+		soatl::apply_simd( move, cell, readwrite(particle_rx), readwrite(particle_ry), readwrite(particle_rz), read(particle_vx), read(particle_vy), read(particle_vz) );
+		return;
+	}
+	for(size_t r=0;r<nranges;r++)
+	{
+		const size_t first = start(gen) & ~size_t(15); // aligned on chunks
+		soatl::apply_simd( move, first, std::min(range,N-first), cell, readwrite(particle_rx), readwrite(particle_ry), readwrite(particle_rz), read(particle_vx), read(particle_vy), read(particle_vz) );
+	}
+}
+
+template<typename ArraysA, typename ArraysB>
+static inline bool same( const ArraysA& a, const ArraysB& b )
+{
+	if( a.size() != b.size() ) return false;
+	for(size_t i=0;i<a.size();i++)
+	{
+		if( a[particle_rx][i]!=b[particle_rx][i] || a[particle_ry][i]!=b[particle_ry][i] || a[particle_rz][i]!=b[particle_rz][i]
+		 || a[particle_vx][i]!=b[particle_vx][i] || a[particle_vy][i]!=b[particle_vy][i] || a[particle_vz][i]!=b[particle_vz][i] || a[particle_e][i]!=b[particle_e][i] ) return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 4000000;
+	if(argc>=2) { N = atoi(argv[1]); }
+
+	auto cell = soatl::make_tracked_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(),
+		particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_e );
+	auto make_copy = []() { return soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(),
+		particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_e ); };
+
+	std::default_random_engine gen( 0 );
+	{
+		std::uniform_real_distribution<> rdist(-1.0,1.0);
+		cell.resize( N );
+		for(size_t i=0;i<N;i++)
+		{
+			cell[particle_rx][i] = rdist(gen); cell[particle_ry][i] = rdist(gen); cell[particle_rz][i] = rdist(gen);
+			cell[particle_vx][i] = rdist(gen); cell[particle_vy][i] = rdist(gen); cell[particle_vz][i] = rdist(gen);
+			cell[particle_e][i] = 0.0;
+		}
+	}
+
+	bool ok = true;
+	auto mirror = make_copy();
+	auto full = make_copy();
+	const std::string base_file = "dirty_base.dat", delta_file = "dirty_delta.dat", full_file = "dirty_full.dat";
+
+	// mirror and base checkpoint, everything is dirty after initialization
+	ok = ok && soatl::incremental_copy( mirror, cell ) == N * 7 * sizeof(double);
+	{
+		std::ofstream out( base_file, std::ios::binary | std::ios::trunc );
+		ok = ok && soatl::write( out, cell );
+	}
+	cell.clear_dirty();
+	std::ofstream delta( delta_file, std::ios::binary | std::ios::trunc );
+
+	using clock = std::chrono::high_resolution_clock;
+	auto milliseconds = [](clock::duration d) { return std::chrono::duration<double,std::milli>(d).count(); };
+	const double full_mb = N * 7 * sizeof(double) / double(1<<20);
+
+	std::cout<<"N="<<N<<", 7 fields, "<<cell.block_count()<<" blocks of "<<cell.BlockSize<<" elements per field, modifications by ranges of 1000 elements"<<std::endl;
+	std::cout<<std::setw(8)<<"rate"<<std::setw(10)<<"dirty"
+	         <<std::setw(14)<<"copy MB"<<std::setw(12)<<"copy ms"<<std::setw(14)<<"incr. MB"<<std::setw(12)<<"incr. ms"
+	         <<std::setw(14)<<"write MB"<<std::setw(12)<<"write ms"<<std::setw(14)<<"incr. MB"<<std::setw(12)<<"incr. ms"<<std::endl;
+	std::cout<<std::fixed<<std::setprecision(2);
+
+	for(double rate : { 0.01, 0.1, 1.0 })
+	{
+		// halo refresh like copies
+		modify( cell, rate, gen );
+		const double dirty = cell.dirty_block_count(particle_rx) * 100.0 / cell.block_count();
+		auto t1 = clock::now();
+		full.resize( N );
+		soatl::copy( full, cell );
+		const double copy_time = milliseconds( clock::now() - t1 );
+		t1 = clock::now();
+		const size_t copied = soatl::incremental_copy( mirror, cell );
+		const double incr_copy_time = milliseconds( clock::now() - t1 );
+		ok = ok && same( mirror, cell );
+
+		// checkpoints
+		modify( cell, rate, gen );
+		t1 = clock::now();
+		size_t written = 0;
+		{
+			std::ofstream out( full_file, std::ios::binary | std::ios::trunc );
+			ok = ok && soatl::write( out, cell );
+			written = out.tellp();
+		}
+		const double write_time = milliseconds( clock::now() - t1 );
+		const size_t delta_start = delta.tellp();
+		t1 = clock::now();
+		ok = ok && soatl::write_incremental( delta, cell );
+		delta.flush();
+		const double incr_write_time = milliseconds( clock::now() - t1 );
+		const size_t delta_bytes = static_cast<size_t>( delta.tellp() ) - delta_start;
+
+		std::cout<<std::setw(7)<<rate*100<<"%"<<std::setw(9)<<dirty<<"%"
+		         <<std::setw(14)<<full_mb<<std::setw(12)<<copy_time<<std::setw(14)<<copied/double(1<<20)<<std::setw(12)<<incr_copy_time
+		         <<std::setw(14)<<written/double(1<<20)<<std::setw(12)<<write_time<<std::setw(14)<<delta_bytes/double(1<<20)<<std::setw(12)<<incr_write_time<<std::endl;
+		ok = ok && cell.dirty_block_count(particle_rx) == 0;
+
+		// dirty bits are shared by all consumers : the mirror did not see the changes written to the checkpoint
+		soatl::copy( mirror, cell );
+	}
+	delta.close();
+
+	// base checkpoint followed by increments gives the current state. the untouched energy field has no dirty range.
+	{
+		auto restored = make_copy();
+		std::ifstream base( base_file, std::ios::binary );
+		std::ifstream in( delta_file, std::ios::binary );
+		ok = ok && soatl::read( base, restored );
+		for(int k=0;k<3;k++) { ok = ok && soatl::read_incremental( in, restored ); }
+		ok = ok && same( restored, cell );
+	}
+
+	// manual marking, and the mirror sees writes made through copy
+	{
+		cell[particle_e][N/2] = 1.0;
+		cell.mark_dirty( particle_e, N/2, 1 );
+		ok = ok && cell.dirty_block_count(particle_e) == 1 && cell.dirty_block_count(particle_rx) == 0;
+		ok = ok && soatl::incremental_copy( mirror, cell ) == std::min( N, ( N/2/cell.BlockSize + 1 ) * cell.BlockSize ) * sizeof(double) - ( N/2/cell.BlockSize ) * cell.BlockSize * sizeof(double);
+		ok = ok && same( mirror, cell );
+		soatl::copy( cell, full, 0, 10, particle_vx );
+		ok = ok && cell.dirty_block_count(particle_vx) == 1;
+		cell.resize( N + 1 );
+		ok = ok && cell.dirty_block_count(particle_e) == 1 && cell.is_dirty( particle_e, N / cell.BlockSize );
+	}
+
+	unlink( base_file.c_str() );
+	unlink( delta_file.c_str() );
+	unlink( full_file.c_str() );
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute_indexed.h"
+
+#include "declare_fields.h"
+#include "benchsuite.h"
+
+std::default_random_engine rng;
+
+int main(int argc, char* argv[])
+{
+	size_t N = 4000000;
+	int seed = 0;
+	if(argc>=2) { N = atoi(argv[1]); }
+	if(argc>=3) { seed = atoi(argv[2]); }
+	rng.seed( seed );
+
+	auto rx = particle_rx;
+	auto ry = particle_ry;
+	auto rz = particle_rz;
+	auto e = particle_e;
+
+	auto arrays = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), rx, ry, rz, e );
+	arrays.resize(N);
+	std::uniform_real_distribution<> rdist(0.0,1.0);
+	for(size_t i=0;i<N;i++)
+	{
+		arrays[rx][i] = rdist(rng);
+		arrays[ry][i] = rdist(rng);
+		arrays[rz][i] = rdist(rng);
+		arrays[e][i] = 0.0;
+	}
+
+	// a quarter of the particles, in random order, sorted (with gaps), and as runs of consecutive particles (e.g. cell boundaries)
+	const size_t count = N / 4;
+	std::vector<uint32_t> all(N);
+	std::iota( all.begin(), all.end(), 0 );
+	std::shuffle( all.begin(), all.end(), rng );
+	std::vector<uint32_t> random_indices( all.begin(), all.begin()+count );
+	std::vector<uint32_t> sorted_indices( random_indices );
+	std::sort( sorted_indices.begin(), sorted_indices.end() );
+	std::vector<uint32_t> runs_indices;
+	for(size_t start=0; runs_indices.size()<count; start+=1024)
+	{
+		for(size_t i=start; i<start+256 && i<N && runs_indices.size()<count; i++) { runs_indices.push_back(i); }
+	}
+
+	const double ax=0.5, ay=0.5, az=0.5;
+	auto kernel = [ax,ay,az](double& d, double x, double y, double z)
+	{
+		x -= ax; y -= ay; z -= az;
+		d += 1.0 / std::sqrt( x*x + y*y + z*z );
+	};
+
+	std::cout<<"SIMD arch="<<soatl::simd_arch()<<", N="<<N<<", count="<<count<<", times in ns per index"<<std::endl;
+	std::cout<<std::setw(10)<<"pattern"<<std::setw(12)<<"scalar"<<std::setw(12)<<"indexed"<<std::setw(12)<<"no_pf"<<std::setw(12)<<"parallel"<<std::endl;
+
+	const char* names[3] = { "random", "sorted", "runs" };
+	const std::vector<uint32_t>* lists[3] = { &random_indices, &sorted_indices, &runs_indices };
+	const size_t reps = 5;
+	bool ok = true;
+	for(int p=0;p<3;p++)
+	{
+		const uint32_t* idx = lists[p]->data();
+		const size_t n = lists[p]->size();
+		double* __restrict__ d = arrays[e];
+		const double* __restrict__ x = arrays[rx];
+		const double* __restrict__ y = arrays[ry];
+		const double* __restrict__ z = arrays[rz];
+
+		auto scalar = [&]() { for(size_t k=0;k<n;k++) { kernel( d[idx[k]], x[idx[k]], y[idx[k]], z[idx[k]] ); } };
+		auto indexed = [&]() { soatl::apply_indexed( kernel, idx, n, arrays, soatl::readwrite(e), soatl::read(rx), soatl::read(ry), soatl::read(rz) ); };
+		auto nopf = [&]() { soatl::apply_indexed( kernel, idx, n, soatl::cst::prefetch<0>(), arrays, e, rx, ry, rz ); };
+		auto parallel = [&]() { soatl::parallel_apply_indexed( kernel, idx, n, arrays, soatl::readwrite(e), soatl::read(rx), soatl::read(ry), soatl::read(rz) ); };
+
+		// check each variant against one pass of the scalar loop
+		std::fill( d, d+N, 0.0 );
+		scalar();
+		std::vector<double> ref( d, d+N );
+		auto same_as_scalar = [&]( auto variant )
+		{
+			std::fill( d, d+N, 0.0 );
+			variant();
+			for(size_t i=0;i<N;i++) { if( std::abs( d[i] - ref[i] ) > 1.e-12 * std::abs(ref[i]) ) return false; }
+			return true;
+		};
+		ok = ok && same_as_scalar(indexed) && same_as_scalar(nopf) && same_as_scalar(parallel);
+
+		double t_scalar = best_time( reps, scalar );
+		double t_indexed = best_time( reps, indexed );
+		double t_nopf = best_time( reps, nopf );
+		double t_par = best_time( reps, parallel );
+
+		std::cout<<std::setw(10)<<names[p]<<std::fixed<<std::setprecision(3)
+		         <<std::setw(12)<<t_scalar*1.e9/n
+		         <<std::setw(12)<<t_indexed*1.e9/n
+		         <<std::setw(12)<<t_nopf*1.e9/n
+		         <<std::setw(12)<<t_par*1.e9/n<<std::endl;
+	}
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
+
@@ -0,0 +1,159 @@
+#include <string>
+#include <iostream>
+#include <random>
+#include <cmath>
+#include <chrono>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/kernel_graph.h"
+
+#include "declare_fields.h"
+
+enum RunMode
+{
+	SEQUENTIAL,
+	PARALLEL,
+	GRAPH
+};
+
+template<typename OperatorT, typename ArraysT, typename... FieldAccessT>
+static inline void run_kernel( RunMode mode, soatl::KernelGraph& graph, OperatorT f, ArraysT& arrays, const FieldAccessT& ... fas )
+{
+	switch( mode )
+	{
+		case SEQUENTIAL: soatl::apply_simd( f, arrays, fas... ); break;
+		case PARALLEL: soatl::parallel_apply_simd( f, arrays, fas... ); break;
+		case GRAPH: soatl::submit_apply_simd( graph, f, arrays, fas... ); break;
+	}
+}
+
+// 6 kernels per cell : 4 independent ones (forces on disjoint fields, kinetic energy),
+// then velocity and position updates depending on them through overlapping fields.
+template<typename ArraysT>
+static inline void timestep( RunMode mode, soatl::KernelGraph& graph, ArraysT& cell )
+{
+	using soatl::read;
+	using soatl::write;
+	using soatl::readwrite;
+
+	const double dt = 0.001;
+	const double k = 2.0;
+
+	run_kernel( mode, graph, [k](double& fx, double x) { fx = -k*x + std::sqrt(1.0+x*x); } , cell, write(particle_fx), read(particle_rx) );
+	run_kernel( mode, graph, [k](double& fy, double y) { fy = -k*y + std::sqrt(1.0+y*y); } , cell, write(particle_fy), read(particle_ry) );
+	run_kernel( mode, graph, [k](double& fz, double z) { fz = -k*z + std::sqrt(1.0+z*z); } , cell, write(particle_fz), read(particle_rz) );
+	run_kernel( mode, graph, [](double& e, double vx, double vy, double vz) { e = 0.5 * ( vx*vx + vy*vy + vz*vz ); }
+	          , cell, write(particle_e), read(particle_vx), read(particle_vy), read(particle_vz) );
+	run_kernel( mode, graph, [dt](double& vx, double& vy, double& vz, double fx, double fy, double fz) { vx += dt*fx; vy += dt*fy; vz += dt*fz; }
+	          , cell, readwrite(particle_vx), readwrite(particle_vy), readwrite(particle_vz), read(particle_fx), read(particle_fy), read(particle_fz) );
+	run_kernel( mode, graph, [dt](double& x, double& y, double& z, double vx, double vy, double vz) { x += dt*vx; y += dt*vy; z += dt*vz; }
+	          , cell, readwrite(particle_rx), readwrite(particle_ry), readwrite(particle_rz), read(particle_vx), read(particle_vy), read(particle_vz) );
+}
+
+template<typename ArraysT>
+static inline void initialize( ArraysT& cell, size_t N, int seed )
+{
+	std::default_random_engine gen( seed );
+	std::uniform_real_distribution<> rdist(0.0,1.0);
+	cell.resize(N);
+	for(size_t i=0;i<N;i++)
+	{
+		cell[particle_rx][i] = rdist(gen);
+		cell[particle_ry][i] = rdist(gen);
+		cell[particle_rz][i] = rdist(gen);
+		cell[particle_vx][i] = rdist(gen);
+		cell[particle_vy][i] = rdist(gen);
+		cell[particle_vz][i] = rdist(gen);
+		cell[particle_fx][i] = 0.0;
+		cell[particle_fy][i] = 0.0;
+		cell[particle_fz][i] = 0.0;
+		cell[particle_e][i] = 0.0;
+	}
+}
+
+template<typename ArraysT>
+static inline double checksum( const ArraysT& cell )
+{
+	double s = 0.0;
+	for(size_t i=0;i<cell.size();i++)
+	{
+		s += cell[particle_rx][i] + cell[particle_ry][i] + cell[particle_rz][i] + cell[particle_e][i];
+	}
+	return s;
+}
+
+template<typename ArraysT>
+static inline bool same_values( const ArraysT& a, const ArraysT& b )
+{
+	for(size_t i=0;i<a.size();i++)
+	{
+		if( a[particle_rx][i]!=b[particle_rx][i] || a[particle_ry][i]!=b[particle_ry][i] || a[particle_rz][i]!=b[particle_rz][i]
+		 || a[particle_vx][i]!=b[particle_vx][i] || a[particle_vy][i]!=b[particle_vy][i] || a[particle_vz][i]!=b[particle_vz][i]
+		 || a[particle_e][i]!=b[particle_e][i] ) { return false; }
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	static constexpr size_t nCycles = 10;
+	size_t N = 1000000;
+	size_t block_size = soatl::KernelGraph::DefaultBlockSize;
+
+	if(argc>=2) { N = atoi(argv[1]); }
+	if(argc>=3) { block_size = atoi(argv[2]); }
+
+	auto make_cell = []() { return soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(),
+		particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_fx, particle_fy, particle_fz, particle_e ); };
+
+	// two cells, 12 kernels per time step
+	auto ref_cell1 = make_cell(); auto ref_cell2 = make_cell();
+	auto cell1 = make_cell(); auto cell2 = make_cell();
+
+	std::cout<<"N="<<N<<", block size="<<block_size<<", kernels per step=12"<<std::endl;
+
+	const char* mode_names[3] = { "sequential apply_simd", "parallel_apply_simd", "submit_apply_simd graph" };
+	for(int m=SEQUENTIAL; m<=GRAPH; m++)
+	{
+		RunMode mode = static_cast<RunMode>(m);
+		soatl::KernelGraph graph( block_size );
+		initialize( cell1, N, 1 );
+		initialize( cell2, N, 2 );
+
+		std::chrono::nanoseconds timens(0);
+		for(size_t cycle=0;cycle<nCycles;cycle++)
+		{
+			auto t1 = std::chrono::high_resolution_clock::now();
+			timestep( mode, graph, cell1 );
+			timestep( mode, graph, cell2 );
+			if( mode == GRAPH )
+			{
+				if( cycle == 0 ) { std::cout<<"graph: tasks="<<graph.task_count()<<", dependencies="<<graph.dependency_count()<<std::endl; }
+				graph.wait();
+			}
+			auto t2 = std::chrono::high_resolution_clock::now();
+			timens += t2-t1;
+		}
+		std::cout<<mode_names[m]<<" : time = "<<timens.count()/nCycles<<", checksum = "<<checksum(cell1)+checksum(cell2)<<std::endl;
+
+		if( mode == SEQUENTIAL )
+		{
+			initialize( ref_cell1, N, 1 );
+			initialize( ref_cell2, N, 2 );
+			soatl::copy( ref_cell1, cell1 );
+			soatl::copy( ref_cell2, cell2 );
+		}
+		else if( ! same_values(cell1,ref_cell1) || ! same_values(cell2,ref_cell2) )
+		{
+			std::cerr<<mode_names[m]<<" : results differ from sequential execution"<<std::endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
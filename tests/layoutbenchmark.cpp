@@ -0,0 +1,157 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/packed_layout.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/copy.h"
+
+#include "declare_fields.h"
+#include "compute_kernel.h"
+#include "benchsuite.h"
+
+/*
+Storage order of PackedFieldArrays (see packed_layout.h) : cells of a few tens of particles with mixed size fields,
+declared as in soatest.cpp (hot positions interleaved with cold small fields), stored in declaration order, by decreasing size,
+and with the fields of the kernel of benchmark.cpp grouped first. Reports the memory used by the cells and the time of the kernel
+over all cells for each layout, checks that results and FieldId access do not depend on the layout.
+usage : soatllayoutbenchmark [N] [reps] [mean cell size]
+*/
+
+using soatl::read;
+using soatl::write;
+
+template<typename CellT>
+__attribute__((noinline)) void vecreport_layout_kernel( CellT& cell, double ax, double ay, double az )
+{
+	soatl::apply_simd( [ax,ay,az](double& d, double x, double y, double z) { COMPUTE_KERNEL; }, cell, write(particle_e), read(particle_rx), read(particle_ry), read(particle_rz) );
+}
+
+template<typename LayoutT>
+using CellT = soatl::LayoutPackedFieldArrays< LayoutT, 64, 16, particle_atype_id, particle_rx_id, particle_mid_id, particle_ry_id, particle_dist_id, particle_rz_id, particle_tmp1_id, particle_tmp2_id, particle_e_id >;
+
+using Grouped = decltype( soatl::layout::groups( soatl::layout::group( particle_rx, particle_ry, particle_rz, particle_e ) ) );
+
+static_assert( std::is_same< CellT<soatl::layout::by_size>, soatl::PackedFieldArrays<64,16, particle_rx_id, particle_ry_id, particle_rz_id, particle_e_id, particle_mid_id, particle_dist_id, particle_tmp1_id, particle_atype_id, particle_tmp2_id > >::value , "by_size storage order" );
+static_assert( std::is_same< CellT<Grouped>, soatl::PackedFieldArrays<64,16, particle_rx_id, particle_ry_id, particle_rz_id, particle_e_id, particle_atype_id, particle_mid_id, particle_dist_id, particle_tmp1_id, particle_tmp2_id > >::value , "grouped storage order" );
+
+// fills cells with the same particles, returns the sum of data_size()
+template<typename CellT>
+static inline size_t fill_cells( std::vector<CellT>& cells, const std::vector<size_t>& sizes, const std::vector<double>& pos )
+{
+	size_t bytes = 0;
+	size_t p = 0;
+	for(size_t c=0;c<cells.size();c++)
+	{
+		cells[c].resize( sizes[c] );
+		for(size_t i=0;i<sizes[c];i++,p++)
+		{
+			cells[c][particle_rx][i] = pos[3*p];
+			cells[c][particle_ry][i] = pos[3*p+1];
+			cells[c][particle_rz][i] = pos[3*p+2];
+			cells[c][particle_atype][i] = p % 50;
+			cells[c][particle_mid][i] = p;
+			cells[c][particle_dist][i] = 0.0f;
+			cells[c][particle_tmp1][i] = 0;
+			cells[c][particle_tmp2][i] = 0;
+		}
+		bytes += cells[c].data_size();
+	}
+	return bytes;
+}
+
+template<typename CellT>
+static inline double run( const char* name, std::vector<CellT>& cells, const std::vector<size_t>& sizes, const std::vector<double>& pos, size_t reps, size_t reference_bytes )
+{
+	const size_t N = pos.size() / 3;
+	const size_t bytes = fill_cells( cells, sizes, pos );
+	size_t padding = 0;
+	for(const auto& cell : cells) { padding += CellT::padding_size( cell.capacity() ); }
+	const double ax = 0.25, ay = 0.5, az = 0.75; // not a particle position, d > 0
+	const double t = best_time( reps, [&]() { for(auto& cell : cells) { vecreport_layout_kernel( cell, ax, ay, az ); } } );
+	std::cout<<"  "<<std::setw(10)<<std::left<<name<<std::right<<std::setw(11)<<bytes<<" bytes, "<<std::setw(10)<<padding<<" padding bytes";
+	if( reference_bytes > 0 ) { std::cout<<" ("<<std::showpos<<std::fixed<<std::setprecision(2)<<100.0*(double(bytes)/reference_bytes-1.0)<<std::noshowpos<<"%)"; }
+	else { std::cout<<"         "; }
+	std::cout<<std::fixed<<std::setprecision(2)<<", kernel "<<std::setw(8)<<N/t*1.e-6<<" Melements/s"<<std::defaultfloat<<std::endl;
+	return t;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 1000003;
+	size_t reps = 5;
+	size_t mean_cell_size = 24;
+	if(argc>=2) { N = atoll(argv[1]); }
+	if(argc>=3) { reps = atoi(argv[2]); }
+	if(argc>=4) { mean_cell_size = std::max( atoll(argv[3]) , 1ll ); }
+
+	bool ok = true;
+
+	std::default_random_engine rng;
+	std::uniform_real_distribution<> rdist(0.0,1.0);
+	std::uniform_int_distribution<size_t> sdist(1,2*mean_cell_size-1);
+	std::vector<size_t> sizes;
+	for(size_t n=0;n<N;)
+	{
+		const size_t s = std::min( sdist(rng) , N-n );
+		sizes.push_back( s );
+		n += s;
+	}
+	std::vector<double> pos( 3*N );
+	for(auto& x : pos) { x = rdist(rng); }
+
+	// cells are not copied, vectors are not resized after construction
+	std::vector< CellT<soatl::layout::declared> > declared( sizes.size() );
+	std::vector< CellT<soatl::layout::by_size> > by_size( sizes.size() );
+	std::vector< CellT<Grouped> > grouped( sizes.size() );
+
+	std::cout<<N<<" elements in "<<sizes.size()<<" cells, fields atype,rx,mid,ry,dist,rz,tmp1,tmp2,e, kernel of benchmark.cpp"<<std::endl;
+	const size_t reference_bytes = fill_cells( declared, sizes, pos );
+	run( "declared", declared, sizes, pos, reps, 0 );
+	run( "by_size", by_size, sizes, pos, reps, reference_bytes );
+	run( "grouped", grouped, sizes, pos, reps, reference_bytes );
+
+	// same results, stripes in storage order
+	for(size_t c=0;c<sizes.size();c++)
+	{
+		for(size_t i=0;i<sizes[c];i++)
+		{
+			ok = ok && declared[c][particle_e][i] == by_size[c][particle_e][i] && declared[c][particle_e][i] == grouped[c][particle_e][i]
+			        && declared[c][particle_mid][i] == by_size[c][particle_mid][i] && declared[c][particle_atype][i] == grouped[c][particle_atype][i];
+		}
+		ok = ok && by_size[c][particle_rx] == by_size[c][soatl::cst::at<0>()] && static_cast<void*>( grouped[c][particle_rx] ) == grouped[c].data()
+		        && reinterpret_cast<uint8_t*>( grouped[c][particle_e] ) - reinterpret_cast<uint8_t*>( grouped[c][particle_rz] ) == ptrdiff_t( ( grouped[c].capacity()*sizeof(double) + 63 ) & ~size_t(63) );
+	}
+	for(size_t c=0;c<sizes.size();c++)
+	{
+		ok = ok && by_size[c].data_size() <= declared[c].data_size();
+	}
+
+	// copies between layouts go through field ids
+	soatl::copy( grouped[0], declared[1], 0, std::min( sizes[0], sizes[1] ) );
+	for(size_t i=0;i<std::min( sizes[0], sizes[1] );i++) { ok = ok && grouped[0][particle_mid][i] == declared[1][particle_mid][i] && grouped[0][particle_ry][i] == declared[1][particle_ry][i]; }
+
+	auto cell = soatl::make_packed_field_arrays( soatl::layout::by_size(), particle_atype, particle_rx );
+	static_assert( std::is_same< decltype(cell), soatl::PackedFieldArrays< soatl::DefaultLayout<particle_atype_id,particle_rx_id>::alignment, soatl::DefaultLayout<particle_atype_id,particle_rx_id>::chunksize, particle_rx_id, particle_atype_id > >::value , "default alignment and chunk size" );
+	cell.resize( 3 );
+	cell[particle_atype][2] = 7;
+	ok = ok && cell[particle_atype][2] == 7;
+
+	for(auto& c : declared) { c.resize( 0 ); }
+	for(auto& c : by_size) { c.resize( 0 ); }
+	for(auto& c : grouped) { c.resize( 0 ); }
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
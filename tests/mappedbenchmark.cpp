@@ -0,0 +1,128 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+#include <chrono>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/packed_snapshot.h"
+#include "soatl/mapped_packed_field_arrays.h"
+
+#include "declare_fields.h"
+
+// asks the kernel to drop the file from the page cache, to time loads from disk (best effort)
+static inline void evict_file( const std::string& filename )
+{
+	int fd = open( filename.c_str(), O_RDONLY );
+	if( fd < 0 ) return;
+	fdatasync( fd );
+	posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+	close( fd );
+}
+
+// first kernel after loading : distance to a point, reads 3 of the 10 fields through a const view
+template<typename ArraysT>
+static inline double first_kernel( const ArraysT& arrays )
+{
+	double sum = 0.0;
+	soatl::apply_simd( [&sum](double x, double y, double z) { sum += std::sqrt( x*x + y*y + z*z ); }
+	                 , arrays, soatl::read(particle_rx), soatl::read(particle_ry), soatl::read(particle_rz) );
+	return sum;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 4000000;
+	std::string filename = "mapped_snapshot.dat";
+	if(argc>=2) { N = atoi(argv[1]); }
+	if(argc>=3) { filename = argv[2]; }
+
+	auto make_cell = []() { return soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(),
+		particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_fx, particle_fy, particle_fz, particle_e ); };
+	auto make_view = []() { return soatl::make_mapped_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(),
+		particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_fx, particle_fy, particle_fz, particle_e ); };
+
+	double ref = 0.0;
+	{
+		auto cell = make_cell();
+		cell.resize(N);
+		std::default_random_engine gen( 0 );
+		std::uniform_real_distribution<> rdist(0.0,1.0);
+		for(size_t i=0;i<N;i++)
+		{
+			cell[particle_rx][i] = rdist(gen); cell[particle_ry][i] = rdist(gen); cell[particle_rz][i] = rdist(gen);
+			cell[particle_vx][i] = cell[particle_vy][i] = cell[particle_vz][i] = 0.0;
+			cell[particle_fx][i] = cell[particle_fy][i] = cell[particle_fz][i] = 0.0;
+			cell[particle_e][i] = 0.0;
+		}
+		ref = first_kernel( cell );
+		if( ! soatl::write_snapshot( filename, cell ) ) { std::cerr<<"cannot write "<<filename<<std::endl; return 1; }
+		std::cout<<"N="<<N<<", snapshot size="<<cell.data_size()<<" bytes, kernel reads 3 of 10 fields"<<std::endl;
+	}
+
+	bool ok = true;
+	auto check = [&ok,ref](double sum) { ok = ok && std::abs( sum - ref ) <= 1.e-9 * std::abs(ref); };
+
+	// time to first kernel, in ms, with the file in the page cache (warm) and evicted from it (cold)
+	auto time_to_first_kernel = [&](bool cold, auto load_and_run)
+	{
+		if( cold ) { evict_file( filename ); }
+		auto t1 = std::chrono::high_resolution_clock::now();
+		load_and_run();
+		auto t2 = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double,std::milli>(t2-t1).count();
+	};
+
+	auto read_load = [&]() { auto cell = make_cell(); ok = ok && soatl::read_snapshot( filename, cell ); check( first_kernel(cell) ); };
+	auto mapped = [&]() { auto view = make_view(); ok = ok && view.map( filename ); check( first_kernel(view) ); };
+	auto mapped_sequential = [&]() { auto view = make_view(); ok = ok && view.map( filename, soatl::MAPPED_READ_ONLY, soatl::MAPPED_ADVICE_SEQUENTIAL ); check( first_kernel(view) ); };
+	auto mapped_willneed = [&]()
+	{
+		auto view = make_view();
+		ok = ok && view.map( filename );
+		view.advise( soatl::MAPPED_ADVICE_WILLNEED, particle_rx, particle_ry, particle_rz );
+		check( first_kernel(view) );
+	};
+
+	std::cout<<std::setw(28)<<"load path"<<std::setw(12)<<"warm (ms)"<<std::setw(12)<<"cold (ms)"<<std::endl<<std::fixed<<std::setprecision(2);
+	std::cout<<std::setw(28)<<"read_snapshot"<<std::setw(12)<<time_to_first_kernel(false,read_load)<<std::setw(12)<<time_to_first_kernel(true,read_load)<<std::endl;
+	std::cout<<std::setw(28)<<"map"<<std::setw(12)<<time_to_first_kernel(false,mapped)<<std::setw(12)<<time_to_first_kernel(true,mapped)<<std::endl;
+	std::cout<<std::setw(28)<<"map + sequential"<<std::setw(12)<<time_to_first_kernel(false,mapped_sequential)<<std::setw(12)<<time_to_first_kernel(true,mapped_sequential)<<std::endl;
+	std::cout<<std::setw(28)<<"map + willneed(rx,ry,rz)"<<std::setw(12)<<time_to_first_kernel(false,mapped_willneed)<<std::setw(12)<<time_to_first_kernel(true,mapped_willneed)<<std::endl;
+
+	// copy on write : modifications stay private to the mapping
+	{
+		auto view = make_view();
+		ok = ok && view.map( filename, soatl::MAPPED_COPY_ON_WRITE );
+		soatl::apply_simd( [](double& e, double x) { e = 2.0 * x; }, view, soatl::write(particle_e), soatl::read(particle_rx) );
+		for(size_t i=0;i<view.size();i++) { ok = ok && view[particle_e][i] == 2.0*view[particle_rx][i]; }
+		auto other = make_view();
+		ok = ok && other.map( filename );
+		const auto& read_only = other;
+		static_assert( std::is_const< typename std::remove_reference< decltype( *read_only[particle_e] ) >::type >::value && ! std::is_const< typename std::remove_reference< decltype( *other[particle_e] ) >::type >::value , "const views give const pointers" );
+		for(size_t i=0;i<read_only.size();i++) { ok = ok && read_only[particle_e][i] == 0.0; }
+	}
+
+	// layout mismatch is detected
+	{
+		auto view = soatl::make_mapped_packed_field_arrays( soatl::cst::align<32>(), soatl::cst::chunk<16>(), particle_rx, particle_ry );
+		ok = ok && ! view.map( filename );
+	}
+
+	unlink( filename.c_str() );
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
+
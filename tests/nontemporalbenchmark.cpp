@@ -0,0 +1,93 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/copy.h"
+#include "soatl/non_temporal.h"
+
+#include "declare_fields.h"
+#include "benchsuite.h"
+
+int main(int argc, char* argv[])
+{
+	size_t max_bytes = 512ul << 20;
+	if(argc>=2) { max_bytes = atoll(argv[1]); }
+
+	const size_t default_threshold = soatl::non_temporal_threshold();
+	std::cout<<"SIMD arch="<<soatl::simd_arch()<<", non temporal alignment="<<soatl::NON_TEMPORAL_ALIGNMENT<<", threshold="<<default_threshold<<" bytes"<<std::endl;
+	std::cout<<"bandwidth in GB/s (bytes read + bytes written, without read for ownership traffic)"<<std::endl;
+	std::cout<<std::setw(12)<<"bytes"
+	         <<std::setw(12)<<"apply"
+	         <<std::setw(12)<<"write()"
+	         <<std::setw(12)<<"streamed"
+	         <<std::setw(12)<<"par_apply"
+	         <<std::setw(12)<<"par_write()"
+	         <<std::setw(12)<<"copy"
+	         <<std::setw(12)<<"stream_copy"
+	         <<std::setw(12)<<"stream_all"<<std::endl;
+
+	auto rx = particle_rx;
+	auto e = particle_e;
+	auto src = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), rx, e );
+	auto dst = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), rx, e );
+
+	const double a = 1.5, b = 0.25;
+	auto kernel = [a,b](double& d, double x) { d = a*x + b; };
+
+	bool ok = true;
+	for(size_t bytes=16384; bytes<=max_bytes; bytes*=4)
+	{
+		// kernel reads rx and writes e, copy moves both
+		const size_t N = bytes / ( 2 * sizeof(double) );
+		const size_t reps = std::max( size_t(3) , (size_t(1)<<28) / bytes );
+		src.resize(N);
+		dst.resize(N);
+		for(size_t i=0;i<N;i++) { src[rx][i] = i; src[e][i] = 0.0; dst[rx][i] = 0.0; dst[e][i] = 0.0; }
+
+		soatl::non_temporal_threshold() = default_threshold;
+		double t_apply = best_time( reps, [&]() { soatl::apply_simd( kernel, src, e, rx ); } );
+		double t_write = best_time( reps, [&]() { soatl::apply_simd( kernel, src, soatl::write(e), soatl::read(rx) ); } );
+		double t_par_apply = best_time( reps, [&]() { soatl::parallel_apply_simd( kernel, src, e, rx ); } );
+		double t_par_write = best_time( reps, [&]() { soatl::parallel_apply_simd( kernel, src, soatl::write(e), soatl::read(rx) ); } );
+		double t_stream_copy = best_time( reps, [&]() { soatl::stream_copy( dst, src ); } );
+
+		soatl::non_temporal_threshold() = 0;
+		double t_streamed = best_time( reps, [&]() { soatl::apply_simd( kernel, src, soatl::write(e), soatl::read(rx) ); } );
+		double t_stream_all = best_time( reps, [&]() { soatl::stream_copy( dst, src ); } );
+
+		soatl::non_temporal_threshold() = default_threshold;
+		double t_copy = best_time( reps, [&]() { soatl::copy( dst, src ); } );
+
+		for(size_t i=0;i<N;i++)
+		{
+			ok = ok && ( src[e][i] == a*i + b ) && ( dst[e][i] == src[e][i] ) && ( dst[rx][i] == src[rx][i] );
+		}
+
+		const double gb = bytes * 1.e-9;
+		std::cout<<std::setw(12)<<bytes<<std::fixed<<std::setprecision(2)
+		         <<std::setw(12)<<gb/t_apply
+		         <<std::setw(12)<<gb/t_write
+		         <<std::setw(12)<<gb/t_streamed
+		         <<std::setw(12)<<gb/t_par_apply
+		         <<std::setw(12)<<gb/t_par_write
+		         <<std::setw(12)<<gb/t_copy
+		         <<std::setw(12)<<gb/t_stream_copy
+		         <<std::setw(12)<<gb/t_stream_all<<std::endl;
+	}
+	soatl::non_temporal_threshold() = default_threshold;
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
+
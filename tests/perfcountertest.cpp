@@ -0,0 +1,95 @@
+#include <string>
+#include <iostream>
+#include <omp.h>
+
+#define SOATL_PERF_COUNTERS 1
+
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/copy.h"
+#include "soatl/instrument.h"
+
+#include "declare_fields.h"
+
+using soatl::read;
+using soatl::write;
+using soatl::readwrite;
+
+int main(int argc, char* argv[])
+{
+	size_t N = 1000000;
+	size_t nsteps = 10;
+	if(argc>=2) { N = atoi(argv[1]); }
+	if(argc>=3) { nsteps = atoi(argv[2]); }
+
+	auto cell = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_e );
+	auto copy = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_e );
+	cell.resize( N );
+	copy.resize( N );
+	{
+		SOATL_INSTRUMENT_SCOPE("init");
+		for(size_t i=0;i<cell.chunk_ceil();i++)
+		{
+			cell[particle_rx][i] = i; cell[particle_ry][i] = 1.0; cell[particle_rz][i] = 2.0; cell[particle_e][i] = 0.0;
+		}
+	}
+
+	for(size_t s=0;s<nsteps;s++)
+	{
+		SOATL_INSTRUMENT_SCOPE("step");
+		soatl::apply_simd( [](double x, double y, double z, double& e) { e = x*x + y*y + z*z; }, cell, read(particle_rx), read(particle_ry), read(particle_rz), write(particle_e) );
+		soatl::parallel_apply_simd( [](double& x, double y) { x += y; }, cell, readwrite(particle_rx), read(particle_ry) );
+		soatl::copy( copy, cell );
+	}
+
+	// kernels called by each thread of a parallel region
+	size_t nthreads = 1;
+	{
+		SOATL_INSTRUMENT_PARALLEL_SCOPE("team");
+#		pragma omp parallel
+		{
+			const size_t T = omp_get_num_threads();
+			const size_t t = omp_get_thread_num();
+#			pragma omp single
+			nthreads = T;
+			const size_t chunk = ( ( cell.size() / T ) / 16 ) * 16;
+			const size_t first = t * chunk;
+			const size_t count = ( t == T-1 ) ? cell.size() - first : chunk;
+			soatl::apply_simd( [](double& e) { e *= 0.5; }, first, count, cell, readwrite(particle_e) );
+		}
+	}
+
+	soatl::PerfRegistry& reg = soatl::perf_registry();
+	reg.print( std::cout );
+	auto calls = [&reg](const std::string& label) { return reg.sites.count(label) ? reg.sites[label].calls : size_t(0); };
+
+	bool ok = true;
+	// reallocation of both containers, the copy inside reallocate is not measured separately
+	ok = ok && calls("reallocate") == 2 && calls("reallocate/copy") == 0 && calls("copy") == 0;
+	ok = ok && calls("init") == 1;
+	ok = ok && calls("step") == nsteps && calls("step/apply_simd") == nsteps && calls("step/parallel_apply_simd") == nsteps && calls("step/copy") == nsteps;
+	ok = ok && calls("team") == 1 && calls("team/apply_simd") == nthreads && reg.sites["team/apply_simd"].per_thread.size() == nthreads && reg.sites["team/apply_simd"].thread_calls[0] == 1;
+	ok = ok && reg.sites["step/parallel_apply_simd"].per_thread.size() == static_cast<size_t>( omp_get_max_threads() );
+	ok = ok && reg.sites["step"].total.seconds >= reg.sites["step/apply_simd"].total.seconds;
+	ok = ok && copy[particle_rx][N-1] == cell[particle_rx][N-1] && cell[particle_e][N-1] == 0.5 * ( copy[particle_rx][N-1] - 1.0 ) * ( copy[particle_rx][N-1] - 1.0 ) + 2.5;
+
+	// counters are optional, when they work they count something
+	if( soatl::PerfThreadCounters::local().available( soatl::PERF_INSTRUCTIONS ) )
+	{
+		ok = ok && reg.sites["step/apply_simd"].total.count[soatl::PERF_INSTRUCTIONS] > 0.0;
+	}
+	else
+	{
+		std::cout<<"hardware counters unavailable"<<std::endl;
+	}
+
+	reg.dump_at_exit = false;
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,159 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/field_encoding.h"
+#include "soatl/compute.h"
+
+#include "declare_fields.h"
+#include "compute_kernel.h"
+#include "benchsuite.h"
+
+/*
+Reduced precision storage (see field_encoding.h) : the kernel of benchmark.cpp, computed in double,
+reads positions stored as double, float, half and 32 bits fixed point. Reports the bandwidth of each storage
+and the error of the result against double storage. Also checks the half conversions on all 65536 values
+and the fixed point origin of OriginFieldArrays.
+usage : soatlprecisionbenchmark [N] [reps]
+*/
+
+using soatl::read;
+using soatl::write;
+
+template<typename ArraysT, typename idx, typename idy, typename idz>
+__attribute__((noinline)) void vecreport_precision( ArraysT& arrays, double ax, double ay, double az, soatl::FieldId<idx> rx, soatl::FieldId<idy> ry, soatl::FieldId<idz> rz )
+{
+	soatl::apply_simd( [ax,ay,az](double& d, double x, double y, double z) { COMPUTE_KERNEL; }, arrays, write(particle_e), read(rx), read(ry), read(rz) );
+}
+
+template<typename Encoding> static inline typename Encoding::stored_type encode( double x, double origin ) { return Encoding::encode( x, origin ); }
+template<> inline double encode< soatl::NativeEncoding<double> >( double x, double ) { return x; }
+
+struct Errors { double position = 0.0; double median = 0.0; };
+
+// encodes the reference positions, runs the kernel. errors of the result are amplified near the singularities of the kernel (x/(y*z)),
+// the median relative error of d and the largest error of decoded positions are reported
+template<typename ArraysT, typename idx, typename idy, typename idz>
+static inline Errors run( const char* name, ArraysT& arrays, const std::vector<double>& pos, const std::vector<double>& reference, size_t reps, soatl::FieldId<idx> rx, soatl::FieldId<idy> ry, soatl::FieldId<idz> rz )
+{
+	using Encoding = typename soatl::FieldEncoding<idx>::type;
+	using StoredT = typename Encoding::stored_type;
+	const size_t N = reference.size();
+	arrays.resize( N );
+	const double* p = pos.data();
+	const double ox = soatl::FieldOrigin<ArraysT,idx>::get( arrays );
+	const double oy = soatl::FieldOrigin<ArraysT,idy>::get( arrays );
+	const double oz = soatl::FieldOrigin<ArraysT,idz>::get( arrays );
+	for(size_t i=0;i<N;i++)
+	{
+		arrays[rx][i] = encode<Encoding>( p[3*i], ox );
+		arrays[ry][i] = encode<Encoding>( p[3*i+1], oy );
+		arrays[rz][i] = encode<Encoding>( p[3*i+2], oz );
+	}
+
+	Errors errors;
+	soatl::apply_simd( [](double& d, double x) { d = x; }, arrays, write(particle_e), read(rx) );
+	for(size_t i=0;i<N;i++) { errors.position = std::max( errors.position, std::abs( arrays[particle_e][i] - p[3*i] ) ); }
+
+	const double ax = p[0], ay = p[1], az = p[2];
+	const double t = best_time( reps, [&]() { vecreport_precision( arrays, ax, ay, az, rx, ry, rz ); } );
+
+	std::vector<double> e( N-1 );
+	for(size_t i=1;i<N;i++) { e[i-1] = std::abs( arrays[particle_e][i] - reference[i] ) / std::abs( reference[i] ); }
+	std::nth_element( e.begin(), e.begin() + e.size()/2, e.end() );
+	errors.median = e[ e.size()/2 ];
+
+	const double bytes = N * ( 3 * sizeof(StoredT) + sizeof(double) );
+	std::cout<<std::setw(12)<<name<<" : "<<std::setw(2)<<sizeof(StoredT)<<" bytes/coordinate, "
+	         <<std::fixed<<std::setprecision(2)<<std::setw(7)<<bytes/t*1.e-9<<" GB/s, "<<std::setw(7)<<N/t*1.e-6<<" Melements/s, "
+	         <<std::scientific<<std::setprecision(2)<<"position error "<<errors.position<<", median relative error "<<errors.median<<std::defaultfloat<<std::endl;
+	arrays.resize( 0 );
+	return errors;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 1000003;
+	size_t reps = 5;
+	if(argc>=2) { N = atoll(argv[1]); }
+	if(argc>=3) { reps = atoi(argv[2]); }
+
+	bool ok = true;
+
+	// half conversions, all values round trip, floats round to nearest even
+	for(uint32_t h=0;h<65536;h++)
+	{
+		const float f = soatl::detail::half_to_float( uint16_t(h) );
+		const bool nan = ( h & 0x7c00 ) == 0x7c00 && ( h & 0x3ff ) != 0;
+		ok = ok && ( nan ? std::isnan(f) : soatl::detail::float_to_half( f ) == h );
+	}
+	ok = ok && soatl::detail::float_to_half( 1.00048828125f ) == 0x3c00 && soatl::detail::float_to_half( 1.00146484375f ) == 0x3c02
+	        && soatl::detail::float_to_half( 65520.0f ) == 0x7c00 && soatl::detail::half_to_float( 0x0001 ) == 5.9604644775390625e-08f;
+	if( ! ok ) { std::cerr<<"half conversion error"<<std::endl; }
+
+	std::default_random_engine rng;
+	std::uniform_real_distribution<> rdist(0.0,1.0);
+	std::vector<double> pos( 3*N );
+	for(auto& x : pos) { x = rdist(rng); }
+	std::vector<double> reference( N );
+	{
+		const double ax = pos[0], ay = pos[1], az = pos[2];
+		for(size_t i=0;i<N;i++)
+		{
+			double x = pos[3*i], y = pos[3*i+1], z = pos[3*i+2], d = 0.0;
+			COMPUTE_KERNEL;
+			reference[i] = d;
+		}
+	}
+
+	auto cell = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_e, particle_rx, particle_ry, particle_rz );
+	auto cell_f = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_e, particle_rx_sf, particle_ry_sf, particle_rz_sf );
+	auto cell_h = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_e, particle_rx_h, particle_ry_h, particle_rz_h );
+	auto cell_q = soatl::make_origin_field_arrays( soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_e, particle_rx_q, particle_ry_q, particle_rz_q ) );
+	cell_q.set_origin( particle_rx_q, 0.5 );
+	cell_q.set_origin( particle_ry_q, 0.5 );
+	cell_q.set_origin( particle_rz_q, 0.5 );
+
+	std::cout<<"kernel of benchmark.cpp computed in double, "<<N<<" elements"<<std::endl;
+	const Errors e_d = run( "double", cell, pos, reference, reps, particle_rx, particle_ry, particle_rz );
+	const Errors e_f = run( "float", cell_f, pos, reference, reps, particle_rx_sf, particle_ry_sf, particle_rz_sf );
+	const Errors e_h = run( "half", cell_h, pos, reference, reps, particle_rx_h, particle_ry_h, particle_rz_h );
+	const Errors e_q = run( "fixed point", cell_q, pos, reference, reps, particle_rx_q, particle_ry_q, particle_rz_q );
+	// half an ulp of positions in [0,1), doubles are rounded twice when stored as halves (through float)
+	ok = ok && e_d.position == 0.0 && e_d.median == 0.0;
+	ok = ok && e_f.position <= 2.98023223876953125e-08 && e_h.position <= 2.44140625e-04 * ( 1.0 + 1.0/2048 ) && e_q.position <= 2.98023223876953125e-08;
+	ok = ok && e_f.median < 1.e-5 && e_h.median < 1.e-1 && e_q.median < 1.e-5;
+
+	// decoded values follow the origin, read and write through the kernel
+	cell_q.resize( 3 );
+	soatl::apply( [](double& x) { x = 1.25; }, cell_q, write(particle_rx_q) );
+	ok = ok && cell_q[particle_rx_q][0] == int32_t( 0.75 * ( 1 << 24 ) );
+	cell_q.set_origin( particle_rx_q, 10.0 );
+	soatl::apply_simd( [](double& x, double& e) { e = x; x += 1.0; }, cell_q, particle_rx_q, particle_e );
+	ok = ok && cell_q[particle_e][2] == 10.75 && cell_q[particle_rx_q][1] == int32_t( 1.75 * ( 1 << 24 ) );
+
+	// values out of the fixed point range are clamped, [-128,128) around the origin for 2^-24 steps in an int32_t
+	using Q = soatl::FixedPointEncoding<int32_t,double,-24>;
+	using QF = soatl::FixedPointEncoding<int32_t,float,-24>;
+	ok = ok && Q::encode( 1.e30, 0.0 ) == std::numeric_limits<int32_t>::max() && Q::encode( -1.e30, 0.0 ) == std::numeric_limits<int32_t>::min()
+	        && Q::encode( 138.0, 10.0 ) == std::numeric_limits<int32_t>::max() && Q::encode( std::nan(""), 0.0 ) == std::numeric_limits<int32_t>::min()
+	        && Q::encode( -128.0, 0.0 ) == std::numeric_limits<int32_t>::min() && Q::decode( Q::encode( 127.5, 0.0 ), 0.0 ) == 127.5;
+	ok = ok && QF::encode( 1.e30f, 0.0f ) == 2147483520 && QF::encode( -1.e30f, 0.0f ) == std::numeric_limits<int32_t>::min();
+	cell_q.resize( 0 );
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include <string>
+#include <iostream>
+#include <cmath>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/roofline.h"
+
+#include "declare_fields.h"
+
+using soatl::read;
+using soatl::write;
+using soatl::readwrite;
+
+// traffic is derived from field types and access modes
+static_assert( soatl::KernelTraffic< soatl::FieldAccess<particle_rx_id,soatl::access::read_only>, soatl::FieldAccess<particle_e_f_id,soatl::access::write_only> >::read_bytes == 8 , "read bytes" );
+static_assert( soatl::KernelTraffic< soatl::FieldAccess<particle_rx_id,soatl::access::read_only>, soatl::FieldAccess<particle_e_f_id,soatl::access::write_only> >::write_bytes == 4 , "write bytes" );
+static_assert( soatl::KernelTraffic< soatl::FieldAccess<particle_mid_id,soatl::access::read_write> >::bytes == 8 , "read write bytes" );
+static_assert( soatl::KernelTraffic< soatl::FieldId<particle_atype_id>, soatl::FieldId<particle_tmp1_id> >::bytes == 6 , "unannotated fields" );
+
+int main(int argc, char* argv[])
+{
+	size_t N = 10000000;
+	size_t stream_elements = 0;
+	size_t repeat = 5;
+	if(argc>=2) { N = atoi(argv[1]); }
+	if(argc>=3) { stream_elements = atoi(argv[2]); }
+	if(argc>=4) { repeat = atoi(argv[3]); }
+
+	const soatl::StreamBandwidth bw = soatl::stream_bandwidth( stream_elements );
+	soatl::peak_bandwidth() = bw.triad;
+	std::cout<<"STREAM : copy "<<bw.copy<<" GB/s, scale "<<bw.scale<<" GB/s, add "<<bw.add<<" GB/s, triad "<<bw.triad<<" GB/s"<<std::endl;
+
+	auto cell = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_e );
+	cell.resize( N );
+	for(size_t i=0;i<cell.chunk_ceil();i++)
+	{
+		cell[particle_rx][i] = 1.0 + ( i % 7 ) * 0.1;
+		cell[particle_ry][i] = 1.0 + ( i % 5 ) * 0.1;
+		cell[particle_rz][i] = 1.0 + ( i % 3 ) * 0.1;
+		cell[particle_e][i] = 0.0;
+	}
+
+	// low, medium and high arithmetic intensity kernels
+	soatl::KernelRoofline scale( "scale", 1 );
+	soatl::KernelRoofline distance( "distance", 15 );
+	soatl::KernelRoofline polynomial( "polynomial", 32 );
+	soatl::KernelRoofline parallel_polynomial( "parallel polynomial", 32 );
+	for(size_t r=0;r<repeat;r++)
+	{
+		soatl::roofline_apply_simd( scale, [](double x, double& e) { e = 2.0 * x; }, cell, read(particle_rx), write(particle_e) );
+		soatl::roofline_apply_simd( distance, [](double x, double y, double z, double& e)
+			{
+				x = x - 0.5; y = y - 0.5; z = z - 0.5;
+				double d = std::sqrt( x*x + y*y + z*z );
+				x /= d; y /= d; z /= d;
+				e = d + x/(y*z);
+			}, cell, read(particle_rx), read(particle_ry), read(particle_rz), write(particle_e) );
+		auto horner = [](double x, double& e)
+			{
+				double p = 1.0;
+				for(int k=0;k<16;k++) { p = p * x + 0.5; }
+				e = p;
+			};
+		soatl::roofline_apply_simd( polynomial, horner, cell, read(particle_rx), write(particle_e) );
+		soatl::roofline_parallel_apply_simd( parallel_polynomial, horner, cell, read(particle_rx), write(particle_e) );
+	}
+
+	for(const auto* k : { &scale, &distance, &polynomial, &parallel_polynomial }) { k->print( std::cout, soatl::peak_bandwidth() ); }
+
+	bool ok = bw.triad > 0.0;
+	ok = ok && scale.calls == repeat && scale.bytes_read == 8.0 * N * repeat && scale.bytes_written == 8.0 * N * repeat;
+	ok = ok && distance.bytes() == 32.0 * N * repeat && distance.flops() == 15.0 * N * repeat;
+	ok = ok && std::abs( polynomial.intensity() - 2.0 ) < 1.e-12;
+	{
+		double p = 1.0;
+		for(int k=0;k<16;k++) { p = p * cell[particle_rx][N-1] + 0.5; }
+		ok = ok && std::abs( cell[particle_e][N-1] - p ) <= 1.e-12 * std::abs( p );
+	}
+
+	// scoped measurement of any code
+	{
+		soatl::KernelRoofline manual( "manual" );
+		{
+			auto scope = soatl::make_roofline_scope( manual, N, particle_rx, read(particle_ry) );
+		}
+		ok = ok && manual.bytes_read == 16.0 * N && manual.bytes_written == 8.0 * N;
+	}
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,166 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#if defined(__GLIBCXX__) && defined(_OPENMP)
+#include <parallel/algorithm>
+#endif
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_rows.h"
+
+#include "declare_fields.h"
+#include "benchsuite.h"
+
+/*
+Rows and row iterators (see field_rows.h) : sorts a container of positions, velocities, atom type and a key (particle_mid, a random
+permutation) with std::sort on row iterators, and by sorting (key,index) pairs then permuting the fields with permute_rows.
+Compares a wide container (8 fields) with a narrow one (key and one position). Also checks standard algorithms on rows
+(stable_partition, partition, reverse, is_sorted on a const container), row assignment between containers and swaps.
+usage : soatlrowbenchmark [N] [reps]
+*/
+
+struct KeyLess
+{
+	template<typename RowA, typename RowB>
+	inline bool operator () ( const RowA& a, const RowB& b ) const { return a[particle_mid] < b[particle_mid]; }
+};
+
+// row values from a key
+struct KeyRow
+{
+	int32_t key;
+	template<typename _id> inline double operator [] ( soatl::FieldId<_id> ) const { return key * 0.5; }
+	inline int32_t operator [] ( soatl::FieldId<particle_mid_id> ) const { return key; }
+	inline unsigned char operator [] ( soatl::FieldId<particle_atype_id> ) const { return key % 4; }
+};
+
+// element i gets key keys[i], the other fields are functions of the key
+template<typename CellT>
+static inline void fill( CellT& cell, const std::vector<int32_t>& keys )
+{
+	cell.resize( keys.size() );
+	for(size_t i=0;i<keys.size();i++) { cell.row(i) = KeyRow { keys[i] }; }
+}
+
+template<typename CellT>
+static inline void sort_rows( CellT& cell )
+{
+	std::sort( cell.begin(), cell.end(), KeyLess() );
+}
+
+#if defined(__GLIBCXX__) && defined(_OPENMP)
+template<typename CellT>
+static inline void parallel_sort_rows( CellT& cell )
+{
+	__gnu_parallel::sort( cell.begin(), cell.end(), KeyLess() );
+}
+#endif
+
+template<typename CellT>
+static inline void sort_keys_then_permute( CellT& cell )
+{
+	const size_t N = cell.size();
+	const int32_t* __restrict__ key = cell[particle_mid];
+	std::vector< std::pair<int32_t,uint32_t> > keys( N );
+	for(size_t i=0;i<N;i++) { keys[i] = { key[i], uint32_t(i) }; }
+	std::sort( keys.begin(), keys.end() );
+	std::vector<uint32_t> order( N );
+	for(size_t i=0;i<N;i++) { order[i] = keys[i].second; }
+	soatl::permute_rows( cell, order );
+}
+
+// all fields follow their key
+template<typename CellT>
+static inline bool check_sorted( const CellT& cell )
+{
+	bool ok = std::is_sorted( cell.begin(), cell.end(), KeyLess() );
+	for(size_t i=0;i<cell.size();i++)
+	{
+		const auto r = cell.row(i);
+		ok = ok && r[particle_mid] == int32_t(i) && r[particle_rx] == i * 0.5;
+	}
+	return ok;
+}
+
+template<typename CellT>
+static inline bool run( const char* name, CellT& cell, const std::vector<int32_t>& keys, size_t reps )
+{
+	const size_t N = keys.size();
+	bool ok = true;
+	auto prepare = [&]() { fill( cell, keys ); };
+	const double t_rows = best_time( reps, prepare, [&]() { sort_rows( cell ); } );
+	ok = ok && check_sorted( cell );
+	const double t_perm = best_time( reps, prepare, [&]() { sort_keys_then_permute( cell ); } );
+	ok = ok && check_sorted( cell );
+	std::cout<<"  "<<std::setw(8)<<std::left<<name<<std::right<<std::fixed<<std::setprecision(2)
+	         <<" std::sort on rows "<<std::setw(7)<<N/t_rows*1.e-6<<" Melements/s, key sort and permute "<<std::setw(7)<<N/t_perm*1.e-6<<" Melements/s";
+#	if defined(__GLIBCXX__) && defined(_OPENMP)
+	const double t_par = best_time( reps, prepare, [&]() { parallel_sort_rows( cell ); } );
+	ok = ok && check_sorted( cell );
+	std::cout<<", parallel mode sort on rows "<<std::setw(7)<<N/t_par*1.e-6<<" Melements/s";
+#	endif
+	std::cout<<std::defaultfloat<<std::endl;
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 1000003;
+	size_t reps = 5;
+	if(argc>=2) { N = atoll(argv[1]); }
+	if(argc>=3) { reps = atoi(argv[2]); }
+
+	bool ok = true;
+
+	std::vector<int32_t> keys( N );
+	std::iota( keys.begin(), keys.end(), 0 );
+	std::shuffle( keys.begin(), keys.end(), std::default_random_engine() );
+
+	auto wide = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_atype, particle_mid );
+	auto narrow = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_mid );
+
+	std::cout<<N<<" elements, sort by a random key"<<std::endl;
+	ok = run( "8 fields", wide, keys, reps ) && ok;
+	ok = run( "2 fields", narrow, keys, reps ) && ok;
+
+	// standard algorithms move whole rows, stable_partition keeps the order of keys
+	std::vector<size_t> position( N );
+	for(size_t i=0;i<N;i++) { position[ keys[i] ] = i; }
+	fill( wide, keys );
+	auto mid = std::stable_partition( wide.begin(), wide.end(), [](const auto& r) { return r[particle_atype] == 0; } );
+	ok = ok && size_t( mid - wide.begin() ) == ( N + 3 ) / 4;
+	ok = ok && std::is_sorted( wide.begin(), mid, [&position](const auto& a, const auto& b) { return position[ a[particle_mid] ] < position[ b[particle_mid] ]; } );
+	for(const auto& r : wide) { ok = ok && r[particle_atype] == r[particle_mid] % 4 && r[particle_vz] == r[particle_mid] * 0.5; }
+	std::partition( wide.begin(), wide.end(), [](const auto& r) { return r[particle_mid] % 2 == 0; } );
+	std::reverse( wide.begin(), wide.end() );
+	sort_rows( wide );
+	ok = ok && check_sorted( wide );
+
+	// rows of containers with the same fields in another order, and of FieldArrays
+	auto other = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_mid, particle_atype, particle_vz, particle_vy, particle_vx, particle_rz, particle_ry, particle_rx );
+	other.resize( 3 );
+	other.row(0) = wide.row(7);
+	other.row(1) = wide.row(8);
+	other.row(2) = soatl::FieldArraysRowValue< decltype(wide)::FieldIdsTuple >( wide.row(9) );
+	swap( other.row(0), other.row(2) );
+	ok = ok && other[particle_mid][0] == 9 && other[particle_ry][1] == 4.0 && other[particle_atype][2] == 3;
+	decltype(other.begin())::value_type v = *other.begin();
+	swap( v, other.row(1) );
+	ok = ok && v[particle_mid] == 8 && other.row(1)[particle_mid] == 9 && other.end() - other.begin() == 3;
+	other.resize( 0 );
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,375 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <tuple>
+#include <omp.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/compute.h"
+#include "soatl/copy.h"
+
+#include "declare_fields.h"
+#include "benchsuite.h"
+
+/*
+Thread scaling of parallel_apply, parallel_apply_simd and parallel_copy on 4 double fields.
+For each pinning layout and first touch policy, thread counts are swept for
+	strong scaling : fixed number of elements, efficiency = T(1) / ( p * T(p) )
+	weak scaling   : elements proportional to the thread count, efficiency = T(1) / T(p)
+Layouts pin thread t of the OpenMP team to one cpu of the process' affinity mask :
+	compact : consecutive cpus, filling hardware threads of a core, then cores of a NUMA node (like OMP_PROC_BIND=close)
+	scatter : one cpu per core, round robin over NUMA nodes, before any second hardware thread (like OMP_PROC_BIND=spread)
+	none    : no pinning, threads may run anywhere in the affinity mask (OMP_PLACES/OMP_PROC_BIND still apply)
+Containers are allocated for every measure and initialized either by the pinned team with the same static schedule
+as the kernels (parallel first touch), or by the master thread (serial first touch, pages end up on its NUMA node).
+Imbalance is measured on a static partition of the same kernel where each thread times its own block : (max - mean) / mean.
+The bandwidth saturation point is the smallest thread count reaching 90% of the best strong scaling bandwidth.
+Medians go to the report (text, csv or json, see scripts/compare_benchmarks.py) with benchmark = <kernel>_<strong|weak>[_serialinit],
+size_class = layout, the scaling summary is printed to stderr.
+usage : soatlscalingbenchmark [--format text|csv|json] [--output file] [--elements N] [--reps R] [--warmup W] [--min-sample-us T]
+                              [--threads 1,2,...] [--layouts compact,scatter,none] [--first-touch parallel,serial]
+                              [--containers fa,pfa] [--benchmarks parallel_apply,parallel_apply_simd,parallel_copy]
+*/
+
+// cpu orders of the pinning layouts
+struct CpuTopology
+{
+	std::vector<int> compact;
+	std::vector<int> scatter;
+
+	static inline int read_int( const std::string& filename, int fallback )
+	{
+		std::ifstream in( filename );
+		int value = fallback;
+		if( ! ( in >> value ) ) { value = fallback; }
+		return value;
+	}
+
+	inline void detect()
+	{
+		struct Cpu { int cpu, node, package, core, smt, node_core; };
+		std::vector<Cpu> cpus;
+#		ifdef __linux__
+		cpu_set_t mask;
+		CPU_ZERO( &mask );
+		if( sched_getaffinity( 0, sizeof(mask), &mask ) == 0 )
+		{
+			for(int c=0;c<CPU_SETSIZE;c++)
+			{
+				if( ! CPU_ISSET( c, &mask ) ) { continue; }
+				const std::string topo = "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/";
+				Cpu cpu { c, 0, read_int( topo + "physical_package_id", 0 ), read_int( topo + "core_id", c ), 0, 0 };
+				for(int n=0;n<1024;n++)
+				{
+					std::ifstream node( "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/node" + std::to_string(n) + "/cpulist" );
+					if( node.good() ) { cpu.node = n; break; }
+				}
+				cpus.push_back( cpu );
+			}
+		}
+#		endif
+
+		// rank of hardware threads within their core, and of cores within their NUMA node
+		auto by_core = []( const Cpu& a, const Cpu& b ) { return std::make_tuple(a.node,a.package,a.core,a.cpu) < std::make_tuple(b.node,b.package,b.core,b.cpu); };
+		std::sort( cpus.begin(), cpus.end(), by_core );
+		std::map< std::tuple<int,int,int>, int > smt_count;
+		std::map< int, std::set< std::pair<int,int> > > node_cores;
+		for(Cpu& c : cpus)
+		{
+			c.smt = smt_count[ std::make_tuple(c.node,c.package,c.core) ]++;
+			node_cores[c.node].insert( std::make_pair(c.package,c.core) );
+			c.node_core = std::distance( node_cores[c.node].begin(), node_cores[c.node].find( std::make_pair(c.package,c.core) ) );
+		}
+
+		compact.clear();
+		for(const Cpu& c : cpus) { compact.push_back( c.cpu ); }
+
+		std::sort( cpus.begin(), cpus.end(), []( const Cpu& a, const Cpu& b ) { return std::make_tuple(a.smt,a.node_core,a.node,a.cpu) < std::make_tuple(b.smt,b.node_core,b.node,b.cpu); } );
+		scatter.clear();
+		for(const Cpu& c : cpus) { scatter.push_back( c.cpu ); }
+	}
+
+	inline const std::vector<int>* order( const std::string& layout ) const
+	{
+		if( layout == "compact" ) { return &compact; }
+		if( layout == "scatter" ) { return &scatter; }
+		return nullptr;
+	}
+};
+
+// pins the threads of a team of nthreads, they are reused by the following parallel regions of the same size.
+// without an order, threads get the whole process mask back.
+static inline void pin_threads( size_t nthreads, const std::vector<int>* order, const std::vector<int>& all )
+{
+#	ifdef __linux__
+#	pragma omp parallel num_threads(nthreads)
+	{
+		cpu_set_t set;
+		CPU_ZERO( &set );
+		if( order != nullptr && ! order->empty() ) { CPU_SET( (*order)[ omp_get_thread_num() % order->size() ], &set ); }
+		else { for(int c : all) { CPU_SET( c, &set ); } }
+		sched_setaffinity( 0, sizeof(set), &set );
+	}
+#	endif
+}
+
+struct ScalingPoint
+{
+	size_t threads = 1;
+	double ns = 0.0;
+	double gbps = 0.0;
+	double imbalance = 0.0;
+};
+
+struct ScalingBenchmark
+{
+	BenchOptions options;
+	BenchReport report;
+	CpuTopology topology;
+	size_t elements = 1ul << 22;
+	std::vector<size_t> threads;
+	std::vector<std::string> layouts = { "compact", "scatter", "none" };
+	std::vector<std::string> first_touch = { "parallel", "serial" };
+	std::vector<std::string> containers = { "fa", "pfa" };
+	std::vector<std::string> benchmarks = { "parallel_apply", "parallel_apply_simd", "parallel_copy" };
+	std::map< std::string, std::vector<ScalingPoint> > series; // key : benchmark container layout touch mode
+	bool ok = true;
+
+	static inline bool contains( const std::vector<std::string>& v, const std::string& s ) { return std::find( v.begin(), v.end(), s ) != v.end(); }
+};
+
+template<typename ArraysT>
+static inline void first_touch( ArraysT& a, size_t N, bool parallel )
+{
+	a.resize( N );
+	auto init = [](double& x, double& y, double& z, double& e) { x = 1.0; y = 2.0; z = 3.0; e = 0.0; };
+	if( parallel ) { soatl::parallel_apply_simd( init, a, particle_rx, particle_ry, particle_rz, particle_e ); }
+	else { soatl::apply_simd( init, a, particle_rx, particle_ry, particle_rz, particle_e ); }
+}
+
+// per thread time of a static partition of the kernel, in chunks, (max - mean) / mean
+template<typename ArraysT, typename BlockFuncT>
+static inline double thread_imbalance( size_t N, size_t nthreads, size_t reps, BlockFuncT block )
+{
+	std::vector<double> t( nthreads, 0.0 );
+	const size_t nchunks = ( N + ArraysT::ChunkSize - 1 ) / ArraysT::ChunkSize;
+	for(size_t r=0;r<reps;r++)
+	{
+#		pragma omp parallel num_threads(nthreads)
+		{
+			const size_t tid = omp_get_thread_num();
+			const size_t nt = omp_get_num_threads();
+			const size_t first = std::min( N, ( nchunks * tid / nt ) * ArraysT::ChunkSize );
+			const size_t last = std::min( N, ( nchunks * (tid+1) / nt ) * ArraysT::ChunkSize );
+#			pragma omp barrier
+			auto t1 = std::chrono::steady_clock::now();
+			block( first, last - first );
+			t[tid] += std::chrono::duration<double,std::nano>( std::chrono::steady_clock::now() - t1 ).count();
+		}
+	}
+	double sum = 0.0, mx = 0.0;
+	for(double x : t) { sum += x; mx = std::max( mx, x ); }
+	const double mean = sum / nthreads;
+	return mean > 0.0 ? ( mx - mean ) / mean : 0.0;
+}
+
+template<typename ArraysT>
+static inline void run_case( ScalingBenchmark& bench, const char* container, const std::string& benchmark, const std::string& layout, bool parallel_touch, bool weak )
+{
+	auto kernel = [](double x, double y, double z, double& e) { e = x*x + y*y + z*z; };
+	const std::string mode = weak ? "weak" : "strong";
+	const std::string name = benchmark + "_" + mode + ( parallel_touch ? "" : "_serialinit" );
+	const std::vector<int> all = bench.topology.compact;
+	std::vector<ScalingPoint>& series = bench.series[ benchmark + " " + container + " " + layout + " " + ( parallel_touch ? "parallel" : "serial" ) + " " + mode ];
+
+	for(size_t p : bench.threads)
+	{
+		omp_set_num_threads( p );
+		pin_threads( p, bench.topology.order( layout ), all );
+
+		const size_t N = weak ? bench.elements * p : bench.elements;
+		const bool copy = ( benchmark == "parallel_copy" );
+		ArraysT src, dst;
+		first_touch( src, N, parallel_touch );
+		if( copy ) { first_touch( dst, N, parallel_touch ); }
+
+		BenchResult r;
+		r.benchmark = name; r.container = container; r.precision = "double"; r.size_class = layout;
+		r.elements = N; r.threads = p; r.bytes = ( copy ? 2 : 1 ) * N * 4 * sizeof(double);
+		ScalingPoint point;
+		point.threads = p;
+		if( benchmark == "parallel_apply" )
+		{
+			r.samples = bench_samples( bench.options, r.inner, [&]() { soatl::parallel_apply( kernel, src, particle_rx, particle_ry, particle_rz, particle_e ); } );
+			point.imbalance = thread_imbalance<ArraysT>( N, p, bench.options.reps, [&](size_t first, size_t count)
+				{ soatl::apply( kernel, first, count, src, particle_rx, particle_ry, particle_rz, particle_e ); } );
+		}
+		else if( benchmark == "parallel_apply_simd" )
+		{
+			r.samples = bench_samples( bench.options, r.inner, [&]() { soatl::parallel_apply_simd( kernel, src, particle_rx, particle_ry, particle_rz, particle_e ); } );
+			point.imbalance = thread_imbalance<ArraysT>( N, p, bench.options.reps, [&](size_t first, size_t count)
+				{ soatl::apply_simd( kernel, first, count, src, particle_rx, particle_ry, particle_rz, particle_e ); } );
+		}
+		else
+		{
+			for(size_t i=0;i<N;i+=N/3+1) { src[particle_e][i] = double(i); }
+			r.samples = bench_samples( bench.options, r.inner, [&]() { soatl::parallel_copy( dst, src ); } );
+			point.imbalance = thread_imbalance<ArraysT>( N, p, bench.options.reps, [&](size_t first, size_t count)
+				{ soatl::copy( dst, src, first, count ); } );
+			for(size_t i=0;i<N;i+=N/3+1) { bench.ok = bench.ok && dst[particle_e][i] == double(i); }
+		}
+		if( ! copy )
+		{
+			bench.ok = bench.ok && src[particle_e][0] == 14.0 && src[particle_e][N-1] == 14.0;
+		}
+
+		point.ns = r.median();
+		point.gbps = r.gbps();
+		series.push_back( point );
+		bench.report.results.push_back( r );
+		std::cerr << name << " " << container << " " << layout << " t=" << p << " : " << r.median() << " ns" << std::endl;
+
+		release( src );
+		release( dst );
+	}
+}
+
+template<typename ArraysT>
+static inline void run_container( ScalingBenchmark& bench, const char* container )
+{
+	if( ! ScalingBenchmark::contains( bench.containers, container ) ) { return; }
+	for(const std::string& benchmark : bench.benchmarks)
+	for(const std::string& layout : bench.layouts)
+	for(const std::string& touch : bench.first_touch)
+	{
+		run_case<ArraysT>( bench, container, benchmark, layout, touch == "parallel", false );
+		run_case<ArraysT>( bench, container, benchmark, layout, touch == "parallel", true );
+	}
+}
+
+static inline void print_summary( ScalingBenchmark& bench, std::ostream& out )
+{
+	out << std::left << std::setw(48) << "benchmark container layout touch mode" << std::right << std::setw(5) << "thr"
+	    << std::setw(14) << "median ns" << std::setw(10) << "GB/s" << std::setw(12) << "efficiency" << std::setw(11) << "imbalance" << '\n';
+	out << std::fixed;
+	for(const auto& s : bench.series)
+	{
+		const std::vector<ScalingPoint>& points = s.second;
+		if( points.empty() ) { continue; }
+		const bool weak = s.first.compare( s.first.size() - 4, 4, "weak" ) == 0;
+		const ScalingPoint& base = points.front();
+		double best_gbps = 0.0;
+		for(const ScalingPoint& p : points) { best_gbps = std::max( best_gbps, p.gbps ); }
+		size_t saturation = 0;
+		for(const ScalingPoint& p : points)
+		{
+			const double speedup = p.ns > 0.0 ? base.ns / p.ns : 0.0;
+			const double efficiency = weak ? speedup : speedup * base.threads / p.threads;
+			out << std::left << std::setw(48) << s.first << std::right << std::setw(5) << p.threads
+			    << std::setprecision(1) << std::setw(14) << p.ns << std::setprecision(2) << std::setw(10) << p.gbps
+			    << std::setw(12) << efficiency << std::setw(11) << p.imbalance << '\n';
+			if( saturation == 0 && p.gbps >= 0.9 * best_gbps ) { saturation = p.threads; }
+		}
+		if( ! weak )
+		{
+			out << "  bandwidth saturation at " << saturation << " threads (" << std::setprecision(2) << best_gbps << " GB/s)\n";
+			bench.report.context.push_back( { "saturation " + s.first, std::to_string( saturation ) } );
+		}
+	}
+	out << std::defaultfloat;
+}
+
+int main(int argc, char* argv[])
+{
+	ScalingBenchmark bench;
+	std::string format = "text";
+	std::string output;
+
+	for(int a=1;a<argc;a++)
+	{
+		const std::string arg = argv[a];
+		if( a+1 >= argc )
+		{
+			std::cerr<<"usage: "<<argv[0]<<" [--format text|csv|json] [--output file] [--elements N] [--reps R] [--warmup W] [--min-sample-us T] [--threads 1,2,...]"
+			         <<" [--layouts compact,scatter,none] [--first-touch parallel,serial] [--containers fa,pfa] [--benchmarks names]"<<std::endl;
+			return 1;
+		}
+		const std::string value = argv[++a];
+		if( arg == "--format" ) { format = value; }
+		else if( arg == "--output" ) { output = value; }
+		else if( arg == "--elements" ) { bench.elements = std::max( 1, atoi( value.c_str() ) ); }
+		else if( arg == "--reps" ) { bench.options.reps = std::max( 1, atoi( value.c_str() ) ); }
+		else if( arg == "--warmup" ) { bench.options.warmup = atoi( value.c_str() ); }
+		else if( arg == "--min-sample-us" ) { bench.options.min_sample_ns = atof( value.c_str() ) * 1000.0; }
+		else if( arg == "--layouts" ) { bench.layouts = split_list( value ); }
+		else if( arg == "--first-touch" ) { bench.first_touch = split_list( value ); }
+		else if( arg == "--containers" ) { bench.containers = split_list( value ); }
+		else if( arg == "--benchmarks" ) { bench.benchmarks = split_list( value ); }
+		else if( arg == "--threads" ) { for(const auto& t : split_list( value )) { bench.threads.push_back( std::max( 1, atoi( t.c_str() ) ) ); } }
+		else { std::cerr<<"unknown option "<<arg<<std::endl; return 1; }
+	}
+
+	bench.topology.detect();
+
+	// default thread counts : powers of 2 up to the maximum, and the maximum
+	const size_t max_threads = omp_get_max_threads();
+	if( bench.threads.empty() )
+	{
+		for(size_t t=1;t<max_threads;t*=2) { bench.threads.push_back( t ); }
+		bench.threads.push_back( max_threads );
+	}
+
+	std::string compact, scatter;
+	for(int c : bench.topology.compact) { compact += ( compact.empty() ? "" : "," ) + std::to_string(c); }
+	for(int c : bench.topology.scatter) { scatter += ( scatter.empty() ? "" : "," ) + std::to_string(c); }
+	bench.report.context = {
+		{ "simd_arch", soatl::simd_arch() },
+		{ "alignment", std::to_string( soatl::DEFAULT_ALIGNMENT ) },
+		{ "chunk_size", std::to_string( soatl::DEFAULT_CHUNK_SIZE ) },
+		{ "omp_max_threads", std::to_string( max_threads ) },
+		{ "compact_cpus", compact },
+		{ "scatter_cpus", scatter },
+		{ "compiler", __VERSION__ },
+		{ "reps", std::to_string( bench.options.reps ) },
+		{ "warmup", std::to_string( bench.options.warmup ) } };
+
+	using FieldsT = soatl::FieldArrays<soatl::DEFAULT_ALIGNMENT,soatl::DEFAULT_CHUNK_SIZE,particle_rx_id,particle_ry_id,particle_rz_id,particle_e_id>;
+	using PackedT = soatl::PackedFieldArrays<soatl::DEFAULT_ALIGNMENT,soatl::DEFAULT_CHUNK_SIZE,particle_rx_id,particle_ry_id,particle_rz_id,particle_e_id>;
+	run_container<FieldsT>( bench, "fa" );
+	run_container<PackedT>( bench, "pfa" );
+
+	omp_set_num_threads( max_threads );
+	pin_threads( max_threads, nullptr, bench.topology.compact );
+
+	print_summary( bench, std::cerr );
+
+	bool written = false;
+	if( output.empty() ) { written = bench.report.write( std::cout, format ); }
+	else
+	{
+		std::ofstream out( output );
+		written = bench.report.write( out, format ) && out.good();
+	}
+	if( ! written )
+	{
+		std::cerr<<"cannot write "<<format<<" results"<<std::endl;
+		return 1;
+	}
+
+	if( ! bench.ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,110 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/scan.h"
+
+#include "declare_fields.h"
+#include "benchsuite.h"
+
+int main(int argc, char* argv[])
+{
+	size_t N = 16000000;
+	size_t nbins = 64;
+	int seed = 0;
+	if(argc>=2) { N = atoi(argv[1]); }
+	if(argc>=3) { nbins = atoi(argv[2]); }
+	if(argc>=4) { seed = atoi(argv[3]); }
+
+	auto atype = particle_atype;
+	auto offset = particle_offset;
+
+	auto arrays = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), atype, offset );
+	arrays.resize(N);
+	std::default_random_engine rng( seed );
+	std::uniform_int_distribution<int> tdist( 0, nbins-1 );
+	for(size_t i=0;i<N;i++) { arrays[atype][i] = tdist(rng); }
+
+	const unsigned char* types = arrays[atype];
+	uint32_t* offsets = arrays[offset];
+	std::vector<uint32_t> ref_offsets(N);
+	std::vector<uint32_t> ref_bins(nbins);
+	std::vector<uint32_t> bins(nbins);
+	const size_t reps = 5;
+
+	std::cout<<"N="<<N<<", bins="<<nbins<<", times in ns per element"<<std::endl;
+
+	// exclusive scan of uint8 types into uint32 offsets
+	auto naive_scan = [&]() { uint32_t s=0; for(size_t i=0;i<N;i++) { ref_offsets[i]=s; s+=types[i]; } };
+#	if __cplusplus >= 201703L
+	auto std_scan = [&]() { std::exclusive_scan( types, types+N, offsets, uint32_t(0) ); };
+#	else
+	auto std_scan = [&]() { if(N>0) { offsets[0]=0; std::partial_sum( types, types+N-1, offsets+1, std::plus<uint32_t>() ); } };
+#	endif
+	auto soatl_scan = [&]() { soatl::exclusive_scan( arrays, atype, offset ); };
+
+	bool ok = true;
+	naive_scan();
+	std_scan();
+	ok = ok && std::equal( offsets, offsets+N, ref_offsets.begin() );
+	const uint32_t total = soatl::exclusive_scan( arrays, atype, offset );
+	ok = ok && std::equal( offsets, offsets+N, ref_offsets.begin() ) && ( N==0 || total == ref_offsets[N-1] + types[N-1] );
+
+	// inclusive scan, in place
+	std::copy( types, types+N, offsets );
+	soatl::inclusive_scan( arrays, offset, offset );
+	for(size_t i=0;i<N;i++) { ok = ok && ( offsets[i] == ref_offsets[i] + types[i] ); }
+
+	// exclusive scan, in place
+	std::copy( types, types+N, offsets );
+	soatl::exclusive_scan( arrays, offset, offset );
+	ok = ok && std::equal( offsets, offsets+N, ref_offsets.begin() );
+
+	double t_naive_scan = best_time( reps, naive_scan );
+	double t_std_scan = best_time( reps, std_scan );
+	double t_soatl_scan = best_time( reps, soatl_scan );
+
+	// histogram of types, in random order and sorted (long runs of equal values)
+	auto naive_histogram = [&]() { std::fill( ref_bins.begin(), ref_bins.end(), 0 ); for(size_t i=0;i<N;i++) { ++ ref_bins[types[i]]; } };
+	auto soatl_histogram = [&]() { std::fill( bins.begin(), bins.end(), 0 ); soatl::histogram( arrays, atype, bins ); };
+
+	naive_histogram();
+	soatl_histogram();
+	ok = ok && ( bins == ref_bins );
+	double t_naive_histogram = best_time( reps, naive_histogram );
+	double t_soatl_histogram = best_time( reps, soatl_histogram );
+
+	std::sort( arrays[atype], arrays[atype]+N );
+	naive_histogram();
+	soatl_histogram();
+	ok = ok && ( bins == ref_bins );
+	double t_naive_histogram_sorted = best_time( reps, naive_histogram );
+	double t_soatl_histogram_sorted = best_time( reps, soatl_histogram );
+
+	std::cout<<std::fixed<<std::setprecision(3);
+	std::cout<<std::setw(24)<<"naive exclusive scan"<<std::setw(12)<<t_naive_scan*1.e9/N<<std::endl;
+#	if __cplusplus >= 201703L
+	std::cout<<std::setw(24)<<"std::exclusive_scan"<<std::setw(12)<<t_std_scan*1.e9/N<<std::endl;
+#	else
+	std::cout<<std::setw(24)<<"std::partial_sum"<<std::setw(12)<<t_std_scan*1.e9/N<<std::endl;
+#	endif
+	std::cout<<std::setw(24)<<"soatl::exclusive_scan"<<std::setw(12)<<t_soatl_scan*1.e9/N<<std::endl;
+	std::cout<<std::setw(24)<<"naive histogram"<<std::setw(12)<<t_naive_histogram*1.e9/N<<std::endl;
+	std::cout<<std::setw(24)<<"soatl::histogram"<<std::setw(12)<<t_soatl_histogram*1.e9/N<<std::endl;
+	std::cout<<std::setw(24)<<"naive histogram sorted"<<std::setw(12)<<t_naive_histogram_sorted*1.e9/N<<std::endl;
+	std::cout<<std::setw(24)<<"soatl::histogram sorted"<<std::setw(12)<<t_soatl_histogram_sorted*1.e9/N<<std::endl;
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
+
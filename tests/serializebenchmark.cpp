@@ -0,0 +1,120 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <random>
+#include <cstdio>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/copy.h"
+#include "soatl/serialize.h"
+
+#include "declare_fields.h"
+#include "benchsuite.h"
+
+/*
+Serialization bandwidth : writes and reads a container with soatl::write / soatl::read (see serialize.h), and compares with a raw dump
+of the data() of a PackedFieldArrays with the same fields (capacity padding included, no header, same layout required to load it).
+Files are written to the current directory and are likely to stay in the page cache, bandwidths are those of the copies to and from it.
+serializetest.cpp checks the format, this program only times it.
+usage : soatlserializebenchmark [N] [reps]
+*/
+
+static inline void report( const char* name, size_t bytes, double t_write, double t_read )
+{
+	std::cout<<"  "<<std::setw(9)<<std::left<<name<<std::right<<std::setw(12)<<bytes<<" bytes, write "<<std::fixed<<std::setprecision(2)
+	         <<std::setw(7)<<bytes/t_write*1.e-9<<" GB/s, read "<<std::setw(7)<<bytes/t_read*1.e-9<<" GB/s"<<std::defaultfloat<<std::endl;
+}
+
+static inline size_t file_size( const std::string& filename )
+{
+	std::ifstream fin( filename, std::ios::binary | std::ios::ate );
+	return fin.tellg();
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 4000000;
+	size_t reps = 5;
+	if(argc>=2) { N = atoll(argv[1]); }
+	if(argc>=3) { reps = atoi(argv[2]); }
+
+	auto rx = particle_rx;
+	auto ry = particle_ry;
+	auto rz = particle_rz;
+	auto e = particle_e;
+	auto atype = particle_atype;
+	auto mid = particle_mid;
+
+	auto arrays = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<8>(), e,atype,rx,mid,ry,rz );
+	arrays.resize(N);
+	std::default_random_engine rng;
+	std::uniform_real_distribution<> rdist(0.0,1.0);
+	for(size_t i=0;i<N;i++)
+	{
+		arrays[rx][i] = rdist(rng);
+		arrays[ry][i] = rdist(rng);
+		arrays[rz][i] = rdist(rng);
+		arrays[e][i] = rdist(rng);
+		arrays[atype][i] = i % 50;
+		arrays[mid][i] = i % 500;
+	}
+
+	bool ok = true;
+	auto packed = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<8>(), e,atype,rx,mid,ry,rz );
+	packed.resize(N);
+	soatl::copy( packed, arrays );
+
+	// raw dump of the packed storage
+	const std::string raw_file = "serialize_raw.dat";
+	const double t_raw_write = best_time( reps, [&]()
+		{
+			std::ofstream fout( raw_file, std::ios::binary | std::ios::trunc );
+			fout.write( static_cast<const char*>( packed.data() ), packed.data_size() );
+		} );
+	const double t_raw_read = best_time( reps, [&]()
+		{
+			std::ifstream fin( raw_file, std::ios::binary );
+			ok = ok && fin.read( static_cast<char*>( packed.data() ), packed.data_size() );
+		} );
+	const size_t raw_bytes = file_size( raw_file );
+
+	// self describing format, read into a container with another field order
+	const std::string soatl_file = "serialize_bench.soatl";
+	auto loaded = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<8>(), mid,rz,ry,rx,atype,e );
+	const double t_write = best_time( reps, [&]()
+		{
+			std::ofstream fout( soatl_file, std::ios::binary | std::ios::trunc );
+			ok = ok && soatl::write( fout, arrays );
+		} );
+	const double t_read = best_time( reps, [&]()
+		{
+			std::ifstream fin( soatl_file, std::ios::binary );
+			ok = ok && soatl::read( fin, loaded );
+		} );
+	const size_t soatl_bytes = file_size( soatl_file );
+
+	std::cout<<N<<" elements, fields e,atype,rx,mid,ry,rz"<<std::endl;
+	report( "raw dump", raw_bytes, t_raw_write, t_raw_read );
+	report( "soatl", soatl_bytes, t_write, t_read );
+
+	ok = ok && loaded.size() == N;
+	for(size_t i=0;i<N && ok;i++)
+	{
+		ok = loaded[rx][i] == arrays[rx][i] && loaded[rz][i] == arrays[rz][i] && loaded[e][i] == arrays[e][i] && loaded[mid][i] == arrays[mid][i]
+		  && packed[ry][i] == arrays[ry][i] && packed[atype][i] == arrays[atype][i];
+	}
+
+	std::remove( raw_file.c_str() );
+	std::remove( soatl_file.c_str() );
+	arrays.resize(0);
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
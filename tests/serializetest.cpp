@@ -5,12 +5,15 @@
 #include <cmath>
 #include <typeinfo>
 #include <fstream>
+#include <sstream>
 
 #include "soatl/field_descriptor.h"
 #include "soatl/field_arrays.h"
 #include "soatl/packed_field_arrays.h"
 #include "soatl/variadic_template_utils.h"
 #include "soatl/field_pointers.h"
+#include "soatl/copy.h"
+#include "soatl/serialize.h"
 
 #include "declare_fields.h"
 
@@ -30,6 +33,7 @@ int main(int argc, char* argv[])
 	size_t N = 10000;
 
 	if(argc>=2) { seed=atoi(argv[1]); }
+	if(argc>=3) { N=atoi(argv[2]); }
 
 	rng.seed( seed );
 
@@ -66,11 +70,13 @@ int main(int argc, char* argv[])
 	// all these variants need to be tested
 	soatl::copy( serialize_arrays , in_arrays, 0, N/2 );
 	soatl::copy( serialize_arrays , in_arrays, N/2, N/2, rx, ry );
-	soatl::copy( serialize_arrays , in_arrays, N/2, N, rx, ry );
+	// count is the number of elements, starting at N/2 only N-N/2 remain
+	soatl::copy( serialize_arrays , in_arrays, N/2, N-N/2, rx, ry );
 	soatl::copy( serialize_arrays , in_arrays, rz,e,atype,mid );
 
 	soatl::copy( serialize_arrays , in_arrays );
 
+	// raw dump of the packed storage, capacity padding included
 	{
 		std::ofstream fout("serialize.dat");
 		fout.write( (const char*) serialize_arrays.data() , serialize_arrays.data_size() );
@@ -98,6 +104,66 @@ int main(int argc, char* argv[])
 		assert( in_arrays[mid][i] == out_arrays[mid][i] );
 	}
 
+	// self describing format, read back into containers with other field order, alignment and chunk size
+	{
+		std::ofstream fout("serialize.soatl", std::ios::binary);
+		if( ! soatl::write( fout, in_arrays ) ) { std::cerr<<"write failed"<<std::endl; return 1; }
+	}
+	auto packed_arrays = soatl::make_packed_field_arrays( soatl::cst::align<16>(), soatl::cst::chunk<4>(), mid,rz,ry,rx,atype,e );
+	packed_arrays.resize(N);
+	{
+		uint8_t* ptr = (uint8_t*) packed_arrays.data();
+		for(size_t i=0;i<packed_arrays.data_size();i++) { ptr[i]=0; }
+	}
+	{
+		std::ifstream fin("serialize.soatl", std::ios::binary);
+		if( ! soatl::read( fin, packed_arrays ) ) { std::cerr<<"read failed"<<std::endl; return 1; }
+	}
+
+	// a subset of the fields, and a missing field
+	auto position_arrays = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), rz,rx );
+	auto other_arrays = soatl::make_field_arrays( rx, particle_dist );
+	{
+		std::ifstream fin("serialize.soatl", std::ios::binary);
+		if( ! soatl::read( fin, position_arrays ) ) { std::cerr<<"read of a field subset failed"<<std::endl; return 1; }
+	}
+	{
+		std::ifstream fin("serialize.soatl", std::ios::binary);
+		if( soatl::read( fin, other_arrays ) ) { std::cerr<<"missing field not detected"<<std::endl; return 1; }
+	}
+	{
+		std::ifstream fin("serialize.dat", std::ios::binary);
+		if( soatl::read( fin, other_arrays ) ) { std::cerr<<"invalid header not detected"<<std::endl; return 1; }
+	}
+
+	// several containers in the same stream
+	{
+		std::stringstream ss;
+		soatl::write( ss, position_arrays );
+		soatl::write( ss, in_arrays, atype, mid );
+		auto a = soatl::make_field_arrays( rx, rz );
+		auto b = soatl::make_field_arrays( atype, mid );
+		if( ! soatl::read( ss, a ) || ! soatl::read( ss, b ) || a.size()!=N || b.size()!=N ) { std::cerr<<"stream of containers failed"<<std::endl; return 1; }
+		for(size_t i=0;i<N;i++)
+		{
+			assert( a[rx][i] == in_arrays[rx][i] && a[rz][i] == in_arrays[rz][i] );
+			assert( b[atype][i] == in_arrays[atype][i] && b[mid][i] == in_arrays[mid][i] );
+		}
+	}
+
+	if( packed_arrays.size()!=N || position_arrays.size()!=N ) { std::cerr<<"wrong size"<<std::endl; return 1; }
+	for(size_t i=0;i<N;i++)
+	{
+		assert( in_arrays[rx][i] == packed_arrays[rx][i] );
+		assert( in_arrays[ry][i] == packed_arrays[ry][i] );
+		assert( in_arrays[rz][i] == packed_arrays[rz][i] );
+		assert( in_arrays[e][i] == packed_arrays[e][i] );
+		assert( in_arrays[atype][i] == packed_arrays[atype][i] );
+		assert( in_arrays[mid][i] == packed_arrays[mid][i] );
+		assert( in_arrays[rx][i] == position_arrays[rx][i] );
+		assert( in_arrays[rz][i] == position_arrays[rz][i] );
+	}
+
 	std::cout<<"serialization ok"<<std::endl;
 	return 0;
 }
@@ -0,0 +1,189 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cmath>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/column_io.h"
+#include "soatl/shared_packed_field_arrays.h"
+
+#include "declare_fields.h"
+
+using soatl::read;
+using soatl::write;
+using soatl::readwrite;
+
+// what the analysis process reports, in an anonymous shared mapping
+struct AnalysisReport
+{
+	std::atomic<int> done;
+	size_t analyses;
+	size_t attempts;
+	size_t torn;         // consistent reads where energies differ, should be 0
+	double time;         // seconds spent in analyses, retries included
+	double last_sum;
+	double last_e;
+};
+
+// analysis : sum of distances to origin, and energy range, which is a single value in a consistent state
+template<typename ArraysT>
+static inline void analysis( ArraysT& cell, double& sum, double& emin, double& emax )
+{
+	double s = 0.0, mn = 1.e30, mx = -1.e30;
+	soatl::apply_simd( [&s,&mn,&mx](double x, double y, double z, double e) { s += std::sqrt( x*x + y*y + z*z ); mn = std::min(mn,e); mx = std::max(mx,e); }
+	                 , cell, read(particle_rx), read(particle_ry), read(particle_rz), read(particle_e) );
+	sum = s; emin = mn; emax = mx;
+}
+
+// simulation step : positions and energies are modified, inside a write section for shared containers
+template<typename ArraysT>
+static inline void integrate( ArraysT& cell, double step )
+{
+	const double dt = 0.01;
+	soatl::apply_simd( [dt,step](double& x, double& y, double& z, double& e, double vx, double vy, double vz) { x += dt*vx; y += dt*vy; z += dt*vz; e = step; }
+	                 , cell, readwrite(particle_rx), readwrite(particle_ry), readwrite(particle_rz), write(particle_e), read(particle_vx), read(particle_vy), read(particle_vz) );
+}
+
+// work of the simulation outside of the shared data (forces in a private container)
+template<typename ArraysT>
+static inline void private_work( ArraysT& forces )
+{
+	soatl::apply_simd( [](double& fx, double& fy, double& fz) { fx = std::sqrt( fx*fx + 1.0 ); fy = std::sqrt( fy*fy + 1.0 ); fz = std::sqrt( fz*fz + 1.0 ); }
+	                 , forces, readwrite(particle_fx), readwrite(particle_fy), readwrite(particle_fz) );
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 2000000;
+	size_t nsteps = 100;
+	std::string name = "/soatl_shared_benchmark_" + std::to_string( getpid() );
+	if(argc>=2) { N = atoi(argv[1]); }
+	if(argc>=3) { nsteps = atoi(argv[2]); }
+
+	auto make_shared = []() { return soatl::make_shared_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(),
+		particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_e ); };
+
+	auto cell = make_shared();
+	if( ! cell.create( name, N ) ) { std::cerr<<"cannot create shared memory object "<<name<<std::endl; return 1; }
+	cell.write_begin();
+	cell.resize( N );
+	{
+		std::default_random_engine gen( 0 );
+		std::uniform_real_distribution<> rdist(-1.0,1.0);
+		for(size_t i=0;i<N;i++)
+		{
+			cell[particle_rx][i] = rdist(gen); cell[particle_ry][i] = rdist(gen); cell[particle_rz][i] = rdist(gen);
+			cell[particle_vx][i] = rdist(gen); cell[particle_vy][i] = rdist(gen); cell[particle_vz][i] = rdist(gen);
+			cell[particle_e][i] = 0.0;
+		}
+	}
+	cell.write_end();
+
+	void* report_ptr = mmap( nullptr, sizeof(AnalysisReport), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+	if( report_ptr == MAP_FAILED ) { std::cerr<<"mmap failed"<<std::endl; return 1; }
+	AnalysisReport* report = new( report_ptr ) AnalysisReport;
+	report->done.store( 0 );
+
+	std::cout<<"N="<<N<<", steps="<<nsteps<<", shared segment "<<cell.data_size()/(1<<20)<<" MB"<<std::endl;
+
+	// analysis process : attaches a read only view, and runs analyses on live data until the simulation ends
+	pid_t pid = fork();
+	if( pid == 0 )
+	{
+		auto view = make_shared();
+		if( ! view.attach( name ) ) { _exit( 1 ); }
+		double sum = 0.0, emin = 0.0, emax = 0.0;
+		auto run = [&](decltype(view)& v) { analysis( v, sum, emin, emax ); };
+		auto t1 = std::chrono::high_resolution_clock::now();
+		while( report->done.load() == 0 )
+		{
+			report->attempts += view.read_consistent( run );
+			report->analyses ++;
+			if( emin != emax ) { report->torn ++; }
+		}
+		report->time = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - t1 ).count();
+		view.read_consistent( run );
+		report->last_sum = sum;
+		report->last_e = ( emin == emax ) ? emin : -1.0;
+		view.detach();
+		_exit( 0 );
+	}
+
+	// simulation process
+	auto forces = soatl::make_packed_field_arrays( particle_fx, particle_fy, particle_fz );
+	forces.resize( N );
+	for(size_t i=0;i<N;i++) { forces[particle_fx][i] = forces[particle_fy][i] = forces[particle_fz][i] = 0.0; }
+	auto t1 = std::chrono::high_resolution_clock::now();
+	for(size_t step=1;step<=nsteps;step++)
+	{
+		private_work( forces );
+		cell.write_begin();
+		integrate( cell, step );
+		cell.write_end();
+	}
+	const double simulation_time = std::chrono::duration<double>( std::chrono::high_resolution_clock::now() - t1 ).count();
+	report->done.store( 1 );
+	int status = 0;
+	waitpid( pid, &status, 0 );
+
+	bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && report->torn == 0 && report->analyses > 0;
+	double ref_sum = 0.0, emin = 0.0, emax = 0.0;
+	analysis( cell, ref_sum, emin, emax );
+	ok = ok && report->last_e == nsteps && std::abs( report->last_sum - ref_sum ) <= 1.e-12 * std::abs( ref_sum );
+
+	// same hand off through a file : the simulation saves the fields of the analysis, which loads them
+	const std::string filename = "shared_benchmark.dat";
+	auto copy = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_e );
+	// padding elements, processed by apply_simd but not loaded, are zeroed once
+	copy.resize( N );
+	for(size_t i=0;i<copy.chunk_ceil();i++) { copy[particle_rx][i] = copy[particle_ry][i] = copy[particle_rz][i] = copy[particle_e][i] = 0.0; }
+	const size_t nfile = std::max( size_t(1), std::min( nsteps, size_t(10) ) );
+	double save_time = 0.0, load_time = 0.0, file_analysis_time = 0.0;
+	for(size_t k=0;k<nfile;k++)
+	{
+		auto c1 = std::chrono::high_resolution_clock::now();
+		ok = ok && soatl::save( filename, cell, particle_rx, particle_ry, particle_rz, particle_e );
+		auto c2 = std::chrono::high_resolution_clock::now();
+		ok = ok && soatl::load( filename, copy );
+		auto c3 = std::chrono::high_resolution_clock::now();
+		double sum = 0.0;
+		analysis( copy, sum, emin, emax );
+		auto c4 = std::chrono::high_resolution_clock::now();
+		ok = ok && std::abs( sum - ref_sum ) <= 1.e-12 * std::abs( ref_sum );
+		save_time += std::chrono::duration<double>(c2-c1).count();
+		load_time += std::chrono::duration<double>(c3-c2).count();
+		file_analysis_time += std::chrono::duration<double>(c4-c3).count();
+	}
+	unlink( filename.c_str() );
+
+	std::cout<<std::fixed<<std::setprecision(3);
+	std::cout<<"simulation             : "<<simulation_time*1.e3/nsteps<<" ms per step"<<std::endl;
+	std::cout<<"shared memory analysis : "<<report->analyses<<" consistent analyses, "<<report->attempts-report->analyses<<" retries, "
+	         <<report->time*1.e3/report->analyses<<" ms per analysis (retries included), "<<report->torn<<" torn"<<std::endl;
+	std::cout<<"file hand off          : save "<<save_time*1.e3/nfile<<" ms + load "<<load_time*1.e3/nfile<<" ms + analysis "<<file_analysis_time*1.e3/nfile<<" ms"<<std::endl;
+
+	// layout mismatch is detected
+	{
+		auto view = soatl::make_shared_packed_field_arrays( particle_rx, particle_ry );
+		ok = ok && ! view.attach( name );
+	}
+
+	munmap( report_ptr, sizeof(AnalysisReport) );
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
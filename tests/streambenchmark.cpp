@@ -0,0 +1,154 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/serialize.h"
+#include "soatl/tile_reader.h"
+
+#include "declare_fields.h"
+
+// asks the kernel to drop the file from the page cache, to time loads from disk (best effort)
+static inline void evict_file( const std::string& filename )
+{
+	int fd = open( filename.c_str(), O_RDONLY );
+	if( fd < 0 ) return;
+	fdatasync( fd );
+	posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+	close( fd );
+}
+
+// value of element i of the f-th field, so that the file can be generated and checked without holding it in memory
+static inline double field_value( size_t i, unsigned int f )
+{
+	return ( ( i * 2654435761ull + f * 40503ull ) % 1000003 ) * 1.e-6;
+}
+
+// only size() is needed to build a header
+struct ElementCount
+{
+	size_t n;
+	inline size_t size() const { return n; }
+};
+
+// writes N elements of 7 fields, one block at a time
+static inline bool generate_file( const std::string& filename, size_t N )
+{
+	std::ofstream out( filename, std::ios::binary | std::ios::trunc );
+	soatl::write_header( out, soatl::make_header( ElementCount{N}, particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_e ) );
+	std::vector<double> block( 1<<16 );
+	for(unsigned int f=0;f<7;f++)
+	{
+		for(size_t first=0;first<N;first+=block.size())
+		{
+			const size_t n = std::min( block.size(), N-first );
+			for(size_t i=0;i<n;i++) { block[i] = field_value( first+i, f ); }
+			out.write( reinterpret_cast<const char*>( block.data() ), n * sizeof(double) );
+		}
+	}
+	return bool( out );
+}
+
+// one pass analysis over a tile : distance to origin and kinetic energy, reads 6 of the 7 fields
+template<typename ArraysT>
+static inline double analysis( ArraysT& tile )
+{
+	double sum = 0.0;
+	soatl::apply_simd( [&sum](double x, double y, double z, double vx, double vy, double vz) { sum += std::sqrt( x*x + y*y + z*z ) + 0.5 * ( vx*vx + vy*vy + vz*vz ); }
+	                 , tile, soatl::read(particle_rx), soatl::read(particle_ry), soatl::read(particle_rz), soatl::read(particle_vx), soatl::read(particle_vy), soatl::read(particle_vz) );
+	return sum;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 20000000;
+	size_t limit_mb = 256;
+	size_t tile_size = soatl::TILE_READER_DEFAULT_TILE_SIZE;
+	std::string filename = "stream_fields.dat";
+	if(argc>=2) { N = atoi(argv[1]); }
+	if(argc>=3) { limit_mb = atoi(argv[2]); }
+	if(argc>=4) { tile_size = atoi(argv[3]); }
+	if(argc>=5) { filename = argv[4]; }
+
+	if( ! generate_file( filename, N ) ) { std::cerr<<"cannot write "<<filename<<std::endl; return 1; }
+	double ref = 0.0;
+	for(size_t i=0;i<N;i++)
+	{
+		const double x=field_value(i,0), y=field_value(i,1), z=field_value(i,2), vx=field_value(i,3), vy=field_value(i,4), vz=field_value(i,5);
+		ref += std::sqrt( x*x + y*y + z*z ) + 0.5 * ( vx*vx + vy*vy + vz*vz );
+	}
+
+	const size_t file_bytes = N * 7 * sizeof(double);
+	const size_t selected_bytes = N * 6 * sizeof(double);
+	bool ok = true;
+
+	// simulates a machine with limit_mb of memory : the address space of the process is limited (0 for no limit)
+	if( limit_mb > 0 )
+	{
+		struct rlimit rl;
+		getrlimit( RLIMIT_AS, &rl );
+		rl.rlim_cur = limit_mb << 20;
+		if( setrlimit( RLIMIT_AS, &rl ) != 0 ) { std::cerr<<"cannot set memory limit"<<std::endl; return 1; }
+		if( file_bytes > rl.rlim_cur )
+		{
+			void* whole = std::malloc( selected_bytes );
+			ok = ok && whole == nullptr;
+			std::free( whole );
+		}
+	}
+
+	auto reader = soatl::make_field_tile_reader( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz );
+	ok = ok && reader.open( filename, tile_size ) && reader.size() == N;
+	std::cout<<"N="<<N<<", file size="<<file_bytes/(1<<20)<<" MB, memory limit="<<limit_mb<<" MB, "
+	         <<reader.tile_count()<<" tiles of "<<reader.tile_size()<<" elements, kernel reads 6 of 7 fields"<<std::endl;
+
+	// tiles start where expected, and hold the expected values
+	ok = ok && reader.for_each_tile( [&ok,N](const decltype(reader)::TileT& tile, size_t first)
+		{
+			ok = ok && tile.size() > 0 && first + tile.size() <= N && tile[particle_rx][0] == field_value(first,0) && tile[particle_vz][tile.size()-1] == field_value(first+tile.size()-1,5);
+		} );
+
+	// one pass over the file, in GB/s of selected fields
+	auto stream = [&](bool cold, bool double_buffered)
+	{
+		if( cold ) { evict_file( filename ); }
+		double sum = 0.0;
+		auto t1 = std::chrono::high_resolution_clock::now();
+		ok = ok && reader.for_each_tile( [&sum](decltype(reader)::TileT& tile, size_t) { sum += analysis( tile ); }, double_buffered );
+		auto t2 = std::chrono::high_resolution_clock::now();
+		ok = ok && std::abs( sum - ref ) <= 1.e-9 * std::abs(ref);
+		return selected_bytes * 1.e-9 / std::chrono::duration<double>(t2-t1).count();
+	};
+
+	const double sequential_warm = stream(false,false), sequential_cold = stream(true,false);
+	const double double_buffered_warm = stream(false,true), double_buffered_cold = stream(true,true);
+	std::cout<<std::setw(20)<<"tile loading"<<std::setw(16)<<"warm (GB/s)"<<std::setw(16)<<"cold (GB/s)"<<std::endl<<std::fixed<<std::setprecision(3);
+	std::cout<<std::setw(20)<<"sequential"<<std::setw(16)<<sequential_warm<<std::setw(16)<<sequential_cold<<std::endl;
+	std::cout<<std::setw(20)<<"double buffered"<<std::setw(16)<<double_buffered_warm<<std::setw(16)<<double_buffered_cold<<std::endl;
+
+	// missing field is detected
+	{
+		auto other = soatl::make_field_tile_reader( particle_rx, particle_fx );
+		ok = ok && ! other.open( filename );
+	}
+
+	unlink( filename.c_str() );
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,123 @@
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <omp.h>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/field_arrays.h"
+#include "soatl/field_access.h"
+#include "soatl/compute.h"
+#include "soatl/copy.h"
+#include "soatl/instrument.h"
+
+#include "declare_fields.h"
+
+/*
+Cost of tracing (see trace.h) : built with and without SOATL_TRACE, the same small kernels are timed per call.
+With tracing, the cost of an empty traced scope is measured too, and the events of a short time step are checked
+and written to the file given as first argument.
+usage : soatltracebenchmark [trace file] [calls]
+*/
+
+using soatl::read;
+using soatl::write;
+using soatl::readwrite;
+
+template<typename FuncT>
+static inline double ns_per_call( size_t calls, FuncT func )
+{
+	auto t1 = std::chrono::steady_clock::now();
+	for(size_t i=0;i<calls;i++) { func(); }
+	return std::chrono::duration<double,std::nano>( std::chrono::steady_clock::now() - t1 ).count() / calls;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string filename = "trace_test.json";
+	size_t calls = 1000000;
+	if(argc>=2) { filename = argv[1]; }
+	if(argc>=3) { calls = atoi(argv[2]); }
+
+	auto cell = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_e );
+	auto copy = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_e );
+	bool ok = true;
+
+	// small kernels, where the cost of an event is most visible
+	cell.resize( 16 );
+	for(size_t i=0;i<16;i++) { cell[particle_rx][i] = i; cell[particle_ry][i] = 1.0; cell[particle_rz][i] = 2.0; }
+	const double apply_ns = ns_per_call( calls, [&]() { soatl::apply_simd( [](double x, double y, double z, double& e) { e = x*x + y*y + z*z; }, cell, particle_rx, particle_ry, particle_rz, particle_e ); } );
+	copy.resize( 16 );
+	const double copy_ns = ns_per_call( calls, [&]() { soatl::copy( copy, cell ); } );
+	ok = ok && copy[particle_e][15] == 15.0*15.0 + 1.0 + 4.0;
+
+#	ifdef SOATL_TRACE
+	std::cout << "tracing enabled, " << soatl::TraceBuffer::Capacity << " events per thread" << std::endl;
+	const double event_ns = ns_per_call( calls, []() { SOATL_TRACE_KERNEL("empty",0); } );
+	std::cout << "empty event : " << event_ns << " ns" << std::endl;
+#	else
+	std::cout << "tracing disabled" << std::endl;
+#	endif
+	std::cout << "apply_simd 16 elements : " << apply_ns << " ns/call" << std::endl;
+	std::cout << "copy 16 elements : " << copy_ns << " ns/call" << std::endl;
+
+#	ifdef SOATL_TRACE
+	// a short time step, checked event by event
+	soatl::trace_registry().clear();
+	const size_t N = 10000;
+	cell.resize( N );
+	soatl::apply_simd( [](double& x, double& y, double& z) { x = 1.0; y = 2.0; z = 3.0; }, cell, write(particle_rx), write(particle_ry), write(particle_rz) );
+	soatl::parallel_apply_simd( [](double x, double y, double z, double& e) { e = x*x + y*y + z*z; }, cell, particle_rx, particle_ry, particle_rz, particle_e );
+	copy.resize( N );
+	soatl::copy( copy, cell, particle_e );
+	soatl::parallel_copy( copy, cell );
+	size_t nthreads = 1;
+#	pragma omp parallel
+	{
+		const size_t T = omp_get_num_threads();
+		const size_t t = omp_get_thread_num();
+#		pragma omp single
+		nthreads = T;
+		const size_t first = ( N * t / T / 16 ) * 16;
+		const size_t last = ( t == T-1 ) ? N : ( N * (t+1) / T / 16 ) * 16;
+		soatl::apply( [](double& e) { e *= 0.5; }, first, last-first, cell, readwrite(particle_e) );
+	}
+	ok = ok && cell[particle_e][N-1] == 7.0 && copy[particle_rz][N-1] == 3.0;
+
+	// streaming stores, computed tile by tile : one event per driver call, not per tile
+	const size_t threshold = soatl::non_temporal_threshold();
+	soatl::non_temporal_threshold() = 0;
+	soatl::apply_simd( [](double& e, double x) { e = x; }, cell, write(particle_e), read(particle_rx) );
+	soatl::parallel_apply_simd( [](double& e, double x) { e = 2.0 * x; }, cell, write(particle_e), read(particle_rx) );
+	soatl::non_temporal_threshold() = threshold;
+	ok = ok && cell[particle_e][N-1] == 2.0;
+
+	// 2 reallocations, apply_simd, parallel_apply_simd, copy, parallel_copy, one apply per thread, 2 streamed kernels
+	const size_t expected = 8 + nthreads;
+	std::cout << soatl::trace_registry().event_count() << " events, " << expected << " expected" << std::endl;
+	ok = ok && soatl::trace_registry().event_count() == expected;
+
+	std::ostringstream json;
+	soatl::trace_registry().write_chrome_trace( json );
+	const std::string trace = json.str();
+	for(const char* e : { "\"name\":\"reallocate\"", "\"name\":\"apply_simd\"", "\"name\":\"parallel_apply_simd\"", "\"name\":\"copy\"", "\"name\":\"parallel_copy\"", "\"name\":\"apply\"",
+	                      "\"count\":10000,\"fields\":\"Particle position X,Particle position Y,Particle position Z\"",
+	                      "\"fields\":\"Particle energy\"" })
+	{
+		if( trace.find( e ) == std::string::npos ) { std::cerr << "missing " << e << std::endl; ok = false; }
+	}
+	ok = ok && soatl::trace_registry().write_chrome_trace( filename );
+	soatl::trace_registry().dump_at_exit = false;
+#	endif
+
+	cell.resize( 0 );
+	copy.resize( 0 );
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
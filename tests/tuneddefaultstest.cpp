@@ -0,0 +1,55 @@
+#include <iostream>
+#include <cstdint>
+#include <type_traits>
+
+#include "soatl/tuned_defaults.h"
+
+// as found in a header generated by soatlautotune
+SOATL_SET_TUNED_DEFAULTS(int16_t,128,32)
+SOATL_SET_TUNED_DEFAULTS(int8_t,16,2)
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/compute.h"
+
+#include "declare_fields.h"
+
+int main(int argc, char* argv[])
+{
+	size_t N = 1000;
+	if(argc>=2) { N = atoi(argv[1]); }
+
+	// tuned value type
+	auto tmp1 = soatl::make_field_arrays( particle_tmp1 );
+	static_assert( decltype(tmp1)::alignment() == 128 && decltype(tmp1)::chunksize() == 32 , "tuned defaults not used" );
+
+	// mixed fields take the largest alignment and chunk size
+	using DoubleDefaults = soatl::TunedDefaults<double>;
+	auto mixed = soatl::make_packed_field_arrays( particle_tmp2, particle_rx );
+	static_assert( decltype(mixed)::alignment() == std::max( size_t(16), DoubleDefaults::alignment ) , "wrong alignment" );
+	static_assert( decltype(mixed)::chunksize() == std::max( size_t(2), DoubleDefaults::chunksize ) , "wrong chunk size" );
+	static_assert( std::is_same< decltype(soatl::make_field_arrays(particle_rx,particle_ry)),
+	                             soatl::FieldArrays<DoubleDefaults::alignment,DoubleDefaults::chunksize,particle_rx_id,particle_ry_id> >::value , "wrong container type" );
+
+	bool ok = true;
+
+	tmp1.resize( N );
+	ok = ok && ( tmp1.capacity() % 32 ) == 0 && ( reinterpret_cast<size_t>( tmp1[particle_tmp1] ) % 128 ) == 0;
+	for(size_t i=0;i<N;i++) { tmp1[particle_tmp1][i] = i % 100; }
+	soatl::apply_simd( [](int16_t& x) { x = x * 2; }, tmp1, particle_tmp1 );
+	for(size_t i=0;i<N;i++) { ok = ok && tmp1[particle_tmp1][i] == int16_t( 2 * (i%100) ); }
+	tmp1.resize( 0 );
+
+	mixed.resize( N );
+	ok = ok && ( mixed.capacity() % decltype(mixed)::chunksize() ) == 0 && ( reinterpret_cast<size_t>( mixed[particle_rx] ) % decltype(mixed)::alignment() ) == 0;
+
+	std::cout << "int16_t : a=" << tmp1.alignment() << " c=" << tmp1.chunksize() << ", int8_t+double : a=" << mixed.alignment() << " c=" << mixed.chunksize() << std::endl;
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}
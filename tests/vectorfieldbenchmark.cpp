@@ -0,0 +1,116 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include "soatl/field_descriptor.h"
+#include "soatl/field_arrays.h"
+#include "soatl/packed_field_arrays.h"
+#include "soatl/compute.h"
+#include "soatl/vector_field.h"
+
+#include "declare_fields.h"
+#include "benchsuite.h"
+
+/*
+Vector fields (see vector_field.h) against the same kernels written with 3 scalar fields per vector.
+Results must be identical. The vecreport_* functions are compared instruction for instruction by the soatl_vectorfield_vecreport test
+(optimized builds with objdump), the vector field kernels must generate the same code as their scalar counterparts.
+usage : soatlvectorfieldbenchmark [N] [reps]
+*/
+
+using soatl::VecRef;
+
+static constexpr double dt = 0.001;
+
+template<typename CellT>
+__attribute__((noinline)) void vecreport_vector_fields( CellT& cell )
+{
+	soatl::apply_simd( [](VecRef<double,3> r, VecRef<double,3> v, double& e)
+	{
+		r += dt * v;
+		e = 0.5 * soatl::norm2( v ) + soatl::dot( r, r );
+	}
+	, cell, particle_r, particle_v, particle_e );
+}
+
+template<typename CellT>
+__attribute__((noinline)) void vecreport_scalar_fields( CellT& cell )
+{
+	soatl::apply_simd( [](double& rx, double& ry, double& rz, double vx, double vy, double vz, double& e)
+	{
+		rx += dt * vx;
+		ry += dt * vy;
+		rz += dt * vz;
+		e = 0.5 * ( vx*vx + vy*vy + vz*vz ) + ( rx*rx + ry*ry + rz*rz );
+	}
+	, cell, particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_e );
+}
+
+template<typename VecCellT, typename ScalarCellT>
+static inline bool run( const char* name, VecCellT& vcell, ScalarCellT& scell, size_t N, size_t reps )
+{
+	vcell.resize( N );
+	scell.resize( N );
+	auto r = soatl::vector_field( vcell, particle_r );
+	auto v = soatl::vector_field( vcell, particle_v );
+	for(size_t i=0;i<N;i++)
+	{
+		r[i] = soatl::Vec3<double>{ { i*0.5, i*0.25, -1.0*i } };
+		v[i] = soatl::Vec3<double>{ { 1.0, i*0.01, 2.0 } };
+		scell[particle_rx][i] = i*0.5; scell[particle_ry][i] = i*0.25; scell[particle_rz][i] = -1.0*i;
+		scell[particle_vx][i] = 1.0; scell[particle_vy][i] = i*0.01; scell[particle_vz][i] = 2.0;
+	}
+
+	const double tv = best_time( reps, [&]() { vecreport_vector_fields( vcell ); } );
+	const double ts = best_time( reps, [&]() { vecreport_scalar_fields( scell ); } );
+
+	// component stripes are scalar fields of the container
+	bool ok = ( reinterpret_cast<size_t>( vcell[ soatl::component<1>(particle_r) ] ) % vcell.alignment() ) == 0;
+	for(size_t i=0;i<N;i++)
+	{
+		ok = ok && r[i].x() == scell[particle_rx][i] && r[i].y() == scell[particle_ry][i] && r[i].z() == scell[particle_rz][i]
+		        && vcell[particle_e][i] == scell[particle_e][i];
+	}
+	std::cout<<name<<" : vector fields "<<tv*1.e3<<" ms, scalar fields "<<ts*1.e3<<" ms"<<std::endl;
+
+	vcell.resize( 0 );
+	scell.resize( 0 );
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t N = 1000003;
+	size_t reps = 5;
+	if(argc>=2) { N = atoll(argv[1]); }
+	if(argc>=3) { reps = atoi(argv[2]); }
+
+	bool ok = true;
+
+	auto vcell = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_r, particle_v, particle_e );
+	auto scell = soatl::make_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_e );
+	ok = run( "FieldArrays", vcell, scell, N, reps ) && ok;
+
+	auto vpcell = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_r, particle_v, particle_e );
+	auto spcell = soatl::make_packed_field_arrays( soatl::cst::align<64>(), soatl::cst::chunk<16>(), particle_rx, particle_ry, particle_rz, particle_vx, particle_vy, particle_vz, particle_e );
+	ok = run( "PackedFieldArrays", vpcell, spcell, N, reps ) && ok;
+
+	// other drivers, with default layout
+	auto cell = soatl::make_field_arrays( particle_r, particle_e );
+	static_assert( decltype(cell)::TupleSize == 4 , "vector field not expanded" );
+	cell.resize( N );
+	soatl::apply( [](VecRef<double,3> r, double& e) { r = soatl::Vec3<double>{ { 1.0, 2.0, 3.0 } }; e = 0.0; }, cell, particle_r, particle_e );
+	soatl::parallel_apply( [](VecRef<double,3> r) { r *= 2.0; }, 0, N/2, cell, particle_r );
+	soatl::parallel_apply_simd( [](VecRef<double,3> r, double& e) { e = soatl::dot( r, r ); }, cell, particle_r, particle_e );
+	ok = ok && cell[particle_e][0] == 56.0 && cell[particle_e][N-1] == 14.0;
+	ok = ok && std::string( soatl::FieldDescriptor< soatl::VectorComponent<particle_r_id,2> >::name() ) == "Particle position.z";
+	cell.resize( 0 );
+
+	if( ! ok )
+	{
+		std::cerr<<"wrong results"<<std::endl;
+		return 1;
+	}
+	return 0;
+}